@@ -80,6 +80,7 @@ void DemoWidget::SetupConnections()
     connect(insert_equation_action_, &QAction::triggered, this, &DemoWidget::OnInsertEquationRequest);
     connect(insert_equation_group_action_, &QAction::triggered, this, &DemoWidget::OnInsertEquationGroupRequest);
     connect(update_all_action_, &QAction::triggered, this, &DemoWidget::AsyncUpdateManager);
+    connect(lazy_evaluation_action_, &QAction::toggled, this, &DemoWidget::OnLazyEvaluationToggled);
     connect(show_dependency_graph_action_, &QAction::triggered, this, &DemoWidget::OnShowDependencyGraph);
     connect(show_equation_manager_action_, &QAction::triggered, this, &DemoWidget::OnShowEquationManager);
     connect(show_variable_inspector_action_, &QAction::triggered, this, &DemoWidget::OnShowEquationInspector);
@@ -95,13 +96,33 @@ void DemoWidget::SetupConnections()
     );
 
     connect(
-        expression_watch_widget_, &xequation::gui::ExpressionWatchWidget::EvalResultAsyncRequested, this,
-        &DemoWidget::OnEvalResultAsyncRequested
+        expression_watch_widget_, &xequation::gui::ExpressionWatchWidget::EvalResultsAsyncRequested, this,
+        &DemoWidget::OnEvalResultsAsyncRequested
     );
 
     connect(
-        dependency_graph_viewer_, &xequation::gui::EquationDependencyGraphViewer::DependencyGraphImageRequested, this,
-        &DemoWidget::OnEquationDependencyGraphImageRequested
+        expression_watch_widget_, &xequation::gui::ExpressionWatchWidget::EquationObserved, this,
+        &DemoWidget::OnEquationObserved
+    );
+
+    connect(
+        expression_watch_widget_, &xequation::gui::ExpressionWatchWidget::EquationUnobserved, this,
+        &DemoWidget::OnEquationUnobserved
+    );
+
+    connect(
+        variable_inspect_widget_, &xequation::gui::VariableInspectWidget::EquationObserved, this,
+        &DemoWidget::OnEquationObserved
+    );
+
+    connect(
+        variable_inspect_widget_, &xequation::gui::VariableInspectWidget::EquationUnobserved, this,
+        &DemoWidget::OnEquationUnobserved
+    );
+
+    connect(
+        dependency_graph_viewer_, &xequation::gui::EquationDependencyGraphViewer::DependencyGraphLayoutRequested, this,
+        &DemoWidget::OnEquationDependencyGraphLayoutRequested
     );
 
     connect(
@@ -221,6 +242,10 @@ void DemoWidget::CreateActions()
     update_all_action_ = new QAction("Update All Equations", this);
     update_all_action_->setStatusTip("Update all equations in the manager");
 
+    lazy_evaluation_action_ = new QAction("Lazy Evaluation", this);
+    lazy_evaluation_action_->setCheckable(true);
+    lazy_evaluation_action_->setStatusTip("Only compute equations that are watched or inspected");
+
     // View menu actions
     show_dependency_graph_action_ = new QAction("Dependency Graph", this);
     show_dependency_graph_action_->setStatusTip("Show equation dependency graph");
@@ -243,12 +268,19 @@ void DemoWidget::InitCompletionModel()
     }
     if (equation_completion_model_->language_name() == "Python")
     {
-        std::set<std::string> all_builtin_names = equation_manager_->context().GetBuiltinNames();
-        for (const auto &name : all_builtin_names)
+        std::shared_ptr<const std::unordered_set<std::string>> all_builtin_names =
+            equation_manager_->context().GetBuiltinNames();
+        if (!all_builtin_names)
+        {
+            return;
+        }
+        QList<gui::CompletionItem> items;
+        for (const auto &name : *all_builtin_names)
         {
             QString word = QString::fromStdString(name);
-            equation_completion_model_->AddCompletionItem(word, "Builtin", word);
+            items.append(gui::CompletionListModel::CreateCompletionItem(word, "Builtin", word));
         }
+        equation_completion_model_->AddCompletionItems(items);
     }
 }
 
@@ -265,6 +297,7 @@ void DemoWidget::CreateMenus()
     edit_menu_->addAction(insert_equation_action_);
     edit_menu_->addAction(insert_equation_group_action_);
     edit_menu_->addAction(update_all_action_);
+    edit_menu_->addAction(lazy_evaluation_action_);
 
     // View menu
     view_menu_ = menuBar()->addMenu("&View");
@@ -581,6 +614,54 @@ void DemoWidget::AsyncUpdateEquationsAfterRemoveGroup(const std::vector<std::str
     task_manager_->EnqueueTask(std::move(task));
 }
 
+void DemoWidget::AsyncRequestEquations(const std::vector<std::string> &equation_names)
+{
+    auto task = std::unique_ptr<xequation::gui::RequestEquationsTask>(new xequation::gui::RequestEquationsTask(
+        "Compute Requested Equations", equation_manager_.get(), equation_names
+    ));
+
+    task_manager_->EnqueueTask(std::move(task));
+}
+
+void DemoWidget::OnEquationObserved(const QString &equation_name)
+{
+    std::string name = equation_name.toStdString();
+    equation_manager_->ObserveEquation(name);
+    if (equation_manager_->evaluation_mode() == EvaluationMode::kLazy && equation_manager_->IsEquationExist(name))
+    {
+        AsyncRequestEquations({name});
+    }
+}
+
+void DemoWidget::OnEquationUnobserved(const QString &equation_name)
+{
+    equation_manager_->UnobserveEquation(equation_name.toStdString());
+}
+
+void DemoWidget::OnLazyEvaluationToggled(bool checked)
+{
+    if (!task_manager_->IsIdle())
+    {
+        QMessageBox::warning(
+            this, "Operation Locked",
+            "Cannot change the evaluation mode while updating equations. Please wait for the current operation to "
+            "complete.",
+            QMessageBox::Ok
+        );
+        lazy_evaluation_action_->blockSignals(true);
+        lazy_evaluation_action_->setChecked(!checked);
+        lazy_evaluation_action_->blockSignals(false);
+        return;
+    }
+
+    equation_manager_->SetEvaluationMode(checked ? EvaluationMode::kLazy : EvaluationMode::kEager);
+    // equations skipped while lazy are still dirty, catch up on them
+    if (!checked)
+    {
+        AsyncUpdateManager();
+    }
+}
+
 void DemoWidget::OnEquationGroupSelected(const xequation::EquationGroupId &id)
 {
     equation_browser_widget_->blockSignals(true);
@@ -667,27 +748,39 @@ void DemoWidget::OnParseResultRequested(const QString &expression, xequation::Pa
     result = equation_manager_->Parse(expression.toStdString(), xequation::ParseMode::kExpression);
 }
 
-void DemoWidget::OnEvalResultAsyncRequested(const QUuid& id, const QString& expression)
+void DemoWidget::OnEvalResultsAsyncRequested(const QVector<QUuid>& ids, const QStringList& expressions)
 {
-    gui::EvalExpressionTask *task =
-        new gui::EvalExpressionTask("Evaluate Expression", equation_manager_.get(), expression.toStdString());
+    std::vector<std::string> expression_list;
+    for (const auto &expression : expressions)
+    {
+        expression_list.push_back(expression.toStdString());
+    }
 
-    connect(task, &gui::EvalExpressionTask::EvalCompleted, this, [this, id](InterpretResult result) {
-        expression_watch_widget_->OnEvalResultSubmitted(id, result);
-    });
+    gui::EvalExpressionsTask *task =
+        new gui::EvalExpressionsTask("Evaluate Expressions", equation_manager_.get(), ids, expression_list);
+
+    connect(
+        task, &gui::EvalExpressionsTask::EvalsCompleted, this,
+        [this](QVector<QUuid> ids, std::vector<InterpretResult> results) {
+            expression_watch_widget_->OnEvalResultsSubmitted(ids, results);
+        }
+    );
 
-    task_manager_->EnqueueTask(std::unique_ptr<gui::EvalExpressionTask>(task));
+    task_manager_->EnqueueTask(std::unique_ptr<gui::EvalExpressionsTask>(task));
 }
 
-void DemoWidget::OnEquationDependencyGraphImageRequested()
+void DemoWidget::OnEquationDependencyGraphLayoutRequested()
 {
     gui::EquationDependencyGraphGenerationTask *task = new gui::EquationDependencyGraphGenerationTask(
-        "Generate Dependency Graph", equation_manager_.get()
+        "Generate Dependency Graph", equation_manager_.get(), dependency_graph_viewer_->layout(),
+        dependency_graph_viewer_->view_options()
     );
 
     connect(
-        task, &gui::EquationDependencyGraphGenerationTask::DependencyGraphImageGenerated, this,
-        [this](const QString &image_path) { dependency_graph_viewer_->OnDependencyGraphImageGenerated(image_path); }
+        task, &gui::EquationDependencyGraphGenerationTask::DependencyGraphLayoutGenerated, this,
+        [this](std::shared_ptr<const xequation::DependencyGraphLayout> layout) {
+            dependency_graph_viewer_->OnDependencyGraphLayoutGenerated(layout);
+        }
     );
 
     task_manager_->EnqueueTask(std::unique_ptr<gui::EquationDependencyGraphGenerationTask>(task));
@@ -46,8 +46,11 @@ private:
     void OnShowEquationInspector();
     void OnShowExpressionWatch();
     void OnParseResultRequested(const QString& expression, xequation::ParseResult &result);
-    void OnEvalResultAsyncRequested(const QUuid& id, const QString& expression);
-    void OnEquationDependencyGraphImageRequested();
+    void OnEvalResultsAsyncRequested(const QVector<QUuid>& ids, const QStringList& expressions);
+    void OnEquationDependencyGraphLayoutRequested();
+    void OnEquationObserved(const QString& equation_name);
+    void OnEquationUnobserved(const QString& equation_name);
+    void OnLazyEvaluationToggled(bool checked);
 
     bool AddEquationGroup(const std::string& statement);
     bool EditEquationGroup(const xequation::EquationGroupId& id, const std::string& statement);
@@ -57,6 +60,7 @@ private:
     void AsyncUpdateEquationGroup(const xequation::EquationGroupId& id);
     void AsyncUpdateManager();
     void AsyncUpdateEquationsAfterRemoveGroup(const std::vector<std::string>& equation_names);
+    void AsyncRequestEquations(const std::vector<std::string>& equation_names);
     
 private:
     void SetupUI();
@@ -75,6 +79,7 @@ private:
     QAction *insert_equation_action_;
     QAction *insert_equation_group_action_;
     QAction *update_all_action_;
+    QAction *lazy_evaluation_action_;
     QAction *show_dependency_graph_action_;
     QAction *show_equation_manager_action_;
     QAction *show_variable_inspector_action_;
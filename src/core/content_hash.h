@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace xequation
+{
+// 64-bit FNV-1a. Unlike std::hash the result is stable across runs and
+// platforms, so it can be persisted to disk.
+class ContentHasher
+{
+  public:
+    ContentHasher() : hash_(kOffsetBasis) {}
+
+    ContentHasher &Update(const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash_ ^= bytes[i];
+            hash_ *= kPrime;
+        }
+        return *this;
+    }
+
+    // length prefixed, so that ("ab", "c") and ("a", "bc") hash differently
+    ContentHasher &Update(const std::string &data)
+    {
+        Update(static_cast<uint64_t>(data.size()));
+        return Update(data.data(), data.size());
+    }
+
+    ContentHasher &Update(uint64_t data)
+    {
+        unsigned char bytes[8];
+        for (int i = 0; i < 8; i++)
+        {
+            bytes[i] = static_cast<unsigned char>(data >> (i * 8));
+        }
+        return Update(bytes, sizeof(bytes));
+    }
+
+    uint64_t value() const
+    {
+        return hash_;
+    }
+
+  private:
+    static constexpr uint64_t kOffsetBasis = 14695981039346656037ULL;
+    static constexpr uint64_t kPrime = 1099511628211ULL;
+
+    uint64_t hash_;
+};
+
+inline uint64_t ComputeContentHash(const std::string &data)
+{
+    return ContentHasher().Update(data).value();
+}
+} // namespace xequation
@@ -1,4 +1,5 @@
 #include "dependency_graph.h"
+#include "dependency_graph_exporter.h"
 #include <iostream>
 #include <queue>
 #include <string>
@@ -81,6 +82,11 @@ bool DependencyGraph::EndBatchUpdate()
     }
 
     batch_update_in_progress_ = false;
+    // the graph was acyclic before the batch and nothing changed
+    if (operation_stack_.empty())
+    {
+        return true;
+    }
     std::vector<std::string> cycle_path;
     if (CheckCycle(cycle_path))
     {
@@ -105,6 +111,11 @@ bool DependencyGraph::EndBatchUpdateNoThrow() noexcept
     }
 
     batch_update_in_progress_ = false;
+    // the graph was acyclic before the batch and nothing changed
+    if (operation_stack_.empty())
+    {
+        return true;
+    }
     std::vector<std::string> cycle_path;
     if (CheckCycle(cycle_path))
     {
@@ -270,6 +281,27 @@ bool DependencyGraph::RemoveEdges(const std::vector<Edge> &edge_list) noexcept
     return res;
 }
 
+bool DependencyGraph::AddEdgesWithoutCycleCheck(const std::vector<Edge> &edge_list)
+{
+    if (batch_update_in_progress_ == true)
+    {
+        return false;
+    }
+
+    bool res = true;
+    for (const Edge &edge : edge_list)
+    {
+        if (edge_container_.contains(edge) == true)
+        {
+            res = false;
+            continue;
+        }
+        edge_container_.insert(edge);
+        ActiveEdge(edge);
+    }
+    return res;
+}
+
 std::vector<std::string> DependencyGraph::TopologicalSort(const std::vector<std::string>& nodes) const
 {
     if (nodes.empty())
@@ -354,6 +386,83 @@ std::vector<std::string> DependencyGraph::TopologicalSort(const std::vector<std:
     return topo_order;
 }
 
+std::vector<std::string> DependencyGraph::TopologicalSortDependencies(const std::vector<std::string> &nodes) const
+{
+    if (nodes.empty())
+    {
+        return {};
+    }
+
+    // Kahn's Algorithm for specific nodes and their transitive dependencies
+    std::unordered_map<std::string, int> in_degree;
+    std::queue<std::string> zero_in_degree_queue;
+    std::vector<std::string> topo_order;
+
+    std::unordered_set<std::string> relevant_nodes;
+    std::queue<std::string> node_queue;
+
+    for (const auto &node : nodes)
+    {
+        if (node_map_.find(node) == node_map_.end() || relevant_nodes.count(node) != 0)
+        {
+            continue;
+        }
+        node_queue.push(node);
+        relevant_nodes.insert(node);
+    }
+
+    while (!node_queue.empty())
+    {
+        auto current_node = node_queue.front();
+        node_queue.pop();
+
+        for (const auto &dep : node_map_.at(current_node)->dependencies_)
+        {
+            if (relevant_nodes.find(dep) == relevant_nodes.end())
+            {
+                relevant_nodes.insert(dep);
+                node_queue.push(dep);
+            }
+        }
+    }
+
+    for (const auto &node_name : relevant_nodes)
+    {
+        // every dependency of a relevant node is relevant as well
+        in_degree[node_name] = static_cast<int>(node_map_.at(node_name)->dependencies_.size());
+
+        if (in_degree[node_name] == 0)
+        {
+            zero_in_degree_queue.push(node_name);
+        }
+    }
+
+    while (!zero_in_degree_queue.empty())
+    {
+        auto node_name = zero_in_degree_queue.front();
+        zero_in_degree_queue.pop();
+        topo_order.push_back(node_name);
+
+        for (const auto &dependent : node_map_.at(node_name)->dependents_)
+        {
+            if (relevant_nodes.find(dependent) != relevant_nodes.end())
+            {
+                if (--in_degree[dependent] == 0)
+                {
+                    zero_in_degree_queue.push(dependent);
+                }
+            }
+        }
+    }
+
+    if (topo_order.size() != relevant_nodes.size())
+    {
+        return {};
+    }
+
+    return topo_order;
+}
+
 std::vector<std::string> DependencyGraph::TopologicalSort(const std::string &node) const
 {
     if (node_map_.find(node) == node_map_.end())
@@ -464,6 +573,84 @@ std::vector<std::string> DependencyGraph::TopologicalSort() const
     return topo_order;
 }
 
+std::vector<std::string> DependencyGraph::GetNeighborhood(
+    const std::vector<std::string> &nodes, int upstream_hops, int downstream_hops) const
+{
+    std::vector<std::string> seeds;
+    std::unordered_set<std::string> visited;
+    for (const auto &node_name : nodes)
+    {
+        if (node_map_.count(node_name) != 0 && visited.insert(node_name).second)
+        {
+            seeds.push_back(node_name);
+        }
+    }
+
+    std::vector<std::string> result = seeds;
+
+    // breadth first from the seeds, one direction at a time
+    auto expand = [&](int hops, bool upstream) {
+        std::unordered_set<std::string> reached(seeds.begin(), seeds.end());
+        std::vector<std::string> frontier = seeds;
+        for (int hop = 0; (hops < 0 || hop < hops) && !frontier.empty(); hop++)
+        {
+            std::vector<std::string> next_frontier;
+            for (const auto &node_name : frontier)
+            {
+                const Node *node = node_map_.at(node_name).get();
+                for (const auto &neighbor : upstream ? node->dependencies_ : node->dependents_)
+                {
+                    if (reached.insert(neighbor).second)
+                    {
+                        next_frontier.push_back(neighbor);
+                        if (visited.insert(neighbor).second)
+                        {
+                            result.push_back(neighbor);
+                        }
+                    }
+                }
+            }
+            frontier.swap(next_frontier);
+        }
+    };
+
+    expand(upstream_hops, true);
+    expand(downstream_hops, false);
+    return result;
+}
+
+std::unique_ptr<DependencyGraph> DependencyGraph::ExtractSubgraph(const std::vector<std::string> &nodes) const
+{
+    std::unique_ptr<DependencyGraph> subgraph(new DependencyGraph());
+    std::unordered_set<std::string> node_set;
+    std::vector<std::string> node_list;
+    std::vector<Edge> edge_list;
+    for (const auto &node_name : nodes)
+    {
+        if (node_map_.count(node_name) != 0 && node_set.insert(node_name).second)
+        {
+            node_list.push_back(node_name);
+        }
+    }
+    for (const auto &node_name : node_list)
+    {
+        for (const auto &dependency : node_map_.at(node_name)->dependencies_)
+        {
+            if (node_set.count(dependency) != 0)
+            {
+                edge_list.emplace_back(node_name, dependency);
+            }
+        }
+    }
+
+    // a subgraph of an acyclic graph is acyclic, one batch is enough
+    BatchUpdateGuard guard(subgraph.get());
+    subgraph->AddNodes(node_list);
+    subgraph->AddEdges(edge_list);
+    guard.commit();
+    return subgraph;
+}
+
 void DependencyGraph::InvalidateNode(const std::string &node_name)
 {
     MakeNodeDirty(node_name, true, true);
@@ -496,6 +683,14 @@ void DependencyGraph::Traversal(std::function<void(const std::string &)> callbac
     }
 }
 
+void DependencyGraph::ForEachNode(const std::function<void(const std::string &, const Node &)> &callback) const
+{
+    for (const auto &entry : node_map_)
+    {
+        callback(entry.first, *entry.second);
+    }
+}
+
 void DependencyGraph::Reset()
 {
     node_map_.clear();
@@ -644,62 +839,21 @@ boost::signals2::scoped_connection DependencyGraph::ConnectNodeDependentChangedS
 
 bool DependencyGraph::WriteDotFile(const std::string &file_path, std::function<std::string(const std::string&)> node_label_handler) const
 {
-    std::ofstream ofs(file_path);
+    std::ofstream ofs(file_path, std::ios::binary);
     if (!ofs.is_open())
     {
         return false;
     }
 
-    ofs << "digraph DependencyGraph \n";
-    ofs << "{\n";
-    ofs << "  rankdir=TB;\n";
-    ofs << "  \n";
-
-    // Write all nodes with their labels
-    for (const auto &node_entry : node_map_)
+    DependencyGraphExporter exporter(DependencyGraphExporter::StreamSink(ofs));
+    exporter.SetDotNodeAttributes("shape=Mrecord");
+    if (node_label_handler)
     {
-        const std::string &node_name = node_entry.first;
-        std::string label;
-
-        // Use the provided label handler or default to node name
-        if (node_label_handler)
-        {
-            label = node_label_handler(node_name);
-        }
-        else
-        {
-            label = node_name;
-        }
-
-        // Escape quotes in the label for graphviz
-        for (auto &c : label)
-        {
-            if (c == '"')
-            {
-                c = '\''; // Replace quotes with single quotes to avoid escaping issues
+        exporter.SetNodeLabelHandler(
+            [&node_label_handler](const std::string &node_name, GraphExportFormat, std::string &label) {
+                label.append(node_label_handler(node_name));
             }
-        }
-
-        ofs << "  " << node_name << " [shape=Mrecord, label=\"" << label << "\"];\n";
+        );
     }
-
-    ofs << "  \n";
-
-    // Write all edges based on node dependents
-    for (const auto &node_entry : node_map_)
-    {
-        const std::string &node_name = node_entry.first;
-        const auto &node = node_entry.second;
-
-        // For each dependent of this node, create an edge from this node to the dependent
-        for (const auto &dependent : node->dependents())
-        {
-            ofs << "  " << node_name << " -> " << dependent << "\n";
-        }
-    }
-
-    ofs << "}\n";
-
-    ofs.close();
-    return true;
+    return exporter.Export(*this, GraphExportFormat::kDot);
 }
\ No newline at end of file
@@ -210,23 +210,38 @@ class DependencyGraph
     bool RemoveNodes(const std::vector<std::string> &node_list) noexcept;
     bool AddEdges(const std::vector<Edge> &edge_list);
     bool RemoveEdges(const std::vector<Edge> &edge_list) noexcept;
+    // Adds the edges even if they close cycles, for derived graphs that are
+    // only displayed (e.g. groups depending on each other). Not allowed during
+    // a batch update, TopologicalSort leaves out the nodes on a cycle.
+    bool AddEdgesWithoutCycleCheck(const std::vector<Edge> &edge_list);
 
     void InvalidateNode(const std::string &node_name);
     void MakeNodeDirty(const std::string& node_name, bool dirty, bool make_dependent = false);
     void Traversal(std::function<void(const std::string &)> callback) const;
+    // every node in unspecified order, cheaper than Traversal when order does not matter
+    void ForEachNode(const std::function<void(const std::string &, const Node &)> &callback) const;
     void Reset();
 
     // topological sort
     std::vector<std::string> TopologicalSort() const;
     std::vector<std::string> TopologicalSort(const std::string& node) const;
     std::vector<std::string> TopologicalSort(const std::vector<std::string>& nodes) const;
+    // the nodes and everything they depend on, instead of everything depending on them
+    std::vector<std::string> TopologicalSortDependencies(const std::vector<std::string>& nodes) const;
+
+    // the nodes plus everything within upstream_hops dependencies and
+    // downstream_hops dependents of them, a negative hop count is unlimited
+    std::vector<std::string> GetNeighborhood(
+        const std::vector<std::string> &nodes, int upstream_hops, int downstream_hops) const;
+    // copy of the given nodes and the edges between them
+    std::unique_ptr<DependencyGraph> ExtractSubgraph(const std::vector<std::string> &nodes) const;
 
     boost::signals2::scoped_connection ConnectNodeDependencyChangedSignal(
         const boost::signals2::signal<void(const std::string &)> ::slot_type &slot);
     boost::signals2::scoped_connection ConnectNodeDependentChangedSignal(
         const boost::signals2::signal<void(const std::string &)> ::slot_type &slot);
 
-    // write graphviz dot file
+    // write graphviz dot file, see DependencyGraphExporter for other formats
     bool WriteDotFile(const std::string &file_path, std::function<std::string(const std::string&)> node_label_handler = nullptr) const;
 
   private:
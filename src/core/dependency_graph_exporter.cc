@@ -0,0 +1,316 @@
+#include "dependency_graph_exporter.h"
+
+namespace xequation
+{
+namespace
+{
+struct EscapeTable
+{
+    const char *entries[256];
+};
+
+// quoted DOT strings: backslashes are left alone so record label escapes
+// such as \{ reach graphviz unchanged
+const char *const *GetDotEscapeTable()
+{
+    static const EscapeTable table = []() -> EscapeTable {
+        EscapeTable result = {};
+        result.entries[static_cast<unsigned char>('"')] = "\\\"";
+        result.entries[static_cast<unsigned char>('\n')] = "\\n";
+        result.entries[static_cast<unsigned char>('\r')] = "";
+        return result;
+    }();
+    return table.entries;
+}
+
+const char *const *GetJsonEscapeTable()
+{
+    static const EscapeTable table = []() -> EscapeTable {
+        static char control_escapes[32][7];
+        EscapeTable result = {};
+        for (int c = 0; c < 32; c++)
+        {
+            std::snprintf(control_escapes[c], sizeof(control_escapes[c]), "\\u%04x", c);
+            result.entries[c] = control_escapes[c];
+        }
+        result.entries[static_cast<unsigned char>('"')] = "\\\"";
+        result.entries[static_cast<unsigned char>('\\')] = "\\\\";
+        result.entries[static_cast<unsigned char>('\n')] = "\\n";
+        result.entries[static_cast<unsigned char>('\r')] = "\\r";
+        result.entries[static_cast<unsigned char>('\t')] = "\\t";
+        return result;
+    }();
+    return table.entries;
+}
+
+const char *const *GetXmlEscapeTable()
+{
+    static const EscapeTable table = []() -> EscapeTable {
+        EscapeTable result = {};
+        result.entries[static_cast<unsigned char>('&')] = "&amp;";
+        result.entries[static_cast<unsigned char>('<')] = "&lt;";
+        result.entries[static_cast<unsigned char>('>')] = "&gt;";
+        result.entries[static_cast<unsigned char>('"')] = "&quot;";
+        result.entries[static_cast<unsigned char>('\'')] = "&apos;";
+        return result;
+    }();
+    return table.entries;
+}
+} // namespace
+
+DependencyGraphExporter::DependencyGraphExporter(Sink sink, size_t buffer_size)
+    : sink_(sink), buffer_size_(buffer_size == 0 ? kDefaultBufferSize : buffer_size)
+{
+    buffer_.reserve(buffer_size_);
+}
+
+DependencyGraphExporter::Sink DependencyGraphExporter::FileSink(std::FILE *file)
+{
+    return [file](const char *data, size_t size) { return std::fwrite(data, 1, size, file) == size; };
+}
+
+DependencyGraphExporter::Sink DependencyGraphExporter::StreamSink(std::ostream &stream)
+{
+    return [&stream](const char *data, size_t size) -> bool {
+        stream.write(data, static_cast<std::streamsize>(size));
+        return !stream.fail();
+    };
+}
+
+DependencyGraphExporter::Sink DependencyGraphExporter::StringSink(std::string &output)
+{
+    return [&output](const char *data, size_t size) -> bool {
+        output.append(data, size);
+        return true;
+    };
+}
+
+bool DependencyGraphExporter::Export(const DependencyGraph &graph, GraphExportFormat format)
+{
+    buffer_.clear();
+    failed_ = false;
+
+    // run the filter once per node instead of once per edge end
+    accepted_nodes_.clear();
+    if (node_filter_)
+    {
+        graph.ForEachNode([this](const std::string &node_name, const DependencyGraph::Node &) {
+            if (node_filter_(node_name))
+            {
+                accepted_nodes_.insert(node_name);
+            }
+        });
+    }
+
+    bool result = false;
+    switch (format)
+    {
+    case GraphExportFormat::kDot:
+        result = ExportDot(graph);
+        break;
+    case GraphExportFormat::kJson:
+        result = ExportJson(graph);
+        break;
+    case GraphExportFormat::kGraphML:
+        result = ExportGraphML(graph);
+        break;
+    }
+
+    accepted_nodes_.clear();
+    return Flush() && result && !failed_;
+}
+
+bool DependencyGraphExporter::ExportDot(const DependencyGraph &graph)
+{
+    const char *const *escape_table = GetDotEscapeTable();
+
+    Append("digraph DependencyGraph\n{\n  rankdir=TB;\n\n");
+    graph.ForEachNode([&](const std::string &node_name, const DependencyGraph::Node &) {
+        if (failed_ || !IsNodeAccepted(node_name))
+        {
+            return;
+        }
+        Append("  \"");
+        AppendEscaped(node_name, escape_table);
+        Append("\" [");
+        if (!dot_node_attributes_.empty())
+        {
+            Append(dot_node_attributes_);
+            Append(", ");
+        }
+        Append("label=\"");
+        AppendEscaped(GetLabel(node_name, GraphExportFormat::kDot), escape_table);
+        Append("\"];\n");
+    });
+
+    Append("\n");
+    graph.ForEachNode([&](const std::string &node_name, const DependencyGraph::Node &node) {
+        if (failed_ || !IsNodeAccepted(node_name))
+        {
+            return;
+        }
+        for (const auto &dependent : node.dependents())
+        {
+            if (!IsNodeAccepted(dependent))
+            {
+                continue;
+            }
+            Append("  \"");
+            AppendEscaped(node_name, escape_table);
+            Append("\" -> \"");
+            AppendEscaped(dependent, escape_table);
+            Append("\";\n");
+        }
+    });
+    Append("}\n");
+    return true;
+}
+
+bool DependencyGraphExporter::ExportJson(const DependencyGraph &graph)
+{
+    const char *const *escape_table = GetJsonEscapeTable();
+
+    // adjacency list: every node with the nodes depending on it
+    Append("{\"directed\":true,\"nodes\":[");
+    bool first_node = true;
+    graph.ForEachNode([&](const std::string &node_name, const DependencyGraph::Node &node) {
+        if (failed_ || !IsNodeAccepted(node_name))
+        {
+            return;
+        }
+        Append(first_node ? "\n{\"id\":\"" : ",\n{\"id\":\"");
+        first_node = false;
+        AppendEscaped(node_name, escape_table);
+        Append("\",\"label\":\"");
+        AppendEscaped(GetLabel(node_name, GraphExportFormat::kJson), escape_table);
+        Append("\",\"dependents\":[");
+        bool first_dependent = true;
+        for (const auto &dependent : node.dependents())
+        {
+            if (!IsNodeAccepted(dependent))
+            {
+                continue;
+            }
+            Append(first_dependent ? "\"" : ",\"");
+            first_dependent = false;
+            AppendEscaped(dependent, escape_table);
+            Append("\"");
+        }
+        Append("]}");
+    });
+    Append("\n]}\n");
+    return true;
+}
+
+bool DependencyGraphExporter::ExportGraphML(const DependencyGraph &graph)
+{
+    const char *const *escape_table = GetXmlEscapeTable();
+
+    Append(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+        "  <key id=\"label\" for=\"node\" attr.name=\"label\" attr.type=\"string\"/>\n"
+        "  <graph id=\"DependencyGraph\" edgedefault=\"directed\">\n"
+    );
+    graph.ForEachNode([&](const std::string &node_name, const DependencyGraph::Node &) {
+        if (failed_ || !IsNodeAccepted(node_name))
+        {
+            return;
+        }
+        Append("    <node id=\"");
+        AppendEscaped(node_name, escape_table);
+        Append("\"><data key=\"label\">");
+        AppendEscaped(GetLabel(node_name, GraphExportFormat::kGraphML), escape_table);
+        Append("</data></node>\n");
+    });
+    graph.ForEachNode([&](const std::string &node_name, const DependencyGraph::Node &node) {
+        if (failed_ || !IsNodeAccepted(node_name))
+        {
+            return;
+        }
+        for (const auto &dependent : node.dependents())
+        {
+            if (!IsNodeAccepted(dependent))
+            {
+                continue;
+            }
+            Append("    <edge source=\"");
+            AppendEscaped(node_name, escape_table);
+            Append("\" target=\"");
+            AppendEscaped(dependent, escape_table);
+            Append("\"/>\n");
+        }
+    });
+    Append("  </graph>\n</graphml>\n");
+    return true;
+}
+
+bool DependencyGraphExporter::IsNodeAccepted(const std::string &node_name) const
+{
+    return !node_filter_ || accepted_nodes_.count(node_name) != 0;
+}
+
+const std::string &DependencyGraphExporter::GetLabel(const std::string &node_name, GraphExportFormat format)
+{
+    label_.clear();
+    if (node_label_handler_)
+    {
+        node_label_handler_(node_name, format, label_);
+    }
+    else
+    {
+        label_.append(node_name);
+    }
+    return label_;
+}
+
+void DependencyGraphExporter::Append(const char *data, size_t size)
+{
+    if (buffer_.size() + size > buffer_size_)
+    {
+        Flush();
+        if (size > buffer_size_)
+        {
+            // larger than the whole buffer, hand it over directly
+            if (!failed_ && sink_ && !sink_(data, size))
+            {
+                failed_ = true;
+            }
+            return;
+        }
+    }
+    buffer_.append(data, size);
+}
+
+void DependencyGraphExporter::AppendEscaped(const std::string &data, const char *const *escape_table)
+{
+    // copy unescaped runs in one go
+    const char *begin = data.data();
+    const char *end = begin + data.size();
+    const char *run = begin;
+    for (const char *p = begin; p != end; ++p)
+    {
+        const char *replacement = escape_table[static_cast<unsigned char>(*p)];
+        if (replacement)
+        {
+            Append(run, p - run);
+            Append(replacement);
+            run = p + 1;
+        }
+    }
+    Append(run, end - run);
+}
+
+bool DependencyGraphExporter::Flush()
+{
+    if (!buffer_.empty())
+    {
+        if (!failed_ && sink_ && !sink_(buffer_.data(), buffer_.size()))
+        {
+            failed_ = true;
+        }
+        buffer_.clear();
+    }
+    return !failed_;
+}
+} // namespace xequation
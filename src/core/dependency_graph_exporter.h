@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+
+#include "dependency_graph.h"
+
+namespace xequation
+{
+enum class GraphExportFormat
+{
+    kDot,
+    kJson,
+    kGraphML,
+};
+
+// Streams a DependencyGraph as DOT, JSON adjacency list or GraphML.
+//
+// Output goes through one reusable buffer which is handed to the sink when
+// full, so the sink can be a file, a pipe or memory. Escaping is table
+// driven. Edges run from a dependency to its dependents, like WriteDotFile.
+class DependencyGraphExporter
+{
+  public:
+    static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+    // returns false to abort the export
+    using Sink = std::function<bool(const char *data, size_t size)>;
+    // nodes rejected by the filter are skipped together with their edges
+    using NodeFilter = std::function<bool(const std::string &node_name)>;
+    // appends the label of a node to label, which is cleared before each call
+    using NodeLabelHandler =
+        std::function<void(const std::string &node_name, GraphExportFormat format, std::string &label)>;
+
+    explicit DependencyGraphExporter(Sink sink, size_t buffer_size = kDefaultBufferSize);
+    ~DependencyGraphExporter() = default;
+
+    DependencyGraphExporter(const DependencyGraphExporter &) = delete;
+    DependencyGraphExporter &operator=(const DependencyGraphExporter &) = delete;
+
+    void SetNodeFilter(NodeFilter node_filter)
+    {
+        node_filter_ = node_filter;
+    }
+
+    void SetNodeLabelHandler(NodeLabelHandler node_label_handler)
+    {
+        node_label_handler_ = node_label_handler;
+    }
+
+    // written verbatim inside the brackets of every DOT node, e.g. "shape=Mrecord"
+    void SetDotNodeAttributes(const std::string &attributes)
+    {
+        dot_node_attributes_ = attributes;
+    }
+
+    bool Export(const DependencyGraph &graph, GraphExportFormat format);
+
+    static Sink FileSink(std::FILE *file);
+    static Sink StreamSink(std::ostream &stream);
+    static Sink StringSink(std::string &output);
+
+  private:
+    bool ExportDot(const DependencyGraph &graph);
+    bool ExportJson(const DependencyGraph &graph);
+    bool ExportGraphML(const DependencyGraph &graph);
+
+    bool IsNodeAccepted(const std::string &node_name) const;
+    const std::string &GetLabel(const std::string &node_name, GraphExportFormat format);
+
+    void Append(const char *data, size_t size);
+    void Append(const std::string &data)
+    {
+        Append(data.data(), data.size());
+    }
+    void Append(const char *data)
+    {
+        Append(data, std::strlen(data));
+    }
+    // escape_table maps a byte to its replacement, nullptr keeps the byte
+    void AppendEscaped(const std::string &data, const char *const *escape_table);
+    bool Flush();
+
+    Sink sink_;
+    NodeFilter node_filter_;
+    NodeLabelHandler node_label_handler_;
+    std::string dot_node_attributes_;
+
+    std::string buffer_;
+    size_t buffer_size_;
+    bool failed_{false};
+    std::string label_;
+    std::unordered_set<std::string> accepted_nodes_;
+};
+} // namespace xequation
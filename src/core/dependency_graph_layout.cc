@@ -0,0 +1,411 @@
+#include "dependency_graph_layout.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+namespace xequation
+{
+namespace
+{
+// a real node or a virtual node splitting a long edge
+struct Vertex
+{
+    int node;
+    int layer;
+    double width;
+    double key;
+    double x;
+    std::vector<int> upper;
+    std::vector<int> lower;
+};
+
+double Average(const std::vector<int> &neighbors, const std::vector<double> &values)
+{
+    double sum = 0;
+    for (int neighbor : neighbors)
+    {
+        sum += values[neighbor];
+    }
+    return sum / neighbors.size();
+}
+
+// order vertices of one layer by the barycenter of their neighbours in the
+// adjacent layer, vertices without neighbours keep their position
+void SortByBarycenter(
+    std::vector<int> &layer, std::vector<Vertex> &vertices, std::vector<double> &positions, bool use_upper
+)
+{
+    for (int v : layer)
+    {
+        const auto &neighbors = use_upper ? vertices[v].upper : vertices[v].lower;
+        vertices[v].key = neighbors.empty() ? positions[v] : Average(neighbors, positions);
+    }
+    std::stable_sort(layer.begin(), layer.end(), [&vertices](int lhs, int rhs) {
+        return vertices[lhs].key < vertices[rhs].key;
+    });
+    for (size_t i = 0; i < layer.size(); i++)
+    {
+        positions[layer[i]] = static_cast<double>(i);
+    }
+}
+
+// move vertices towards the average x of their neighbours while keeping the
+// order and the minimum separation; averaging a left-to-right and a
+// right-to-left packing avoids drifting to one side
+void BalanceLayer(const std::vector<int> &layer, std::vector<Vertex> &vertices, bool use_upper, double spacing)
+{
+    size_t count = layer.size();
+    if (count == 0)
+    {
+        return;
+    }
+
+    std::vector<double> desired(count);
+    std::vector<double> xs(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        xs[i] = vertices[layer[i]].x;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex &vertex = vertices[layer[i]];
+        const auto &neighbors = use_upper ? vertex.upper : vertex.lower;
+        if (neighbors.empty())
+        {
+            desired[i] = vertex.x;
+            continue;
+        }
+        double sum = 0;
+        for (int neighbor : neighbors)
+        {
+            sum += vertices[neighbor].x;
+        }
+        desired[i] = sum / neighbors.size();
+    }
+
+    auto separation = [&](size_t left, size_t right) {
+        return (vertices[layer[left]].width + vertices[layer[right]].width) / 2 + spacing;
+    };
+
+    std::vector<double> left_packed(count);
+    std::vector<double> right_packed(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        left_packed[i] = i == 0 ? desired[i] : std::max(desired[i], left_packed[i - 1] + separation(i - 1, i));
+    }
+    for (size_t i = count; i-- > 0;)
+    {
+        right_packed[i] =
+            i + 1 == count ? desired[i] : std::min(desired[i], right_packed[i + 1] - separation(i, i + 1));
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        vertices[layer[i]].x = (left_packed[i] + right_packed[i]) / 2;
+    }
+}
+} // namespace
+
+void DependencyGraphLayout::Compute(
+    const DependencyGraph &graph, std::function<std::string(const std::string &)> node_label_handler
+)
+{
+    // previous positions seed the order, so unchanged parts of the graph stay put
+    std::unordered_map<std::string, double> previous_x;
+    for (const auto &node : nodes_)
+    {
+        previous_x[node.name] = node.x;
+    }
+    bool seeded = !previous_x.empty();
+
+    nodes_.clear();
+    edges_.clear();
+    node_index_map_.clear();
+    width_ = 0;
+    height_ = 0;
+    layer_count_ = 0;
+
+    // dependencies come before their dependents, nodes on a cycle (possible
+    // in views collapsing groups) follow by name
+    std::vector<std::string> order = graph.TopologicalSort();
+    std::unordered_set<std::string> ordered(order.begin(), order.end());
+    std::vector<std::string> cyclic;
+    graph.ForEachNode([&](const std::string &name, const DependencyGraph::Node &) {
+        if (ordered.count(name) == 0)
+        {
+            cyclic.push_back(name);
+        }
+    });
+    std::sort(cyclic.begin(), cyclic.end());
+    order.insert(order.end(), cyclic.begin(), cyclic.end());
+    nodes_.reserve(order.size());
+    for (const auto &name : order)
+    {
+        NodeLayout node;
+        node.name = name;
+        node.label = node_label_handler ? node_label_handler(name) : name;
+        node.layer = 0;
+        node.x = 0;
+        node.y = 0;
+
+        size_t line_count = 1;
+        size_t line_length = 0;
+        size_t max_line_length = 0;
+        for (char c : node.label)
+        {
+            if (c == '\n')
+            {
+                line_count++;
+                line_length = 0;
+                continue;
+            }
+            max_line_length = std::max(max_line_length, ++line_length);
+        }
+        node.width = std::max(options_.min_node_width, max_line_length * options_.char_width + 2 * options_.node_padding);
+        node.height = line_count * options_.line_height + 2 * options_.node_padding;
+
+        node_index_map_[name] = nodes_.size();
+        nodes_.push_back(std::move(node));
+    }
+
+    // an edge goes down from the earlier node in the order to the later one,
+    // only edges closing a cycle are drawn from a dependent to its dependency
+    std::vector<std::vector<size_t>> upper_nodes(nodes_.size());
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        for (const auto &dependency : graph.GetNode(nodes_[i].name)->dependencies())
+        {
+            auto it = node_index_map_.find(dependency);
+            if (it == node_index_map_.end())
+            {
+                continue;
+            }
+            if (it->second < i)
+            {
+                upper_nodes[i].push_back(it->second);
+            }
+            else
+            {
+                upper_nodes[it->second].push_back(i);
+            }
+        }
+    }
+
+    // longest path layering
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        for (size_t upper : upper_nodes[i])
+        {
+            nodes_[i].layer = std::max(nodes_[i].layer, nodes_[upper].layer + 1);
+        }
+        layer_count_ = std::max(layer_count_, nodes_[i].layer + 1);
+    }
+
+    std::vector<Vertex> vertices;
+    vertices.reserve(nodes_.size());
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        vertices.push_back(Vertex{static_cast<int>(i), nodes_[i].layer, nodes_[i].width, 0, 0, {}, {}});
+    }
+
+    // split edges spanning several layers, chains are kept for routing
+    std::vector<std::vector<int>> edge_chains;
+    std::vector<bool> edge_reversed;
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        for (const auto &dependency : graph.GetNode(nodes_[i].name)->dependencies())
+        {
+            auto it = node_index_map_.find(dependency);
+            if (it == node_index_map_.end())
+            {
+                continue;
+            }
+            bool reversed = it->second > i;
+            int upper = static_cast<int>(reversed ? i : it->second);
+            int lower = static_cast<int>(reversed ? it->second : i);
+
+            std::vector<int> chain{upper};
+            for (int layer = nodes_[upper].layer + 1; layer < nodes_[lower].layer; layer++)
+            {
+                vertices.push_back(Vertex{-1, layer, 0, 0, 0, {}, {}});
+                chain.push_back(static_cast<int>(vertices.size() - 1));
+            }
+            chain.push_back(lower);
+            for (size_t j = 0; j + 1 < chain.size(); j++)
+            {
+                vertices[chain[j]].lower.push_back(chain[j + 1]);
+                vertices[chain[j + 1]].upper.push_back(chain[j]);
+            }
+
+            EdgeLayout edge;
+            edge.from = nodes_[i].name;
+            edge.to = dependency;
+            edges_.push_back(std::move(edge));
+            edge_chains.push_back(std::move(chain));
+            edge_reversed.push_back(reversed);
+        }
+    }
+
+    std::vector<std::vector<int>> layers(layer_count_);
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        layers[vertices[v].layer].push_back(static_cast<int>(v));
+    }
+
+    // initial order: previous x for known nodes, otherwise the barycenter of
+    // the upper neighbours, new roots go to the right
+    double next_free_key = 0;
+    for (const auto &entry : previous_x)
+    {
+        next_free_key = std::max(next_free_key, entry.second + options_.node_spacing);
+    }
+    for (auto &layer : layers)
+    {
+        for (int v : layer)
+        {
+            Vertex &vertex = vertices[v];
+            auto it = vertex.node >= 0 ? previous_x.find(nodes_[vertex.node].name) : previous_x.end();
+            if (it != previous_x.end())
+            {
+                vertex.key = it->second;
+            }
+            else if (!vertex.upper.empty())
+            {
+                double sum = 0;
+                for (int neighbor : vertex.upper)
+                {
+                    sum += vertices[neighbor].key;
+                }
+                vertex.key = sum / vertex.upper.size();
+            }
+            else
+            {
+                vertex.key = next_free_key;
+                next_free_key += options_.node_spacing;
+            }
+        }
+        std::stable_sort(layer.begin(), layer.end(), [&vertices](int lhs, int rhs) {
+            return vertices[lhs].key < vertices[rhs].key;
+        });
+    }
+
+    std::vector<double> positions(vertices.size());
+    for (const auto &layer : layers)
+    {
+        for (size_t i = 0; i < layer.size(); i++)
+        {
+            positions[layer[i]] = static_cast<double>(i);
+        }
+    }
+
+    // crossing reduction, a seeded order is already close to its final state
+    int sweeps = seeded ? std::min(1, options_.crossing_sweeps) : options_.crossing_sweeps;
+    for (int sweep = 0; sweep < sweeps; sweep++)
+    {
+        for (size_t l = 1; l < layers.size(); l++)
+        {
+            SortByBarycenter(layers[l], vertices, positions, true);
+        }
+        for (size_t l = layers.size(); l-- > 1;)
+        {
+            SortByBarycenter(layers[l - 1], vertices, positions, false);
+        }
+    }
+
+    // x coordinates: pack each layer, then pull vertices towards their neighbours
+    for (const auto &layer : layers)
+    {
+        double x = 0;
+        for (size_t i = 0; i < layer.size(); i++)
+        {
+            Vertex &vertex = vertices[layer[i]];
+            if (i > 0)
+            {
+                x += (vertices[layer[i - 1]].width + vertex.width) / 2 + options_.node_spacing;
+            }
+            vertex.x = x;
+        }
+    }
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t l = 1; l < layers.size(); l++)
+        {
+            BalanceLayer(layers[l], vertices, true, options_.node_spacing);
+        }
+        for (size_t l = layers.size(); l-- > 1;)
+        {
+            BalanceLayer(layers[l - 1], vertices, false, options_.node_spacing);
+        }
+    }
+
+    double min_x = std::numeric_limits<double>::max();
+    double max_x = std::numeric_limits<double>::lowest();
+    for (const auto &vertex : vertices)
+    {
+        min_x = std::min(min_x, vertex.x - vertex.width / 2);
+        max_x = std::max(max_x, vertex.x + vertex.width / 2);
+    }
+    if (vertices.empty())
+    {
+        min_x = max_x = 0;
+    }
+
+    // y coordinates: each layer is as tall as its tallest node
+    std::vector<double> layer_top(layers.size());
+    std::vector<double> layer_height(layers.size(), 0);
+    for (const auto &node : nodes_)
+    {
+        layer_height[node.layer] = std::max(layer_height[node.layer], node.height);
+    }
+    double y = 0;
+    for (size_t l = 0; l < layers.size(); l++)
+    {
+        layer_top[l] = y;
+        y += layer_height[l] + options_.layer_spacing;
+    }
+
+    for (const auto &vertex : vertices)
+    {
+        if (vertex.node < 0)
+        {
+            continue;
+        }
+        NodeLayout &node = nodes_[vertex.node];
+        node.x = vertex.x - min_x;
+        node.y = layer_top[node.layer] + layer_height[node.layer] / 2;
+    }
+
+    for (size_t i = 0; i < edges_.size(); i++)
+    {
+        const auto &chain = edge_chains[i];
+        const NodeLayout &upper = nodes_[vertices[chain.front()].node];
+        const NodeLayout &lower = nodes_[vertices[chain.back()].node];
+        auto &points = edges_[i].points;
+        points.reserve(chain.size());
+        points.push_back(Point{upper.x, upper.y + upper.height / 2});
+        for (size_t j = 1; j + 1 < chain.size(); j++)
+        {
+            const Vertex &vertex = vertices[chain[j]];
+            points.push_back(Point{vertex.x - min_x, layer_top[vertex.layer] + layer_height[vertex.layer] / 2});
+        }
+        points.push_back(Point{lower.x, lower.y - lower.height / 2});
+        if (edge_reversed[i])
+        {
+            std::reverse(points.begin(), points.end());
+        }
+    }
+
+    width_ = max_x - min_x;
+    height_ = layers.empty() ? 0 : y - options_.layer_spacing;
+}
+
+const DependencyGraphLayout::NodeLayout *DependencyGraphLayout::GetNode(const std::string &node_name) const
+{
+    auto it = node_index_map_.find(node_name);
+    if (it == node_index_map_.end())
+    {
+        return nullptr;
+    }
+    return &nodes_[it->second];
+}
+} // namespace xequation
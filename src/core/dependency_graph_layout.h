@@ -0,0 +1,115 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dependency_graph.h"
+
+namespace xequation
+{
+// Layered (Sugiyama style) drawing of a DependencyGraph.
+//
+// Dependencies are placed above their dependents: nodes are assigned to
+// layers by longest path, long edges are split by virtual nodes, crossings
+// are reduced with barycenter sweeps and x coordinates are balanced between
+// neighbours. Compute() seeds the node order with the coordinates of the
+// previous run, so a small edit only moves the nodes around it.
+class DependencyGraphLayout
+{
+  public:
+    struct Options
+    {
+        double char_width = 7.0;
+        double line_height = 16.0;
+        double node_padding = 8.0;
+        double min_node_width = 40.0;
+        double node_spacing = 24.0;
+        double layer_spacing = 60.0;
+        int crossing_sweeps = 4;
+    };
+
+    struct Point
+    {
+        double x;
+        double y;
+    };
+
+    struct NodeLayout
+    {
+        std::string name;
+        std::string label;
+        int layer;
+        // center of the node
+        double x;
+        double y;
+        double width;
+        double height;
+    };
+
+    // Edge from the DependencyGraph::Edge point of view: from depends on to.
+    // points run from to (the dependency) to from, normally from the bottom
+    // of to to the top of from. An edge closing a cycle points upwards.
+    struct EdgeLayout
+    {
+        std::string from;
+        std::string to;
+        std::vector<Point> points;
+    };
+
+    DependencyGraphLayout() = default;
+    explicit DependencyGraphLayout(const Options &options) : options_(options) {}
+    ~DependencyGraphLayout() = default;
+
+    DependencyGraphLayout(const DependencyGraphLayout &) = default;
+    DependencyGraphLayout &operator=(const DependencyGraphLayout &) = default;
+    DependencyGraphLayout(DependencyGraphLayout &&) = default;
+    DependencyGraphLayout &operator=(DependencyGraphLayout &&) = default;
+
+    // label lines are separated by '\n', the node size follows the label
+    void Compute(
+        const DependencyGraph &graph, std::function<std::string(const std::string &)> node_label_handler = nullptr
+    );
+
+    const NodeLayout *GetNode(const std::string &node_name) const;
+
+    const std::vector<NodeLayout> &nodes() const
+    {
+        return nodes_;
+    }
+
+    const std::vector<EdgeLayout> &edges() const
+    {
+        return edges_;
+    }
+
+    double width() const
+    {
+        return width_;
+    }
+
+    double height() const
+    {
+        return height_;
+    }
+
+    int layer_count() const
+    {
+        return layer_count_;
+    }
+
+    const Options &options() const
+    {
+        return options_;
+    }
+
+  private:
+    Options options_;
+    std::vector<NodeLayout> nodes_;
+    std::vector<EdgeLayout> edges_;
+    std::unordered_map<std::string, size_t> node_index_map_;
+    double width_{0};
+    double height_{0};
+    int layer_count_{0};
+};
+} // namespace xequation
@@ -48,6 +48,24 @@ class Equation
         message_ = message;
     }
 
+    // details of the error of the last update, null if there is none or the
+    // engine does not capture them
+    void set_error(std::shared_ptr<const ErrorRecord> error)
+    {
+        error_ = std::move(error);
+    }
+
+    // the failed equation a kUpstreamError status goes back to
+    void set_root_cause(const std::string &root_cause)
+    {
+        root_cause_ = root_cause;
+    }
+
+    void set_cacheable(bool cacheable)
+    {
+        cacheable_ = cacheable;
+    }
+
     const std::string &name() const
     {
         return name_;
@@ -73,6 +91,21 @@ class Equation
         return message_;
     }
 
+    const std::shared_ptr<const ErrorRecord> &error() const
+    {
+        return error_;
+    }
+
+    const std::string &root_cause() const
+    {
+        return root_cause_;
+    }
+
+    bool cacheable() const
+    {
+        return cacheable_;
+    }
+
     const EquationManager *manager() const
     {
         return manager_;
@@ -96,7 +129,10 @@ class Equation
     ItemType type_;
     ResultStatus status_;
     std::string message_;
+    std::shared_ptr<const ErrorRecord> error_;
+    std::string root_cause_;
     EquationGroupId group_id_;
+    bool cacheable_ = true;
     EquationManager *manager_ = nullptr;
 };
 
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <exception>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -29,7 +31,11 @@ enum class ResultStatus
     kKeyError,
     kAttributeError,
     kKeyBoardInterrupt,
-    kUnknownError
+    kUnknownError,
+    // snapshots store the values, new statuses are added from here on
+    kTimeout,
+    // not interpreted because an equation it depends on failed
+    kUpstreamError
 };
 
 enum class InterpretMode
@@ -38,12 +44,77 @@ enum class InterpretMode
     kEval
 };
 
+enum class EvaluationMode
+{
+    kEager,
+    kLazy,
+};
+
+// Limits of a single interpret call, 0 is unlimited. Calls over the wall
+// time end with ResultStatus::kTimeout, calls over the memory limit with
+// ResultStatus::kMemoryError.
+struct ExecutionBudget
+{
+    uint32_t wall_time_ms = 0;
+    uint64_t memory_bytes = 0;
+};
+
+struct ErrorFrame
+{
+    std::string file;
+    std::string function;
+    int line = 0;
+};
+
+// An error as the engine captured it, the traceback text is only formatted
+// when someone asks for it.
+struct ErrorRecord
+{
+    std::string type;
+    std::string message;
+    // line of the code the error was raised in, 0 if unknown
+    int line = 0;
+    // innermost frame last, for engines capturing the frames right away
+    std::vector<ErrorFrame> frames;
+
+    virtual ~ErrorRecord() = default;
+
+    // Engines keeping their native traceback override this to build the
+    // frames on the first call.
+    virtual std::vector<ErrorFrame> GetFrames() const
+    {
+        return frames;
+    }
+
+    std::string FormatTraceback() const
+    {
+        std::vector<ErrorFrame> traceback = GetFrames();
+        std::string text;
+        if (!traceback.empty())
+        {
+            text += "Traceback (most recent call last):\n";
+        }
+        for (const auto &frame : traceback)
+        {
+            text += "  File \"" + frame.file + "\", line " + std::to_string(frame.line) + ", in " + frame.function + "\n";
+        }
+        text += type;
+        if (!message.empty())
+        {
+            text += ": " + message;
+        }
+        return text;
+    }
+};
+
 struct InterpretResult
 {
     InterpretMode mode;
     ResultStatus status;
     std::string message;
     Value value;
+    // set by engines capturing errors in detail
+    std::shared_ptr<const ErrorRecord> error;
 };
 
 enum class ItemType
@@ -216,6 +287,10 @@ class ResultStatusConverter
             return ResultStatus::kAttributeError;
         else if (status_str == "KeyBoardInterrupt")
             return ResultStatus::kKeyBoardInterrupt;
+        else if (status_str == "Timeout")
+            return ResultStatus::kTimeout;
+        else if (status_str == "UpstreamError")
+            return ResultStatus::kUpstreamError;
         else
             return ResultStatus::kPending;
     }
@@ -254,6 +329,10 @@ class ResultStatusConverter
             return "AttributeError";
         case ResultStatus::kKeyBoardInterrupt:
             return "KeyBoardInterrupt";
+        case ResultStatus::kTimeout:
+            return "Timeout";
+        case ResultStatus::kUpstreamError:
+            return "UpstreamError";
         default:
             return "Unknown";
         }
@@ -267,6 +346,15 @@ inline std::ostream &operator<<(std::ostream &os, ResultStatus status)
 
 using InterpretHandler = std::function<InterpretResult(const std::string &, EquationContext *, InterpretMode)>;
 using ParseHandler = std::function<ParseResult(const std::string &, ParseMode)>;
+using InterruptHandler = std::function<void()>;
+// Interprets statements independent of each other in kExec mode, fills the
+// results of the statements it took and returns which ones these are.
+using BatchInterpretHandler =
+    std::function<std::vector<bool>(const std::vector<std::string> &, EquationContext *, std::vector<InterpretResult> &)>;
+// Evaluates expressions one after another in kEval mode and returns one
+// result per expression, taking whatever lock the interpreter needs once.
+using BatchEvalHandler =
+    std::function<std::vector<InterpretResult>(const std::vector<std::string> &, EquationContext *)>;
 } // namespace xequation
 
 namespace std
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <unordered_set>
 
@@ -9,6 +10,8 @@ namespace xequation
 class EquationContext
 {
   public:
+    virtual ~EquationContext() = default;
+
     // Checks if key exists.
     virtual bool Contains(const std::string &key) const = 0;
 
@@ -39,6 +42,45 @@ class EquationContext
       return keys().size() == 0;
     }
 
-    virtual std::set<std::string> GetBuiltinNames() const { return {}; }
+    // Names resolved without an equation, dependencies on them are dropped.
+    // Contexts hand out the same immutable set until their builtins change,
+    // null if there are none.
+    virtual std::shared_ptr<const std::unordered_set<std::string>> GetBuiltinNames() const
+    {
+      return nullptr;
+    }
+
+    // Serializes the value of the given key into a byte string, returns false
+    // if the context can not persist it.
+    virtual bool SerializeValue(const std::string & /*key*/, std::string & /*data*/) const
+    {
+      return false;
+    }
+
+    // Restores a value produced by SerializeValue under the given key.
+    virtual bool DeserializeValue(const std::string & /*key*/, const std::string & /*data*/)
+    {
+      return false;
+    }
+
+    // Estimates the bytes held by the value of the given key including the
+    // objects it references, returns false if the context can not tell.
+    virtual bool GetValueSize(const std::string & /*key*/, size_t & /*size*/) const
+    {
+      return false;
+    }
+
+    // Starts / stops counting the bytes allocated by the context, returns
+    // false if the context can not count them.
+    virtual bool SetAllocationTracking(bool /*enabled*/)
+    {
+      return false;
+    }
+
+    // Bytes currently allocated by the context while tracking is enabled.
+    virtual bool GetAllocatedMemory(size_t & /*bytes*/) const
+    {
+      return false;
+    }
 };
 } // namespace xequation
\ No newline at end of file
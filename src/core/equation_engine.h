@@ -21,6 +21,11 @@ class EquationEngine
     virtual InterpretResult Interpret(const std::string& code, const EquationContext *context = nullptr, InterpretMode mode = InterpretMode::kExec) = 0;
     virtual ParseResult Parse(const std::string & code, ParseMode mode = ParseMode::kExpression) = 0;
     virtual std::string GetLanguage() const = 0;
+    // stops the code Interpret() is running, from any thread
+    virtual void Interrupt() = 0;
+    // stops only the code Interpret() is running with context, the managers
+    // created here interrupt their own equations this way
+    virtual void Interrupt(const EquationContext *context) = 0;
     virtual std::unique_ptr<EquationManager> CreateEquationManager()
     {
 
@@ -32,7 +37,10 @@ class EquationEngine
             return Parse(code, mode);
         };
         
-        return std::unique_ptr<EquationManager>(new EquationManager(CreateContext(), interpret_handler, parse_callback, GetLanguage()));
+        std::unique_ptr<EquationManager> manager(new EquationManager(CreateContext(), interpret_handler, parse_callback, GetLanguage()));
+        const EquationContext *context = &manager->context();
+        manager->SetInterruptHandler([this, context]() { Interrupt(context); });
+        return manager;
     }
 
     virtual std::unique_ptr<EquationContext> CreateContext() = 0;
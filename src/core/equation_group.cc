@@ -11,13 +11,21 @@ EquationGroupPtr EquationGroup::Create(const EquationManager *manager)
     return group;
 }
 
+EquationGroupPtr EquationGroup::Create(const EquationGroupId &id, const EquationManager *manager)
+{
+    EquationGroupPtr group = EquationGroupPtr(new EquationGroup(id, manager));
+    return group;
+}
+
 EquationGroup::EquationGroup(const EquationManager *manager) : manager_(manager)
 {
     static boost::uuids::random_generator rgen;
     id_ = rgen();
 }
 
-void EquationGroup::AddEquation(std::unique_ptr<Equation> equation)
+EquationGroup::EquationGroup(const EquationGroupId &id, const EquationManager *manager) : id_(id), manager_(manager) {}
+
+void EquationGroup::AddEquation(EquationPtr equation)
 {
     equation_map_.insert({equation->name(), std::move(equation)});
 }
@@ -13,10 +13,12 @@ class EquationGroup
 {
   public:
     EquationGroup(const EquationManager *manager);
+    EquationGroup(const EquationGroupId &id, const EquationManager *manager);
 
     static EquationGroupPtr Create(const EquationManager* manager);
+    static EquationGroupPtr Create(const EquationGroupId &id, const EquationManager* manager);
 
-    void AddEquation(std::unique_ptr<Equation> equation);
+    void AddEquation(EquationPtr equation);
 
     void RemoveEquation(const std::string &equation_name);
 
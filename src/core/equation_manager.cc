@@ -1,7 +1,15 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
 #include <regex>
-#include <sstream>
+#include <set>
+#include <thread>
+#include <unordered_set>
 #include "equation_manager.h"
 #include "equation_common.h"
+#include "equation_snapshot.h"
+#include "content_hash.h"
 #include "core/equation_signals_manager.h"
 
 namespace xequation
@@ -25,22 +33,7 @@ bool EquationManager::IsEquationGroupExist(const EquationGroupId &group_id) cons
 
 bool EquationManager::IsEquationExist(const std::string &equation_name) const
 {
-    bool is_name_exist = equation_name_to_group_id_map_.count(equation_name) != 0;
-    if (!is_name_exist)
-    {
-        return false;
-    }
-
-    const EquationGroupId &id = equation_name_to_group_id_map_.at(equation_name);
-    bool is_group_exist = equation_group_map_.contains(id);
-    if (!is_group_exist)
-    {
-        return false;
-    }
-
-    const EquationGroup *group = equation_group_map_.at(id).get();
-    bool is_equation_exist = group->IsEquationExist(equation_name);
-    return is_equation_exist;
+    return equation_registry_.Get(equation_name) != nullptr;
 }
 
 const EquationGroup *EquationManager::GetEquationGroup(const EquationGroupId &group_id) const
@@ -54,27 +47,17 @@ const EquationGroup *EquationManager::GetEquationGroup(const EquationGroupId &gr
 
 const Equation *EquationManager::GetEquation(const std::string &equation_name) const
 {
-    bool is_name_exist = equation_name_to_group_id_map_.count(equation_name) != 0;
-    if (!is_name_exist)
-    {
-        return nullptr;
-    }
-
-    const EquationGroupId &id = equation_name_to_group_id_map_.at(equation_name);
-    bool is_group_exist = equation_group_map_.contains(id);
-    if (!is_group_exist)
-    {
-        return nullptr;
-    }
+    return equation_registry_.Get(equation_name);
+}
 
-    const EquationGroup *group = equation_group_map_.at(id).get();
-    bool is_equation_exist = group->IsEquationExist(equation_name);
-    if (!is_equation_exist)
-    {
-        return nullptr;
-    }
+EquationHandle EquationManager::GetEquationHandle(const std::string &equation_name) const
+{
+    return equation_registry_.Find(equation_name);
+}
 
-    return group->GetEquation(equation_name);
+const Equation *EquationManager::GetEquation(EquationHandle handle) const
+{
+    return equation_registry_.Get(handle);
 }
 
 std::vector<EquationGroupId> EquationManager::GetEquationGroupIds() const
@@ -251,10 +234,10 @@ void EquationManager::EditEquationGroup(const EquationGroupId &group_id, const s
         AddNodeToGraph(item.name, item.dependencies);
     }
 
+    // the node stays, only the edges that differ are touched
     for (const auto &item : to_update_items)
     {
-        RemoveNodeInGraph(item.name);
-        AddNodeToGraph(item.name, item.dependencies);
+        UpdateNodeDependenciesInGraph(item.name, item.dependencies);
     }
 
     guard.commit();
@@ -268,7 +251,7 @@ void EquationManager::EditEquationGroup(const EquationGroupId &group_id, const s
         }
         signals_manager_->Emit<EquationEvent::kEquationRemoving>(group->GetEquation(remove_eqn_name));
         RemoveEquationInGroup(group, remove_eqn_name);
-        context_->Remove(remove_eqn_name);
+        RemoveContextValue(remove_eqn_name);
         signals_manager_->Emit<EquationEvent::kEquationRemoved>(remove_eqn_name);
     }
 
@@ -279,7 +262,9 @@ void EquationManager::EditEquationGroup(const EquationGroupId &group_id, const s
         update_eqn->set_content(update_item.content);
         update_eqn->set_type(update_item.type);
         update_eqn->set_status(ResultStatus::kPending);
-        context_->Remove(update_item.name);
+        update_eqn->set_error(nullptr);
+        update_eqn->set_root_cause("");
+        RemoveContextValue(update_item.name);
         signals_manager_->Emit<EquationEvent::kEquationUpdated>(
             update_eqn, EquationUpdateFlag::kContent | EquationUpdateFlag::kType | EquationUpdateFlag::kValue | EquationUpdateFlag::kStatus
         );
@@ -386,7 +371,7 @@ void EquationManager::RemoveEquationGroup(const EquationGroupId &group_id)
         graph_->InvalidateNode(equation_name);
         signals_manager_->Emit<EquationEvent::kEquationRemoving>(group->GetEquation(equation_name));
         RemoveEquationInGroup(group, equation_name);
-        context_->Remove(equation_name);
+        RemoveContextValue(equation_name);
         signals_manager_->Emit<EquationEvent::kEquationRemoved>(equation_name);
     }
     equation_group_map_.erase(group_id);
@@ -405,28 +390,75 @@ void EquationManager::RemoveEquationGroup(const EquationGroupId &group_id)
 ParseResult EquationManager::Parse(const std::string &expression, ParseMode mode) const
 {
     auto res = parse_handler_(expression, mode);
-    // remove dependencies in builtin names
-    std::set<std::string> builtin_names = context_->GetBuiltinNames();
+    // remove dependencies in builtin names, in place against the shared set
+    std::shared_ptr<const std::unordered_set<std::string>> builtin_names = context_->GetBuiltinNames();
+    if (!builtin_names || builtin_names->empty())
+    {
+        return res;
+    }
     for (auto &item : res.items)
     {
-        std::vector<std::string> filtered_dependencies;
-        for (const auto &dep : item.dependencies)
-        {
-            if (builtin_names.count(dep) == 0)
-            {
-                filtered_dependencies.push_back(dep);
-            }
-        }
-        item.dependencies = filtered_dependencies;
+        auto &dependencies = item.dependencies;
+        dependencies.erase(
+            std::remove_if(
+                dependencies.begin(), dependencies.end(),
+                [&builtin_names](const std::string &dependency) { return builtin_names->count(dependency) != 0; }
+            ),
+            dependencies.end()
+        );
     }
     return res;
 }
 
-InterpretResult EquationManager::Eval(const std::string &expression) const
+InterpretResult EquationManager::Eval(const std::string &expression)
 {
+    MaterializeExpressionDependencies(expression);
     return interpret_handler_(expression, context_.get(), InterpretMode::kEval);
 }
 
+std::vector<InterpretResult> EquationManager::EvalBatch(const std::vector<std::string> &expressions)
+{
+    for (const auto &expression : expressions)
+    {
+        MaterializeExpressionDependencies(expression);
+    }
+    if (batch_eval_handler_)
+    {
+        return batch_eval_handler_(expressions, context_.get());
+    }
+
+    std::vector<InterpretResult> results;
+    results.reserve(expressions.size());
+    for (const auto &expression : expressions)
+    {
+        results.push_back(interpret_handler_(expression, context_.get(), InterpretMode::kEval));
+    }
+    return results;
+}
+
+void EquationManager::MaterializeExpressionDependencies(const std::string &expression)
+{
+    if (evicted_equations_.empty())
+    {
+        return;
+    }
+    try
+    {
+        ParseResult parse_result = parse_handler_(expression, ParseMode::kExpression);
+        for (const auto &item : parse_result.items)
+        {
+            for (const auto &dependency : item.dependencies)
+            {
+                MaterializeEquationInternal(dependency);
+            }
+        }
+    }
+    catch (const ParseException &)
+    {
+        // the interpreter reports the error
+    }
+}
+
 void EquationManager::Reset()
 {
     graph_->Reset();
@@ -439,8 +471,16 @@ void EquationManager::Reset()
         }
     }
     equation_group_map_.clear();
-    equation_name_to_group_id_map_.clear();
+    equation_registry_.Clear();
     context_->Clear();
+    value_hash_map_.clear();
+    allocation_delta_map_.clear();
+    value_size_map_.clear();
+    while (!evicted_equations_.empty())
+    {
+        std::string equation_name = *evicted_equations_.begin();
+        DiscardEvictedValue(equation_name);
+    }
     for (const auto &equation_group_entry : equation_group_map_)
     {
         for( const auto &equation_entry : equation_group_entry.second->equation_map())
@@ -453,302 +493,1360 @@ void EquationManager::Reset()
 
 void EquationManager::UpdateEquationInternal(const std::string &equation_name)
 {
-    if (IsEquationExist(equation_name) == false)
+    PendingEquationUpdate update;
+    if (!BeginEquationUpdate(equation_name, update))
+    {
+        return;
+    }
+
+    size_t allocated_before = 0;
+    bool measure = allocation_tracking_ && context_->GetAllocatedMemory(allocated_before);
+    InterpretResult result = interpret_handler_(update.statement, context_.get(), InterpretMode::kExec);
+    size_t allocated_after = 0;
+    if (measure && context_->GetAllocatedMemory(allocated_after))
+    {
+        allocation_delta_map_[equation_name] =
+            static_cast<int64_t>(allocated_after) - static_cast<int64_t>(allocated_before);
+    }
+    FinishEquationUpdate(update, result);
+}
+
+void EquationManager::UpdateEquationsInternal(const std::vector<std::string> &topo_order)
+{
+    if ((interpret_concurrency_ > 1 || batch_interpret_handler_) && topo_order.size() > 1)
+    {
+        UpdateEquationsInWaves(topo_order);
+    }
+    else
+    {
+        for (const auto &node_name : topo_order)
+        {
+            UpdateEquationInternal(node_name);
+        }
+    }
+    EnforceEvictionPolicy();
+}
+
+void EquationManager::UpdateEquationsInWaves(const std::vector<std::string> &topo_order)
+{
+    // an equation's wave is one after the latest wave of its dependencies, so
+    // the equations of a wave are independent of each other
+    std::unordered_map<std::string, size_t> wave_map;
+    std::vector<std::vector<std::string>> waves;
+    for (const auto &node_name : topo_order)
+    {
+        size_t wave = 0;
+        const DependencyGraph::Node *node = graph_->GetNode(node_name);
+        if (node)
+        {
+            for (const auto &dependency : node->dependencies())
+            {
+                auto it = wave_map.find(dependency);
+                if (it != wave_map.end())
+                {
+                    wave = std::max(wave, it->second + 1);
+                }
+            }
+        }
+        wave_map[node_name] = wave;
+        if (waves.size() <= wave)
+        {
+            waves.resize(wave + 1);
+        }
+        waves[wave].push_back(node_name);
+    }
+
+    // an exception of the interpreter fails its equation like an error result,
+    // the remaining waves still run, the first one is rethrown at the end
+    std::exception_ptr first_error;
+    for (const auto &wave : waves)
+    {
+        std::vector<PendingEquationUpdate> updates;
+        for (const auto &node_name : wave)
+        {
+            PendingEquationUpdate update;
+            if (BeginEquationUpdate(node_name, update))
+            {
+                updates.push_back(std::move(update));
+            }
+        }
+
+        std::vector<InterpretResult> results(updates.size());
+        std::vector<size_t> remaining;
+        if (batch_interpret_handler_ && updates.size() > 1)
+        {
+            std::vector<std::string> statements;
+            for (const auto &update : updates)
+            {
+                statements.push_back(update.statement);
+            }
+            std::vector<bool> interpreted = batch_interpret_handler_(statements, context_.get(), results);
+            for (size_t i = 0; i < updates.size(); i++)
+            {
+                if (i >= interpreted.size() || !interpreted[i])
+                {
+                    remaining.push_back(i);
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < updates.size(); i++)
+            {
+                remaining.push_back(i);
+            }
+        }
+
+        // only the interpretation runs in parallel, statuses, signals and the
+        // cache are handled on this thread
+        std::vector<std::exception_ptr> errors(updates.size());
+        std::atomic<size_t> next_update(0);
+        auto interpret = [&]() {
+            for (size_t j = next_update++; j < remaining.size(); j = next_update++)
+            {
+                size_t i = remaining[j];
+                try
+                {
+                    results[i] = interpret_handler_(updates[i].statement, context_.get(), InterpretMode::kExec);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+
+        size_t thread_count = std::min(interpret_concurrency_, remaining.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < thread_count; i++)
+        {
+            threads.emplace_back(interpret);
+        }
+        interpret();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        for (size_t i = 0; i < updates.size(); i++)
+        {
+            if (errors[i])
+            {
+                results[i].mode = InterpretMode::kExec;
+                results[i].status = ResultStatus::kUnknownError;
+                try
+                {
+                    std::rethrow_exception(errors[i]);
+                }
+                catch (const std::exception &e)
+                {
+                    results[i].message = e.what();
+                }
+                catch (...)
+                {
+                    results[i].message = "Unknown error";
+                }
+                if (!first_error)
+                {
+                    first_error = errors[i];
+                }
+            }
+            FinishEquationUpdate(updates[i], results[i]);
+        }
+    }
+    if (first_error)
+    {
+        std::rethrow_exception(first_error);
+    }
+}
+
+bool EquationManager::BeginEquationUpdate(const std::string &equation_name, PendingEquationUpdate &update)
+{
+    // the hot path of every update, looked up once
+    Equation *equation = GetEquationInternal(equation_name);
+    if (!equation)
     {
         throw EquationException::EquationNotFound(equation_name);
     }
 
     const DependencyGraph::Node *node = graph_->GetNode(equation_name);
-    Equation *equation = GetEquationInternal(equation_name);
 
     if (!node->dirty_flag())
     {
-        return;
+        return false;
+    }
+
+    DiscardEvictedValue(equation_name);
+    for (const auto &dependency : node->dependencies())
+    {
+        MaterializeEquationInternal(dependency);
+    }
+
+    // it could only fail on the missing value of the dependency
+    if (BlockOnFailedDependency(equation, node))
+    {
+        return false;
     }
 
     // set status and message to calculating before calculation
     equation->set_status(ResultStatus::kCalculating);
     equation->set_message("Calculating...");
+    equation->set_error(nullptr);
+    equation->set_root_cause("");
 
     signals_manager_->Emit<EquationEvent::kEquationUpdated>(
         equation, EquationUpdateFlag::kStatus | EquationUpdateFlag::kMessage
     );
 
-    const std::string &equation_statement = equation->type() == ItemType::kVariable
-                                                ? equation->name() + " = " + equation->content()
-                                                : equation->content();
-    InterpretResult result = interpret_handler_(equation_statement, context_.get(), InterpretMode::kExec);
-    equation->set_status(result.status);
-    equation->set_message(result.message);
-    if (equation->status() != ResultStatus::kSuccess)
+    value_hash_map_.erase(equation_name);
+    allocation_delta_map_.erase(equation_name);
+    value_size_map_.erase(equation_name);
+
+    update.equation_name = equation_name;
+    update.cache_key = 0;
+    update.use_cache = ComputeResultCacheKey(equation, update.cache_key);
+    std::string cached_data;
+    if (update.use_cache && result_cache_->Lookup(update.cache_key, cached_data) &&
+        context_->DeserializeValue(equation_name, cached_data))
+    {
+        equation->set_status(ResultStatus::kSuccess);
+        equation->set_message("");
+        value_hash_map_[equation_name] = ComputeContentHash(cached_data);
+        CompleteEquationUpdate(equation);
+        return false;
+    }
+
+    update.statement = GetEquationStatement(equation);
+    return true;
+}
+
+bool EquationManager::BlockOnFailedDependency(Equation *equation, const DependencyGraph::Node *node)
+{
+    for (const auto &dependency : node->dependencies())
     {
-        context_->Remove(equation_name);
+        const Equation *dependency_equation = equation_registry_.Get(dependency);
+        if (!dependency_equation)
+        {
+            continue;
+        }
+        ResultStatus status = dependency_equation->status();
+        if (status == ResultStatus::kSuccess || status == ResultStatus::kPending || status == ResultStatus::kCalculating)
+        {
+            continue;
+        }
+
+        // restored snapshots do not know the root cause of blocked equations
+        std::string root_cause = status == ResultStatus::kUpstreamError && !dependency_equation->root_cause().empty()
+                                     ? dependency_equation->root_cause()
+                                     : dependency;
+        const Equation *root_equation = equation_registry_.Get(root_cause);
+        if (!root_equation)
+        {
+            root_equation = dependency_equation;
+        }
+        equation->set_status(ResultStatus::kUpstreamError);
+        equation->set_message(
+            "Upstream equation '" + root_cause + "' failed with " +
+            ResultStatusConverter::ToString(root_equation->status())
+        );
+        equation->set_error(nullptr);
+        equation->set_root_cause(root_cause);
+        RemoveContextValue(equation->name());
+        CompleteEquationUpdate(equation);
+        return true;
     }
-    signals_manager_->Emit<EquationEvent::kEquationUpdated>(
-        equation, EquationUpdateFlag::kStatus | EquationUpdateFlag::kMessage | EquationUpdateFlag::kValue
-    );
+    return false;
 }
 
-void EquationManager::AddNodeToGraph(const std::string &node_name, const std::vector<std::string> &dependencies)
+void EquationManager::FinishEquationUpdate(const PendingEquationUpdate &update, const InterpretResult &result)
 {
-    DependencyGraph::BatchUpdateGuard guard(graph_.get());
-    graph_->AddNode(node_name);
-    const DependencyGraph::EdgeContainer::RangeByFrom edges = graph_->GetEdgesByFrom(node_name);
-    std::vector<DependencyGraph::Edge> edges_to_remove;
-    for (auto it = edges.first; it != edges.second; it++)
+    Equation *equation = GetEquationInternal(update.equation_name);
+    equation->set_status(result.status);
+    equation->set_message(result.message);
+    equation->set_error(result.error);
+    if (equation->status() != ResultStatus::kSuccess)
     {
-        edges_to_remove.push_back(*it);
+        RemoveContextValue(update.equation_name);
     }
-    graph_->RemoveEdges(edges_to_remove);
-    for (const std::string &dep : dependencies)
+    else if (update.use_cache)
     {
-        graph_->AddEdge({node_name, dep});
+        std::string data;
+        if (context_->SerializeValue(update.equation_name, data))
+        {
+            value_hash_map_[update.equation_name] = ComputeContentHash(data);
+            result_cache_->Store(update.cache_key, data);
+        }
     }
-    guard.commit();
+    CompleteEquationUpdate(equation);
 }
 
-void EquationManager::RemoveNodeInGraph(const std::string &node_name)
+void EquationManager::CompleteEquationUpdate(Equation *equation)
 {
-    graph_->RemoveNode(node_name);
-    auto edges = graph_->GetEdgesByFrom(node_name);
-    std::vector<DependencyGraph::Edge> edges_to_remove;
-    for (auto it = edges.first; it != edges.second; it++)
+    // lazy mode relies on clean nodes to skip equations that are up to date
+    if (evaluation_mode_ == EvaluationMode::kLazy)
     {
-        edges_to_remove.push_back(*it);
+        graph_->MakeNodeDirty(equation->name(), false);
     }
-    graph_->RemoveEdges(edges_to_remove);
+    if (equation->status() == ResultStatus::kSuccess)
+    {
+        TrackValueSize(equation->name());
+    }
+    signals_manager_->Emit<EquationEvent::kEquationUpdated>(
+        equation, EquationUpdateFlag::kStatus | EquationUpdateFlag::kMessage | EquationUpdateFlag::kValue
+    );
 }
 
-void EquationManager::AddEquationToGroup(EquationGroup *group, EquationPtr equation)
+void EquationManager::RemoveContextValue(const std::string &equation_name)
 {
-    equation_name_to_group_id_map_.insert({equation->name(), equation->group_id()});
-    group->AddEquation(std::move(equation));
+    context_->Remove(equation_name);
+    value_hash_map_.erase(equation_name);
+    allocation_delta_map_.erase(equation_name);
+    value_size_map_.erase(equation_name);
+    DiscardEvictedValue(equation_name);
 }
 
-void EquationManager::RemoveEquationInGroup(EquationGroup *group, const std::string &equation_name)
+std::string EquationManager::GetEquationStatement(const Equation *equation)
 {
-    equation_name_to_group_id_map_.erase(equation_name);
-    group->RemoveEquation(equation_name);
+    return equation->type() == ItemType::kVariable ? equation->name() + " = " + equation->content()
+                                                   : equation->content();
 }
 
-void EquationManager::Update()
+void EquationManager::TrackValueSize(const std::string &equation_name)
 {
-    graph_->Traversal([&](const std::string &eqn_name) { UpdateEquationInternal(eqn_name); });
+    size_t size = 0;
+    if (eviction_policy_.memory_budget > 0 && context_->GetValueSize(equation_name, size))
+    {
+        value_size_map_[equation_name] = size;
+    }
 }
 
-void EquationManager::UpdateEquation(const std::string &equation_name)
+void EquationManager::EnforceEvictionPolicy()
 {
-    if (IsEquationExist(equation_name) == false)
+    if (eviction_policy_.memory_budget == 0)
     {
-        throw EquationException::EquationNotFound(equation_name);
+        return;
     }
 
-    auto topo_order = graph_->TopologicalSort(equation_name);
-
-    for (const auto &node_name : topo_order)
+    uint64_t total_size = 0;
+    std::vector<std::pair<uint64_t, std::string>> candidates;
+    for (const auto &entry : value_size_map_)
     {
-        UpdateEquationInternal(node_name);
+        total_size += entry.second;
+        const Equation *equation = GetEquation(entry.first);
+        // only a variable binds a value that can be put back under its name
+        if (entry.second >= eviction_policy_.min_value_size && equation && equation->type() == ItemType::kVariable &&
+            !IsEquationObserved(entry.first))
+        {
+            candidates.emplace_back(entry.second, entry.first);
+        }
     }
-}
-
-void EquationManager::UpdateEquationGroup(const EquationGroupId &group_id)
-{
-    if (IsEquationGroupExist(group_id) == false)
+    if (total_size <= eviction_policy_.memory_budget)
     {
-        throw EquationException::EquationGroupNotFound(group_id);
+        return;
     }
 
-    const EquationGroup *group = GetEquationGroup(group_id);
-
-    auto topo_order = graph_->TopologicalSort(group->GetEquationNames());
-
-    for (const auto &node_name : topo_order)
+    std::sort(candidates.begin(), candidates.end(), [](const std::pair<uint64_t, std::string> &a, const std::pair<uint64_t, std::string> &b) -> bool {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    for (const auto &candidate : candidates)
     {
-        UpdateEquationInternal(node_name);
+        if (total_size <= eviction_policy_.memory_budget)
+        {
+            break;
+        }
+        EvictEquationValue(candidate.second);
+        total_size -= candidate.first;
     }
 }
 
-void EquationManager::UpdateEquationWithoutPropagate(const std::string &equation_name)
+void EquationManager::EvictEquationValue(const std::string &equation_name)
 {
-    if (IsEquationExist(equation_name) == false)
+    std::string data;
+    if (eviction_policy_.spill_cache && context_->SerializeValue(equation_name, data))
     {
-        throw EquationException::EquationNotFound(equation_name);
+        eviction_policy_.spill_cache->Store(GetSpillKey(equation_name), data);
     }
-
-    UpdateEquationInternal(equation_name);
+    // the value hash stays, so cache keys of dependents do not need the value
+    context_->Remove(equation_name);
+    value_size_map_.erase(equation_name);
+    evicted_equations_.insert(equation_name);
 }
 
-void EquationManager::UpdateEquationStatus(const std::string &equation_name, ResultStatus status, const std::string& message)
+bool EquationManager::MaterializeEquationInternal(const std::string &equation_name)
 {
-    if (IsEquationExist(equation_name) == false)
+    if (evicted_equations_.erase(equation_name) == 0)
     {
-        throw EquationException::EquationNotFound(equation_name);
+        return true;
     }
 
-    Equation *equation = GetEquationInternal(equation_name);
-    equation->set_status(status);
-    equation->set_message(message);
-    context_->Remove(equation_name);
-
-    signals_manager_->Emit<EquationEvent::kEquationUpdated>(
-        equation, EquationUpdateFlag::kStatus | EquationUpdateFlag::kMessage | EquationUpdateFlag::kValue
-    );
-}
-
-Equation *EquationManager::GetEquationInternal(const std::string &equation_name)
-{
-    bool is_name_exist = equation_name_to_group_id_map_.count(equation_name) != 0;
-    if (!is_name_exist)
+    std::string data;
+    if (eviction_policy_.spill_cache && eviction_policy_.spill_cache->Lookup(GetSpillKey(equation_name), data) &&
+        context_->DeserializeValue(equation_name, data))
     {
-        return nullptr;
+        eviction_policy_.spill_cache->Remove(GetSpillKey(equation_name));
+        TrackValueSize(equation_name);
+        return true;
     }
 
-    const EquationGroupId &id = equation_name_to_group_id_map_.at(equation_name);
-    bool is_group_exist = equation_group_map_.contains(id);
-    if (!is_group_exist)
+    // recompute from the dependencies, which may have been evicted as well
+    const DependencyGraph::Node *node = graph_->GetNode(equation_name);
+    if (node)
     {
-        return nullptr;
+        for (const auto &dependency : node->dependencies())
+        {
+            MaterializeEquationInternal(dependency);
+        }
     }
-
-    EquationGroup *group = equation_group_map_.at(id).get();
-    bool is_equation_exist = group->IsEquationExist(equation_name);
-    if (!is_equation_exist)
+    Equation *equation = GetEquationInternal(equation_name);
+    InterpretResult result = interpret_handler_(GetEquationStatement(equation), context_.get(), InterpretMode::kExec);
+    if (result.status != ResultStatus::kSuccess)
     {
-        return nullptr;
+        equation->set_status(result.status);
+        equation->set_message(result.message);
+        equation->set_error(result.error);
+        RemoveContextValue(equation_name);
+        signals_manager_->Emit<EquationEvent::kEquationUpdated>(
+            equation, EquationUpdateFlag::kStatus | EquationUpdateFlag::kMessage | EquationUpdateFlag::kValue
+        );
+        return false;
     }
-
-    return group->GetEquation(equation_name);
+    TrackValueSize(equation_name);
+    return true;
 }
 
-EquationGroup *EquationManager::GetEquationGroupInternal(const EquationGroupId &group_id)
+void EquationManager::DiscardEvictedValue(const std::string &equation_name)
 {
-    if (equation_group_map_.contains(group_id))
+    if (evicted_equations_.erase(equation_name) != 0 && eviction_policy_.spill_cache)
     {
-        return equation_group_map_.at(group_id).get();
+        eviction_policy_.spill_cache->Remove(GetSpillKey(equation_name));
     }
-    return nullptr;
 }
 
-ScopedConnection EquationManager::ConnectGraphDependencyUpdated(std::vector<std::string> &dependency_updated_equation
-) const
+bool EquationManager::ReadSpilledValue(const std::string &equation_name, std::string &data) const
 {
-    return graph_->ConnectNodeDependencyChangedSignal([&](const std::string &node_name) {
-        dependency_updated_equation.push_back(node_name);
-    });
+    return evicted_equations_.count(equation_name) != 0 && eviction_policy_.spill_cache &&
+           eviction_policy_.spill_cache->Lookup(GetSpillKey(equation_name), data);
 }
 
-ScopedConnection EquationManager::ConnectGraphDependentUpdated(std::vector<std::string> &dependent_updated_equation
-) const
+uint64_t EquationManager::GetSpillKey(const std::string &equation_name) const
 {
-    return graph_->ConnectNodeDependentChangedSignal([&](const std::string &node_name) {
-        dependent_updated_equation.push_back(node_name);
-    });
+    return ContentHasher().Update(spill_key_salt_).Update(equation_name).value();
 }
 
-void EquationManager::NotifyEquationDependentsUpdated(const std::string &equation_name) const
+std::string EquationManager::NormalizeContent(const std::string &content)
 {
-    if (IsEquationExist(equation_name))
+    std::string normalized_content;
+    std::istringstream content_stream(content);
+    std::string line;
+    while (std::getline(content_stream, line))
     {
-        signals_manager_->Emit<EquationEvent::kEquationUpdated>(
-            GetEquation(equation_name), EquationUpdateFlag::kDependents
-        );
+        size_t end = line.find_last_not_of(" \t\r");
+        normalized_content += (end == std::string::npos ? std::string() : line.substr(0, end + 1)) + "\n";
     }
+    size_t content_end = normalized_content.find_last_not_of('\n');
+    normalized_content.erase(content_end == std::string::npos ? 0 : content_end + 1);
+    return normalized_content;
 }
 
-void EquationManager::NotifyEquationDependenciesUpdated(const std::string &equation_name) const
+bool EquationManager::ComputeResultCacheKey(const Equation *equation, uint64_t &key)
 {
-    if (IsEquationExist(equation_name))
+    // only variables bind a single value that can be serialized back under their name
+    if (!result_cache_ || !equation->cacheable() || equation->type() != ItemType::kVariable)
     {
-        signals_manager_->Emit<EquationEvent::kEquationUpdated>(
-            GetEquation(equation_name), EquationUpdateFlag::kDependencies
+        return false;
+    }
+
+    ContentHasher hasher;
+    hasher.Update(language_).Update(equation->name()).Update(NormalizeContent(equation->content()));
+
+    const auto &dependencies = equation->GetDependencies();
+    std::vector<std::string> sorted_dependencies(dependencies.begin(), dependencies.end());
+    std::sort(sorted_dependencies.begin(), sorted_dependencies.end());
+    for (const auto &dependency : sorted_dependencies)
+    {
+        uint64_t value_hash = 0;
+        if (!GetValueHash(dependency, value_hash))
+        {
+            return false;
+        }
+        hasher.Update(dependency).Update(value_hash);
+    }
+
+    key = hasher.value();
+    return true;
+}
+
+bool EquationManager::GetValueHash(const std::string &equation_name, uint64_t &hash)
+{
+    if (!context_->Contains(equation_name))
+    {
+        return false;
+    }
+
+    auto it = value_hash_map_.find(equation_name);
+    if (it != value_hash_map_.end())
+    {
+        hash = it->second;
+        return true;
+    }
+
+    const Equation *equation = equation_registry_.Get(equation_name);
+    ItemType type = equation ? equation->type() : ItemType::kUnknown;
+    if (type == ItemType::kImport || type == ItemType::kImportFrom || type == ItemType::kFunction ||
+        type == ItemType::kClass)
+    {
+        if (equation->status() != ResultStatus::kSuccess)
+        {
+            return false;
+        }
+        ContentHasher hasher;
+        hasher.Update(static_cast<uint64_t>(type)).Update(equation_name).Update(NormalizeContent(equation->content()));
+        const auto &dependencies = equation->GetDependencies();
+        std::vector<std::string> sorted_dependencies(dependencies.begin(), dependencies.end());
+        std::sort(sorted_dependencies.begin(), sorted_dependencies.end());
+        for (const auto &dependency : sorted_dependencies)
+        {
+            uint64_t dependency_hash = 0;
+            if (!GetValueHash(dependency, dependency_hash))
+            {
+                return false;
+            }
+            hasher.Update(dependency).Update(dependency_hash);
+        }
+        hash = hasher.value();
+        value_hash_map_[equation_name] = hash;
+        return true;
+    }
+
+    std::string data;
+    if (!context_->SerializeValue(equation_name, data))
+    {
+        return false;
+    }
+    hash = ComputeContentHash(data);
+    value_hash_map_[equation_name] = hash;
+    return true;
+}
+
+void EquationManager::AddNodeToGraph(const std::string &node_name, const std::vector<std::string> &dependencies)
+{
+    DependencyGraph::BatchUpdateGuard guard(graph_.get());
+    graph_->AddNode(node_name);
+    const DependencyGraph::EdgeContainer::RangeByFrom edges = graph_->GetEdgesByFrom(node_name);
+    std::vector<DependencyGraph::Edge> edges_to_remove;
+    for (auto it = edges.first; it != edges.second; it++)
+    {
+        edges_to_remove.push_back(*it);
+    }
+    graph_->RemoveEdges(edges_to_remove);
+    for (const std::string &dep : dependencies)
+    {
+        graph_->AddEdge({node_name, dep});
+    }
+    guard.commit();
+}
+
+void EquationManager::UpdateNodeDependenciesInGraph(
+    const std::string &node_name, const std::vector<std::string> &dependencies
+)
+{
+    std::unordered_set<std::string> new_dependencies(dependencies.begin(), dependencies.end());
+    std::unordered_set<std::string> old_dependencies;
+    std::vector<DependencyGraph::Edge> edges_to_remove;
+    auto edges = graph_->GetEdgesByFrom(node_name);
+    for (auto it = edges.first; it != edges.second; it++)
+    {
+        old_dependencies.insert(it->to());
+        if (new_dependencies.count(it->to()) == 0)
+        {
+            edges_to_remove.push_back(*it);
+        }
+    }
+
+    DependencyGraph::BatchUpdateGuard guard(graph_.get());
+    graph_->RemoveEdges(edges_to_remove);
+    for (const std::string &dep : dependencies)
+    {
+        if (old_dependencies.count(dep) == 0)
+        {
+            graph_->AddEdge({node_name, dep});
+        }
+    }
+    guard.commit();
+}
+
+void EquationManager::RemoveNodeInGraph(const std::string &node_name)
+{
+    graph_->RemoveNode(node_name);
+    auto edges = graph_->GetEdgesByFrom(node_name);
+    std::vector<DependencyGraph::Edge> edges_to_remove;
+    for (auto it = edges.first; it != edges.second; it++)
+    {
+        edges_to_remove.push_back(*it);
+    }
+    graph_->RemoveEdges(edges_to_remove);
+}
+
+void EquationManager::AddEquationToGroup(EquationGroup *group, EquationPtr equation)
+{
+    Equation *registered = equation.get();
+    group->AddEquation(std::move(equation));
+    equation_registry_.Add(registered);
+}
+
+void EquationManager::RemoveEquationInGroup(EquationGroup *group, const std::string &equation_name)
+{
+    equation_registry_.Remove(equation_name);
+    group->RemoveEquation(equation_name);
+}
+
+void EquationManager::Update()
+{
+    if (evaluation_mode_ == EvaluationMode::kLazy)
+    {
+        UpdateEquationsInternal(GetUpdateOrder(GetEquationNames()));
+        return;
+    }
+
+    UpdateEquationsInternal(graph_->TopologicalSort());
+}
+
+void EquationManager::UpdateEquation(const std::string &equation_name)
+{
+    if (IsEquationExist(equation_name) == false)
+    {
+        throw EquationException::EquationNotFound(equation_name);
+    }
+
+    UpdateEquationsInternal(GetUpdateOrder({equation_name}));
+}
+
+void EquationManager::UpdateEquationGroup(const EquationGroupId &group_id)
+{
+    if (IsEquationGroupExist(group_id) == false)
+    {
+        throw EquationException::EquationGroupNotFound(group_id);
+    }
+
+    const EquationGroup *group = GetEquationGroup(group_id);
+
+    UpdateEquationsInternal(GetUpdateOrder(group->GetEquationNames()));
+}
+
+void EquationManager::UpdateEquationWithoutPropagate(const std::string &equation_name)
+{
+    if (IsEquationExist(equation_name) == false)
+    {
+        throw EquationException::EquationNotFound(equation_name);
+    }
+
+    UpdateEquationInternal(equation_name);
+    EnforceEvictionPolicy();
+}
+
+void EquationManager::UpdateEquationStatus(const std::string &equation_name, ResultStatus status, const std::string& message)
+{
+    Equation *equation = GetEquationInternal(equation_name);
+    if (!equation)
+    {
+        throw EquationException::EquationNotFound(equation_name);
+    }
+
+    equation->set_status(status);
+    equation->set_message(message);
+    equation->set_error(nullptr);
+    equation->set_root_cause("");
+    RemoveContextValue(equation_name);
+
+    signals_manager_->Emit<EquationEvent::kEquationUpdated>(
+        equation, EquationUpdateFlag::kStatus | EquationUpdateFlag::kMessage | EquationUpdateFlag::kValue
+    );
+}
+
+void EquationManager::SetEvaluationMode(EvaluationMode mode)
+{
+    evaluation_mode_ = mode;
+}
+
+void EquationManager::ObserveEquation(const std::string &equation_name)
+{
+    std::lock_guard<std::mutex> lock(observed_equation_mutex_);
+    observed_equation_count_map_[equation_name]++;
+}
+
+void EquationManager::UnobserveEquation(const std::string &equation_name)
+{
+    std::lock_guard<std::mutex> lock(observed_equation_mutex_);
+    auto it = observed_equation_count_map_.find(equation_name);
+    if (it != observed_equation_count_map_.end() && --it->second <= 0)
+    {
+        observed_equation_count_map_.erase(it);
+    }
+}
+
+bool EquationManager::IsEquationObserved(const std::string &equation_name) const
+{
+    std::lock_guard<std::mutex> lock(observed_equation_mutex_);
+    return observed_equation_count_map_.count(equation_name) != 0;
+}
+
+void EquationManager::RequestEquation(const std::string &equation_name)
+{
+    if (IsEquationExist(equation_name) == false)
+    {
+        throw EquationException::EquationNotFound(equation_name);
+    }
+
+    UpdateEquationsInternal(GetRequestOrder({equation_name}));
+}
+
+std::vector<std::string> EquationManager::GetUpdateOrder(const std::vector<std::string> &equation_names) const
+{
+    std::vector<std::string> topo_order = graph_->TopologicalSort(equation_names);
+    if (evaluation_mode_ == EvaluationMode::kEager)
+    {
+        return topo_order;
+    }
+
+    std::vector<std::string> observed_equation_names;
+    {
+        std::lock_guard<std::mutex> lock(observed_equation_mutex_);
+        for (const auto &node_name : topo_order)
+        {
+            if (observed_equation_count_map_.count(node_name) != 0)
+            {
+                observed_equation_names.push_back(node_name);
+            }
+        }
+    }
+    return GetRequestOrder(observed_equation_names);
+}
+
+std::vector<std::string> EquationManager::GetRequestOrder(const std::vector<std::string> &equation_names) const
+{
+    std::vector<std::string> request_order;
+    for (const auto &node_name : graph_->TopologicalSortDependencies(equation_names))
+    {
+        const DependencyGraph::Node *node = graph_->GetNode(node_name);
+        if (node && node->dirty_flag())
+        {
+            request_order.push_back(node_name);
+        }
+    }
+    return request_order;
+}
+
+void EquationManager::SetInterpretConcurrency(size_t concurrency)
+{
+    interpret_concurrency_ = std::max<size_t>(concurrency, 1);
+}
+
+void EquationManager::SetInterruptHandler(InterruptHandler interrupt_handler)
+{
+    interrupt_handler_ = interrupt_handler;
+}
+
+void EquationManager::SetBatchInterpretHandler(BatchInterpretHandler batch_interpret_handler)
+{
+    batch_interpret_handler_ = batch_interpret_handler;
+}
+
+void EquationManager::SetBatchEvalHandler(BatchEvalHandler batch_eval_handler)
+{
+    batch_eval_handler_ = batch_eval_handler;
+}
+
+void EquationManager::Interrupt()
+{
+    if (interrupt_handler_)
+    {
+        interrupt_handler_();
+    }
+}
+
+MemoryReport EquationManager::GetMemoryReport(size_t top_count) const
+{
+    MemoryReport report;
+    report.total_size = 0;
+    equation_registry_.ForEach([&](const Equation *equation) {
+        EquationMemoryUsage usage;
+        usage.equation_name = equation->name();
+        usage.value_size = 0;
+        if (!context_->GetValueSize(usage.equation_name, usage.value_size))
+        {
+            return;
+        }
+        auto it = allocation_delta_map_.find(usage.equation_name);
+        usage.allocation_delta = it != allocation_delta_map_.end() ? it->second : 0;
+        report.total_size += usage.value_size;
+        report.top_equations.push_back(std::move(usage));
+    });
+
+    auto larger = [](const EquationMemoryUsage &a, const EquationMemoryUsage &b) -> bool {
+        return a.value_size != b.value_size ? a.value_size > b.value_size : a.equation_name < b.equation_name;
+    };
+    if (report.top_equations.size() > top_count)
+    {
+        std::partial_sort(
+            report.top_equations.begin(), report.top_equations.begin() + top_count, report.top_equations.end(), larger
         );
+        report.top_equations.resize(top_count);
+    }
+    else
+    {
+        std::sort(report.top_equations.begin(), report.top_equations.end(), larger);
+    }
+    return report;
+}
+
+bool EquationManager::SetAllocationTracking(bool enabled)
+{
+    if (!context_->SetAllocationTracking(enabled))
+    {
+        allocation_tracking_ = false;
+        return false;
+    }
+    allocation_tracking_ = enabled;
+    if (!enabled)
+    {
+        allocation_delta_map_.clear();
+    }
+    return true;
+}
+
+void EquationManager::SetEvictionPolicy(const EvictionPolicy &policy)
+{
+    // values spilled under the previous policy are brought back first
+    while (!evicted_equations_.empty())
+    {
+        std::string equation_name = *evicted_equations_.begin();
+        MaterializeEquationInternal(equation_name);
+    }
+    eviction_policy_ = policy;
+    if (spill_key_salt_ == 0)
+    {
+        std::random_device random;
+        spill_key_salt_ = (static_cast<uint64_t>(random()) << 32) | random();
+    }
+
+    value_size_map_.clear();
+    if (eviction_policy_.memory_budget == 0)
+    {
+        return;
+    }
+    equation_registry_.ForEach([this](const Equation *equation) {
+        if (equation->status() == ResultStatus::kSuccess)
+        {
+            TrackValueSize(equation->name());
+        }
+    });
+    EnforceEvictionPolicy();
+}
+
+bool EquationManager::IsEquationEvicted(const std::string &equation_name) const
+{
+    return evicted_equations_.count(equation_name) != 0;
+}
+
+bool EquationManager::MaterializeEquation(const std::string &equation_name)
+{
+    if (IsEquationExist(equation_name) == false)
+    {
+        throw EquationException::EquationNotFound(equation_name);
+    }
+    return MaterializeEquationInternal(equation_name);
+}
+
+void EquationManager::SetResultCache(std::shared_ptr<EquationResultCache> result_cache)
+{
+    result_cache_ = result_cache;
+}
+
+void EquationManager::SetEquationCacheable(const std::string &equation_name, bool cacheable)
+{
+    if (IsEquationExist(equation_name) == false)
+    {
+        throw EquationException::EquationNotFound(equation_name);
+    }
+
+    GetEquationInternal(equation_name)->set_cacheable(cacheable);
+}
+
+Equation *EquationManager::GetEquationInternal(const std::string &equation_name)
+{
+    return equation_registry_.Get(equation_name);
+}
+
+EquationGroup *EquationManager::GetEquationGroupInternal(const EquationGroupId &group_id)
+{
+    if (equation_group_map_.contains(group_id))
+    {
+        return equation_group_map_.at(group_id).get();
+    }
+    return nullptr;
+}
+
+ScopedConnection EquationManager::ConnectGraphDependencyUpdated(std::vector<std::string> &dependency_updated_equation
+) const
+{
+    return graph_->ConnectNodeDependencyChangedSignal([&](const std::string &node_name) {
+        dependency_updated_equation.push_back(node_name);
+    });
+}
+
+ScopedConnection EquationManager::ConnectGraphDependentUpdated(std::vector<std::string> &dependent_updated_equation
+) const
+{
+    return graph_->ConnectNodeDependentChangedSignal([&](const std::string &node_name) {
+        dependent_updated_equation.push_back(node_name);
+    });
+}
+
+void EquationManager::NotifyEquationDependentsUpdated(const std::string &equation_name) const
+{
+    const Equation *equation = equation_registry_.Get(equation_name);
+    if (equation)
+    {
+        signals_manager_->Emit<EquationEvent::kEquationUpdated>(equation, EquationUpdateFlag::kDependents);
+    }
+}
+
+void EquationManager::NotifyEquationDependenciesUpdated(const std::string &equation_name) const
+{
+    const Equation *equation = equation_registry_.Get(equation_name);
+    if (equation)
+    {
+        signals_manager_->Emit<EquationEvent::kEquationUpdated>(equation, EquationUpdateFlag::kDependencies);
     }
 }
 
 std::string EquationManager::GenerateEquationDotNodeLabel(const std::string &equation_name) const
+{
+    std::string label;
+    AppendEquationNodeLabel(equation_name, GraphExportFormat::kDot, label);
+    return label;
+}
+
+void EquationManager::AppendEquationNodeLabel(
+    const std::string &equation_name, GraphExportFormat format, std::string &label) const
 {
     const Equation *equation = GetEquation(equation_name);
     if (!equation)
     {
-        return equation_name;
+        label.append(equation_name);
+        return;
+    }
+
+    const size_t max_content_length = 100;
+    const std::string &content = equation->content();
+    size_t content_length = std::min(content.length(), max_content_length);
+
+    if (format != GraphExportFormat::kDot)
+    {
+        // plain text, the exporter escapes it for the target format
+        label.append(equation_name);
+        label.append("\n");
+        label.append(ItemTypeConverter::ToString(equation->type()));
+        label.append("\n");
+        label.append(content, 0, content_length);
+        if (content_length < content.length())
+        {
+            label.append("...");
+        }
+        return;
     }
 
-    // Helper lambda to escape text for record labels
-    auto escape_for_record = [](const std::string& text) -> std::string {
-        std::string escaped;
-        for (char c : text)
+    // Record label characters are escaped here; quotes and line breaks are
+    // escaped by the DOT exporter when the label is written.
+    auto append_escaped = [&label](const char *text, size_t length) {
+        for (size_t i = 0; i < length; i++)
         {
-            // Escape all special characters for record format
-            if (c == '{' || c == '}' || c == '|' || c == '<' || c == '>')
+            char c = text[i];
+            switch (c)
             {
-                escaped += "\\";
-                escaped += c;
+            case '{':
+            case '}':
+            case '|':
+            case '<':
+            case '>':
+            case '\\':
+                label.push_back('\\');
+                label.push_back(c);
+                break;
+            case '\r':
+                break;
+            case '\t':
+                label.append("    ");
+                break;
+            default:
+                label.push_back(c);
+                break;
             }
-            else if (c == '"')
+        }
+    };
+
+    // Build record format: {name|{type|content}}
+    label.push_back('{');
+    append_escaped(equation_name.data(), equation_name.size());
+    label.append("|{");
+    std::string type_str = ItemTypeConverter::ToString(equation->type());
+    append_escaped(type_str.data(), type_str.size());
+    label.push_back('|');
+    append_escaped(content.data(), content_length);
+    if (content_length < content.length())
+    {
+        label.append("...");
+    }
+    label.append("}}");
+}
+
+bool EquationManager::ExportDependencyGraph(
+    DependencyGraphExporter::Sink sink, GraphExportFormat format, DependencyGraphExporter::NodeFilter filter) const
+{
+    DependencyGraphExporter exporter(sink);
+    exporter.SetNodeFilter(filter);
+    exporter.SetDotNodeAttributes("shape=Mrecord");
+    exporter.SetNodeLabelHandler(
+        [this](const std::string &node_name, GraphExportFormat label_format, std::string &label) {
+            AppendEquationNodeLabel(node_name, label_format, label);
+        }
+    );
+    return exporter.Export(*graph_, format);
+}
+
+bool EquationManager::WriteDependencyGraphToDotFile(const std::string &file_path) const
+{
+    std::FILE *file = std::fopen(file_path.c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool result = ExportDependencyGraph(DependencyGraphExporter::FileSink(file), GraphExportFormat::kDot);
+    return std::fclose(file) == 0 && result;
+}
+
+std::vector<std::string> EquationManager::GetEquationNeighborhood(
+    const std::vector<std::string> &equation_names, int upstream_hops, int downstream_hops) const
+{
+    for (const auto &equation_name : equation_names)
+    {
+        if (IsEquationExist(equation_name) == false)
+        {
+            throw EquationException::EquationNotFound(equation_name);
+        }
+    }
+    return graph_->GetNeighborhood(equation_names, upstream_hops, downstream_hops);
+}
+
+DependencyGraphView EquationManager::GetDependencyGraphView(const DependencyGraphViewOptions &options) const
+{
+    std::vector<std::string> node_names =
+        options.focus_equations.empty()
+            ? graph_->TopologicalSort()
+            : GetEquationNeighborhood(options.focus_equations, options.upstream_hops, options.downstream_hops);
+
+    DependencyGraphView view;
+    if (!options.collapse_groups)
+    {
+        view.graph = graph_->ExtractSubgraph(node_names);
+        return view;
+    }
+
+    std::set<EquationGroupId> expanded_group_ids;
+    for (const auto &equation_name : options.focus_equations)
+    {
+        expanded_group_ids.insert(equation_registry_.Get(equation_name)->group_id());
+    }
+
+    auto get_view_node_name = [&](const std::string &node_name) -> std::string {
+        const Equation *equation = equation_registry_.Get(node_name);
+        if (!equation || expanded_group_ids.count(equation->group_id()) != 0)
+        {
+            return node_name;
+        }
+        const EquationGroup *group = GetEquationGroup(equation->group_id());
+        if (!group || group->GetEquationNames().size() <= 1)
+        {
+            return node_name;
+        }
+        std::string group_node_name = GetGroupNodeName(equation->group_id());
+        view.group_nodes[group_node_name] = equation->group_id();
+        return group_node_name;
+    };
+
+    std::unordered_set<std::string> node_set(node_names.begin(), node_names.end());
+    std::vector<std::string> view_node_names;
+    std::unordered_set<std::string> view_node_set;
+    std::vector<DependencyGraph::Edge> view_edges;
+    std::set<std::pair<std::string, std::string>> view_edge_set;
+    for (const auto &node_name : node_names)
+    {
+        std::string view_node_name = get_view_node_name(node_name);
+        if (view_node_set.insert(view_node_name).second)
+        {
+            view_node_names.push_back(view_node_name);
+        }
+
+        for (const auto &dependency : graph_->GetNode(node_name)->dependencies())
+        {
+            if (node_set.count(dependency) == 0)
             {
-                escaped += "\\\"";
+                continue;
             }
-            else if (c == '\\')
+            std::string view_dependency = get_view_node_name(dependency);
+            if (view_dependency != view_node_name && view_edge_set.emplace(view_node_name, view_dependency).second)
             {
-                escaped += "\\\\";
+                view_edges.emplace_back(view_node_name, view_dependency);
             }
-            else if (c == '\n')
+        }
+    }
+
+    // groups may depend on each other through different equations, the
+    // view keeps those edges even though they form cycles between group nodes
+    view.graph.reset(new DependencyGraph());
+    view.graph->AddNodes(view_node_names);
+    view.graph->AddEdgesWithoutCycleCheck(view_edges);
+    return view;
+}
+
+std::string EquationManager::GetGroupNodeName(const EquationGroupId &group_id)
+{
+    return "group:" + boost::uuids::to_string(group_id);
+}
+
+bool EquationManager::SaveSnapshot(const std::string &file_path) const
+{
+    EquationSnapshot snapshot;
+    snapshot.language = language_;
+    for (const auto &group_entry : equation_group_map_)
+    {
+        const EquationGroup *group = group_entry.second.get();
+        EquationGroupSnapshot group_snapshot;
+        group_snapshot.id = group->id();
+        group_snapshot.statement = group->statement();
+        for (const auto &equation_name : group->GetEquationNames())
+        {
+            const Equation *equation = group->GetEquation(equation_name);
+            EquationSnapshotItem item;
+            item.name = equation->name();
+            item.content = equation->content();
+            item.type = equation->type();
+            const auto &dependencies = equation->GetDependencies();
+            item.dependencies.assign(dependencies.begin(), dependencies.end());
+            item.status = equation->status();
+            item.message = equation->message();
+            item.content_hash = EquationSnapshot::ComputeItemHash(item);
+            // spilled values are saved from the spill cache, dropped ones are not saved
+            item.has_value = equation->status() == ResultStatus::kSuccess &&
+                             (ReadSpilledValue(equation_name, item.value_data) ||
+                              (context_->Contains(equation_name) && context_->SerializeValue(equation_name, item.value_data)));
+            if (!item.has_value)
             {
-                escaped += "\\n";
+                item.value_data.clear();
             }
-            else if (c == '\r')
+            item.value_hash = ComputeContentHash(item.value_data);
+            group_snapshot.items.push_back(std::move(item));
+        }
+        snapshot.groups.push_back(std::move(group_snapshot));
+    }
+    return snapshot.WriteToFile(file_path);
+}
+
+bool EquationManager::LoadSnapshot(const std::string &file_path)
+{
+    EquationSnapshot snapshot;
+    if (!EquationSnapshot::ReadFromFile(file_path, snapshot) || snapshot.language != language_)
+    {
+        return false;
+    }
+
+    std::set<std::string> snapshot_equation_names;
+    std::set<EquationGroupId> snapshot_group_ids;
+    for (const auto &group_snapshot : snapshot.groups)
+    {
+        if (!snapshot_group_ids.insert(group_snapshot.id).second)
+        {
+            return false;
+        }
+        for (const auto &item : group_snapshot.items)
+        {
+            if (!snapshot_equation_names.insert(item.name).second)
             {
-                // Skip carriage return
+                return false;
             }
-            else if (c == '\t')
+        }
+    }
+
+    // the current workspace is only torn down once the snapshot graph is known to be valid
+    DependencyGraph snapshot_graph;
+    try
+    {
+        DependencyGraph::BatchUpdateGuard snapshot_guard(&snapshot_graph);
+        for (const auto &equation_name : snapshot_equation_names)
+        {
+            if (equation_name.empty())
             {
-                escaped += "    "; // Replace tab with spaces
+                return false;
             }
-            else
+            snapshot_graph.AddNode(equation_name);
+        }
+        for (const auto &group_snapshot : snapshot.groups)
+        {
+            for (const auto &item : group_snapshot.items)
             {
-                escaped += c;
+                for (const auto &dependency : item.dependencies)
+                {
+                    if (dependency.empty() || dependency == item.name)
+                    {
+                        return false;
+                    }
+                    snapshot_graph.AddEdge({item.name, dependency});
+                }
             }
         }
-        return escaped;
-    };
+        snapshot_guard.commit();
+    }
+    catch (const DependencyCycleException &)
+    {
+        return false;
+    }
 
-    // Escape equation name
-    std::string escaped_name = escape_for_record(equation_name);
+    for (const auto &group_id : GetEquationGroupIds())
+    {
+        RemoveEquationGroup(group_id);
+    }
 
-    // Get and escape type
-    std::string type_str = ItemTypeConverter::ToString(equation->type());
-    std::string escaped_type = escape_for_record(type_str);
+    std::vector<std::string> dependency_updated_equation;
+    ScopedConnection dependency_connection = ConnectGraphDependencyUpdated(dependency_updated_equation);
 
-    // Truncate content if too long
-    std::string content = equation->content();
-    const size_t max_content_length = 100;
-    bool truncated = false;
-    
-    if (content.length() > max_content_length)
+    std::vector<std::string> dependent_updated_equation;
+    ScopedConnection dependent_connection = ConnectGraphDependentUpdated(dependent_updated_equation);
+
+    DependencyGraph::BatchUpdateGuard guard(graph_.get());
+    for (const auto &group_snapshot : snapshot.groups)
+    {
+        for (const auto &item : group_snapshot.items)
+        {
+            AddNodeToGraph(item.name, item.dependencies);
+        }
+    }
+    guard.commit();
+
+    std::vector<std::string> to_invalidate_equation_names;
+    std::unordered_set<std::string> to_execute_equation_names;
+    for (const auto &group_snapshot : snapshot.groups)
+    {
+        EquationGroupPtr group = EquationGroup::Create(group_snapshot.id, this);
+        group->set_statement(group_snapshot.statement);
+        auto group_ptr = group.get();
+        equation_group_map_.insert({group_snapshot.id, std::move(group)});
+        for (const auto &item : group_snapshot.items)
+        {
+            ParseResultItem parse_item;
+            parse_item.name = item.name;
+            parse_item.content = item.content;
+            parse_item.type = item.type;
+            parse_item.dependencies = item.dependencies;
+            parse_item.status = item.status;
+            parse_item.message = item.message;
+
+            EquationPtr equation = Equation::Create(parse_item, group_snapshot.id, this);
+            value_hash_map_.erase(item.name);
+            // only final results are restored, equations saved before or while
+            // they ran are computed again
+            bool restored = false;
+            bool is_statement = item.type == ItemType::kImport || item.type == ItemType::kImportFrom ||
+                                item.type == ItemType::kFunction || item.type == ItemType::kClass;
+            if (item.status == ResultStatus::kSuccess && !item.has_value && is_statement)
+            {
+                // modules, functions and classes can not be serialized, their
+                // statements are executed once every value is restored
+                to_execute_equation_names.insert(item.name);
+            }
+            else if (item.status == ResultStatus::kSuccess)
+            {
+                restored = item.has_value && context_->DeserializeValue(item.name, item.value_data);
+            }
+            else
+            {
+                restored = item.status != ResultStatus::kPending && item.status != ResultStatus::kCalculating &&
+                           item.status != ResultStatus::kKeyBoardInterrupt;
+            }
+            if (restored)
+            {
+                equation->set_status(item.status);
+                equation->set_message(item.message);
+                graph_->MakeNodeDirty(item.name, false);
+            }
+            else if (to_execute_equation_names.count(item.name) == 0)
+            {
+                to_invalidate_equation_names.push_back(item.name);
+            }
+            AddEquationToGroup(group_ptr, std::move(equation));
+            signals_manager_->Emit<EquationEvent::kEquationAdded>(group_ptr->GetEquation(item.name));
+        }
+        signals_manager_->Emit<EquationEvent::kEquationGroupAdded>(group_ptr);
+    }
+
+    // executed in dependency order, a statement only runs when what it depends
+    // on was restored, otherwise it is recomputed like any other equation
+    if (!to_execute_equation_names.empty())
     {
-        content = content.substr(0, max_content_length);
-        truncated = true;
+        std::unordered_set<std::string> unrestored_names(
+            to_invalidate_equation_names.begin(), to_invalidate_equation_names.end()
+        );
+        for (const auto &equation_name : graph_->TopologicalSort())
+        {
+            if (to_execute_equation_names.count(equation_name) == 0)
+            {
+                continue;
+            }
+            bool ready = true;
+            for (const auto &dependency : graph_->GetNode(equation_name)->dependencies())
+            {
+                if (unrestored_names.count(dependency) != 0)
+                {
+                    ready = false;
+                    break;
+                }
+            }
+            Equation *equation = GetEquationInternal(equation_name);
+            if (ready &&
+                interpret_handler_(GetEquationStatement(equation), context_.get(), InterpretMode::kExec).status ==
+                    ResultStatus::kSuccess)
+            {
+                equation->set_status(ResultStatus::kSuccess);
+                equation->set_message("");
+                graph_->MakeNodeDirty(equation_name, false);
+                signals_manager_->Emit<EquationEvent::kEquationUpdated>(
+                    equation, EquationUpdateFlag::kStatus | EquationUpdateFlag::kMessage | EquationUpdateFlag::kValue
+                );
+            }
+            else
+            {
+                unrestored_names.insert(equation_name);
+                to_invalidate_equation_names.push_back(equation_name);
+            }
+        }
     }
 
-    if (truncated)
+    // values that could not be restored are recomputed together with everything downstream
+    for (const auto &equation_name : to_invalidate_equation_names)
     {
-        content += "...";
+        graph_->InvalidateNode(equation_name);
     }
 
-    // Escape content
-    std::string escaped_content = escape_for_record(content);
+    for (const auto &equation_name : dependency_updated_equation)
+    {
+        NotifyEquationDependenciesUpdated(equation_name);
+    }
 
-    // Build record format: {name|{type|content}}
-    std::ostringstream oss;
-    oss << "{" << escaped_name << "|{" << escaped_type << "|" << escaped_content << "}}";
-    return oss.str();
-}
+    for (const auto &equation_name : dependent_updated_equation)
+    {
+        NotifyEquationDependentsUpdated(equation_name);
+    }
 
-bool EquationManager::WriteDependencyGraphToDotFile(const std::string &file_path) const
-{
-    return graph_->WriteDotFile(file_path, [this](const std::string &node_name) {
-        return GenerateEquationDotNodeLabel(node_name);
-    });
+    return true;
 }
 
 } // namespace xequation
\ No newline at end of file
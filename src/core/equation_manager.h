@@ -1,16 +1,22 @@
 #pragma once
 #include <exception>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <boost/uuid/uuid_io.hpp>
 
 #include "dependency_graph.h"
+#include "dependency_graph_exporter.h"
 #include "equation.h"
 #include "equation_common.h"
 #include "equation_context.h"
 #include "equation_group.h"
+#include "equation_registry.h"
+#include "equation_result_cache.h"
 #include "equation_signals_manager.h"
 
 namespace xequation
@@ -118,6 +124,56 @@ class EquationException : public std::exception
     mutable std::string message_cache_;
 };
 
+struct DependencyGraphViewOptions
+{
+    // equations to center the view on, empty shows every equation
+    std::vector<std::string> focus_equations;
+    // hops around the focus equations, negative is unlimited
+    int upstream_hops = -1;
+    int downstream_hops = -1;
+    // groups of several equations become a single node, except the groups
+    // holding a focus equation
+    bool collapse_groups = false;
+};
+
+struct DependencyGraphView
+{
+    std::unique_ptr<DependencyGraph> graph;
+    // node name of each collapsed group
+    std::map<std::string, EquationGroupId> group_nodes;
+};
+
+struct EquationMemoryUsage
+{
+    std::string equation_name;
+    // estimated bytes of the value the equation holds in the context
+    size_t value_size;
+    // bytes the context allocated during the last update of the equation,
+    // negative when it freed more, 0 unless allocation tracking was enabled
+    int64_t allocation_delta;
+};
+
+struct MemoryReport
+{
+    // value size of all equations
+    size_t total_size;
+    // equations holding the most memory, largest first
+    std::vector<EquationMemoryUsage> top_equations;
+};
+
+struct EvictionPolicy
+{
+    // Values of unobserved variables are evicted, largest first, while the
+    // values of all equations exceed this many bytes. 0 disables eviction.
+    uint64_t memory_budget = 0;
+    // smaller values always stay in the context
+    uint64_t min_value_size = 1024 * 1024;
+    // Evicted values are spilled to this cache and reloaded from it. Without
+    // it, or once the cache dropped them, they are recomputed from their
+    // dependencies.
+    std::shared_ptr<EquationResultCache> spill_cache;
+};
+
 class EquationManager
 {
   public:
@@ -130,6 +186,13 @@ class EquationManager
 
     const Equation *GetEquation(const std::string &equation_name) const;
 
+    // Handles stay valid until the equation is removed, looking an equation
+    // up by handle does not hash its name.
+    EquationHandle GetEquationHandle(const std::string &equation_name) const;
+
+    // Null if the equation was removed since the handle was taken.
+    const Equation *GetEquation(EquationHandle handle) const;
+
     std::vector<EquationGroupId> GetEquationGroupIds() const;
 
     std::vector<std::string> GetEquationNames() const;
@@ -150,7 +213,12 @@ class EquationManager
 
     ParseResult Parse(const std::string &expression, ParseMode mode) const;
 
-    InterpretResult Eval(const std::string &expression) const;
+    // Evicted values the expression reads are materialized first.
+    InterpretResult Eval(const std::string &expression);
+
+    // Eval() for every expression, through the batch eval handler when one
+    // is set. Returns one result per expression.
+    std::vector<InterpretResult> EvalBatch(const std::vector<std::string> &expressions);
 
     void Reset();
 
@@ -164,8 +232,107 @@ class EquationManager
 
     void UpdateEquationStatus(const std::string &equation_name, ResultStatus status, const std::string& message = "");
 
+    // In lazy mode updates only compute observed equations and the upstream
+    // equations they need, other equations stay pending until requested.
+    void SetEvaluationMode(EvaluationMode mode);
+
+    // Observers are reference counted, names without an equation may be observed.
+    void ObserveEquation(const std::string &equation_name);
+
+    void UnobserveEquation(const std::string &equation_name);
+
+    bool IsEquationObserved(const std::string &equation_name) const;
+
+    // Equations of one update that do not depend on each other are
+    // interpreted by up to concurrency threads at once, the interpret handler
+    // and the context have to be thread safe then. 1 keeps updates sequential.
+    void SetInterpretConcurrency(size_t concurrency);
+
+    // Interrupt() stops the equations being interpreted through the handler,
+    // they end with ResultStatus::kKeyBoardInterrupt. Engines install it on
+    // the managers they create.
+    void SetInterruptHandler(InterruptHandler interrupt_handler);
+
+    // Equations of one update that do not depend on each other are offered
+    // to the batch handler together before they are interpreted one by one,
+    // so an engine can compute many alike equations in one go. The statements
+    // it leaves are interpreted through the interpret handler.
+    void SetBatchInterpretHandler(BatchInterpretHandler batch_interpret_handler);
+
+    // EvalBatch() hands all expressions to it at once, so an engine locks
+    // its interpreter once per batch instead of once per expression.
+    void SetBatchEvalHandler(BatchEvalHandler batch_eval_handler);
+
+    // May be called from any thread, does nothing without an interrupt handler.
+    void Interrupt();
+
+    // Computes the equation and the dirty equations it depends on.
+    void RequestEquation(const std::string &equation_name);
+
+    // Equations an update of the given ones computes, in topological order.
+    std::vector<std::string> GetUpdateOrder(const std::vector<std::string> &equation_names) const;
+
+    // Dirty equations needed to read the given ones, in topological order.
+    std::vector<std::string> GetRequestOrder(const std::vector<std::string> &equation_names) const;
+
+    // Results of cacheable variables are looked up in / written to the cache,
+    // keyed by their code and the values of their dependencies. Entries are
+    // deserialized into the context (for Python with pickle, which runs code),
+    // so the cache directory must only be writable by trusted users.
+    void SetResultCache(std::shared_ptr<EquationResultCache> result_cache);
+
+    void SetEquationCacheable(const std::string &equation_name, bool cacheable);
+
     bool WriteDependencyGraphToDotFile(const std::string &file_path) const;
 
+    // Streams the dependency graph with equation labels to sink. Only nodes
+    // accepted by filter are written, all of them when filter is empty.
+    bool ExportDependencyGraph(
+        DependencyGraphExporter::Sink sink, GraphExportFormat format,
+        DependencyGraphExporter::NodeFilter filter = nullptr) const;
+
+    // The given equations plus their upstream / downstream neighbours within
+    // the hop counts, negative is unlimited.
+    std::vector<std::string> GetEquationNeighborhood(
+        const std::vector<std::string> &equation_names, int upstream_hops, int downstream_hops) const;
+
+    // A reduced copy of the dependency graph for display.
+    DependencyGraphView GetDependencyGraphView(const DependencyGraphViewOptions &options) const;
+
+    static std::string GetGroupNodeName(const EquationGroupId &group_id);
+
+    // Sizes every equation value in the context, which walks the referenced
+    // objects; huge containers are sampled by the context.
+    MemoryReport GetMemoryReport(size_t top_count = 10) const;
+
+    // Records what the context allocates while each equation is interpreted.
+    // Only sequential updates are measured, concurrent interpretations would
+    // count each other's allocations. Returns false if the context can not
+    // track allocations.
+    bool SetAllocationTracking(bool enabled);
+
+    // Bounds the memory held by equation values, checked after every update.
+    // Value sizes come from EquationContext::GetValueSize, contexts that can
+    // not size values never evict.
+    void SetEvictionPolicy(const EvictionPolicy &policy);
+
+    bool IsEquationEvicted(const std::string &equation_name) const;
+
+    // Brings an evicted value back into the context. Updates, requests and
+    // Eval() do this for the values they read; call it before reading an
+    // unobserved value from context() directly. Returns false if recomputing
+    // the value failed.
+    bool MaterializeEquation(const std::string &equation_name);
+
+    // Writes groups, equations, statuses and (when the context supports it)
+    // values to a binary snapshot file.
+    bool SaveSnapshot(const std::string &file_path) const;
+
+    // Replaces the current workspace with a snapshot. Dependencies are restored
+    // without re-parsing, equations whose value was restored are left clean so
+    // a following Update() only recomputes the rest.
+    bool LoadSnapshot(const std::string &file_path);
+
     const DependencyGraph &graph()
     {
         return *graph_;
@@ -186,6 +353,21 @@ class EquationManager
         return language_;
     }
 
+    EvaluationMode evaluation_mode() const
+    {
+        return evaluation_mode_;
+    }
+
+    const std::shared_ptr<EquationResultCache> &result_cache() const
+    {
+        return result_cache_;
+    }
+
+    size_t interpret_concurrency() const
+    {
+        return interpret_concurrency_;
+    }
+
   private:
     EquationManager(const EquationManager &) = delete;
     EquationManager &operator=(const EquationManager &) = delete;
@@ -195,10 +377,50 @@ class EquationManager
 
     Equation *GetEquationInternal(const std::string &equation_name);
     EquationGroup *GetEquationGroupInternal(const EquationGroupId &group_id);
+    // an equation between BeginEquationUpdate and FinishEquationUpdate
+    struct PendingEquationUpdate
+    {
+        std::string equation_name;
+        std::string statement;
+        bool use_cache;
+        uint64_t cache_key;
+    };
+
     void UpdateEquationInternal(const std::string &equation_name);
+    void UpdateEquationsInternal(const std::vector<std::string> &topo_order);
+    void UpdateEquationsInWaves(const std::vector<std::string> &topo_order);
+    // false when nothing has to be interpreted (clean or restored from the cache)
+    bool BeginEquationUpdate(const std::string &equation_name, PendingEquationUpdate &update);
+    // true if a dependency failed, the equation is marked kUpstreamError then
+    bool BlockOnFailedDependency(Equation *equation, const DependencyGraph::Node *node);
+    void FinishEquationUpdate(const PendingEquationUpdate &update, const InterpretResult &result);
+    void CompleteEquationUpdate(Equation *equation);
+    void RemoveContextValue(const std::string &equation_name);
+    static std::string GetEquationStatement(const Equation *equation);
+
+    void TrackValueSize(const std::string &equation_name);
+    void EnforceEvictionPolicy();
+    void EvictEquationValue(const std::string &equation_name);
+    bool MaterializeEquationInternal(const std::string &equation_name);
+    void MaterializeExpressionDependencies(const std::string &expression);
+    // forgets an evicted value, the equation is recomputed or gone
+    void DiscardEvictedValue(const std::string &equation_name);
+    bool ReadSpilledValue(const std::string &equation_name, std::string &data) const;
+    uint64_t GetSpillKey(const std::string &equation_name) const;
+
+    // ignores line endings and trailing whitespace, cosmetic edits keep the hash
+    static std::string NormalizeContent(const std::string &content);
+    bool ComputeResultCacheKey(const Equation *equation, uint64_t &key);
+    // Serialized value for variables. Imports, functions and classes bind
+    // objects that can not be serialized (modules, code defined by equations),
+    // they are hashed by their statement and the hashes of their dependencies
+    // (the version of an imported package is not part of it).
+    bool GetValueHash(const std::string &equation_name, uint64_t &hash);
 
     void AddNodeToGraph(const std::string &node_name, const std::vector<std::string> &dependencies);
     void RemoveNodeInGraph(const std::string &node_name);
+    // applies the difference to the current dependencies, unchanged edges are left alone
+    void UpdateNodeDependenciesInGraph(const std::string &node_name, const std::vector<std::string> &dependencies);
 
     void AddEquationToGroup(EquationGroup *group, EquationPtr equation);
     void RemoveEquationInGroup(EquationGroup *group, const std::string &equation_name);
@@ -210,16 +432,42 @@ class EquationManager
     void NotifyEquationDependenciesUpdated(const std::string &equation_name) const;
 
     std::string GenerateEquationDotNodeLabel(const std::string &equation_name) const;
+    void AppendEquationNodeLabel(const std::string &equation_name, GraphExportFormat format, std::string &label) const;
   private:
     std::unique_ptr<DependencyGraph> graph_;
     std::unique_ptr<EquationContext> context_;
     std::unique_ptr<EquationSignalsManager> signals_manager_;
 
     EquationGroupPtrOrderedMap equation_group_map_;
-    std::unordered_map<std::string, boost::uuids::uuid> equation_name_to_group_id_map_;
+    EquationRegistry equation_registry_;
 
     InterpretHandler interpret_handler_ = nullptr;
     ParseHandler parse_handler_ = nullptr;
+    InterruptHandler interrupt_handler_ = nullptr;
+    BatchInterpretHandler batch_interpret_handler_ = nullptr;
+    BatchEvalHandler batch_eval_handler_ = nullptr;
     std::string language_{};
+
+    EvaluationMode evaluation_mode_{EvaluationMode::kEager};
+    // observers register from the ui thread while updates run in a task
+    std::unordered_map<std::string, int> observed_equation_count_map_;
+    mutable std::mutex observed_equation_mutex_;
+
+    std::shared_ptr<EquationResultCache> result_cache_;
+    // hashes of serialized context values, valid until the value is removed or recomputed
+    std::unordered_map<std::string, uint64_t> value_hash_map_;
+
+    bool allocation_tracking_{false};
+    // allocation delta of the last update per equation
+    std::unordered_map<std::string, int64_t> allocation_delta_map_;
+
+    EvictionPolicy eviction_policy_;
+    // sizes of the values in the context, kept while eviction is enabled
+    std::unordered_map<std::string, uint64_t> value_size_map_;
+    std::unordered_set<std::string> evicted_equations_;
+    // keeps spill entries of managers sharing a cache directory apart
+    uint64_t spill_key_salt_{0};
+
+    size_t interpret_concurrency_{1};
 };
 } // namespace xequation
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "equation_registry.h"
+
+#include "equation.h"
+
+namespace xequation
+{
+EquationHandle EquationRegistry::Add(Equation *equation)
+{
+    EquationHandle handle;
+    auto it = index_map_.find(equation->name());
+    if (it != index_map_.end())
+    {
+        handle.index = it->second;
+    }
+    else if (!free_slots_.empty())
+    {
+        handle.index = free_slots_.back();
+        free_slots_.pop_back();
+        index_map_.emplace(equation->name(), handle.index);
+    }
+    else
+    {
+        handle.index = static_cast<uint32_t>(slots_.size());
+        slots_.push_back(Slot{nullptr, 0});
+        index_map_.emplace(equation->name(), handle.index);
+    }
+
+    Slot &slot = slots_[handle.index];
+    if (slot.equation && slot.equation != equation)
+    {
+        // handles of the replaced equation go stale
+        slot.generation++;
+    }
+    slot.equation = equation;
+    handle.generation = slot.generation;
+    return handle;
+}
+
+bool EquationRegistry::Remove(const std::string &equation_name)
+{
+    auto it = index_map_.find(equation_name);
+    if (it == index_map_.end())
+    {
+        return false;
+    }
+    Slot &slot = slots_[it->second];
+    slot.equation = nullptr;
+    // handles given out for the slot go stale
+    slot.generation++;
+    free_slots_.push_back(it->second);
+    index_map_.erase(it);
+    return true;
+}
+
+void EquationRegistry::Clear()
+{
+    index_map_.clear();
+    free_slots_.clear();
+    for (uint32_t index = 0; index < slots_.size(); index++)
+    {
+        slots_[index].equation = nullptr;
+        slots_[index].generation++;
+        free_slots_.push_back(index);
+    }
+}
+
+EquationHandle EquationRegistry::Find(const std::string &equation_name) const
+{
+    EquationHandle handle;
+    auto it = index_map_.find(equation_name);
+    if (it != index_map_.end())
+    {
+        handle.index = it->second;
+        handle.generation = slots_[it->second].generation;
+    }
+    return handle;
+}
+
+Equation *EquationRegistry::Get(const std::string &equation_name) const
+{
+    auto it = index_map_.find(equation_name);
+    return it != index_map_.end() ? slots_[it->second].equation : nullptr;
+}
+
+Equation *EquationRegistry::Get(EquationHandle handle) const
+{
+    if (handle.index >= slots_.size())
+    {
+        return nullptr;
+    }
+    const Slot &slot = slots_[handle.index];
+    return slot.generation == handle.generation ? slot.equation : nullptr;
+}
+} // namespace xequation
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace xequation
+{
+class Equation;
+
+// Id of a registered equation that stays valid until the equation is
+// removed. The generation tells a handle of a removed equation apart from
+// one of the equation reusing its slot.
+struct EquationHandle
+{
+    static constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    uint32_t index = kInvalidIndex;
+    uint32_t generation = 0;
+
+    bool valid() const
+    {
+        return index != kInvalidIndex;
+    }
+
+    bool operator==(const EquationHandle &other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const EquationHandle &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Flat index of the equations of a manager: one hash from the name to a
+// dense slot, handles reach the slot without hashing. The equations stay
+// owned by their groups.
+class EquationRegistry
+{
+  public:
+    // Replaces an equation registered under the same name, handles of the
+    // replaced one stop resolving.
+    EquationHandle Add(Equation *equation);
+
+    bool Remove(const std::string &equation_name);
+
+    void Clear();
+
+    // An invalid handle if no equation has the name.
+    EquationHandle Find(const std::string &equation_name) const;
+
+    Equation *Get(const std::string &equation_name) const;
+
+    // Null for invalid handles and handles of removed equations.
+    Equation *Get(EquationHandle handle) const;
+
+    size_t size() const
+    {
+        return index_map_.size();
+    }
+
+    // Calls func for every registered equation, in slot order.
+    template <typename Func>
+    void ForEach(Func func) const
+    {
+        for (const auto &slot : slots_)
+        {
+            if (slot.equation)
+            {
+                func(slot.equation);
+            }
+        }
+    }
+
+  private:
+    struct Slot
+    {
+        Equation *equation;
+        uint32_t generation;
+    };
+
+    std::unordered_map<std::string, uint32_t> index_map_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_slots_;
+};
+} // namespace xequation
@@ -0,0 +1,300 @@
+#include "equation_result_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include "content_hash.h"
+
+namespace xequation
+{
+namespace
+{
+const char kEntryMagic[4] = {'X', 'E', 'Q', 'R'};
+const char kEntryExtension[] = ".xeqr";
+constexpr size_t kEntryHeaderSize = sizeof(kEntryMagic) + 8 + 8;
+
+void AppendUint64(std::string &buffer, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+uint64_t ReadUint64(const char *data)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (i * 8);
+    }
+    return value;
+}
+
+bool ParseEntryKey(const std::string &stem, uint64_t &key)
+{
+    if (stem.size() != 16)
+    {
+        return false;
+    }
+    key = 0;
+    for (char c : stem)
+    {
+        key <<= 4;
+        if (c >= '0' && c <= '9')
+        {
+            key |= static_cast<uint64_t>(c - '0');
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            key |= static_cast<uint64_t>(c - 'a' + 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+EquationResultCache::EquationResultCache(const std::string &directory, uint64_t max_size)
+    : directory_(directory), max_size_(max_size), total_size_(0)
+{
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(directory_, ec);
+    LoadIndex();
+    Evict();
+}
+
+bool EquationResultCache::Lookup(uint64_t key, std::string &data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::string path = GetEntryPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        RemoveInternal(key);
+        return false;
+    }
+    std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    if (buffer.size() < kEntryHeaderSize || std::memcmp(buffer.data(), kEntryMagic, sizeof(kEntryMagic)) != 0 ||
+        ReadUint64(buffer.data() + sizeof(kEntryMagic)) != key)
+    {
+        RemoveInternal(key);
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
+        return false;
+    }
+
+    std::string payload = buffer.substr(kEntryHeaderSize);
+    if (ReadUint64(buffer.data() + sizeof(kEntryMagic) + 8) != ComputeContentHash(payload))
+    {
+        RemoveInternal(key);
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
+        return false;
+    }
+
+    // the entry may have been written by another process sharing the directory
+    if (entry_map_.count(key) == 0)
+    {
+        lru_list_.push_front(key);
+        entry_map_[key] = Entry{lru_list_.begin(), buffer.size()};
+        total_size_ += buffer.size();
+    }
+    Touch(key);
+    data = std::move(payload);
+    return true;
+}
+
+bool EquationResultCache::Store(uint64_t key, const std::string &data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::string buffer;
+    buffer.reserve(kEntryHeaderSize + data.size());
+    buffer.append(kEntryMagic, sizeof(kEntryMagic));
+    AppendUint64(buffer, key);
+    AppendUint64(buffer, ComputeContentHash(data));
+    buffer.append(data);
+
+    if (buffer.size() > max_size_)
+    {
+        return false;
+    }
+
+    // write to a temporary file first so readers never see a partial entry
+    static boost::uuids::random_generator rgen;
+    std::string path = GetEntryPath(key);
+    std::string temp_path = path + "." + boost::uuids::to_string(rgen()) + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        file.close();
+        if (file.fail())
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove(temp_path, ec);
+            return false;
+        }
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(temp_path, path, ec);
+    if (ec)
+    {
+        boost::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    RemoveInternal(key);
+    lru_list_.push_front(key);
+    entry_map_[key] = Entry{lru_list_.begin(), buffer.size()};
+    total_size_ += buffer.size();
+    Evict();
+    return true;
+}
+
+bool EquationResultCache::Contains(uint64_t key) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entry_map_.count(key) != 0;
+}
+
+void EquationResultCache::Remove(uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    RemoveInternal(key);
+    boost::system::error_code ec;
+    boost::filesystem::remove(GetEntryPath(key), ec);
+}
+
+void EquationResultCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint64_t key : lru_list_)
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove(GetEntryPath(key), ec);
+    }
+    lru_list_.clear();
+    entry_map_.clear();
+    total_size_ = 0;
+}
+
+uint64_t EquationResultCache::total_size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_size_;
+}
+
+size_t EquationResultCache::entry_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entry_map_.size();
+}
+
+void EquationResultCache::LoadIndex()
+{
+    std::vector<std::tuple<std::time_t, uint64_t, uint64_t>> entries;
+
+    boost::system::error_code ec;
+    boost::filesystem::directory_iterator it(directory_, ec);
+    boost::filesystem::directory_iterator end;
+    for (; !ec && it != end; it.increment(ec))
+    {
+        const boost::filesystem::path &path = it->path();
+        uint64_t key = 0;
+        if (path.extension() != kEntryExtension || !ParseEntryKey(path.stem().string(), key))
+        {
+            continue;
+        }
+        boost::system::error_code entry_ec;
+        uint64_t size = boost::filesystem::file_size(path, entry_ec);
+        std::time_t time = boost::filesystem::last_write_time(path, entry_ec);
+        if (entry_ec)
+        {
+            continue;
+        }
+        entries.emplace_back(time, key, size);
+    }
+
+    // most recently used first
+    std::sort(entries.begin(), entries.end(), [](const std::tuple<std::time_t, uint64_t, uint64_t> &lhs,
+                                                 const std::tuple<std::time_t, uint64_t, uint64_t> &rhs) {
+        return std::get<0>(lhs) > std::get<0>(rhs);
+    });
+
+    for (const auto &entry : entries)
+    {
+        lru_list_.push_back(std::get<1>(entry));
+        entry_map_[std::get<1>(entry)] = Entry{std::prev(lru_list_.end()), std::get<2>(entry)};
+        total_size_ += std::get<2>(entry);
+    }
+}
+
+void EquationResultCache::Touch(uint64_t key)
+{
+    auto it = entry_map_.find(key);
+    if (it == entry_map_.end())
+    {
+        return;
+    }
+    lru_list_.splice(lru_list_.begin(), lru_list_, it->second.lru_it);
+
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(GetEntryPath(key), std::time(nullptr), ec);
+}
+
+void EquationResultCache::Evict()
+{
+    while (total_size_ > max_size_ && !lru_list_.empty())
+    {
+        uint64_t key = lru_list_.back();
+        RemoveInternal(key);
+        boost::system::error_code ec;
+        boost::filesystem::remove(GetEntryPath(key), ec);
+    }
+}
+
+void EquationResultCache::RemoveInternal(uint64_t key)
+{
+    auto it = entry_map_.find(key);
+    if (it == entry_map_.end())
+    {
+        return;
+    }
+    total_size_ -= it->second.size;
+    lru_list_.erase(it->second.lru_it);
+    entry_map_.erase(it);
+}
+
+std::string EquationResultCache::GetEntryPath(uint64_t key) const
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; i--)
+    {
+        name[i] = kHexDigits[key & 0xF];
+        key >>= 4;
+    }
+    return (boost::filesystem::path(directory_) / (name + kEntryExtension)).string();
+}
+} // namespace xequation
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace xequation
+{
+// Content-addressed store of serialized equation results on disk.
+//
+// Each entry is one file named after its 64-bit key, so a directory can be
+// shared between sessions and machines. The total size of the entries is
+// capped, the least recently used ones are evicted first. Recency is kept in
+// the file modification time, so it survives restarts. Entries are not
+// signed and contexts deserialize them (Python unpickles, which can run
+// code), so everyone able to write to the directory must be trusted.
+class EquationResultCache
+{
+  public:
+    static constexpr uint64_t kDefaultMaxSize = 512ULL * 1024 * 1024;
+
+    explicit EquationResultCache(const std::string &directory, uint64_t max_size = kDefaultMaxSize);
+    ~EquationResultCache() = default;
+
+    EquationResultCache(const EquationResultCache &) = delete;
+    EquationResultCache &operator=(const EquationResultCache &) = delete;
+
+    bool Lookup(uint64_t key, std::string &data);
+
+    bool Store(uint64_t key, const std::string &data);
+
+    bool Contains(uint64_t key) const;
+
+    void Remove(uint64_t key);
+
+    void Clear();
+
+    const std::string &directory() const
+    {
+        return directory_;
+    }
+
+    uint64_t max_size() const
+    {
+        return max_size_;
+    }
+
+    uint64_t total_size() const;
+
+    size_t entry_count() const;
+
+  private:
+    struct Entry
+    {
+        std::list<uint64_t>::iterator lru_it;
+        uint64_t size;
+    };
+
+    void LoadIndex();
+    void Touch(uint64_t key);
+    void Evict();
+    void RemoveInternal(uint64_t key);
+    std::string GetEntryPath(uint64_t key) const;
+
+    std::string directory_;
+    uint64_t max_size_;
+    uint64_t total_size_;
+
+    // front is the most recently used
+    std::list<uint64_t> lru_list_;
+    std::unordered_map<uint64_t, Entry> entry_map_;
+    mutable std::mutex mutex_;
+};
+} // namespace xequation
@@ -0,0 +1,314 @@
+#include "equation_snapshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "content_hash.h"
+
+namespace xequation
+{
+namespace
+{
+const char kSnapshotMagic[4] = {'X', 'E', 'Q', 'S'};
+
+class SnapshotWriter
+{
+  public:
+    void WriteUint8(uint8_t value)
+    {
+        buffer_.push_back(static_cast<char>(value));
+    }
+
+    void WriteUint32(uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            buffer_.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+        }
+    }
+
+    void WriteUint64(uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            buffer_.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+        }
+    }
+
+    void WriteBytes(const void *data, size_t size)
+    {
+        buffer_.append(static_cast<const char *>(data), size);
+    }
+
+    void WriteString(const std::string &value)
+    {
+        WriteUint32(static_cast<uint32_t>(value.size()));
+        buffer_.append(value);
+    }
+
+    const std::string &buffer() const
+    {
+        return buffer_;
+    }
+
+  private:
+    std::string buffer_;
+};
+
+// Every read is bounds checked, a truncated or corrupted file makes ok() false
+// instead of reading past the buffer.
+class SnapshotReader
+{
+  public:
+    SnapshotReader(const char *data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) {}
+
+    uint8_t ReadUint8()
+    {
+        if (!Require(1))
+        {
+            return 0;
+        }
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+
+    uint32_t ReadUint32()
+    {
+        if (!Require(4))
+        {
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(data_[pos_++])) << (i * 8);
+        }
+        return value;
+    }
+
+    uint64_t ReadUint64()
+    {
+        if (!Require(8))
+        {
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data_[pos_++])) << (i * 8);
+        }
+        return value;
+    }
+
+    bool ReadBytes(void *out, size_t size)
+    {
+        if (!Require(size))
+        {
+            return false;
+        }
+        std::memcpy(out, data_ + pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+    std::string ReadString()
+    {
+        uint32_t size = ReadUint32();
+        if (!Require(size))
+        {
+            return std::string();
+        }
+        std::string value(data_ + pos_, size);
+        pos_ += size;
+        return value;
+    }
+
+    // guards count fields against allocating huge vectors from garbage
+    uint32_t ReadCount(size_t min_record_size)
+    {
+        uint32_t count = ReadUint32();
+        if (ok_ && min_record_size != 0 && count > (size_ - pos_) / min_record_size)
+        {
+            ok_ = false;
+            return 0;
+        }
+        return count;
+    }
+
+    bool ok() const
+    {
+        return ok_;
+    }
+
+    bool at_end() const
+    {
+        return pos_ == size_;
+    }
+
+  private:
+    bool Require(size_t size)
+    {
+        if (!ok_ || size > size_ - pos_)
+        {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    const char *data_;
+    size_t size_;
+    size_t pos_;
+    bool ok_;
+};
+
+void WriteItem(SnapshotWriter &writer, const EquationSnapshotItem &item)
+{
+    writer.WriteString(item.name);
+    writer.WriteString(item.content);
+    writer.WriteUint32(static_cast<uint32_t>(item.type));
+    writer.WriteUint32(static_cast<uint32_t>(item.dependencies.size()));
+    for (const auto &dep : item.dependencies)
+    {
+        writer.WriteString(dep);
+    }
+    writer.WriteUint32(static_cast<uint32_t>(item.status));
+    writer.WriteString(item.message);
+    writer.WriteUint64(item.content_hash);
+    writer.WriteUint8(item.has_value ? 1 : 0);
+    writer.WriteString(item.value_data);
+    writer.WriteUint64(item.value_hash);
+}
+
+bool ReadItem(SnapshotReader &reader, EquationSnapshotItem &item)
+{
+    item.name = reader.ReadString();
+    item.content = reader.ReadString();
+    uint32_t type = reader.ReadUint32();
+    if (type > static_cast<uint32_t>(ItemType::kError))
+    {
+        return false;
+    }
+    item.type = static_cast<ItemType>(type);
+    uint32_t dep_count = reader.ReadCount(4);
+    item.dependencies.clear();
+    item.dependencies.reserve(dep_count);
+    for (uint32_t i = 0; i < dep_count && reader.ok(); i++)
+    {
+        item.dependencies.push_back(reader.ReadString());
+    }
+    uint32_t status = reader.ReadUint32();
+    if (status > static_cast<uint32_t>(ResultStatus::kUpstreamError))
+    {
+        return false;
+    }
+    item.status = static_cast<ResultStatus>(status);
+    item.message = reader.ReadString();
+    item.content_hash = reader.ReadUint64();
+    item.has_value = reader.ReadUint8() != 0;
+    item.value_data = reader.ReadString();
+    item.value_hash = reader.ReadUint64();
+
+    if (!reader.ok() || item.content_hash != EquationSnapshot::ComputeItemHash(item))
+    {
+        return false;
+    }
+
+    if (item.has_value && item.value_hash != ComputeContentHash(item.value_data))
+    {
+        item.has_value = false;
+        item.value_data.clear();
+    }
+    return true;
+}
+} // namespace
+
+uint64_t EquationSnapshot::ComputeItemHash(const EquationSnapshotItem &item)
+{
+    ContentHasher hasher;
+    hasher.Update(item.name).Update(item.content).Update(static_cast<uint64_t>(item.type));
+    for (const auto &dep : item.dependencies)
+    {
+        hasher.Update(dep);
+    }
+    return hasher.value();
+}
+
+bool EquationSnapshot::WriteToFile(const std::string &file_path) const
+{
+    SnapshotWriter writer;
+    writer.WriteBytes(kSnapshotMagic, sizeof(kSnapshotMagic));
+    writer.WriteUint32(kVersion);
+    writer.WriteString(language);
+    writer.WriteUint32(static_cast<uint32_t>(groups.size()));
+    for (const auto &group : groups)
+    {
+        writer.WriteBytes(group.id.data, group.id.size());
+        writer.WriteString(group.statement);
+        writer.WriteUint32(static_cast<uint32_t>(group.items.size()));
+        for (const auto &item : group.items)
+        {
+            WriteItem(writer, item);
+        }
+    }
+
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.write(writer.buffer().data(), static_cast<std::streamsize>(writer.buffer().size()));
+    file.close();
+    return !file.fail();
+}
+
+bool EquationSnapshot::ReadFromFile(const std::string &file_path, EquationSnapshot &snapshot)
+{
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    SnapshotReader reader(buffer.data(), buffer.size());
+    char magic[sizeof(kSnapshotMagic)];
+    if (!reader.ReadBytes(magic, sizeof(magic)) || std::memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0)
+    {
+        return false;
+    }
+    if (reader.ReadUint32() != kVersion)
+    {
+        return false;
+    }
+
+    EquationSnapshot result;
+    result.language = reader.ReadString();
+    uint32_t group_count = reader.ReadCount(boost::uuids::uuid::static_size());
+    for (uint32_t i = 0; i < group_count && reader.ok(); i++)
+    {
+        EquationGroupSnapshot group;
+        reader.ReadBytes(group.id.data, group.id.size());
+        group.statement = reader.ReadString();
+        uint32_t item_count = reader.ReadCount(4);
+        for (uint32_t j = 0; j < item_count && reader.ok(); j++)
+        {
+            EquationSnapshotItem item;
+            if (!ReadItem(reader, item))
+            {
+                return false;
+            }
+            group.items.push_back(std::move(item));
+        }
+        result.groups.push_back(std::move(group));
+    }
+
+    if (!reader.ok() || !reader.at_end())
+    {
+        return false;
+    }
+
+    snapshot = std::move(result);
+    return true;
+}
+} // namespace xequation
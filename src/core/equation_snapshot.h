@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "equation_common.h"
+
+namespace xequation
+{
+struct EquationSnapshotItem
+{
+    std::string name;
+    std::string content;
+    ItemType type;
+    std::vector<std::string> dependencies;
+    ResultStatus status;
+    std::string message;
+    // hash of name, content, type and dependencies
+    uint64_t content_hash;
+    bool has_value;
+    // value serialized by EquationContext::SerializeValue
+    std::string value_data;
+    uint64_t value_hash;
+};
+
+struct EquationGroupSnapshot
+{
+    boost::uuids::uuid id;
+    std::string statement;
+    std::vector<EquationSnapshotItem> items;
+};
+
+// Binary image of an evaluated workspace.
+//
+// Layout: magic "XEQS", uint32 version, then flat length-prefixed records in
+// little endian, one per group followed by its items. There are no pointers
+// or offsets inside the file, so it can be read from a single contiguous
+// buffer (or a mapped file) in one forward pass.
+struct EquationSnapshot
+{
+    static constexpr uint32_t kVersion = 1;
+
+    std::string language;
+    std::vector<EquationGroupSnapshot> groups;
+
+    bool WriteToFile(const std::string &file_path) const;
+    static bool ReadFromFile(const std::string &file_path, EquationSnapshot &snapshot);
+
+    static uint64_t ComputeItemHash(const EquationSnapshotItem &item);
+};
+} // namespace xequation
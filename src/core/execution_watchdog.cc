@@ -0,0 +1,89 @@
+#include "execution_watchdog.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace xequation
+{
+ExecutionWatchdog::~ExecutionWatchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_one();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+uint64_t ExecutionWatchdog::Arm(std::chrono::milliseconds timeout, Callback callback)
+{
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = next_id_++;
+        timers_[id] = Timer{Clock::now() + timeout, std::move(callback)};
+        if (!thread_.joinable())
+        {
+            thread_ = std::thread(&ExecutionWatchdog::Run, this);
+        }
+    }
+    changed_.notify_one();
+    return id;
+}
+
+void ExecutionWatchdog::Disarm(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // the thread wakes up for nothing at most once, no need to notify
+    timers_.erase(id);
+}
+
+void ExecutionWatchdog::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        if (timers_.empty())
+        {
+            changed_.wait(lock);
+            continue;
+        }
+
+        Clock::time_point next_deadline = Clock::time_point::max();
+        for (const auto &timer : timers_)
+        {
+            next_deadline = std::min(next_deadline, timer.second.deadline);
+        }
+        if (changed_.wait_until(lock, next_deadline) != std::cv_status::timeout)
+        {
+            continue;
+        }
+
+        std::vector<Callback> expired;
+        Clock::time_point now = Clock::now();
+        for (auto it = timers_.begin(); it != timers_.end();)
+        {
+            if (it->second.deadline <= now)
+            {
+                expired.push_back(std::move(it->second.callback));
+                it = timers_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        lock.unlock();
+        for (const auto &callback : expired)
+        {
+            callback();
+        }
+        lock.lock();
+    }
+}
+} // namespace xequation
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace xequation
+{
+// Runs callbacks once their timeout passed, all on one thread which is
+// started by the first Arm().
+//
+// Used by executors to abort interpret calls over their ExecutionBudget.
+// Callbacks run without any lock held and have to be short.
+class ExecutionWatchdog
+{
+  public:
+    using Callback = std::function<void()>;
+
+    ExecutionWatchdog() = default;
+    ~ExecutionWatchdog();
+
+    ExecutionWatchdog(const ExecutionWatchdog &) = delete;
+    ExecutionWatchdog &operator=(const ExecutionWatchdog &) = delete;
+
+    // returns the id to disarm the callback with
+    uint64_t Arm(std::chrono::milliseconds timeout, Callback callback);
+
+    // Does not wait for a callback which is already running, callbacks have
+    // to check themselves that the call they guard is still running.
+    void Disarm(uint64_t id);
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer
+    {
+        Clock::time_point deadline;
+        Callback callback;
+    };
+
+    void Run();
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::map<uint64_t, Timer> timers_;
+    uint64_t next_id_ = 1;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+} // namespace xequation
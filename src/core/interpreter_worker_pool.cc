@@ -0,0 +1,344 @@
+#include "interpreter_worker_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <boost/process.hpp>
+
+#ifndef _WIN32
+#include <csignal>
+#endif
+
+namespace xequation
+{
+namespace
+{
+// temporary context key an eval result is deserialized into
+const char kEvalResultKey[] = "__xequation_eval_result__";
+
+const auto kShutdownTimeout = std::chrono::seconds(2);
+} // namespace
+
+struct InterpreterWorkerPool::Worker
+{
+    boost::process::opstream input;
+    boost::process::ipstream output;
+    boost::process::child process;
+};
+
+InterpreterWorkerPool::InterpreterWorkerPool(const Options &options) : options_(options)
+{
+#ifndef _WIN32
+    // a worker dying mid request must fail the write, not kill the host
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    size_t worker_count = options_.worker_count;
+    if (worker_count == 0)
+    {
+        worker_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.resize(worker_count);
+    calls_.resize(worker_count);
+    for (size_t i = worker_count; i-- > 0;)
+    {
+        idle_workers_.push_back(i);
+        // a worker failing to start is retried on its first request
+        StartWorker(i);
+    }
+}
+
+InterpreterWorkerPool::~InterpreterWorkerPool()
+{
+    for (auto &worker : workers_)
+    {
+        if (!worker)
+        {
+            continue;
+        }
+        std::error_code ec;
+        auto write = [&worker](const char *data, size_t size) -> bool {
+            worker->input.write(data, static_cast<std::streamsize>(size));
+            return !worker->input.fail();
+        };
+        WorkerProtocol::WriteMessage(write, WorkerMessageType::kShutdown, std::string());
+        worker->input.flush();
+        worker->input.pipe().close();
+        if (!worker->process.wait_for(kShutdownTimeout, ec))
+        {
+            worker->process.terminate(ec);
+        }
+    }
+}
+
+InterpretResult InterpreterWorkerPool::Interpret(const std::string &code, EquationContext *context, InterpretMode mode)
+{
+    InterpretResult result;
+    result.mode = mode;
+    result.status = ResultStatus::kUnknownError;
+
+    size_t index = AcquireWorker();
+    std::error_code ec;
+    if (workers_[index] && !workers_[index]->process.running(ec))
+    {
+        StopWorker(index);
+    }
+    bool started = workers_[index] || StartWorker(index);
+
+    WorkerInterpretResponse response;
+    bool needs_host = false;
+    bool completed = false;
+    ResultStatus abort_status = ResultStatus::kSuccess;
+    if (started)
+    {
+        WorkerInterpretRequest request{mode, code, options_.budget.memory_bytes};
+        BeginCall(index);
+        uint64_t timer = 0;
+        if (options_.budget.wall_time_ms > 0)
+        {
+            uint64_t call_id = calls_[index].id;
+            timer = watchdog_.Arm(std::chrono::milliseconds(options_.budget.wall_time_ms), [this, index, call_id]() {
+                AbortCall(index, call_id, ResultStatus::kTimeout);
+            });
+        }
+        completed = RunRequest(*workers_[index], request, context, response, needs_host);
+        if (timer != 0)
+        {
+            watchdog_.Disarm(timer);
+        }
+        abort_status = EndCall(index);
+        if (!completed)
+        {
+            // restarted by the next request using this slot
+            StopWorker(index);
+        }
+    }
+    ReleaseWorker(index);
+
+    if (!started)
+    {
+        result.message = "Failed to start interpreter worker";
+        return result;
+    }
+    // a worker killed right after it answered still delivered its result
+    if (!completed && abort_status == ResultStatus::kTimeout)
+    {
+        result.status = ResultStatus::kTimeout;
+        result.message = "Execution exceeded the time budget of " + std::to_string(options_.budget.wall_time_ms) + " ms";
+        return result;
+    }
+    if (!completed && abort_status == ResultStatus::kKeyBoardInterrupt)
+    {
+        result.status = ResultStatus::kKeyBoardInterrupt;
+        result.message = "Execution was interrupted";
+        return result;
+    }
+    if (!completed)
+    {
+        result.message = "Interpreter worker exited unexpectedly";
+        return result;
+    }
+
+    bool transferable = !needs_host && response.unserializable_names.empty() &&
+                        !(mode == InterpretMode::kEval && response.status == ResultStatus::kSuccess &&
+                          !response.has_value);
+    if (transferable && ApplyResponse(response, context, mode, result))
+    {
+        return result;
+    }
+
+    if (options_.fallback_handler)
+    {
+        return options_.fallback_handler(code, context, mode);
+    }
+    result.status = ResultStatus::kUnknownError;
+    result.message = "Value can not be transferred from interpreter worker";
+    return result;
+}
+
+void InterpreterWorkerPool::Interrupt()
+{
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    for (size_t i = 0; i < calls_.size(); i++)
+    {
+        if (calls_[i].running && calls_[i].abort_status == ResultStatus::kSuccess)
+        {
+            calls_[i].abort_status = ResultStatus::kKeyBoardInterrupt;
+            std::error_code ec;
+            workers_[i]->process.terminate(ec);
+        }
+    }
+}
+
+size_t InterpreterWorkerPool::AcquireWorker()
+{
+    std::unique_lock<std::mutex> lock(worker_mutex_);
+    worker_released_.wait(lock, [this] { return !idle_workers_.empty(); });
+    size_t index = idle_workers_.back();
+    idle_workers_.pop_back();
+    return index;
+}
+
+void InterpreterWorkerPool::ReleaseWorker(size_t index)
+{
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        idle_workers_.push_back(index);
+    }
+    worker_released_.notify_one();
+}
+
+bool InterpreterWorkerPool::StartWorker(size_t index)
+{
+    std::unique_ptr<Worker> worker(new Worker());
+    try
+    {
+        worker->process = boost::process::child(
+            boost::process::exe = options_.worker_path, boost::process::args = options_.worker_arguments,
+            boost::process::std_in < worker->input, boost::process::std_out > worker->output
+        );
+    }
+    catch (const boost::process::process_error &)
+    {
+        return false;
+    }
+    workers_[index] = std::move(worker);
+    return true;
+}
+
+void InterpreterWorkerPool::StopWorker(size_t index)
+{
+    if (!workers_[index])
+    {
+        return;
+    }
+    std::error_code ec;
+    if (workers_[index]->process.running(ec))
+    {
+        workers_[index]->process.terminate(ec);
+    }
+    workers_[index].reset();
+}
+
+void InterpreterWorkerPool::BeginCall(size_t index)
+{
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    calls_[index].id = next_call_id_++;
+    calls_[index].running = true;
+    calls_[index].abort_status = ResultStatus::kSuccess;
+}
+
+ResultStatus InterpreterWorkerPool::EndCall(size_t index)
+{
+    // the worker may be replaced after this, so no abort touches it anymore
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    calls_[index].running = false;
+    return calls_[index].abort_status;
+}
+
+void InterpreterWorkerPool::AbortCall(size_t index, uint64_t call_id, ResultStatus status)
+{
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    Call &call = calls_[index];
+    if (!call.running || call.id != call_id || call.abort_status != ResultStatus::kSuccess)
+    {
+        return;
+    }
+    call.abort_status = status;
+    // the blocked read of the calling thread fails once the pipe closes
+    std::error_code ec;
+    workers_[index]->process.terminate(ec);
+}
+
+bool InterpreterWorkerPool::RunRequest(
+    Worker &worker, const WorkerInterpretRequest &request, EquationContext *context, WorkerInterpretResponse &response,
+    bool &needs_host
+)
+{
+    auto read = [&worker](char *data, size_t size) -> bool {
+        return static_cast<bool>(worker.output.read(data, static_cast<std::streamsize>(size)));
+    };
+    auto write = [&worker](const char *data, size_t size) -> bool {
+        worker.input.write(data, static_cast<std::streamsize>(size));
+        return !worker.input.fail();
+    };
+
+    if (!WorkerProtocol::WriteMessage(write, WorkerMessageType::kInterpretRequest, WorkerProtocol::Encode(request)) ||
+        !worker.input.flush())
+    {
+        return false;
+    }
+
+    // answer fetches until the worker is done
+    while (true)
+    {
+        WorkerMessageType type;
+        std::string payload;
+        if (!WorkerProtocol::ReadMessage(read, type, payload))
+        {
+            return false;
+        }
+        if (type == WorkerMessageType::kInterpretResponse)
+        {
+            return WorkerProtocol::Decode(payload, response);
+        }
+
+        WorkerFetchRequest fetch;
+        if (type != WorkerMessageType::kFetchRequest || !WorkerProtocol::Decode(payload, fetch))
+        {
+            return false;
+        }
+
+        WorkerFetchResponse reply{fetch.name, false, std::string(), false};
+        if (context)
+        {
+            std::lock_guard<std::mutex> lock(context_mutex_);
+            if (context->Contains(fetch.name))
+            {
+                reply.found = context->SerializeValue(fetch.name, reply.data);
+                // the value only exists in the host, the code has to run there
+                // and the worker stops instead of running it to the end
+                reply.host_only = !reply.found;
+                needs_host = needs_host || reply.host_only;
+            }
+        }
+        if (!WorkerProtocol::WriteMessage(write, WorkerMessageType::kFetchResponse, WorkerProtocol::Encode(reply)) ||
+            !worker.input.flush())
+        {
+            return false;
+        }
+    }
+}
+
+bool InterpreterWorkerPool::ApplyResponse(
+    const WorkerInterpretResponse &response, EquationContext *context, InterpretMode mode, InterpretResult &result
+)
+{
+    result.status = response.status;
+    result.message = response.message;
+    if (!context)
+    {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(context_mutex_);
+    for (const auto &binding : response.bindings)
+    {
+        if (!context->DeserializeValue(binding.first, binding.second))
+        {
+            return false;
+        }
+    }
+    if (mode == InterpretMode::kEval && response.has_value)
+    {
+        if (!context->DeserializeValue(kEvalResultKey, response.value_data))
+        {
+            return false;
+        }
+        result.value = context->Get(kEvalResultKey);
+        context->Remove(kEvalResultKey);
+    }
+    return true;
+}
+} // namespace xequation
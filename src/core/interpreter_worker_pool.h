@@ -0,0 +1,112 @@
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "equation_common.h"
+#include "equation_context.h"
+#include "execution_watchdog.h"
+#include "interpreter_worker_protocol.h"
+
+namespace xequation
+{
+// Interprets code in a pool of worker processes instead of the host process.
+//
+// Each call is sent to an idle worker, which asks for the values of the names
+// the code reads and returns the values the code binds; both travel through
+// EquationContext::SerializeValue / DeserializeValue, the context itself stays
+// in the host. A worker that crashes or breaks the protocol only fails the
+// current call and is restarted for the next one.
+//
+// A call reading a value that can not be serialized is aborted by its worker
+// and runs in the host instead. Values the code binds that can not be
+// serialized (e.g. functions and classes it defines) are only noticed once
+// the worker is done, such code runs a second time in the host.
+//
+// Interpret() may be called from several threads at once, up to one call per
+// worker runs in parallel, see EquationManager::SetInterpretConcurrency.
+//
+// Calls over their budget or interrupted get their worker killed, which stops
+// code blocked in extension modules or sleeping as well.
+class InterpreterWorkerPool
+{
+  public:
+    struct Options
+    {
+        // worker executable speaking WorkerProtocol over stdin / stdout
+        std::string worker_path;
+        std::vector<std::string> worker_arguments;
+        // 0 uses one worker per hardware thread
+        size_t worker_count = 0;
+        // Runs code in the host when a worker needs or produces values that
+        // can not be serialized (e.g. functions). Without it such calls fail.
+        InterpretHandler fallback_handler;
+        // applies to every call, the memory limit is enforced by the worker
+        ExecutionBudget budget;
+    };
+
+    explicit InterpreterWorkerPool(const Options &options);
+    ~InterpreterWorkerPool();
+
+    InterpreterWorkerPool(const InterpreterWorkerPool &) = delete;
+    InterpreterWorkerPool &operator=(const InterpreterWorkerPool &) = delete;
+
+    InterpretResult Interpret(const std::string &code, EquationContext *context, InterpretMode mode);
+
+    // Ends the running calls with ResultStatus::kKeyBoardInterrupt, may be
+    // called from any thread.
+    void Interrupt();
+
+    size_t worker_count() const
+    {
+        return workers_.size();
+    }
+
+  private:
+    struct Worker;
+
+    // state of the call running on a worker, guarded by worker_mutex_
+    struct Call
+    {
+        uint64_t id = 0;
+        bool running = false;
+        ResultStatus abort_status = ResultStatus::kSuccess;
+    };
+
+    size_t AcquireWorker();
+    void ReleaseWorker(size_t index);
+    bool StartWorker(size_t index);
+    void StopWorker(size_t index);
+
+    void BeginCall(size_t index);
+    // returns the status the call was aborted with, kSuccess if it was not
+    ResultStatus EndCall(size_t index);
+    // kills the worker if call_id is still running on it
+    void AbortCall(size_t index, uint64_t call_id, ResultStatus status);
+
+    // false when the worker died or broke the protocol
+    bool RunRequest(
+        Worker &worker, const WorkerInterpretRequest &request, EquationContext *context,
+        WorkerInterpretResponse &response, bool &needs_host
+    );
+    bool ApplyResponse(
+        const WorkerInterpretResponse &response, EquationContext *context, InterpretMode mode, InterpretResult &result
+    );
+
+    Options options_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex worker_mutex_;
+    std::condition_variable worker_released_;
+    std::vector<size_t> idle_workers_;
+    std::vector<Call> calls_;
+    uint64_t next_call_id_ = 1;
+
+    ExecutionWatchdog watchdog_;
+
+    // serializes context access of concurrent calls
+    std::mutex context_mutex_;
+};
+} // namespace xequation
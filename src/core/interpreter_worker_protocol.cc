@@ -0,0 +1,289 @@
+#include "interpreter_worker_protocol.h"
+
+namespace xequation
+{
+namespace
+{
+class MessageWriter
+{
+  public:
+    void WriteUint8(uint8_t value)
+    {
+        buffer_.push_back(static_cast<char>(value));
+    }
+
+    void WriteUint32(uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            buffer_.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+        }
+    }
+
+    void WriteUint64(uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            buffer_.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+        }
+    }
+
+    void WriteString(const std::string &value)
+    {
+        WriteUint32(static_cast<uint32_t>(value.size()));
+        buffer_.append(value);
+    }
+
+    const std::string &buffer() const
+    {
+        return buffer_;
+    }
+
+  private:
+    std::string buffer_;
+};
+
+// Every read is bounds checked, a truncated payload makes ok() false.
+class MessageReader
+{
+  public:
+    explicit MessageReader(const std::string &data) : data_(data), pos_(0), ok_(true) {}
+
+    uint8_t ReadUint8()
+    {
+        if (!Require(1))
+        {
+            return 0;
+        }
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+
+    uint32_t ReadUint32()
+    {
+        if (!Require(4))
+        {
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(data_[pos_++])) << (i * 8);
+        }
+        return value;
+    }
+
+    uint64_t ReadUint64()
+    {
+        if (!Require(8))
+        {
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data_[pos_++])) << (i * 8);
+        }
+        return value;
+    }
+
+    std::string ReadString()
+    {
+        uint32_t size = ReadUint32();
+        if (!Require(size))
+        {
+            return std::string();
+        }
+        std::string value = data_.substr(pos_, size);
+        pos_ += size;
+        return value;
+    }
+
+    // guards count fields against allocating huge vectors from garbage
+    uint32_t ReadCount(size_t min_record_size)
+    {
+        uint32_t count = ReadUint32();
+        if (ok_ && count > (data_.size() - pos_) / min_record_size)
+        {
+            ok_ = false;
+            return 0;
+        }
+        return count;
+    }
+
+    bool ok() const
+    {
+        return ok_;
+    }
+
+    bool at_end() const
+    {
+        return pos_ == data_.size();
+    }
+
+  private:
+    bool Require(size_t size)
+    {
+        if (!ok_ || data_.size() - pos_ < size)
+        {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    const std::string &data_;
+    size_t pos_;
+    bool ok_;
+};
+
+bool IsValidStatus(uint8_t status)
+{
+    return status <= static_cast<uint8_t>(ResultStatus::kUpstreamError);
+}
+} // namespace
+
+bool WorkerProtocol::WriteMessage(const WorkerWriteHandler &write, WorkerMessageType type, const std::string &payload)
+{
+    if (payload.size() > kMaxPayloadSize)
+    {
+        return false;
+    }
+    MessageWriter header;
+    header.WriteUint32(static_cast<uint32_t>(payload.size()));
+    header.WriteUint8(static_cast<uint8_t>(type));
+    return write(header.buffer().data(), header.buffer().size()) &&
+           (payload.empty() || write(payload.data(), payload.size()));
+}
+
+bool WorkerProtocol::ReadMessage(const WorkerReadHandler &read, WorkerMessageType &type, std::string &payload)
+{
+    std::string header(5, '\0');
+    if (!read(&header[0], header.size()))
+    {
+        return false;
+    }
+    MessageReader reader(header);
+    uint32_t size = reader.ReadUint32();
+    uint8_t raw_type = reader.ReadUint8();
+    if (size > kMaxPayloadSize || raw_type < static_cast<uint8_t>(WorkerMessageType::kInterpretRequest) ||
+        raw_type > static_cast<uint8_t>(WorkerMessageType::kShutdown))
+    {
+        return false;
+    }
+    type = static_cast<WorkerMessageType>(raw_type);
+    payload.resize(size);
+    return size == 0 || read(&payload[0], size);
+}
+
+std::string WorkerProtocol::Encode(const WorkerInterpretRequest &message)
+{
+    MessageWriter writer;
+    writer.WriteUint8(static_cast<uint8_t>(message.mode));
+    writer.WriteString(message.code);
+    writer.WriteUint64(message.memory_limit);
+    return writer.buffer();
+}
+
+std::string WorkerProtocol::Encode(const WorkerFetchRequest &message)
+{
+    MessageWriter writer;
+    writer.WriteString(message.name);
+    return writer.buffer();
+}
+
+std::string WorkerProtocol::Encode(const WorkerFetchResponse &message)
+{
+    MessageWriter writer;
+    writer.WriteString(message.name);
+    writer.WriteUint8(message.found ? 1 : 0);
+    writer.WriteString(message.data);
+    writer.WriteUint8(message.host_only ? 1 : 0);
+    return writer.buffer();
+}
+
+std::string WorkerProtocol::Encode(const WorkerInterpretResponse &message)
+{
+    MessageWriter writer;
+    writer.WriteUint8(static_cast<uint8_t>(message.status));
+    writer.WriteString(message.message);
+    writer.WriteUint8(message.has_value ? 1 : 0);
+    writer.WriteString(message.value_data);
+    writer.WriteUint32(static_cast<uint32_t>(message.bindings.size()));
+    for (const auto &binding : message.bindings)
+    {
+        writer.WriteString(binding.first);
+        writer.WriteString(binding.second);
+    }
+    writer.WriteUint32(static_cast<uint32_t>(message.unserializable_names.size()));
+    for (const auto &name : message.unserializable_names)
+    {
+        writer.WriteString(name);
+    }
+    return writer.buffer();
+}
+
+bool WorkerProtocol::Decode(const std::string &payload, WorkerInterpretRequest &message)
+{
+    MessageReader reader(payload);
+    uint8_t mode = reader.ReadUint8();
+    message.code = reader.ReadString();
+    message.memory_limit = reader.ReadUint64();
+    if (mode > static_cast<uint8_t>(InterpretMode::kEval))
+    {
+        return false;
+    }
+    message.mode = static_cast<InterpretMode>(mode);
+    return reader.ok() && reader.at_end();
+}
+
+bool WorkerProtocol::Decode(const std::string &payload, WorkerFetchRequest &message)
+{
+    MessageReader reader(payload);
+    message.name = reader.ReadString();
+    return reader.ok() && reader.at_end();
+}
+
+bool WorkerProtocol::Decode(const std::string &payload, WorkerFetchResponse &message)
+{
+    MessageReader reader(payload);
+    message.name = reader.ReadString();
+    message.found = reader.ReadUint8() != 0;
+    message.data = reader.ReadString();
+    message.host_only = reader.ReadUint8() != 0;
+    return reader.ok() && reader.at_end();
+}
+
+bool WorkerProtocol::Decode(const std::string &payload, WorkerInterpretResponse &message)
+{
+    MessageReader reader(payload);
+    uint8_t status = reader.ReadUint8();
+    if (!IsValidStatus(status))
+    {
+        return false;
+    }
+    message.status = static_cast<ResultStatus>(status);
+    message.message = reader.ReadString();
+    message.has_value = reader.ReadUint8() != 0;
+    message.value_data = reader.ReadString();
+
+    // a binding is at least two string sizes
+    uint32_t binding_count = reader.ReadCount(8);
+    message.bindings.clear();
+    message.bindings.reserve(binding_count);
+    for (uint32_t i = 0; i < binding_count && reader.ok(); i++)
+    {
+        std::string name = reader.ReadString();
+        std::string data = reader.ReadString();
+        message.bindings.emplace_back(std::move(name), std::move(data));
+    }
+
+    uint32_t name_count = reader.ReadCount(4);
+    message.unserializable_names.clear();
+    message.unserializable_names.reserve(name_count);
+    for (uint32_t i = 0; i < name_count && reader.ok(); i++)
+    {
+        message.unserializable_names.push_back(reader.ReadString());
+    }
+    return reader.ok() && reader.at_end();
+}
+} // namespace xequation
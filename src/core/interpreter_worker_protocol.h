@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "equation_common.h"
+
+namespace xequation
+{
+// Binary protocol between an InterpreterWorkerPool and its worker processes.
+//
+// Every message is a frame of a little-endian uint32 payload size, a uint8
+// message type and the payload. Integers in payloads are little-endian,
+// strings are a uint32 size followed by the bytes. Values travel in the form
+// produced by EquationContext::SerializeValue.
+//
+// A worker answers an interpret request with any number of fetch requests for
+// names the code reads, each answered by the parent, followed by exactly one
+// interpret response.
+enum class WorkerMessageType : uint8_t
+{
+    kInterpretRequest = 1,
+    kFetchRequest = 2,
+    kFetchResponse = 3,
+    kInterpretResponse = 4,
+    kShutdown = 5,
+};
+
+struct WorkerInterpretRequest
+{
+    InterpretMode mode;
+    std::string code;
+    // bytes the worker may allocate for this request, 0 is unlimited
+    uint64_t memory_limit;
+};
+
+struct WorkerFetchRequest
+{
+    std::string name;
+};
+
+struct WorkerFetchResponse
+{
+    std::string name;
+    bool found;
+    std::string data;
+    // the host has a value that can not be serialized, the worker aborts the
+    // request since the code has to run in the host
+    bool host_only;
+};
+
+struct WorkerInterpretResponse
+{
+    ResultStatus status;
+    std::string message;
+    // serialized result of an eval
+    bool has_value;
+    std::string value_data;
+    // names bound by the code with their serialized values
+    std::vector<std::pair<std::string, std::string>> bindings;
+    // names bound to values which could not be serialized
+    std::vector<std::string> unserializable_names;
+};
+
+// read exactly size bytes / write all of them, false on a closed or broken channel
+using WorkerReadHandler = std::function<bool(char *data, size_t size)>;
+using WorkerWriteHandler = std::function<bool(const char *data, size_t size)>;
+
+class WorkerProtocol
+{
+  public:
+    // frames larger than this are treated as a corrupted stream
+    static constexpr uint32_t kMaxPayloadSize = 1u << 30;
+
+    static bool WriteMessage(const WorkerWriteHandler &write, WorkerMessageType type, const std::string &payload);
+    static bool ReadMessage(const WorkerReadHandler &read, WorkerMessageType &type, std::string &payload);
+
+    static std::string Encode(const WorkerInterpretRequest &message);
+    static std::string Encode(const WorkerFetchRequest &message);
+    static std::string Encode(const WorkerFetchResponse &message);
+    static std::string Encode(const WorkerInterpretResponse &message);
+
+    // false when the payload is truncated or malformed
+    static bool Decode(const std::string &payload, WorkerInterpretRequest &message);
+    static bool Decode(const std::string &payload, WorkerFetchRequest &message);
+    static bool Decode(const std::string &payload, WorkerFetchResponse &message);
+    static bool Decode(const std::string &payload, WorkerInterpretResponse &message);
+};
+} // namespace xequation
@@ -29,38 +29,132 @@ CodeHighlighter::CodeHighlighter(QTextDocument* document)
 
 void CodeHighlighter::SetModel(QAbstractItemModel* model)
 {
+    if (model_)
+    {
+        disconnect(model_, nullptr, this, nullptr);
+    }
+
     model_ = model;
+    word_categories_dirty_ = true;
+
+    if (!model_)
+    {
+        return;
+    }
+
+    connect(model_, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+        if (!word_categories_dirty_)
+        {
+            AddWordCategories(first, last);
+        }
+    });
+    auto mark_dirty = [this]() { word_categories_dirty_ = true; };
+    connect(model_, &QAbstractItemModel::rowsRemoved, this, mark_dirty);
+    connect(model_, &QAbstractItemModel::dataChanged, this, mark_dirty);
+    connect(model_, &QAbstractItemModel::modelReset, this, mark_dirty);
+    connect(model_, &QAbstractItemModel::destroyed, this, [this]() {
+        model_ = nullptr;
+        word_categories_.clear();
+    });
 }
 
 CodeHighlighter::~CodeHighlighter()
 {
 }
 
-void CodeHighlighter::highlightBlock(const QString& text)
+bool CodeHighlighter::IsIdentifierStart(QChar c)
+{
+    return c.isLetter() || c == '_';
+}
+
+bool CodeHighlighter::IsIdentifierChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == '_';
+}
+
+void CodeHighlighter::AddWordCategories(int first, int last)
 {
+    for (int i = first; i <= last; ++i)
+    {
+        auto index = model_->index(i, 0);
+        QString word = model_->data(index, CompletionListModel::kWordRole).toString();
+        QString category = model_->data(index, CompletionListModel::kCategoryRole).toString();
+        int priority = model_->data(index, CompletionListModel::kPriorityRole).toInt();
+
+        auto it = word_categories_.find(word);
+        if (it == word_categories_.end())
+        {
+            word_categories_.insert(word, WordCategory{category, priority});
+        }
+        else if (priority >= it->priority)
+        {
+            *it = WordCategory{category, priority};
+        }
+    }
+}
+
+void CodeHighlighter::RebuildWordCategories()
+{
+    word_categories_.clear();
+    word_categories_dirty_ = false;
     if (!model_)
     {
         return;
     }
 
     int row = model_->rowCount();
-    for(int i = 0; i < row; ++i)
+    word_categories_.reserve(row);
+    AddWordCategories(0, row - 1);
+}
+
+QString CodeHighlighter::GetWordCategory(const QString& word)
+{
+    if (word_categories_dirty_)
     {
-        auto index = model_->index(i, 0);
-        QString word = model_->data(index, CompletionListModel::kWordRole).toString();
-        QString category = model_->data(index, CompletionListModel::kCategoryRole).toString();
-        QRegularExpression pattern("\\b" + QRegularExpression::escape(word) + "\\b");
-        auto matchIterator = pattern.globalMatch(text);
+        RebuildWordCategories();
+    }
+
+    auto it = word_categories_.constFind(word);
+    if (it == word_categories_.constEnd())
+    {
+        return QString();
+    }
+    return it->name;
+}
 
-        while (matchIterator.hasNext())
+void CodeHighlighter::highlightBlock(const QString& text)
+{
+    if (!model_)
+    {
+        return;
+    }
+
+    // one pass over the identifiers of the block, each looked up in the word table
+    int pos = 0;
+    while (pos < text.length())
+    {
+        QChar c = text.at(pos);
+        if (!IsIdentifierStart(c))
+        {
+            // a token starting with a digit, such as 1e5, is skipped as a whole
+            pos++;
+            while (IsIdentifierChar(c) && pos < text.length() && IsIdentifierChar(text.at(pos)))
+            {
+                pos++;
+            }
+            continue;
+        }
+
+        int start = pos;
+        while (pos < text.length() && IsIdentifierChar(text.at(pos)))
         {
-            auto match = matchIterator.next();
+            pos++;
+        }
 
-            setFormat(
-                match.capturedStart(),
-                match.capturedLength(),
-                syntaxStyle()->getFormat(category)
-            );
+        QString category = GetWordCategory(text.mid(start, pos - start));
+        if (!category.isEmpty())
+        {
+            setFormat(start, pos - start, syntaxStyle()->getFormat(category));
         }
     }
 }
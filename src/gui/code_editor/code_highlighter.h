@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QStyleSyntaxHighlighter>
 
 namespace xequation
@@ -17,8 +18,27 @@ class CodeHighlighter : public QStyleSyntaxHighlighter
   protected:
     explicit CodeHighlighter(QTextDocument* document = nullptr);
     virtual void highlightBlock(const QString& text) override;
+
+    // category of word in the model, empty if the model does not contain it
+    QString GetWordCategory(const QString& word);
+
+    static bool IsIdentifierStart(QChar c);
+    static bool IsIdentifierChar(QChar c);
   private:
+    struct WordCategory
+    {
+        QString name;
+        int priority;
+    };
+
+    void AddWordCategories(int first, int last);
+    void RebuildWordCategories();
+
     QAbstractItemModel* model_;
+    // word -> category, the category with the highest priority value wins, like
+    // the last format applied when scanning the (priority sorted) model rows
+    QHash<QString, WordCategory> word_categories_;
+    bool word_categories_dirty_{true};
 };
 } // namespace gui
-} // namespace xequation
\ No newline at end of file
+} // namespace xequation
@@ -1,7 +1,9 @@
 #include "completion_list_model.h"
 #include <QFile>
 #include <QLanguage>
+#include <QMap>
 #include <algorithm>
+#include <iterator>
 
 namespace xequation
 {
@@ -57,15 +59,17 @@ void CompletionListModel::InitWithLanguageDefinition()
         return;
     }
 
+    QList<CompletionItem> items;
     auto keys = language.keys();
     for (auto &&key : keys)
     {
         auto names = language.names(key);
         for (auto &&name : names)
         {
-            AddCompletionItem(name, key, name);
+            items.append(CreateCompletionItem(name, key, name));
         }
     }
+    AddCompletionItems(items);
 }
 
 int CompletionListModel::rowCount(const QModelIndex &parent) const
@@ -136,7 +140,7 @@ QList<CompletionCategory> CompletionListModel::GetAllCategories() const
     return categories;
 }
 
-CompletionCategory CompletionListModel::FindCategoryByName(const QString& name) const
+CompletionCategory CompletionListModel::FindCategoryByName(const QString& name)
 {
     for (const auto& cat : kPredefinedCategories)
     {
@@ -149,22 +153,10 @@ CompletionCategory CompletionListModel::FindCategoryByName(const QString& name)
     return CompletionCategory{name, 999};
 }
 
-void CompletionListModel::AddCompletionItem(const QString& word, const QString& category_name, const QString& complete_content)
+CompletionItem CompletionListModel::CreateCompletionItem(
+    const QString &word, const QString &category_name, const QString &complete_content
+)
 {
-    auto key = qMakePair(word, category_name);
-    
-    if (item_index_map_.contains(key))
-    {
-        int idx = item_index_map_[key];
-        if (idx >= 0 && idx < items_.size())
-        {
-            items_[idx].complete_content = complete_content;
-            QModelIndex modelIdx = index(idx);
-            emit dataChanged(modelIdx, modelIdx);
-        }
-        return;
-    }
-    
     CompletionItem item;
     item.word = word;
     item.category = FindCategoryByName(category_name);
@@ -173,63 +165,161 @@ void CompletionListModel::AddCompletionItem(const QString& word, const QString&
     {
         item.complete_content += "()";
     }
-    
-    int insert_pos = 0;
-    for (int i = 0; i < items_.size(); ++i)
+    return item;
+}
+
+int CompletionListModel::FindItemIndex(const QString &word, const QString &category_name) const
+{
+    CompletionItem probe;
+    probe.word = word;
+    probe.category = FindCategoryByName(category_name);
+
+    auto it = std::lower_bound(items_.begin(), items_.end(), probe);
+    if (it == items_.end() || it->word != word || it->category.name != category_name)
     {
-        if (item < items_[i])
-        {
-            insert_pos = i;
-            break;
-        }
-        insert_pos = i + 1;
+        return -1;
     }
-    
+    return static_cast<int>(it - items_.begin());
+}
+
+void CompletionListModel::AddCompletionItem(const QString& word, const QString& category_name, const QString& complete_content)
+{
+    CompletionItem item = CreateCompletionItem(word, category_name, complete_content);
+
+    int idx = FindItemIndex(word, category_name);
+    if (idx >= 0)
+    {
+        items_[idx].complete_content = item.complete_content;
+        QModelIndex modelIdx = index(idx);
+        emit dataChanged(modelIdx, modelIdx);
+        return;
+    }
+
+    int insert_pos = static_cast<int>(std::upper_bound(items_.begin(), items_.end(), item) - items_.begin());
+
     beginInsertRows(QModelIndex(), insert_pos, insert_pos);
     items_.insert(insert_pos, item);
+    search_index_.Insert(item.word, item.category.name);
     endInsertRows();
-    
-    item_index_map_.clear();
-    for (int i = 0; i < items_.size(); ++i)
+}
+
+void CompletionListModel::RemoveCompletionItem(const QString& word, const QString& category_name)
+{
+    int idx = FindItemIndex(word, category_name);
+    if (idx < 0)
     {
-        auto k = qMakePair(items_[i].word, items_[i].category.name);
-        item_index_map_[k] = i;
+        return;
     }
+
+    beginRemoveRows(QModelIndex(), idx, idx);
+    items_.remove(idx);
+    search_index_.Remove(word, category_name);
+    endRemoveRows();
 }
 
-void CompletionListModel::RemoveCompletionItem(const QString& word, const QString& category_name)
+void CompletionListModel::AddCompletionItems(const QList<CompletionItem> &items)
 {
-    auto key = qMakePair(word, category_name);
-    
-    if (!item_index_map_.contains(key))
+    if (items.isEmpty())
     {
         return;
     }
-    
-    int idx = item_index_map_[key];
-    
-    if (idx < 0 || idx >= items_.size())
+
+    if (items.size() == 1)
     {
+        const CompletionItem &item = items.front();
+        AddCompletionItem(item.word, item.category.name, item.complete_content);
         return;
     }
-    
-    beginRemoveRows(QModelIndex(), idx, idx);
-    items_.removeAt(idx);
-    endRemoveRows();
-    
-    item_index_map_.clear();
+
+    QVector<CompletionItem> new_items;
+    new_items.reserve(items.size());
+
+    beginResetModel();
+    for (const auto &item : items)
+    {
+        int idx = FindItemIndex(item.word, item.category.name);
+        if (idx >= 0)
+        {
+            items_[idx].complete_content = item.complete_content;
+        }
+        else
+        {
+            new_items.append(item);
+        }
+    }
+
+    // later duplicates win, like repeated AddCompletionItem calls
+    std::stable_sort(new_items.begin(), new_items.end());
+    QVector<CompletionItem> unique_items;
+    unique_items.reserve(new_items.size());
+    QVector<QPair<QString, QString>> index_pairs;
+    index_pairs.reserve(new_items.size());
+    for (const auto &item : new_items)
+    {
+        if (!unique_items.isEmpty() && unique_items.back().word == item.word &&
+            unique_items.back().category.name == item.category.name)
+        {
+            unique_items.back().complete_content = item.complete_content;
+            continue;
+        }
+        unique_items.append(item);
+        index_pairs.append(qMakePair(item.word, item.category.name));
+    }
+    search_index_.InsertBatch(index_pairs);
+
+    QVector<CompletionItem> merged_items;
+    merged_items.reserve(items_.size() + unique_items.size());
+    std::merge(
+        items_.begin(), items_.end(), unique_items.begin(), unique_items.end(), std::back_inserter(merged_items)
+    );
+    items_.swap(merged_items);
+    endResetModel();
+}
+
+void CompletionListModel::RemoveCompletionItems(const QList<QPair<QString, QString>> &word_category_pairs)
+{
+    QVector<bool> remove_flags(items_.size(), false);
+    bool has_removed = false;
+    for (const auto &pair : word_category_pairs)
+    {
+        int idx = FindItemIndex(pair.first, pair.second);
+        if (idx >= 0)
+        {
+            remove_flags[idx] = true;
+            has_removed = true;
+        }
+    }
+
+    if (!has_removed)
+    {
+        return;
+    }
+
+    beginResetModel();
+    QVector<CompletionItem> remaining_items;
+    remaining_items.reserve(items_.size());
+    QVector<QPair<QString, QString>> index_pairs;
     for (int i = 0; i < items_.size(); ++i)
     {
-        auto k = qMakePair(items_[i].word, items_[i].category.name);
-        item_index_map_[k] = i;
+        if (!remove_flags[i])
+        {
+            remaining_items.append(items_[i]);
+        }
+        else
+        {
+            index_pairs.append(qMakePair(items_[i].word, items_[i].category.name));
+        }
     }
+    items_.swap(remaining_items);
+    search_index_.RemoveBatch(index_pairs);
+    endResetModel();
 }
 
 void CompletionListModel::Clear()
 {
     beginResetModel();
     items_.clear();
-    item_index_map_.clear();
+    search_index_.Clear();
     endResetModel();
 }
 
@@ -237,13 +327,6 @@ void CompletionListModel::ResortItems()
 {
     beginResetModel();
     std::sort(items_.begin(), items_.end());
-    
-    item_index_map_.clear();
-    for (int i = 0; i < items_.size(); ++i)
-    {
-        auto k = qMakePair(items_[i].word, items_[i].category.name);
-        item_index_map_[k] = i;
-    }
     endResetModel();
 }
 } // namespace gui
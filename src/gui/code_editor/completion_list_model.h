@@ -1,8 +1,12 @@
 #pragma once
 
 #include <QAbstractListModel>
-#include <QMap>
+#include <QList>
+#include <QPair>
 #include <QSet>
+#include <QVector>
+
+#include "completion_search_index.h"
 
 namespace xequation
 {
@@ -37,7 +41,12 @@ struct CompletionItem
         {
             return category.priority < other.category.priority;
         }
-        return word < other.word;
+        if (word != other.word)
+        {
+            return word < other.word;
+        }
+        // categories outside the predefined ones share a priority
+        return category.name < other.category.name;
     }
 };
 
@@ -51,6 +60,10 @@ class CompletionListModel : public QAbstractListModel
 
     static const QList<CompletionCategory> &GetPredefinedCategories();
 
+    static CompletionItem CreateCompletionItem(
+        const QString &word, const QString &category_name, const QString &complete_content
+    );
+
     explicit CompletionListModel(const QString &language_name, QObject *parent = nullptr);
     ~CompletionListModel() override;
 
@@ -63,6 +76,11 @@ class CompletionListModel : public QAbstractListModel
 
     void RemoveCompletionItem(const QString &word, const QString &category_name);
 
+    // batch versions, each call resets the model once instead of emitting per item
+    void AddCompletionItems(const QList<CompletionItem> &items);
+
+    void RemoveCompletionItems(const QList<QPair<QString, QString>> &word_category_pairs);
+
     void Clear();
 
     const QString &language_name() const
@@ -70,18 +88,27 @@ class CompletionListModel : public QAbstractListModel
         return language_name_;
     }
 
+    const CompletionSearchIndex &search_index() const
+    {
+        return search_index_;
+    }
+
   private:
-    CompletionCategory FindCategoryByName(const QString &name) const;
+    static CompletionCategory FindCategoryByName(const QString &name);
+
+    // binary search in the sorted items, -1 if not found
+    int FindItemIndex(const QString &word, const QString &category_name) const;
 
     void ResortItems();
 
     void InitWithLanguageDefinition();
 
-    QList<CompletionItem> items_;
+    // sorted by CompletionItem::operator<
+    QVector<CompletionItem> items_;
 
     QString language_name_;
 
-    QMap<QPair<QString, QString>, int> item_index_map_;
+    CompletionSearchIndex search_index_;
 };
 } // namespace gui
 } // namespace xequation
\ No newline at end of file
@@ -0,0 +1,290 @@
+#include "completion_search_index.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace xequation
+{
+namespace gui
+{
+namespace
+{
+constexpr int kExactMatchScore = 10000;
+constexpr int kPrefixMatchScore = 5000;
+constexpr int kCaseSensitiveBonus = 100;
+constexpr int kFuzzyMatchScore = 1000;
+constexpr int kConsecutiveBonus = 15;
+constexpr int kWordBoundaryBonus = 10;
+constexpr int kGapPenalty = 1;
+
+bool EntryLess(const CompletionSearchIndex::Entry &lhs, const CompletionSearchIndex::Entry &rhs)
+{
+    return std::tie(lhs.key, lhs.word, lhs.category) < std::tie(rhs.key, rhs.word, rhs.category);
+}
+
+bool IsWordBoundary(const QString &word, int pos)
+{
+    if (pos == 0)
+    {
+        return true;
+    }
+    QChar prev = word.at(pos - 1);
+    QChar curr = word.at(pos);
+    return prev == '_' || prev == '.' || (prev.isLower() && curr.isUpper());
+}
+} // namespace
+
+QString CompletionSearchIndex::FoldCase(const QString &text)
+{
+    return text.toCaseFolded();
+}
+
+void CompletionSearchIndex::Insert(const QString &word, const QString &category)
+{
+    Entry entry{FoldCase(word), word, category};
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), entry, EntryLess);
+    if (it != entries_.end() && it->word == word && it->category == category)
+    {
+        return;
+    }
+    entries_.insert(it, entry);
+    generation_++;
+}
+
+void CompletionSearchIndex::Remove(const QString &word, const QString &category)
+{
+    Entry entry{FoldCase(word), word, category};
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), entry, EntryLess);
+    if (it == entries_.end() || it->word != word || it->category != category)
+    {
+        return;
+    }
+    entries_.erase(it);
+    generation_++;
+}
+
+void CompletionSearchIndex::InsertBatch(const QVector<QPair<QString, QString>> &word_category_pairs)
+{
+    QVector<Entry> new_entries;
+    new_entries.reserve(word_category_pairs.size());
+    for (const auto &pair : word_category_pairs)
+    {
+        new_entries.append(Entry{FoldCase(pair.first), pair.first, pair.second});
+    }
+    std::sort(new_entries.begin(), new_entries.end(), EntryLess);
+
+    QVector<Entry> merged_entries;
+    merged_entries.reserve(entries_.size() + new_entries.size());
+    auto it = entries_.begin();
+    for (const auto &entry : new_entries)
+    {
+        while (it != entries_.end() && EntryLess(*it, entry))
+        {
+            merged_entries.append(*it++);
+        }
+        // already indexed or a duplicate within the batch
+        if ((it != entries_.end() && !EntryLess(entry, *it)) ||
+            (!merged_entries.isEmpty() && !EntryLess(merged_entries.back(), entry)))
+        {
+            continue;
+        }
+        merged_entries.append(entry);
+    }
+    for (; it != entries_.end(); ++it)
+    {
+        merged_entries.append(*it);
+    }
+
+    if (merged_entries.size() != entries_.size())
+    {
+        entries_.swap(merged_entries);
+        generation_++;
+    }
+}
+
+void CompletionSearchIndex::RemoveBatch(const QVector<QPair<QString, QString>> &word_category_pairs)
+{
+    QVector<Entry> removed_entries;
+    removed_entries.reserve(word_category_pairs.size());
+    for (const auto &pair : word_category_pairs)
+    {
+        removed_entries.append(Entry{FoldCase(pair.first), pair.first, pair.second});
+    }
+    std::sort(removed_entries.begin(), removed_entries.end(), EntryLess);
+
+    // both sorted, one sweep keeps the entries not found in removed_entries
+    QVector<Entry> remaining_entries;
+    remaining_entries.reserve(entries_.size());
+    auto removed_it = removed_entries.cbegin();
+    for (const auto &entry : entries_)
+    {
+        while (removed_it != removed_entries.cend() && EntryLess(*removed_it, entry))
+        {
+            ++removed_it;
+        }
+        if (removed_it == removed_entries.cend() || EntryLess(entry, *removed_it))
+        {
+            remaining_entries.append(entry);
+        }
+    }
+
+    if (remaining_entries.size() != entries_.size())
+    {
+        entries_.swap(remaining_entries);
+        generation_++;
+    }
+}
+
+void CompletionSearchIndex::Clear()
+{
+    entries_.clear();
+    generation_++;
+}
+
+QVector<CompletionSearchIndex::Match>
+CompletionSearchIndex::Search(const QString &pattern, bool fuzzy, const EntryFilter &filter) const
+{
+    QVector<Match> matches;
+    if (pattern.isEmpty())
+    {
+        return matches;
+    }
+
+    if (!fuzzy)
+    {
+        // every prefix match sits in one contiguous range of the sorted keys
+        QString folded_pattern = FoldCase(pattern);
+        auto it = std::lower_bound(
+            entries_.begin(), entries_.end(), folded_pattern,
+            [](const Entry &entry, const QString &key) { return entry.key < key; }
+        );
+        for (; it != entries_.end() && it->key.startsWith(folded_pattern); ++it)
+        {
+            if (filter && !filter(it->word, it->category))
+            {
+                continue;
+            }
+            matches.append(Match{it->word, it->category, ScoreMatch(it->word, pattern, false)});
+        }
+        return matches;
+    }
+
+    for (const auto &entry : entries_)
+    {
+        if (filter && !filter(entry.word, entry.category))
+        {
+            continue;
+        }
+        int score = ScoreMatch(entry.word, pattern, true);
+        if (score >= 0)
+        {
+            matches.append(Match{entry.word, entry.category, score});
+        }
+    }
+    return matches;
+}
+
+QVector<CompletionSearchIndex::Match>
+CompletionSearchIndex::Refine(const QVector<Match> &previous, const QString &pattern, bool fuzzy)
+{
+    QVector<Match> matches;
+    matches.reserve(previous.size());
+    for (const auto &match : previous)
+    {
+        int score = ScoreMatch(match.word, pattern, fuzzy);
+        if (score >= 0)
+        {
+            matches.append(Match{match.word, match.category, score});
+        }
+    }
+    return matches;
+}
+
+QVector<CompletionSearchIndex::Match> CompletionSearchIndex::SelectTopMatches(QVector<Match> matches, int max_count)
+{
+    auto better = [](const Match &lhs, const Match &rhs) -> bool {
+        if (lhs.score != rhs.score)
+        {
+            return lhs.score > rhs.score;
+        }
+        return lhs.word < rhs.word;
+    };
+
+    if (max_count > 0 && matches.size() > max_count)
+    {
+        std::partial_sort(matches.begin(), matches.begin() + max_count, matches.end(), better);
+        matches.resize(max_count);
+    }
+    else
+    {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+    return matches;
+}
+
+int CompletionSearchIndex::ScoreMatch(const QString &word, const QString &pattern, bool fuzzy)
+{
+    if (pattern.isEmpty())
+    {
+        return 0;
+    }
+    if (pattern.size() > word.size())
+    {
+        return -1;
+    }
+
+    if (word.startsWith(pattern, Qt::CaseInsensitive))
+    {
+        if (word.size() == pattern.size())
+        {
+            return kExactMatchScore;
+        }
+        // shorter completions of the same prefix rank first
+        int score = kPrefixMatchScore - (word.size() - pattern.size());
+        if (word.startsWith(pattern, Qt::CaseSensitive))
+        {
+            score += kCaseSensitiveBonus;
+        }
+        return std::max(score, kFuzzyMatchScore * 2 + 1);
+    }
+
+    if (!fuzzy)
+    {
+        return -1;
+    }
+
+    // greedy leftmost subsequence match
+    int score = kFuzzyMatchScore;
+    int last_pos = -1;
+    int pos = 0;
+    for (QChar c : pattern)
+    {
+        QChar folded = c.toCaseFolded();
+        while (pos < word.size() && word.at(pos).toCaseFolded() != folded)
+        {
+            pos++;
+        }
+        if (pos == word.size())
+        {
+            return -1;
+        }
+
+        if (last_pos >= 0 && pos == last_pos + 1)
+        {
+            score += kConsecutiveBonus;
+        }
+        else if (last_pos >= 0)
+        {
+            score -= (pos - last_pos - 1) * kGapPenalty;
+        }
+        if (IsWordBoundary(word, pos))
+        {
+            score += kWordBoundaryBonus;
+        }
+        last_pos = pos;
+        pos++;
+    }
+    return std::max(std::min(score, kFuzzyMatchScore * 2), 0);
+}
+} // namespace gui
+} // namespace xequation
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+namespace xequation
+{
+namespace gui
+{
+// Word index behind completion filtering.
+//
+// Entries are kept sorted by their case folded word, so a prefix query is a
+// binary search plus a walk over the matching range. Fuzzy queries match the
+// pattern as a subsequence of the word and rank the results, a longer
+// pattern only needs to re-check the matches of the shorter one (Refine).
+class CompletionSearchIndex
+{
+  public:
+    struct Entry
+    {
+        QString key;
+        QString word;
+        QString category;
+    };
+
+    struct Match
+    {
+        QString word;
+        QString category;
+        int score;
+    };
+
+    using EntryFilter = std::function<bool(const QString &word, const QString &category)>;
+
+    void Insert(const QString &word, const QString &category);
+
+    void Remove(const QString &word, const QString &category);
+
+    // (word, category) pairs at once: one sort and one merge / sweep over the
+    // entries instead of a sorted insert or erase per pair
+    void InsertBatch(const QVector<QPair<QString, QString>> &word_category_pairs);
+
+    void RemoveBatch(const QVector<QPair<QString, QString>> &word_category_pairs);
+
+    void Clear();
+
+    int size() const
+    {
+        return entries_.size();
+    }
+
+    // bumped on every change, lets callers tell when cached matches are stale
+    quint64 generation() const
+    {
+        return generation_;
+    }
+
+    // all entries accepted by filter that match pattern, in index order
+    QVector<Match> Search(const QString &pattern, bool fuzzy, const EntryFilter &filter = EntryFilter()) const;
+
+    // narrow previous matches (of a prefix of pattern) down to pattern
+    static QVector<Match> Refine(const QVector<Match> &previous, const QString &pattern, bool fuzzy);
+
+    // best max_count matches, highest score first; max_count <= 0 keeps all
+    static QVector<Match> SelectTopMatches(QVector<Match> matches, int max_count);
+
+    // -1 if word does not match pattern, higher is better otherwise
+    static int ScoreMatch(const QString &word, const QString &pattern, bool fuzzy);
+
+  private:
+    static QString FoldCase(const QString &text);
+
+    QVector<Entry> entries_;
+    quint64 generation_{0};
+};
+} // namespace gui
+} // namespace xequation
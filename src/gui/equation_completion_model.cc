@@ -3,6 +3,7 @@
 #include "core/equation_common.h"
 #include <QString>
 #include <QSet>
+#include <QTimer>
 #include <algorithm>
 
 namespace xequation
@@ -10,20 +11,25 @@ namespace xequation
 namespace gui
 {
 
+CompletionItem EquationCompletionModel::CreateEquationItem(const Equation *equation)
+{
+    QString word = QString::fromStdString(equation->name());
+    QString type = QString::fromStdString(ItemTypeConverter::ToString(equation->type()));
+    if (type == "Import" || type == "ImportFrom")
+    {
+        type = "Module";
+    }
+    return CreateCompletionItem(word, type, word);
+}
+
 void EquationCompletionModel::OnEquationAdded(const Equation *equation)
 {
 	if (!equation)
 	{
 		return;
 	}
-
-	QString word = QString::fromStdString(equation->name());
-    QString type = QString::fromStdString(ItemTypeConverter::ToString(equation->type()));
-	if(type == "Import" || type == "ImportFrom")
-    {
-        type = "Module";
-    }
-    AddCompletionItem(word, type, word);
+    pending_changes_.append(PendingChange{true, CreateEquationItem(equation)});
+    SchedulePendingChanges();
 }
 
 void EquationCompletionModel::OnEquationRemoving(const Equation *equation)
@@ -32,14 +38,56 @@ void EquationCompletionModel::OnEquationRemoving(const Equation *equation)
 	{
 		return;
 	}
+    // the equation is gone by the time the changes are applied, its item is taken now
+    pending_changes_.append(PendingChange{false, CreateEquationItem(equation)});
+    SchedulePendingChanges();
+}
 
-	const QString word = QString::fromStdString(equation->name());
-    QString type = QString::fromStdString(ItemTypeConverter::ToString(equation->type()));
-	if(type == "Import" || type == "ImportFrom")
+void EquationCompletionModel::SchedulePendingChanges()
+{
+    if (pending_changes_.size() == 1)
     {
-        type = "Module";
+        QTimer::singleShot(0, this, &EquationCompletionModel::ApplyPendingChanges);
+    }
+}
+
+void EquationCompletionModel::ApplyPendingChanges()
+{
+    QVector<PendingChange> changes;
+    changes.swap(pending_changes_);
+
+    // consecutive changes of one kind form a batch, the order between
+    // removing and adding the same word is kept
+    int begin = 0;
+    while (begin < changes.size())
+    {
+        int end = begin;
+        while (end < changes.size() && changes[end].add == changes[begin].add)
+        {
+            ++end;
+        }
+        if (changes[begin].add)
+        {
+            QList<CompletionItem> items;
+            items.reserve(end - begin);
+            for (int i = begin; i < end; ++i)
+            {
+                items.append(changes[i].item);
+            }
+            AddCompletionItems(items);
+        }
+        else
+        {
+            QList<QPair<QString, QString>> word_category_pairs;
+            word_category_pairs.reserve(end - begin);
+            for (int i = begin; i < end; ++i)
+            {
+                word_category_pairs.append(qMakePair(changes[i].item.word, changes[i].item.category.name));
+            }
+            RemoveCompletionItems(word_category_pairs);
+        }
+        begin = end;
     }
-	RemoveCompletionItem(word, type);
 }
 
 EquationCompletionFilterModel::EquationCompletionFilterModel(EquationCompletionModel *model, QObject *parent)
@@ -53,6 +101,7 @@ void EquationCompletionFilterModel::setSourceModel(QAbstractItemModel *sourceMod
 	QSortFilterProxyModel::setSourceModel(sourceModel);
 
 	model_ = qobject_cast<EquationCompletionModel *>(sourceModel);
+	matches_valid_ = false;
 }
 
 void EquationCompletionFilterModel::SetDisplayOnlyWord(bool display_only_word)
@@ -68,19 +117,120 @@ void EquationCompletionFilterModel::SetDisplayOnlyWord(bool display_only_word)
 void EquationCompletionFilterModel::SetEquationGroup(const EquationGroup* group)
 {
 	group_ = group;
-	invalidateFilter();
+	// group and category are applied before the top matches are picked
+	matches_valid_ = false;
+	InvalidateMatches();
 }
 
 void EquationCompletionFilterModel::SetFilterText(const QString &filter_text)
 {
 	filter_text_ = filter_text;
-	invalidateFilter();
+	InvalidateMatches();
 }
 
 void EquationCompletionFilterModel::SetCategory(const QString &category)
 {
 	category_ = category;
-	invalidateFilter();
+	matches_valid_ = false;
+	InvalidateMatches();
+}
+
+void EquationCompletionFilterModel::SetFuzzyMatching(bool fuzzy_matching)
+{
+	if (fuzzy_matching_ == fuzzy_matching)
+	{
+		return;
+	}
+	fuzzy_matching_ = fuzzy_matching;
+	matches_valid_ = false;
+	InvalidateMatches();
+}
+
+void EquationCompletionFilterModel::SetMaxResultCount(int max_result_count)
+{
+	if (max_result_count_ == max_result_count)
+	{
+		return;
+	}
+	max_result_count_ = max_result_count;
+	matches_valid_ = false;
+	InvalidateMatches();
+}
+
+void EquationCompletionFilterModel::InvalidateMatches()
+{
+	invalidate();
+	// rank by score only while there is something to rank, otherwise keep the source order
+	sort(filter_text_.isEmpty() ? -1 : 0);
+}
+
+void EquationCompletionFilterModel::UpdateMatches() const
+{
+	if (!model_)
+	{
+		return;
+	}
+
+	const CompletionSearchIndex &index = model_->search_index();
+	if (matches_valid_ && matched_text_ == filter_text_ && matched_generation_ == index.generation())
+	{
+		return;
+	}
+
+	// a longer filter text only narrows the previous matches
+	if (matches_valid_ && matched_generation_ == index.generation() && !matched_text_.isEmpty() &&
+		filter_text_.startsWith(matched_text_))
+	{
+		all_matches_ = CompletionSearchIndex::Refine(all_matches_, filter_text_, fuzzy_matching_);
+	}
+	else
+	{
+		all_matches_ = index.Search(
+			filter_text_, fuzzy_matching_,
+			[this](const QString &word, const QString &category) -> bool {
+				if (!category_.isEmpty() && category != category_)
+				{
+					return false;
+				}
+				return !(group_ && group_->IsEquationExist(word.toStdString()));
+			}
+		);
+	}
+
+	accepted_scores_.clear();
+	auto top_matches = CompletionSearchIndex::SelectTopMatches(all_matches_, max_result_count_);
+	for (const auto &match : top_matches)
+	{
+		accepted_scores_.insert(qMakePair(match.word, match.category), match.score);
+	}
+
+	matches_valid_ = true;
+	matched_text_ = filter_text_;
+	matched_generation_ = index.generation();
+}
+
+int EquationCompletionFilterModel::GetMatchScore(const QModelIndex &source_index) const
+{
+	QString word = source_index.data(CompletionListModel::kWordRole).toString();
+	QString category = source_index.data(CompletionListModel::kCategoryRole).toString();
+	return accepted_scores_.value(qMakePair(word, category), -1);
+}
+
+bool EquationCompletionFilterModel::lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const
+{
+	if (filter_text_.isEmpty() || !model_)
+	{
+		return source_left.row() < source_right.row();
+	}
+
+	UpdateMatches();
+	int left_score = GetMatchScore(source_left);
+	int right_score = GetMatchScore(source_right);
+	if (left_score != right_score)
+	{
+		return left_score > right_score;
+	}
+	return source_left.row() < source_right.row();
 }
 
 QList<CompletionCategory> EquationCompletionFilterModel::GetAllCategories()
@@ -152,10 +302,12 @@ bool EquationCompletionFilterModel::filterAcceptsRow(int source_row, const QMode
 
 	if (!filter_text_.isEmpty())
 	{
-		if (!word.startsWith(filter_text_, Qt::CaseInsensitive))
+		if (!model_)
 		{
-			return false;
+			return word.startsWith(filter_text_, Qt::CaseInsensitive);
 		}
+		UpdateMatches();
+		return GetMatchScore(idx) >= 0;
 	}
 
 	return true;
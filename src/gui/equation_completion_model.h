@@ -1,6 +1,9 @@
 #pragma once
 
+#include <QHash>
+#include <QPair>
 #include <QSortFilterProxyModel>
+#include <QVector>
 
 #include "code_editor/completion_list_model.h"
 #include "core/equation.h"
@@ -20,17 +23,33 @@ class EquationCompletionModel : public CompletionListModel
     }
     ~EquationCompletionModel() override = default;
 
+    // Changes are collected and applied with one AddCompletionItems /
+    // RemoveCompletionItems call per run when control returns to the event
+    // loop, so adding, loading or removing a group updates the model once.
     void OnEquationAdded(const Equation *equation);
     void OnEquationRemoving(const Equation *equation);
 
   private:
+    struct PendingChange
+    {
+        bool add;
+        CompletionItem item;
+    };
+
+    static CompletionItem CreateEquationItem(const Equation *equation);
+    void SchedulePendingChanges();
+    void ApplyPendingChanges();
+
     QString language_name_;
+    QVector<PendingChange> pending_changes_;
 };
 
 class EquationCompletionFilterModel : public QSortFilterProxyModel
 {
     Q_OBJECT
   public:
+    static constexpr int kDefaultMaxResultCount = 200;
+
     explicit EquationCompletionFilterModel(EquationCompletionModel *model, QObject *parent = nullptr);
     ~EquationCompletionFilterModel() override = default;
 
@@ -38,11 +57,21 @@ class EquationCompletionFilterModel : public QSortFilterProxyModel
     void SetEquationGroup(const EquationGroup *group);
     void SetFilterText(const QString &filter_text);
     void SetCategory(const QString &category);
+    // subsequence matching ranked by score, otherwise plain prefix matching
+    void SetFuzzyMatching(bool fuzzy_matching);
+    // only the best max_result_count matches of the filter text are shown, <= 0 shows all
+    void SetMaxResultCount(int max_result_count);
     QList<CompletionCategory> GetAllCategories();
 
   protected:
     void setSourceModel(QAbstractItemModel *sourceModel) override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const override;
+
+  private:
+    void InvalidateMatches();
+    void UpdateMatches() const;
+    int GetMatchScore(const QModelIndex &source_index) const;
 
   protected:
     EquationCompletionModel *model_;
@@ -50,6 +79,17 @@ class EquationCompletionFilterModel : public QSortFilterProxyModel
     QString filter_text_;
     QString category_;
     bool display_only_word_{false};
+    bool fuzzy_matching_{true};
+    int max_result_count_{kDefaultMaxResultCount};
+
+    // matches of filter_text_ against the source search index, rebuilt lazily
+    // when the filter or the index changes
+    mutable bool matches_valid_{false};
+    mutable QString matched_text_;
+    mutable quint64 matched_generation_{0};
+    mutable QVector<CompletionSearchIndex::Match> all_matches_;
+    mutable QHash<QPair<QString, QString>, int> accepted_scores_;
+
     bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
 };
 
@@ -1,27 +1,152 @@
 #include "equation_dependency_graph_viewer.h"
 
 #include <QAction>
-#include <QGraphicsSvgItem>
+#include <QGraphicsItem>
+#include <QGraphicsSceneMouseEvent>
 #include <QHBoxLayout>
+#include <QPainterPath>
 #include <QPushButton>
+#include <QLabel>
+#include <QSpinBox>
+#include <QStyleOptionGraphicsItem>
 #include <QToolBar>
 #include <QVBoxLayout>
 #include <QWheelEvent>
 #include <QTimer>
 #include <QResizeEvent>
-#include <QSvgRenderer>
+#include <QSvgGenerator>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QImage>
 #include <QPainter>
 
+#include <functional>
+
 namespace xequation
 {
 namespace gui
 {
+namespace
+{
+// below this level of detail nodes are drawn as plain boxes and edges
+// without arrow heads, so zoomed out views of large graphs stay cheap
+constexpr qreal kTextLevelOfDetail = 0.4;
+constexpr qreal kArrowLevelOfDetail = 0.3;
+constexpr qreal kArrowSize = 6.0;
+
+class DependencyGraphNodeItem : public QGraphicsItem
+{
+  public:
+    explicit DependencyGraphNodeItem(std::function<void(const QString &)> activated_handler)
+        : activated_handler_(activated_handler)
+    {
+        setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+        setZValue(1);
+    }
+
+    void SetNode(const DependencyGraphLayout::NodeLayout &node)
+    {
+        prepareGeometryChange();
+        rect_ = QRectF(-node.width / 2, -node.height / 2, node.width, node.height);
+        name_ = QString::fromStdString(node.name);
+        lines_ = QString::fromStdString(node.label).split('\n');
+        setPos(node.x, node.y);
+        setToolTip(QString::fromStdString(node.label));
+    }
+
+    QRectF boundingRect() const override
+    {
+        return rect_.adjusted(-1, -1, 1, 1);
+    }
+
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override
+    {
+        qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+        if (lod < kTextLevelOfDetail)
+        {
+            painter->fillRect(rect_, QColor(0xd6, 0xe4, 0xf0));
+            return;
+        }
+
+        painter->setPen(QPen(Qt::black, 1));
+        painter->setBrush(QColor(0xf4, 0xf8, 0xfc));
+        painter->drawRoundedRect(rect_, 4, 4);
+
+        qreal line_height = rect_.height() / qMax(1, lines_.size());
+        for (int i = 0; i < lines_.size(); i++)
+        {
+            QRectF line_rect(rect_.left(), rect_.top() + i * line_height, rect_.width(), line_height);
+            painter->drawText(line_rect, Qt::AlignCenter, lines_[i]);
+        }
+    }
+
+  protected:
+    void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override
+    {
+        if (activated_handler_)
+        {
+            activated_handler_(name_);
+        }
+        event->accept();
+    }
+
+  private:
+    QRectF rect_;
+    QString name_;
+    QStringList lines_;
+    std::function<void(const QString &)> activated_handler_;
+};
+
+class DependencyGraphEdgeItem : public QGraphicsPathItem
+{
+  public:
+    explicit DependencyGraphEdgeItem(const DependencyGraphLayout::EdgeLayout &edge)
+    {
+        QPainterPath path;
+        path.moveTo(edge.points.front().x, edge.points.front().y);
+        for (size_t i = 1; i < edge.points.size(); i++)
+        {
+            path.lineTo(edge.points[i].x, edge.points[i].y);
+        }
+        setPath(path);
+        setPen(QPen(Qt::darkGray, 1));
+
+        const auto &tip = edge.points.back();
+        const auto &prev = edge.points[edge.points.size() - 2];
+        QLineF direction(QPointF(tip.x, tip.y), QPointF(prev.x, prev.y));
+        direction.setLength(kArrowSize);
+        QLineF left = direction;
+        left.setAngle(direction.angle() + 25);
+        QLineF right = direction;
+        right.setAngle(direction.angle() - 25);
+        arrow_ << QPointF(tip.x, tip.y) << left.p2() << right.p2();
+        setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    }
+
+    QRectF boundingRect() const override
+    {
+        return QGraphicsPathItem::boundingRect().united(arrow_.boundingRect());
+    }
+
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override
+    {
+        painter->setPen(pen());
+        painter->drawPath(path());
+        if (option->levelOfDetailFromTransform(painter->worldTransform()) >= kArrowLevelOfDetail)
+        {
+            painter->setBrush(pen().color());
+            painter->drawPolygon(arrow_);
+        }
+    }
+
+  private:
+    QPolygonF arrow_;
+};
+} // namespace
 
 EquationDependencyGraphViewer::EquationDependencyGraphViewer(QWidget *parent)
-    : QWidget(parent), scene_(new QGraphicsScene(this)), view_(new QGraphicsView(scene_, this)), svg_item_(nullptr)
+    : QWidget(parent), scene_(new QGraphicsScene(this)), view_(new QGraphicsView(scene_, this)),
+      collapse_groups_action_(nullptr), hop_count_spin_box_(nullptr)
 {
     SetupUI();
     SetupConnections();
@@ -51,12 +176,29 @@ void EquationDependencyGraphViewer::SetupUI()
     auto *reset_zoom_action = toolbar->addAction("Reset Zoom");
     auto *refresh_action = toolbar->addAction("Refresh");
     toolbar->addSeparator();
+    auto *show_all_action = toolbar->addAction("Show All");
+    show_all_action->setToolTip("Show every equation, double click a node to focus on its neighbourhood");
+    collapse_groups_action_ = toolbar->addAction("Collapse Groups");
+    collapse_groups_action_->setCheckable(true);
+    toolbar->addWidget(new QLabel(" Hops: ", toolbar));
+    hop_count_spin_box_ = new QSpinBox(toolbar);
+    hop_count_spin_box_->setRange(1, 99);
+    hop_count_spin_box_->setValue(2);
+    toolbar->addWidget(hop_count_spin_box_);
+    toolbar->addSeparator();
     auto *save_image_action = toolbar->addAction("Save Image");
 
+    connect(show_all_action, &QAction::triggered, this, &EquationDependencyGraphViewer::ShowAllEquations);
+    connect(collapse_groups_action_, &QAction::toggled, this, &EquationDependencyGraphViewer::OnCollapseGroupsToggled);
+    connect(
+        hop_count_spin_box_, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &EquationDependencyGraphViewer::OnHopCountChanged
+    );
+
     connect(zoom_in_action, &QAction::triggered, this, &EquationDependencyGraphViewer::ZoomIn);
     connect(zoom_out_action, &QAction::triggered, this, &EquationDependencyGraphViewer::ZoomOut);
     connect(reset_zoom_action, &QAction::triggered, this, &EquationDependencyGraphViewer::ResetZoom);
-    connect(refresh_action, &QAction::triggered, this, &EquationDependencyGraphViewer::DependencyGraphImageRequested);
+    connect(refresh_action, &QAction::triggered, this, &EquationDependencyGraphViewer::DependencyGraphLayoutRequested);
     connect(save_image_action, &QAction::triggered, this, &EquationDependencyGraphViewer::SaveImage);
 
     main_layout->addWidget(toolbar);
@@ -68,6 +210,9 @@ void EquationDependencyGraphViewer::SetupUI()
     view_->setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
     view_->setResizeAnchor(QGraphicsView::AnchorUnderMouse);
     view_->setBackgroundBrush(QBrush(Qt::white));
+    view_->setViewportUpdateMode(QGraphicsView::SmartViewportUpdate);
+    view_->setOptimizationFlag(QGraphicsView::DontAdjustForAntialiasing);
+    scene_->setItemIndexMethod(QGraphicsScene::BspTreeIndex);
 
     main_layout->addWidget(view_);
 
@@ -78,42 +223,127 @@ void EquationDependencyGraphViewer::SetupUI()
 
 void EquationDependencyGraphViewer::SetupConnections() {}
 
-void EquationDependencyGraphViewer::OnDependencyGraphImageGenerated(const QString &image_path)
+void EquationDependencyGraphViewer::OnDependencyGraphLayoutGenerated(std::shared_ptr<const DependencyGraphLayout> layout)
 {
-    current_image_path_ = image_path;
-    
-    // Create SVG renderer to check if file is valid
-    QSvgRenderer *renderer = new QSvgRenderer(image_path);
-    if (!renderer->isValid())
+    if (!layout)
     {
-        delete renderer;
         return;
     }
 
-    // Remove old SVG item if exists
-    if (svg_item_)
+    bool first_layout = !layout_;
+    layout_ = layout;
+    UpdateSceneItems();
+
+    if (first_layout)
     {
-        scene_->removeItem(svg_item_);
-        delete svg_item_;
-        svg_item_ = nullptr;
+        FitToView();
     }
+}
 
-    // Clear scene and add new SVG item
-    scene_->clear();
-    svg_item_ = new QGraphicsSvgItem();
-    svg_item_->setSharedRenderer(renderer);
-    scene_->addItem(svg_item_);
+void EquationDependencyGraphViewer::UpdateSceneItems()
+{
+    for (auto *item : edge_items_)
+    {
+        scene_->removeItem(item);
+        delete item;
+    }
+    edge_items_.clear();
 
-    // Set scene rect to match SVG bounds
-    scene_->setSceneRect(svg_item_->boundingRect());
+    QHash<QString, QGraphicsItem *> node_items;
+    node_items.reserve(static_cast<int>(layout_->nodes().size()));
+    for (const auto &node : layout_->nodes())
+    {
+        QString name = QString::fromStdString(node.name);
+        DependencyGraphNodeItem *item = nullptr;
+        auto it = node_items_.find(name);
+        if (it != node_items_.end())
+        {
+            item = static_cast<DependencyGraphNodeItem *>(it.value());
+            node_items_.erase(it);
+        }
+        else
+        {
+            item = new DependencyGraphNodeItem([this](const QString &node_name) { OnNodeActivated(node_name); });
+            scene_->addItem(item);
+        }
+        item->SetNode(node);
+        node_items.insert(name, item);
+    }
 
-    FitToView();
+    // whatever is left belongs to removed nodes
+    for (auto *item : node_items_)
+    {
+        scene_->removeItem(item);
+        delete item;
+    }
+    node_items_.swap(node_items);
+
+    for (const auto &edge : layout_->edges())
+    {
+        if (edge.points.size() < 2)
+        {
+            continue;
+        }
+        auto *item = new DependencyGraphEdgeItem(edge);
+        scene_->addItem(item);
+        edge_items_.append(item);
+    }
+
+    const qreal margin = 20;
+    scene_->setSceneRect(-margin, -margin, layout_->width() + 2 * margin, layout_->height() + 2 * margin);
+}
+
+void EquationDependencyGraphViewer::FocusEquations(const QStringList &equation_names)
+{
+    view_options_.focus_equations.clear();
+    for (const auto &equation_name : equation_names)
+    {
+        view_options_.focus_equations.push_back(equation_name.toStdString());
+    }
+    view_options_.upstream_hops = hop_count_spin_box_->value();
+    view_options_.downstream_hops = hop_count_spin_box_->value();
+    emit DependencyGraphLayoutRequested();
+}
+
+void EquationDependencyGraphViewer::ShowAllEquations()
+{
+    if (view_options_.focus_equations.empty())
+    {
+        return;
+    }
+    view_options_.focus_equations.clear();
+    emit DependencyGraphLayoutRequested();
+}
+
+void EquationDependencyGraphViewer::OnNodeActivated(const QString &node_name)
+{
+    // collapsed groups have no equation to focus on
+    if (layout_ && !node_name.startsWith("group:"))
+    {
+        FocusEquations(QStringList() << node_name);
+    }
+}
+
+void EquationDependencyGraphViewer::OnCollapseGroupsToggled(bool checked)
+{
+    view_options_.collapse_groups = checked;
+    emit DependencyGraphLayoutRequested();
+}
+
+void EquationDependencyGraphViewer::OnHopCountChanged(int hop_count)
+{
+    view_options_.upstream_hops = hop_count;
+    view_options_.downstream_hops = hop_count;
+    if (!view_options_.focus_equations.empty())
+    {
+        emit DependencyGraphLayoutRequested();
+    }
 }
 
 void EquationDependencyGraphViewer::OnEquationGroupAdded(const EquationGroup *group)
 {
     // Request to regenerate dependency graph
-    emit DependencyGraphImageRequested();
+    emit DependencyGraphLayoutRequested();
 }
 
 void EquationDependencyGraphViewer::OnEquationGroupUpdated(
@@ -121,13 +351,13 @@ void EquationDependencyGraphViewer::OnEquationGroupUpdated(
 )
 {
     // Request to regenerate dependency graph
-    emit DependencyGraphImageRequested();
+    emit DependencyGraphLayoutRequested();
 }
 
 void EquationDependencyGraphViewer::OnEquationGroupRemoving(const EquationGroup *group)
 {
     // Request to regenerate dependency graph
-    emit DependencyGraphImageRequested();
+    emit DependencyGraphLayoutRequested();
 }
 
 void EquationDependencyGraphViewer::wheelEvent(QWheelEvent *event)
@@ -207,7 +437,7 @@ void EquationDependencyGraphViewer::resizeEvent(QResizeEvent *event)
 
 void EquationDependencyGraphViewer::SaveImage()
 {
-    if (current_image_path_.isEmpty() || !svg_item_)
+    if (!layout_ || scene_->items().isEmpty())
     {
         QMessageBox::warning(this, "Save Image", "No graph image to save.");
         return;
@@ -228,53 +458,50 @@ void EquationDependencyGraphViewer::SaveImage()
     else if (fileName.toLower().endsWith(".svg"))
         format = "SVG";
 
+    QRectF source_rect = scene_->sceneRect();
     if (format == "SVG")
     {
-        // Copy SVG file directly
-        QFile::remove(fileName);
-        if (QFile::copy(current_image_path_, fileName))
-        {
-            QMessageBox::information(this, "Save Image", "Image saved successfully.");
-        }
-        else
+        QSvgGenerator generator;
+        generator.setFileName(fileName);
+        generator.setSize(source_rect.size().toSize());
+        generator.setViewBox(QRectF(QPointF(0, 0), source_rect.size()));
+
+        QPainter painter;
+        if (!painter.begin(&generator))
         {
             QMessageBox::warning(this, "Save Image", "Failed to save SVG file.");
-        }
-    }
-    else
-    {
-        // Render SVG to raster image
-        QSvgRenderer renderer(current_image_path_);
-        if (!renderer.isValid())
-        {
-            QMessageBox::warning(this, "Save Image", "Invalid SVG file.");
             return;
         }
+        scene_->render(&painter, QRectF(QPointF(0, 0), source_rect.size()), source_rect);
+        painter.end();
+        QMessageBox::information(this, "Save Image", "Image saved successfully.");
+        return;
+    }
 
-        // Get default size from SVG, or use a reasonable default
-        QSize size = renderer.defaultSize();
-        if (size.isEmpty() || size.width() < 100 || size.height() < 100)
-        {
-            size = QSize(1920, 1080); // Default HD size
-        }
+    // Render the scene to a raster image, large graphs are scaled down
+    const qreal max_side = 8192;
+    QSizeF size = source_rect.size();
+    if (size.width() > max_side || size.height() > max_side)
+    {
+        size.scale(max_side, max_side, Qt::KeepAspectRatio);
+    }
 
-        QImage image(size, QImage::Format_ARGB32);
-        image.fill(Qt::white);
+    QImage image(size.toSize().expandedTo(QSize(1, 1)), QImage::Format_ARGB32);
+    image.fill(Qt::white);
 
-        QPainter painter(&image);
-        painter.setRenderHint(QPainter::Antialiasing);
-        painter.setRenderHint(QPainter::SmoothPixmapTransform);
-        renderer.render(&painter);
-        painter.end();
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    scene_->render(&painter, QRectF(QPointF(0, 0), size), source_rect);
+    painter.end();
 
-        if (image.save(fileName, format.toStdString().c_str()))
-        {
-            QMessageBox::information(this, "Save Image", "Image saved successfully.");
-        }
-        else
-        {
-            QMessageBox::warning(this, "Save Image", "Failed to save image.");
-        }
+    if (image.save(fileName, format.toStdString().c_str()))
+    {
+        QMessageBox::information(this, "Save Image", "Image saved successfully.");
+    }
+    else
+    {
+        QMessageBox::warning(this, "Save Image", "Failed to save image.");
     }
 }
 
@@ -2,10 +2,17 @@
 
 #include <QGraphicsScene>
 #include <QGraphicsView>
+#include <QHash>
 #include <QWidget>
-#include <QGraphicsSvgItem>
 
+#include <memory>
+
+#include "core/dependency_graph_layout.h"
 #include "core/equation_group.h"
+#include "core/equation_manager.h"
+
+class QAction;
+class QSpinBox;
 
 namespace xequation
 {
@@ -20,12 +27,28 @@ class EquationDependencyGraphViewer : public QWidget
     void OnEquationGroupAdded(const EquationGroup *group);
     void OnEquationGroupUpdated(const EquationGroup *group, bitmask::bitmask<EquationGroupUpdateFlag> update_flags);
     void OnEquationGroupRemoving(const EquationGroup *group);
-    void OnDependencyGraphImageGenerated(const QString &image_path);
+    void OnDependencyGraphLayoutGenerated(std::shared_ptr<const DependencyGraphLayout> layout);
     qreal GetMaxScale() const;
     qreal GetMinScale() const;
 
+    // last rendered layout, pass it to the next layout task to keep positions stable
+    std::shared_ptr<const DependencyGraphLayout> layout() const
+    {
+        return layout_;
+    }
+
+    // which part of the graph to lay out, edited from the toolbar
+    const DependencyGraphViewOptions &view_options() const
+    {
+        return view_options_;
+    }
+
+    // shows the equations and their neighbours within the hop count of the toolbar
+    void FocusEquations(const QStringList &equation_names);
+    void ShowAllEquations();
+
   signals:
-    void DependencyGraphImageRequested();
+    void DependencyGraphLayoutRequested();
 
   protected:
     void SetupUI();
@@ -41,10 +64,20 @@ class EquationDependencyGraphViewer : public QWidget
     void resizeEvent(QResizeEvent *event) override;
 
   private:
+    void UpdateSceneItems();
+    void OnNodeActivated(const QString &node_name);
+    void OnCollapseGroupsToggled(bool checked);
+    void OnHopCountChanged(int hop_count);
+
     QGraphicsScene *scene_;
     QGraphicsView *view_;
-    QGraphicsSvgItem *svg_item_;
-    QString current_image_path_;
+    std::shared_ptr<const DependencyGraphLayout> layout_;
+    // node items are reused across layouts, edges are rebuilt
+    QHash<QString, QGraphicsItem *> node_items_;
+    QList<QGraphicsItem *> edge_items_;
+    DependencyGraphViewOptions view_options_;
+    QAction *collapse_groups_action_;
+    QSpinBox *hop_count_spin_box_;
 };
 } // namespace gui
 } // namespace xequation
\ No newline at end of file
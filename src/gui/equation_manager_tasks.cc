@@ -1,55 +1,33 @@
 #include "equation_manager_tasks.h"
 #include "core/equation_common.h"
 #include "python/python_qt_wrapper.h"
-#include <QDir>
-#include <QProcess>
 #include <QThread>
-#include <QFont>
-#include <QFontDatabase>
+
+#include <algorithm>
 
 
 namespace xequation
 {
 namespace gui
 {
-void EquationManagerTask::Execute()
-{
-    if (equation_manager_->language() == "Python")
-    {
-        pybind11::gil_scoped_acquire acquire;
-        PyThreadState *py_thread_state = PyThreadState_Get();
-        internal_data_ = static_cast<void *>(py_thread_state);
-    }
-}
-
 void EquationManagerTask::RequestCancel()
 {
     Task::RequestCancel();
-    if (equation_manager_->language() == "Python" && internal_data_)
-    {
-        pybind11::gil_scoped_acquire acquire;
-        void *data = internal_data_;
-        PyThreadState *py_thread_state = static_cast<PyThreadState *>(data);
-        PyThreadState_SetAsyncExc(py_thread_state->thread_id, PyExc_KeyboardInterrupt);
-    }
+    // the executor tracks its running calls, no thread state to keep here
+    equation_manager_->Interrupt();
 }
 
 void EquationManagerTask::Cleanup()
 {
-    if (equation_manager_->language() == "Python")
-    {
-        internal_data_ = nullptr;
-    }
 }
 
 void UpdateEquationGroupTask::Execute()
 {
-    EquationManagerTask::Execute();
     SetProgress(5, "Starting update of equation group...");
     auto manager = equation_manager();
     // get the equations in the group before updating
     auto equation_names = manager->GetEquationGroup(group_id_)->GetEquationNames();
-    auto update_equation_names = manager->graph().TopologicalSort(equation_names);
+    auto update_equation_names = manager->GetUpdateOrder(equation_names);
 
     SetProgress(10, "Updating equations in the group...");
 
@@ -75,10 +53,9 @@ void UpdateEquationGroupTask::Execute()
 
 void UpdateManagerTask::Execute()
 {
-    EquationManagerTask::Execute();
     SetProgress(5, "Starting full update...");
     auto manager = equation_manager();
-    auto update_equation_names = manager->graph().TopologicalSort();
+    auto update_equation_names = manager->GetUpdateOrder(manager->GetEquationNames());
 
     SetProgress(10, "Updating equations...");
 
@@ -104,10 +81,9 @@ void UpdateManagerTask::Execute()
 
 void UpdateEquationsTask::Execute()
 {
-    EquationManagerTask::Execute();
     SetProgress(5, "Starting update of equations...");
     auto manager = equation_manager();
-    auto update_equation_names = manager->graph().TopologicalSort(update_equations_);
+    auto update_equation_names = manager->GetUpdateOrder(update_equations_);
 
     SetProgress(10, "Updating equations...");
 
@@ -131,6 +107,34 @@ void UpdateEquationsTask::Execute()
     SetProgress(100, "Update completed.");
 }
 
+void RequestEquationsTask::Execute()
+{
+    SetProgress(5, "Starting request of equations...");
+    auto manager = equation_manager();
+    auto request_equation_names = manager->GetRequestOrder(request_equations_);
+
+    SetProgress(10, "Computing requested equations...");
+
+    for (size_t i = 0; i < request_equation_names.size(); ++i)
+    {
+        if (cancel_requested_.load())
+        {
+            manager->UpdateEquationStatus(request_equation_names[i], ResultStatus::kKeyBoardInterrupt);
+            continue;
+        }
+        int progress = 10 + static_cast<int>(80.0 * i / request_equation_names.size());
+        SetProgress(progress, "Updating equation: " + QString::fromStdString(request_equation_names[i]));
+        manager->UpdateEquationWithoutPropagate(request_equation_names[i]);
+        // release GIL for main thread to update UI
+        QThread::msleep(200);
+    }
+    if (cancel_requested_.load())
+    {
+        return;
+    }
+    SetProgress(100, "Request completed.");
+}
+
 EvalExpressionTask::EvalExpressionTask(const QString &title, EquationManager *manager, const std::string &expression)
     : EquationManagerTask(title, manager), expression_(expression)
 {
@@ -139,7 +143,6 @@ EvalExpressionTask::EvalExpressionTask(const QString &title, EquationManager *ma
 
 void EvalExpressionTask::Execute()
 {
-    EquationManagerTask::Execute();
     SetProgress(5, "Starting evaluation of expression...");
     auto manager = equation_manager();
 
@@ -152,93 +155,113 @@ void EvalExpressionTask::Execute()
     SetProgress(100, "Evaluation completed.");
 }
 
+EvalExpressionsTask::EvalExpressionsTask(
+    const QString &title, EquationManager *manager, const QVector<QUuid> &ids, const std::vector<std::string> &expressions
+)
+    : EquationManagerTask(title, manager), ids_(ids), expressions_(expressions)
+{
+    connect(this, &Task::Finished, this, [this](QUuid id) { emit EvalsCompleted(ids_, results_); });
+}
+
+void EvalExpressionsTask::Execute()
+{
+    SetProgress(5, "Starting evaluation of expressions...");
+    auto manager = equation_manager();
+
+    SetProgress(10, "Evaluating expressions...");
+    // the engine locks its interpreter once for the whole batch
+    results_ = manager->EvalBatch(expressions_);
+    if (cancel_requested_.load())
+    {
+        return;
+    }
+    SetProgress(100, "Evaluation completed.");
+}
+
 EquationDependencyGraphGenerationTask::EquationDependencyGraphGenerationTask(
-    const QString &title, EquationManager *manager
+    const QString &title, EquationManager *manager, std::shared_ptr<const DependencyGraphLayout> previous_layout,
+    const DependencyGraphViewOptions &view_options
 )
-    : EquationManagerTask(title, manager)
+    : EquationManagerTask(title, manager), previous_layout_(previous_layout), view_options_(view_options)
 {
-    connect(this, &Task::Finished, this, [this](QUuid id) { emit DependencyGraphImageGenerated(image_path_); });
+    connect(this, &Task::Finished, this, [this](QUuid id) {
+        if (layout_)
+        {
+            emit DependencyGraphLayoutGenerated(layout_);
+        }
+    });
 }
 
 void EquationDependencyGraphGenerationTask::Execute()
 {
-    EquationManagerTask::Execute();
-    SetProgress(0, "Starting dependency graph generation...");
-    QDir temp_dir("temp");
-    if (!temp_dir.exists())
+    SetProgress(0, "Starting dependency graph layout...");
+
+    std::shared_ptr<DependencyGraphLayout> layout =
+        previous_layout_ ? std::make_shared<DependencyGraphLayout>(*previous_layout_)
+                         : std::make_shared<DependencyGraphLayout>();
+
+    const EquationManager *manager = equation_manager();
+    DependencyGraphView view;
+    try
     {
-        temp_dir.mkpath(".");
+        view = manager->GetDependencyGraphView(view_options_);
     }
-    SetProgress(10, "Generating dependency graph DOT file...");
-    // Generate SVG using graphviz dot command
-    QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
-    QString dot_file = QString("temp/%1_dependency.dot").arg(timestamp);
-    QString svg_file = QString("temp/%1_dependency.svg").arg(timestamp);
-    bool result = equation_manager()->WriteDependencyGraphToDotFile(dot_file.toStdString());
-    if (!result)
+    catch (const EquationException &)
     {
-        SetProgress(0, "Failed to generate DOT file.");
-        return;
+        // a focused equation was removed meanwhile, show the whole graph
+        view_options_.focus_equations.clear();
+        view = manager->GetDependencyGraphView(view_options_);
     }
 
-    // clear old temp files, keep only last 10 files
-    QStringList dot_files = temp_dir.entryList(QStringList() << "*_dependency.dot", QDir::Files, QDir::Name);
-    QStringList svg_files = temp_dir.entryList(QStringList() << "*_dependency.svg", QDir::Files, QDir::Name);
-    QStringList png_files = temp_dir.entryList(QStringList() << "*_dependency.png", QDir::Files, QDir::Name);
-
-    if (dot_files.size() > 10)
-    {
-        for (int i = 0; i < dot_files.size() - 10; ++i)
+    SetProgress(30, "Computing dependency graph layout...");
+    layout->Compute(*view.graph, [manager, &view](const std::string &node_name) -> std::string {
+        auto group_it = view.group_nodes.find(node_name);
+        if (group_it != view.group_nodes.end())
         {
-            temp_dir.remove(dot_files[i]);
+            const EquationGroup *group = manager->GetEquationGroup(group_it->second);
+            if (!group)
+            {
+                return node_name;
+            }
+            // collapsed group: equation count and the first few names
+            const size_t max_name_count = 3;
+            std::vector<std::string> names = group->GetEquationNames();
+            std::string label = "group (" + std::to_string(names.size()) + ")\n";
+            for (size_t i = 0; i < names.size() && i < max_name_count; i++)
+            {
+                label += (i == 0 ? "" : ", ") + names[i];
+            }
+            if (names.size() > max_name_count)
+            {
+                label += ", ...";
+            }
+            return label;
         }
-    }
 
-    if (svg_files.size() > 10)
-    {
-        for (int i = 0; i < svg_files.size() - 10; ++i)
+        const Equation *equation = manager->GetEquation(node_name);
+        if (!equation)
         {
-            temp_dir.remove(svg_files[i]);
+            return node_name;
         }
-    }
 
-    if (png_files.size() > 10)
-    {
-        for (int i = 0; i < png_files.size() - 10; ++i)
+        // name, type and the first line of the content, truncated
+        const size_t max_content_length = 40;
+        std::string content = equation->content();
+        size_t line_end = content.find('\n');
+        bool truncated = line_end != std::string::npos || content.length() > max_content_length;
+        content = content.substr(0, std::min(line_end, max_content_length));
+        if (truncated)
         {
-            temp_dir.remove(png_files[i]);
+            content += "...";
         }
-    }
+        return node_name + "\n" + ItemTypeConverter::ToString(equation->type()) + "\n" + content;
+    });
 
-    SetProgress(60, "Converting DOT file to SVG...");
-    QProcess process;
-    
-    // Get fixed-width font for better readability
-    QFont fixed_font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
-    QString font_name = fixed_font.family();
-    
-    QStringList args;
-    args << "-Tsvg"
-         << "-Gfontname=" + font_name     // Set graph font
-         << "-Nfontname=" + font_name     // Set node font
-         << "-Efontname=" + font_name     // Set edge font
-         << dot_file 
-         << "-o" 
-         << svg_file;
-    
-    process.start("dot", args);
-    if (!process.waitForFinished(5000))
-    {
-        SetProgress(60, "Failed to generate dependency graph: Graphviz timeout or not installed.");
-        return;
-    }
-    if (process.exitCode() != 0)
+    if (cancel_requested_.load())
     {
-        QString error = process.readAllStandardError();
-        SetProgress(60, "Failed to generate dependency graph");
         return;
     }
-    image_path_ = svg_file;
+    layout_ = layout;
     SetProgress(100, "Successfully generated dependency graph");
 }
 } // namespace gui
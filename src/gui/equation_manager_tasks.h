@@ -1,10 +1,14 @@
 #pragma once
 
+#include "core/dependency_graph_layout.h"
 #include "core/equation_common.h"
 #include "core/equation_manager.h"
 #include "task/task.h"
 
 #include <QSize>
+#include <QVector>
+
+#include <memory>
 
 namespace xequation
 {
@@ -17,7 +21,6 @@ class EquationManagerTask : public Task
     EquationManagerTask(const QString &title, EquationManager *manager) : Task(title), equation_manager_(manager) {}
     ~EquationManagerTask() override = default;
 
-    virtual void Execute() override;
     virtual void RequestCancel() override;
     virtual void Cleanup() override;
     EquationManager *equation_manager() const
@@ -73,6 +76,25 @@ class UpdateEquationsTask : public EquationManagerTask
     std::vector<std::string> update_equations_;
 };
 
+// computes requested equations and the dirty equations they depend on
+class RequestEquationsTask : public EquationManagerTask
+{
+    Q_OBJECT
+  public:
+    RequestEquationsTask(
+        const QString &title, EquationManager *manager, const std::vector<std::string> &request_equations
+    )
+        : EquationManagerTask(title, manager), request_equations_(request_equations)
+    {
+    }
+    ~RequestEquationsTask() override = default;
+
+    void Execute() override;
+
+  private:
+    std::vector<std::string> request_equations_;
+};
+
 class EvalExpressionTask : public EquationManagerTask
 {
     Q_OBJECT
@@ -90,20 +112,47 @@ class EvalExpressionTask : public EquationManagerTask
     InterpretResult result_;
 };
 
+class EvalExpressionsTask : public EquationManagerTask
+{
+    Q_OBJECT
+  public:
+    EvalExpressionsTask(
+        const QString &title, EquationManager *manager, const QVector<QUuid> &ids, const std::vector<std::string> &expressions
+    );
+    ~EvalExpressionsTask() override = default;
+
+    void Execute() override;
+
+  signals:
+    void EvalsCompleted(QVector<QUuid> ids, std::vector<InterpretResult> results);
+
+  private:
+    QVector<QUuid> ids_;
+    std::vector<std::string> expressions_;
+    std::vector<InterpretResult> results_;
+};
+
 class EquationDependencyGraphGenerationTask : public EquationManagerTask
 {
     Q_OBJECT
   public:
-    EquationDependencyGraphGenerationTask(const QString &title, EquationManager *manager);
+    // previous_layout seeds the node order so an edit only moves the nodes around it
+    EquationDependencyGraphGenerationTask(
+        const QString &title, EquationManager *manager,
+        std::shared_ptr<const DependencyGraphLayout> previous_layout = nullptr,
+        const DependencyGraphViewOptions &view_options = DependencyGraphViewOptions()
+    );
     ~EquationDependencyGraphGenerationTask() override = default;
 
     void Execute() override;
 
   signals:
-    void DependencyGraphImageGenerated(const QString &image_path);
+    void DependencyGraphLayoutGenerated(std::shared_ptr<const DependencyGraphLayout> layout);
 
   private:
-    QString image_path_;
+    std::shared_ptr<const DependencyGraphLayout> previous_layout_;
+    DependencyGraphViewOptions view_options_;
+    std::shared_ptr<DependencyGraphLayout> layout_;
 };
 
 } // namespace gui
@@ -203,25 +203,9 @@ ExpressionWatchWidget::ExpressionWatchWidget(EquationCompletionModel *completion
 void ExpressionWatchWidget::OnEquationRemoved(const std::string &equation_name)
 {
     auto range = expression_item_equation_name_bimap_.right.equal_range(equation_name);
-    std::vector<QUuid> ids_to_update;
     for (auto it = range.first; it != range.second; ++it)
     {
-        const QUuid& id = it->get_left();
-        ids_to_update.push_back(id);
-    }
-    for (const auto& id : ids_to_update)
-    {
-        auto it = expression_item_map_.find(id);
-        if (it == expression_item_map_.end())
-            continue;
-        auto expression = it->second->name();
-        // recreate the watch item
-        auto new_item = CreateWatchItem(expression);
-        if (new_item)
-        {
-            model_->ReplaceWatchItem(id, new_item);
-            DeleteWatchItem(id);
-        }
+        ScheduleEval(it->get_left());
     }
 }
 
@@ -231,27 +215,11 @@ void ExpressionWatchWidget::OnEquationUpdated(
 {
     if (change_type & EquationUpdateFlag::kValue)
     {
-        // find all watch items depending on this equation
+        // re-evaluate only the watch items depending on this equation, the parse result is kept
         auto range = expression_item_equation_name_bimap_.right.equal_range(equation->name());
-        std::vector<QUuid> ids_to_update;
         for (auto it = range.first; it != range.second; ++it)
         {
-            const QUuid& id = it->get_left();
-            ids_to_update.push_back(id);
-        }
-        for (const auto& id : ids_to_update)
-        {
-            auto it = expression_item_map_.find(id);
-            if (it == expression_item_map_.end())
-                continue;
-            auto expression = it->second->name();
-            // recreate the watch item
-            auto new_item = CreateWatchItem(expression);
-            if (new_item)
-            {
-                model_->ReplaceWatchItem(id, new_item);
-                DeleteWatchItem(id);
-            }
+            ScheduleEval(it->get_left());
         }
     }
 }
@@ -268,6 +236,17 @@ void ExpressionWatchWidget::OnAddExpressionToWatch(const QString &expression)
 
 void ExpressionWatchWidget::OnEvalResultSubmitted(const QUuid& id, const InterpretResult &result)
 {
+    auto count_it = in_flight_eval_count_map_.find(id);
+    if (count_it != in_flight_eval_count_map_.end())
+    {
+        // a newer evaluation of this item is still running, drop the stale result
+        if (--count_it->second > 0)
+        {
+            return;
+        }
+        in_flight_eval_count_map_.erase(count_it);
+    }
+
     auto it = expression_item_map_.find(id);
     if (it == expression_item_map_.end())
         return;
@@ -305,10 +284,37 @@ void ExpressionWatchWidget::OnEvalResultSubmitted(const QUuid& id, const Interpr
     // insert new item
     expression_item_map_.insert({new_item_id, std::move(new_item)});
 
+    // keep a scheduled re-evaluation on the replacing item
+    if (pending_eval_ids_.erase(id) != 0)
+    {
+        pending_eval_ids_.insert(new_item_id);
+    }
+
     model_->ReplaceWatchItem(id, new_item_ptr);
     DeleteWatchItem(id);
 }
 
+void ExpressionWatchWidget::OnEvalResultsSubmitted(
+    const QVector<QUuid> &ids, const std::vector<InterpretResult> &results
+)
+{
+    for (int i = 0; i < ids.size(); ++i)
+    {
+        if (static_cast<size_t>(i) < results.size())
+        {
+            OnEvalResultSubmitted(ids[i], results[i]);
+            continue;
+        }
+
+        // the batch was cancelled before this item was evaluated
+        auto count_it = in_flight_eval_count_map_.find(ids[i]);
+        if (count_it != in_flight_eval_count_map_.end() && --count_it->second <= 0)
+        {
+            in_flight_eval_count_map_.erase(count_it);
+        }
+    }
+}
+
 void ExpressionWatchWidget::SetupUI()
 {
     setWindowTitle("Expression Watch");
@@ -318,6 +324,10 @@ void ExpressionWatchWidget::SetupUI()
     setContextMenuPolicy(Qt::CustomContextMenu);
     setMinimumSize(800, 600);
 
+    eval_debounce_timer_ = new QTimer(this);
+    eval_debounce_timer_->setSingleShot(true);
+    eval_debounce_timer_->setInterval(kEvalDebounceInterval);
+
     view_ = new ValueTreeView(this);
     model_ = new ExpressionWatchModel(view_);
 
@@ -366,6 +376,8 @@ void ExpressionWatchWidget::SetupUI()
 
 void ExpressionWatchWidget::SetupConnections()
 {
+    connect(eval_debounce_timer_, &QTimer::timeout, this, &ExpressionWatchWidget::FlushPendingEvals);
+
     connect(model_, &ExpressionWatchModel::AddWatchItemRequested, this, &ExpressionWatchWidget::OnRequestAddWatchItem);
 
     connect(
@@ -418,8 +430,12 @@ ValueItem *ExpressionWatchWidget::CreateWatchItem(const QString &expression)
         for (const auto &dependency : dependencies)
         {
             expression_item_equation_name_bimap_.insert({item_id, dependency});
+            if (expression_item_equation_name_bimap_.right.count(dependency) == 1)
+            {
+                emit EquationObserved(QString::fromStdString(dependency));
+            }
         }
-        emit EvalResultAsyncRequested(item_id, expression);
+        ScheduleEval(item_id);
     }
     auto item_ptr = item.get();
     expression_item_map_.insert({item->id(), std::move(item)});
@@ -429,9 +445,22 @@ ValueItem *ExpressionWatchWidget::CreateWatchItem(const QString &expression)
 void ExpressionWatchWidget::DeleteWatchItem(const QUuid& id)
 {
     auto range = expression_item_equation_name_bimap_.left.equal_range(id);
+    std::set<std::string> dependencies;
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        dependencies.insert(it->get_right());
+    }
     expression_item_equation_name_bimap_.left.erase(range.first, range.second);
+    for (const auto &dependency : dependencies)
+    {
+        if (expression_item_equation_name_bimap_.right.count(dependency) == 0)
+        {
+            emit EquationUnobserved(QString::fromStdString(dependency));
+        }
+    }
 
     expression_item_map_.erase(id);
+    pending_eval_ids_.erase(id);
 }
 
 void ExpressionWatchWidget::SetCurrentItemToPlaceholder()
@@ -439,6 +468,33 @@ void ExpressionWatchWidget::SetCurrentItemToPlaceholder()
     view_->setCurrentIndex(model_->index(model_->rowCount() - 1, 0, QModelIndex()));
 }
 
+void ExpressionWatchWidget::ScheduleEval(const QUuid &id)
+{
+    pending_eval_ids_.insert(id);
+    // restart the timer so a burst of equation updates is delivered as one batch
+    eval_debounce_timer_->start();
+}
+
+void ExpressionWatchWidget::FlushPendingEvals()
+{
+    QVector<QUuid> ids;
+    QStringList expressions;
+    for (const auto &id : pending_eval_ids_)
+    {
+        auto it = expression_item_map_.find(id);
+        if (it == expression_item_map_.end())
+            continue;
+        ids.push_back(id);
+        expressions.push_back(it->second->name());
+        in_flight_eval_count_map_[id]++;
+    }
+    pending_eval_ids_.clear();
+
+    if (ids.isEmpty())
+        return;
+    emit EvalResultsAsyncRequested(ids, expressions);
+}
+
 void ExpressionWatchWidget::OnRequestAddWatchItem(const QString &expression)
 {
     auto item = CreateWatchItem(expression);
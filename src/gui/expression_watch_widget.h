@@ -8,9 +8,12 @@
 #include "equation_completion_model.h"
 
 #include <QEvent>
+#include <QTimer>
+#include <QVector>
 #include <boost/bimap.hpp>
 #include <boost/bimap/multiset_of.hpp>
 #include <quuid.h>
+#include <set>
 
 namespace xequation
 {
@@ -50,10 +53,14 @@ class ExpressionWatchWidget : public QWidget
     void OnEquationUpdated(const Equation *equation, bitmask::bitmask<EquationUpdateFlag> change_type);
     void OnAddExpressionToWatch(const QString &expression);
     void OnEvalResultSubmitted(const QUuid& id, const InterpretResult& result);
+    void OnEvalResultsSubmitted(const QVector<QUuid>& ids, const std::vector<InterpretResult>& results);
     
   signals:
     void ParseResultRequested(const QString& expression, ParseResult &result);
-    void EvalResultAsyncRequested(const QUuid& id, const QString& expression);
+    void EvalResultsAsyncRequested(const QVector<QUuid>& ids, const QStringList& expressions);
+    // emitted when the first watch item depending on an equation is added, and when the last one is removed
+    void EquationObserved(const QString& equation_name);
+    void EquationUnobserved(const QString& equation_name);
 
   protected:
     void SetupUI();
@@ -62,6 +69,8 @@ class ExpressionWatchWidget : public QWidget
     ValueItem *CreateWatchItem(const QString &expression);
     void DeleteWatchItem(const QUuid& id);
     void SetCurrentItemToPlaceholder();
+    void ScheduleEval(const QUuid& id);
+    void FlushPendingEvals();
     void OnRequestAddWatchItem(const QString &expression);
     void OnRequestReplaceWatchItem(const QUuid& id, const QString &new_expression);
 
@@ -76,6 +85,8 @@ class ExpressionWatchWidget : public QWidget
     bool eventFilter(QObject *obj, QEvent *event) override;
 
   private:
+    static constexpr int kEvalDebounceInterval = 20;
+
     typedef boost::bimaps::bimap<boost::bimaps::multiset_of<QUuid>, boost::bimaps::multiset_of<std::string>>
         ExpressionItemEquationNameBimap;
     ExpressionWatchModel *model_;
@@ -85,6 +96,11 @@ class ExpressionWatchWidget : public QWidget
     ExpressionItemEquationNameBimap expression_item_equation_name_bimap_;
     std::map<QUuid, ValueItem::UniquePtr> expression_item_map_;
 
+    // watch items waiting for the debounce timer, and the number of batches still evaluating each item
+    QTimer *eval_debounce_timer_{};
+    std::set<QUuid> pending_eval_ids_;
+    std::map<QUuid, int> in_flight_eval_count_map_;
+
     // actions
     QAction *copy_action_{};
     QAction *paste_action_{};
@@ -6,131 +6,210 @@ namespace xequation
 {
 namespace gui
 {
-PythonHighlighter::PythonHighlighter(QTextDocument *document) : CodeHighlighter(document)
+namespace
 {
-    // Initialize pre-model rules
-    // Variables
-    pre_model_rules_.append({QRegularExpression(R"((\b[a-zA-Z_][a-zA-Z0-9_]*\b))"), "Variable"});
-
-    // Functions
-    pre_model_rules_.append({QRegularExpression(R"((\b[a-zA-Z_][a-zA-Z0-9_]*\b)\()"), "Function"});
-
-    // Class Define
-    pre_model_rules_.append({QRegularExpression(R"(\bclass\b\s+([A-Za-z_][A-Za-z0-9_]*))"), "Class"});
-
-    // Function Define
-    pre_model_rules_.append({QRegularExpression(R"(\bdef\b\s+([A-Za-z_][A-Za-z0-9_]*))"), "Function"});
-
-    // Initialize post-model rules
-    // Numbers
-    post_model_rules_.append({QRegularExpression(R"((\b(0b|0x){0,1}[\d.']+\b))"), "Number"});
-
-    // Strings
-    post_model_rules_.append({QRegularExpression(R"(("[^\n"]*"))"), "String"});
-    post_model_rules_.append({QRegularExpression(R"(('[^\n"]*'))"), "String"});
-
-    // Single line comment
-    post_model_rules_.append({QRegularExpression("(#[^\n]*)"), "Comment"});
-
-    // Multiline string
-    block_rules_.append({QRegularExpression("(''')"), QRegularExpression("(''')"), "String"});
-    block_rules_.append({QRegularExpression("(\"\"\")"), QRegularExpression("(\"\"\")"), "String"});
+bool IsStringPrefix(const QString &word)
+{
+    if (word.length() > 2)
+    {
+        return false;
+    }
+    for (QChar c : word)
+    {
+        QChar lower = c.toLower();
+        if (lower != 'r' && lower != 'b' && lower != 'u' && lower != 'f')
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
-void PythonHighlighter::ApplyRules(const QString &text, const QVector<QHighlightRule> &rules)
+// position after the closing quote(s) at or after from, -1 if there is none in text
+int FindStringEnd(const QString &text, int from, QChar quote, bool triple)
 {
-    for (const auto &rule : rules)
+    int pos = from;
+    while (pos < text.length())
     {
-        QRegularExpression pattern = rule.pattern;
-        auto matchIterator = pattern.globalMatch(text);
-
-        while (matchIterator.hasNext())
+        QChar c = text.at(pos);
+        if (c == '\\')
         {
-            auto match = matchIterator.next();
-            setFormat(match.capturedStart(1), match.capturedLength(1), syntaxStyle()->getFormat(rule.formatName));
+            pos += 2;
+            continue;
         }
+        if (c == quote)
+        {
+            if (!triple)
+            {
+                return pos + 1;
+            }
+            if (pos + 2 < text.length() && text.at(pos + 1) == quote && text.at(pos + 2) == quote)
+            {
+                return pos + 3;
+            }
+        }
+        pos++;
     }
+    return -1;
 }
-void PythonHighlighter::highlightBlock(const QString &text)
-{
-    // Apply pre-model rules
-    ApplyRules(text, pre_model_rules_);
-
-    // Apply model-based rules
-    CodeHighlighter::highlightBlock(text);
+} // namespace
 
-    // Apply post-model rules
-    ApplyRules(text, post_model_rules_);
+PythonHighlighter::PythonHighlighter(QTextDocument *document) : CodeHighlighter(document) {}
 
-    setCurrentBlockState(0);
-    int startIndex = 0;
-    int highlightRuleId = previousBlockState();
+void PythonHighlighter::highlightBlock(const QString &text)
+{
+    const int length = text.length();
+    int pos = 0;
+    setCurrentBlockState(kNormalState);
 
-    if (highlightRuleId >= 1 && highlightRuleId <= block_rules_.size())
+    int state = previousBlockState();
+    if (state == kSingleQuoteStringState || state == kDoubleQuoteStringState)
     {
-        const auto &blockRules = block_rules_.at(highlightRuleId - 1);
-        auto match = blockRules.endPattern.match(text);
-
-        if (match.capturedStart() == -1)
+        QChar quote = state == kSingleQuoteStringState ? '\'' : '"';
+        int end = FindStringEnd(text, 0, quote, true);
+        if (end < 0)
         {
-            setCurrentBlockState(highlightRuleId);
-            setFormat(0, text.length(), syntaxStyle()->getFormat(blockRules.formatName));
+            setFormat(0, length, syntaxStyle()->getFormat("String"));
+            setCurrentBlockState(state);
             return;
         }
-
-        int matchLength = match.capturedStart() + match.capturedLength();
-        setFormat(0, matchLength, syntaxStyle()->getFormat(blockRules.formatName));
-        startIndex = matchLength;
-        highlightRuleId = 0;
+        setFormat(0, end, syntaxStyle()->getFormat("String"));
+        pos = end;
     }
 
-    while (startIndex < text.length())
+    // last identifier seen, names following def / class are definitions
+    QString previous_word;
+    while (pos < length)
     {
-        int nextStartIndex = -1;
-        int nextRuleId = 0;
+        QChar c = text.at(pos);
+        if (c == '#')
+        {
+            setFormat(pos, length - pos, syntaxStyle()->getFormat("Comment"));
+            break;
+        }
 
-        for (int i = 0; i < block_rules_.size(); ++i)
+        if (c == '\'' || c == '"')
         {
-            auto match = block_rules_.at(i).startPattern.match(text, startIndex);
-            if (match.hasMatch())
+            pos = LexString(text, pos, pos);
+            if (pos < 0)
             {
-                int matchStart = match.capturedStart();
-                if (nextStartIndex == -1 || matchStart < nextStartIndex)
+                return;
+            }
+            previous_word.clear();
+            continue;
+        }
+
+        if (c.isDigit() || (c == '.' && pos + 1 < length && text.at(pos + 1).isDigit()))
+        {
+            pos = LexNumber(text, pos);
+            previous_word.clear();
+            continue;
+        }
+
+        if (IsIdentifierStart(c))
+        {
+            int start = pos;
+            while (pos < length && IsIdentifierChar(text.at(pos)))
+            {
+                pos++;
+            }
+            QString word = text.mid(start, pos - start);
+
+            // string prefix such as r"..." or b'...'
+            if (pos < length && (text.at(pos) == '\'' || text.at(pos) == '"') && IsStringPrefix(word))
+            {
+                pos = LexString(text, start, pos);
+                if (pos < 0)
                 {
-                    nextStartIndex = matchStart;
-                    nextRuleId = i + 1;
+                    return;
                 }
+                previous_word.clear();
+                continue;
             }
-        }
 
-        if (nextStartIndex == -1)
-            break;
+            LexIdentifier(text, start, pos, previous_word);
+            previous_word = word;
+            continue;
+        }
 
-        const auto &blockRules = block_rules_.at(nextRuleId - 1);
-        auto startMatch = blockRules.startPattern.match(text, nextStartIndex);
-        int afterStart = startMatch.capturedStart() + startMatch.capturedLength();
+        if (!c.isSpace())
+        {
+            previous_word.clear();
+        }
+        pos++;
+    }
+}
 
-        auto endMatch = blockRules.endPattern.match(text, afterStart);
+int PythonHighlighter::LexString(const QString &text, int start, int quote_pos)
+{
+    QChar quote = text.at(quote_pos);
+    bool triple = quote_pos + 2 < text.length() && text.at(quote_pos + 1) == quote && text.at(quote_pos + 2) == quote;
+    int end = FindStringEnd(text, quote_pos + (triple ? 3 : 1), quote, triple);
+    if (end < 0)
+    {
+        setFormat(start, text.length() - start, syntaxStyle()->getFormat("String"));
+        if (triple)
+        {
+            setCurrentBlockState(quote == '\'' ? kSingleQuoteStringState : kDoubleQuoteStringState);
+            return -1;
+        }
+        // unterminated single line string ends with the line
+        return text.length();
+    }
+    setFormat(start, end - start, syntaxStyle()->getFormat("String"));
+    return end;
+}
 
-        if (endMatch.hasMatch())
+int PythonHighlighter::LexNumber(const QString &text, int start)
+{
+    bool is_hex = text.midRef(start, 2).compare(QLatin1String("0x"), Qt::CaseInsensitive) == 0;
+    int pos = start + 1;
+    while (pos < text.length())
+    {
+        QChar c = text.at(pos);
+        QChar prev = text.at(pos - 1);
+        if (IsIdentifierChar(c) || c == '.')
         {
-            int blockEnd = endMatch.capturedStart() + endMatch.capturedLength();
-            setFormat(
-                startMatch.capturedStart(), blockEnd - startMatch.capturedStart(),
-                syntaxStyle()->getFormat(blockRules.formatName)
-            );
-            startIndex = blockEnd;
+            pos++;
+        }
+        else if ((c == '+' || c == '-') && !is_hex && (prev == 'e' || prev == 'E'))
+        {
+            pos++;
         }
         else
         {
-            setCurrentBlockState(nextRuleId);
-            setFormat(
-                startMatch.capturedStart(), text.length() - startMatch.capturedStart(),
-                syntaxStyle()->getFormat(blockRules.formatName)
-            );
             break;
         }
     }
+    setFormat(start, pos - start, syntaxStyle()->getFormat("Number"));
+    return pos;
+}
+
+void PythonHighlighter::LexIdentifier(const QString &text, int start, int end, const QString &previous_word)
+{
+    // names known to the model (keywords, builtins, equations) take precedence
+    QString category = GetWordCategory(text.mid(start, end - start));
+    if (category.isEmpty())
+    {
+        if (previous_word == "def")
+        {
+            category = "Function";
+        }
+        else if (previous_word == "class")
+        {
+            category = "Class";
+        }
+        else
+        {
+            int next = end;
+            while (next < text.length() && text.at(next).isSpace())
+            {
+                next++;
+            }
+            category = next < text.length() && text.at(next) == '(' ? "Function" : "Variable";
+        }
+    }
+    setFormat(start, end - start, syntaxStyle()->getFormat(category));
 }
 } // namespace gui
 } // namespace xequation
\ No newline at end of file
@@ -1,23 +1,30 @@
 #include "code_editor/code_highlighter.h"
-#include <QHighlightBlockRule>
-#include <QHighlightRule>
 
 namespace xequation
 {
 namespace gui
 {
+// Single pass Python lexer. The block state records an open triple quoted
+// string, so QSyntaxHighlighter only re-lexes the edited block and the blocks
+// after it whose incoming state changed.
 class PythonHighlighter : public CodeHighlighter
 {
     Q_OBJECT
 public:
     explicit PythonHighlighter(QTextDocument* document = nullptr);
 protected:
+    enum BlockState
+    {
+        kNormalState = 0,
+        kSingleQuoteStringState = 1,
+        kDoubleQuoteStringState = 2,
+    };
+
     void highlightBlock(const QString& text) override;
-    void ApplyRules(const QString& text, const QVector<QHighlightRule>& rules);
-protected:
-    QVector<QHighlightRule> pre_model_rules_;
-    QVector<QHighlightRule> post_model_rules_;
-    QVector<QHighlightBlockRule> block_rules_;
+    // returns the position after the string, or -1 if it continues into the next block
+    int LexString(const QString& text, int start, int quote_pos);
+    int LexNumber(const QString& text, int start);
+    void LexIdentifier(const QString& text, int start, int end, const QString& previous_word);
 };
 }
 }
\ No newline at end of file
@@ -9,6 +9,10 @@ namespace gui
 {
 
 // PythonDefaultItemBuilder implementation
+constexpr int PythonDefaultItemBuilder::kMaxReprLength;
+constexpr int PythonDefaultItemBuilder::kMaxReprItemCount;
+constexpr int PythonDefaultItemBuilder::kMaxReprLevel;
+
 PythonDefaultItemBuilder::PythonDefaultItemBuilder() = default;
 PythonDefaultItemBuilder::~PythonDefaultItemBuilder() = default;
 
@@ -77,9 +81,9 @@ QString PythonDefaultItemBuilder::GetObjectRepr(py::handle obj)
 
     try
     {
-        py::object repr_obj = py::repr(obj);
+        py::object repr_obj = GetBudgetedRepr().attr("repr")(obj);
         std::string repr_result = repr_obj.cast<std::string>();
-        return QString::fromStdString(repr_result);
+        return TruncateRepr(QString::fromStdString(repr_result));
     }
     catch (const std::exception &e)
     {
@@ -87,7 +91,7 @@ QString PythonDefaultItemBuilder::GetObjectRepr(py::handle obj)
         {
             py::object str_obj = py::str(obj);
             std::string str_result = str_obj.cast<std::string>();
-            return QString::fromStdString(str_result);
+            return TruncateRepr(QString::fromStdString(str_result));
         }
         catch (const std::exception &e2)
         {
@@ -100,6 +104,37 @@ QString PythonDefaultItemBuilder::GetObjectRepr(py::handle obj)
     }
 }
 
+py::object &PythonDefaultItemBuilder::GetBudgetedRepr()
+{
+    // reprlib stops descending into builtin containers and slices strings once
+    // the limits are hit, so the cost no longer grows with the size of the object.
+    // Intentionally leaked, it must not be released after the interpreter is finalized.
+    static py::object *budgeted_repr = nullptr;
+    if (!budgeted_repr)
+    {
+        py::object repr = py::module_::import("reprlib").attr("Repr")();
+        repr.attr("maxlevel") = kMaxReprLevel;
+        for (const char *attr : {"maxtuple", "maxlist", "maxarray", "maxdict", "maxset", "maxfrozenset", "maxdeque"})
+        {
+            repr.attr(attr) = kMaxReprItemCount;
+        }
+        repr.attr("maxstring") = kMaxReprLength;
+        repr.attr("maxlong") = kMaxReprLength;
+        repr.attr("maxother") = kMaxReprLength;
+        budgeted_repr = new py::object(repr);
+    }
+    return *budgeted_repr;
+}
+
+QString PythonDefaultItemBuilder::TruncateRepr(const QString &repr)
+{
+    if (repr.size() <= kMaxReprLength)
+    {
+        return repr;
+    }
+    return repr.left(kMaxReprLength) + "...";
+}
+
 // PythonListItemBuilder implementation
 bool PythonListItemBuilder::CanBuild(const Value &value)
 {
@@ -257,10 +292,11 @@ void PythonSetItemBuilder::LoadChildren(ValueItem *item, int begin, int end)
 
     auto obj = py::cast(item->value());
     auto set = py::cast<py::set>(obj);
-    for (int i = begin; i <= end; i++)
+    // sets have no random access, skip to the page once instead of once per element
+    auto it = set.begin();
+    std::advance(it, begin);
+    for (int i = begin; i <= end && it != set.end(); i++, ++it)
     {
-        auto it = set.begin();
-        std::advance(it, i);
         Value child_value = *it;
         QString item_name = QString("[%1]").arg(i);
         ValueItem::UniquePtr child_item = BuilderUtils::CreateValueItem(item_name, child_value, item);
@@ -312,10 +348,10 @@ void PythonDictItemBuilder::LoadChildren(ValueItem *item, int begin, int end)
 
     auto obj = py::cast(item->value());
     auto dict = py::cast<py::dict>(obj);
-    for (int i = begin; i <= end; i++)
+    auto it = dict.begin();
+    std::advance(it, begin);
+    for (int i = begin; i <= end && it != dict.end(); i++, ++it)
     {
-        auto it = dict.begin();
-        std::advance(it, i);
         py::object key = py::reinterpret_borrow<py::object>(it->first);
         py::object value = py::reinterpret_borrow<py::object>(it->second);
         QString key_str = PythonDefaultItemBuilder::GetObjectRepr(key);
@@ -361,10 +397,10 @@ void PythonClassItemBuilder::LoadChildren(ValueItem *item, int begin, int end)
 
     auto obj = py::cast(item->value());
     auto dict = py::cast<py::dict>(obj.attr("__dict__"));
-    for (int i = begin; i <= end; i++)
+    auto it = dict.begin();
+    std::advance(it, begin);
+    for (int i = begin; i <= end && it != dict.end(); i++, ++it)
     {
-        auto it = dict.begin();
-        std::advance(it, i);
         py::object key = py::reinterpret_borrow<py::object>(it->first);
         py::object value = py::reinterpret_borrow<py::object>(it->second);
         // check key is py::str
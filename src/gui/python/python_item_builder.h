@@ -18,8 +18,17 @@ class PythonDefaultItemBuilder : public ValueItemBuilder
 
     virtual void LoadChildren(ValueItem *item, int begin, int end) override {}
   protected:
+    // display values are rendered with a budget, huge objects are cut at the source
+    static constexpr int kMaxReprLength = 1024;
+    static constexpr int kMaxReprItemCount = 32;
+    static constexpr int kMaxReprLevel = 3;
+
     static QString GetTypeName(pybind11::handle obj, bool qualified = false);
     static QString GetObjectRepr(pybind11::handle obj);
+
+  private:
+    static pybind11::object &GetBudgetedRepr();
+    static QString TruncateRepr(const QString &repr);
 };
 
 class PythonListItemBuilder : public PythonDefaultItemBuilder
@@ -82,7 +82,6 @@ class Task : public QObject
     QDateTime end_time_;
     int progress_ = 0;
     QString progress_message_;
-    std::atomic<void*> internal_data_ {nullptr};
     std::atomic<bool> cancel_requested_{false};
     friend class TaskManager;
 };
@@ -83,6 +83,21 @@ void VariableInspectWidget::SetCurrentEquation(const Equation *equation)
         return;
     }
     current_equation_ = equation;
+
+    QString equation_name = current_equation_ ? QString::fromStdString(current_equation_->name()) : QString();
+    if (equation_name != observed_equation_name_)
+    {
+        if (!observed_equation_name_.isEmpty())
+        {
+            emit EquationUnobserved(observed_equation_name_);
+        }
+        observed_equation_name_ = equation_name;
+        if (!observed_equation_name_.isEmpty())
+        {
+            emit EquationObserved(observed_equation_name_);
+        }
+    }
+
     model_->Clear();
     if (current_equation_)
     {
@@ -23,6 +23,8 @@ public:
     void OnEquationUpdated(const Equation* equation, bitmask::bitmask<EquationUpdateFlag> change_type);
 signals:
     void AddExpressionToWatch(const QString &expression);
+    void EquationObserved(const QString &equation_name);
+    void EquationUnobserved(const QString &equation_name);
 
 private:
     void SetupUI();
@@ -38,6 +40,8 @@ private:
     ValueTreeView *view_;
     ValueTreeModel *model_;
     const Equation* current_equation_{};
+    // name of the shown equation, it stays observed while the item is rebuilt
+    QString observed_equation_name_;
     ValueItem::UniquePtr current_variable_item_;
     // actions
     QAction* copy_action_{};
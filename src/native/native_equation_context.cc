@@ -0,0 +1,157 @@
+#include "native_equation_context.h"
+
+#include <cstring>
+
+#include "native_program.h"
+
+namespace xequation
+{
+namespace native
+{
+bool NativeEquationContext::Contains(const std::string &key) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return values_.count(key) != 0;
+}
+
+Value NativeEquationContext::Get(const std::string &key) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = values_.find(key);
+    return it != values_.end() ? it->second : Value::Null();
+}
+
+void NativeEquationContext::Set(const std::string &key, const Value &value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    values_[key] = value;
+}
+
+bool NativeEquationContext::Remove(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return values_.erase(key) != 0;
+}
+
+void NativeEquationContext::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    values_.clear();
+}
+
+std::unordered_set<std::string> NativeEquationContext::keys() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_set<std::string> keys;
+    for (const auto &entry : values_)
+    {
+        keys.insert(entry.first);
+    }
+    return keys;
+}
+
+size_t NativeEquationContext::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return values_.size();
+}
+
+bool NativeEquationContext::empty() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return values_.empty();
+}
+
+std::shared_ptr<const std::unordered_set<std::string>> NativeEquationContext::GetBuiltinNames() const
+{
+    // the builtins never change, one set serves every context
+    static const std::shared_ptr<const std::unordered_set<std::string>> builtin_names =
+        std::make_shared<const std::unordered_set<std::string>>(
+            NativeProgram::BuiltinFunctionNames().begin(), NativeProgram::BuiltinFunctionNames().end()
+        );
+    return builtin_names;
+}
+
+// one kind byte, then the int64_t / double or the item count and the items
+// in host byte order
+bool NativeEquationContext::SerializeValue(const std::string &key, std::string &data) const
+{
+    NativeValue value;
+    if (!NativeValue::FromValue(Get(key), value))
+    {
+        return false;
+    }
+    data.assign(1, static_cast<char>(value.kind));
+    switch (value.kind)
+    {
+    case NativeValue::Kind::kBool:
+    case NativeValue::Kind::kInt:
+        data.append(reinterpret_cast<const char *>(&value.int_value), sizeof(value.int_value));
+        break;
+    case NativeValue::Kind::kFloat:
+        data.append(reinterpret_cast<const char *>(&value.float_value), sizeof(value.float_value));
+        break;
+    case NativeValue::Kind::kVector: {
+        uint64_t count = value.vector_value.size();
+        data.append(reinterpret_cast<const char *>(&count), sizeof(count));
+        data.append(reinterpret_cast<const char *>(value.vector_value.data()), count * sizeof(double));
+        break;
+    }
+    }
+    return true;
+}
+
+bool NativeEquationContext::DeserializeValue(const std::string &key, const std::string &data)
+{
+    if (data.size() < 1 + sizeof(uint64_t))
+    {
+        return false;
+    }
+    NativeValue value;
+    value.kind = static_cast<NativeValue::Kind>(data[0]);
+    const char *payload = data.data() + 1;
+    switch (value.kind)
+    {
+    case NativeValue::Kind::kBool:
+    case NativeValue::Kind::kInt:
+    case NativeValue::Kind::kFloat:
+        if (data.size() != 1 + sizeof(uint64_t))
+        {
+            return false;
+        }
+        std::memcpy(&value.int_value, payload, sizeof(value.int_value));
+        std::memcpy(&value.float_value, payload, sizeof(value.float_value));
+        break;
+    case NativeValue::Kind::kVector: {
+        uint64_t count = 0;
+        std::memcpy(&count, payload, sizeof(count));
+        if ((data.size() - 1 - sizeof(count)) / sizeof(double) != count ||
+            (data.size() - 1 - sizeof(count)) % sizeof(double) != 0)
+        {
+            return false;
+        }
+        value.vector_value.resize(count);
+        std::memcpy(value.vector_value.data(), payload + sizeof(count), count * sizeof(double));
+        break;
+    }
+    default:
+        return false;
+    }
+    Set(key, value.ToValue());
+    return true;
+}
+
+bool NativeEquationContext::GetValueSize(const std::string &key, size_t &size) const
+{
+    Value stored = Get(key);
+    NativeValue value;
+    if (!NativeValue::FromValue(stored, value))
+    {
+        return false;
+    }
+    size = sizeof(Value) + (value.kind == NativeValue::Kind::kVector ? value.vector_value.size() * sizeof(double)
+                                                                     : sizeof(double));
+    return true;
+}
+} // namespace native
+} // namespace xequation
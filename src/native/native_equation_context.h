@@ -0,0 +1,54 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "core/equation_context.h"
+
+namespace xequation
+{
+namespace native
+{
+// Plain map of Values behind a mutex, so equations are interpreted in
+// parallel without any interpreter lock.
+class NativeEquationContext : public EquationContext
+{
+  public:
+    NativeEquationContext() = default;
+
+    NativeEquationContext(const NativeEquationContext &) = delete;
+    NativeEquationContext &operator=(const NativeEquationContext &) = delete;
+
+    bool Contains(const std::string &key) const override;
+
+    Value Get(const std::string &key) const override;
+
+    void Set(const std::string &key, const Value &value) override;
+
+    bool Remove(const std::string &key) override;
+
+    void Clear() override;
+
+    std::unordered_set<std::string> keys() const override;
+
+    size_t size() const override;
+
+    bool empty() const override;
+
+    std::shared_ptr<const std::unordered_set<std::string>> GetBuiltinNames() const override;
+
+    // Only values NativeValue::FromValue accepts are persisted.
+    bool SerializeValue(const std::string &key, std::string &data) const override;
+
+    bool DeserializeValue(const std::string &key, const std::string &data) override;
+
+    bool GetValueSize(const std::string &key, size_t &size) const override;
+
+  private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Value> values_;
+};
+} // namespace native
+} // namespace xequation
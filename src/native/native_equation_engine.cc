@@ -0,0 +1,263 @@
+#include "native_equation_engine.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "native_equation_context.h"
+#include "native_parser.h"
+
+namespace xequation
+{
+namespace native
+{
+// Registers a call in running_calls_ while it runs.
+class NativeEquationEngine::CallScope
+{
+  public:
+    CallScope(NativeEquationEngine &engine, const EquationContext *context) : engine_(engine)
+    {
+        call_.context = context;
+        std::lock_guard<std::mutex> lock(engine_.call_mutex_);
+        engine_.running_calls_.push_back(&call_);
+    }
+
+    ~CallScope()
+    {
+        std::lock_guard<std::mutex> lock(engine_.call_mutex_);
+        auto &calls = engine_.running_calls_;
+        calls.erase(std::remove(calls.begin(), calls.end(), &call_), calls.end());
+    }
+
+    CallScope(const CallScope &) = delete;
+    CallScope &operator=(const CallScope &) = delete;
+
+    const std::atomic<uint64_t> &interrupt_epoch() const
+    {
+        return call_.interrupt_epoch;
+    }
+
+  private:
+    NativeEquationEngine &engine_;
+    RunningCall call_;
+};
+
+InterpretResult NativeEquationEngine::Interpret(const std::string &code, const EquationContext *context, InterpretMode mode)
+{
+    InterpretResult result;
+    result.mode = mode;
+
+    std::shared_ptr<const NativeProgram> program;
+    try
+    {
+        program = GetProgram(code, mode);
+    }
+    catch (const NativeCompileError &e)
+    {
+        result.status = e.status();
+        result.message = e.error_message();
+        return result;
+    }
+    catch (const ParseException &e)
+    {
+        result.status = ResultStatus::kSyntaxError;
+        result.message = e.error_message();
+        return result;
+    }
+
+    // assignments write into the context, like the Python engine does
+    CallScope scope(*this, context);
+    if (!context)
+    {
+        NativeEquationContext scratch;
+        return program->Run(scratch, scope.interrupt_epoch());
+    }
+    return program->Run(*const_cast<EquationContext *>(context), scope.interrupt_epoch());
+}
+
+ParseResult NativeEquationEngine::Parse(const std::string &code, ParseMode mode)
+{
+    ParseResult result;
+    result.mode = mode;
+    if (mode == ParseMode::kExpression)
+    {
+        ParseResultItem item;
+        item.name = "__expression__";
+        item.content = code;
+        item.type = ItemType::kExpression;
+        item.status = ResultStatus::kSuccess;
+        try
+        {
+            item.dependencies = NativeParser::CollectDependencies(*NativeParser::ParseExpression(code));
+        }
+        catch (const ParseException &e)
+        {
+            item.type = ItemType::kError;
+            item.status = ResultStatus::kSyntaxError;
+            item.message = e.error_message();
+        }
+        result.items.push_back(item);
+        return result;
+    }
+
+    for (const auto &statement : NativeParser::ParseStatements(code))
+    {
+        if (statement.target.empty())
+        {
+            throw ParseException(
+                "Unsupported statement '" + statement.content +
+                "': only assignments of the form 'name = expression' are supported"
+            );
+        }
+        ParseResultItem item;
+        item.name = statement.target;
+        item.content = statement.content;
+        item.type = ItemType::kVariable;
+        item.dependencies = NativeParser::CollectDependencies(*statement.expression);
+        item.status = ResultStatus::kSuccess;
+        result.items.push_back(item);
+    }
+    return result;
+}
+
+void NativeEquationEngine::Interrupt()
+{
+    std::lock_guard<std::mutex> lock(call_mutex_);
+    for (RunningCall *call : running_calls_)
+    {
+        call->interrupt_epoch++;
+    }
+}
+
+void NativeEquationEngine::Interrupt(const EquationContext *context)
+{
+    std::lock_guard<std::mutex> lock(call_mutex_);
+    for (RunningCall *call : running_calls_)
+    {
+        if (call->context == context)
+        {
+            call->interrupt_epoch++;
+        }
+    }
+}
+
+std::unique_ptr<EquationContext> NativeEquationEngine::CreateContext()
+{
+    return std::unique_ptr<EquationContext>(new NativeEquationContext());
+}
+
+std::unique_ptr<EquationManager> NativeEquationEngine::CreateEquationManager()
+{
+    std::unique_ptr<EquationManager> manager = EquationEngine<NativeEquationEngine>::CreateEquationManager();
+    manager->SetBatchInterpretHandler(
+        [this](const std::vector<std::string> &codes, EquationContext *context, std::vector<InterpretResult> &results) {
+            return InterpretBatch(codes, context, results);
+        }
+    );
+    return manager;
+}
+
+std::vector<bool> NativeEquationEngine::InterpretBatch(
+    const std::vector<std::string> &codes, EquationContext *context, std::vector<InterpretResult> &results
+)
+{
+    std::vector<bool> interpreted(codes.size(), false);
+    results.resize(codes.size());
+    if (!context)
+    {
+        return interpreted;
+    }
+
+    // programs by shape, in the order of the codes
+    std::vector<std::shared_ptr<const NativeProgram>> programs(codes.size());
+    std::unordered_map<std::string, std::vector<size_t>> groups;
+    std::vector<const std::string *> shapes;
+    for (size_t i = 0; i < codes.size(); i++)
+    {
+        try
+        {
+            programs[i] = GetProgram(codes[i], InterpretMode::kExec);
+        }
+        catch (const ParseException &)
+        {
+            // Interpret() reports the error
+            continue;
+        }
+        const std::string &shape = programs[i]->batch_shape();
+        if (shape.empty())
+        {
+            continue;
+        }
+        std::vector<size_t> &group = groups[shape];
+        if (group.empty())
+        {
+            shapes.push_back(&shape);
+        }
+        group.push_back(i);
+    }
+
+    NativeProgram::NameLoader load = [context](const std::string &name, NativeValue &value) -> ResultStatus {
+        if (!context->Contains(name))
+        {
+            return ResultStatus::kNameError;
+        }
+        return NativeValue::FromValue(context->Get(name), value) ? ResultStatus::kSuccess : ResultStatus::kTypeError;
+    };
+    NativeProgram::NameStorer store = [context](const std::string &name, const NativeValue &value) {
+        context->Set(name, value.ToValue());
+    };
+
+    CallScope scope(*this, context);
+    for (const std::string *shape : shapes)
+    {
+        const std::vector<size_t> &group = groups[*shape];
+        if (group.size() < min_batch_size_)
+        {
+            continue;
+        }
+        std::vector<const NativeProgram *> batch;
+        for (size_t index : group)
+        {
+            batch.push_back(programs[index].get());
+        }
+        std::vector<InterpretResult> batch_results;
+        std::vector<bool> ran = NativeProgram::RunBatch(batch, load, store, scope.interrupt_epoch(), batch_results);
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            if (ran[i])
+            {
+                results[group[i]] = batch_results[i];
+                interpreted[group[i]] = true;
+                batched_statement_count_++;
+            }
+        }
+    }
+    return interpreted;
+}
+
+size_t NativeEquationEngine::GetCompiledProgramCacheSize() const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return program_cache_.size();
+}
+
+std::shared_ptr<const NativeProgram> NativeEquationEngine::GetProgram(const std::string &code, InterpretMode mode)
+{
+    // the same text compiles differently as statement and as expression
+    std::string key = (mode == InterpretMode::kEval ? "e:" : "x:") + code;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto cached = program_cache_.get(key);
+        if (cached)
+        {
+            return *cached;
+        }
+    }
+
+    // compiled outside the lock, a program compiled twice at once is harmless
+    std::shared_ptr<const NativeProgram> program = NativeProgram::Compile(code, mode);
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    program_cache_.insert(key, program);
+    return program;
+}
+} // namespace native
+} // namespace xequation
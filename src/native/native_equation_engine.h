@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/compute/detail/lru_cache.hpp>
+
+#include "core/equation_common.h"
+#include "core/equation_engine.h"
+#include "native_program.h"
+
+namespace xequation
+{
+namespace native
+{
+// Engine for purely numeric sheets without an interpreter: the code is a
+// numeric subset of Python (see NativeNode) compiled once to NativeProgram
+// bytecode. No global lock is held, managers created here interpret
+// independent equations in parallel with SetInterpretConcurrency().
+class NativeEquationEngine : public EquationEngine<NativeEquationEngine>
+{
+  public:
+    InterpretResult Interpret(const std::string &code, const EquationContext *context = nullptr, InterpretMode mode = InterpretMode::kExec) override;
+    ParseResult Parse(const std::string &code, ParseMode mode = ParseMode::kExpression) override;
+    void Interrupt() override;
+    void Interrupt(const EquationContext *context) override;
+
+    std::unique_ptr<EquationContext> CreateContext() override;
+    std::string GetLanguage() const override { return "Native"; }
+
+    // Also installs InterpretBatch() as the batch interpret handler.
+    std::unique_ptr<EquationManager> CreateEquationManager() override;
+
+    // Runs the statements of each group of at least min_batch_size_ with the
+    // same NativeProgram::batch_shape() as one batch, returns which of the
+    // codes were interpreted. What NativeProgram::RunBatch() does not run is
+    // left to Interpret(), as are the codes without a shape.
+    std::vector<bool> InterpretBatch(
+        const std::vector<std::string> &codes, EquationContext *context, std::vector<InterpretResult> &results
+    );
+
+    size_t GetCompiledProgramCacheSize() const;
+
+    // statements InterpretBatch() computed in batches so far
+    size_t batched_statement_count() const
+    {
+        return batched_statement_count_;
+    }
+
+  private:
+    friend class EquationEngine<NativeEquationEngine>;
+
+    NativeEquationEngine() = default;
+    ~NativeEquationEngine() override = default;
+
+    // compiled programs are shared by the calls running them
+    std::shared_ptr<const NativeProgram> GetProgram(const std::string &code, InterpretMode mode);
+
+    // an Interpret / InterpretBatch call for the time it runs, interrupted
+    // through its own epoch so Interrupt(context) reaches only its calls
+    struct RunningCall
+    {
+        const EquationContext *context = nullptr;
+        std::atomic<uint64_t> interrupt_epoch{0};
+    };
+    class CallScope;
+
+  private:
+    static constexpr size_t max_cache_size_ = 1024;
+    static constexpr size_t min_batch_size_ = 4;
+    mutable std::mutex cache_mutex_;
+    boost::compute::detail::lru_cache<std::string, std::shared_ptr<const NativeProgram>> program_cache_{max_cache_size_};
+    std::mutex call_mutex_;
+    std::vector<RunningCall *> running_calls_;
+    std::atomic<size_t> batched_statement_count_{0};
+};
+} // namespace native
+} // namespace xequation
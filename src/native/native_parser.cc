@@ -0,0 +1,593 @@
+#include "native_parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <unordered_set>
+
+namespace xequation
+{
+namespace native
+{
+namespace
+{
+struct Token
+{
+    enum class Type
+    {
+        kInt,
+        kFloat,
+        kName,
+        kKeyword,
+        kOp,
+        kSeparator,
+        kEnd,
+    };
+
+    Type type;
+    std::string text;
+    size_t begin;
+    size_t end;
+};
+
+bool IsNameStart(char c)
+{
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool IsNameChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool IsDigit(char c)
+{
+    return std::isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+class Lexer
+{
+  public:
+    // leading whitespace is only allowed in expressions
+    Lexer(const std::string &code, bool statements) : code_(code), statements_(statements) {}
+
+    std::vector<Token> Tokenize()
+    {
+        std::vector<Token> tokens;
+        int depth = 0;
+        size_t pos = 0;
+        bool line_start = statements_;
+        while (pos < code_.size())
+        {
+            char c = code_[pos];
+            if (line_start && depth == 0)
+            {
+                // statements can not be indented, like in Python
+                line_start = false;
+                size_t first = code_.find_first_not_of(" \t", pos);
+                if (first != pos && first != std::string::npos && code_[first] != '\n' && code_[first] != '\r' &&
+                    code_[first] != '#')
+                {
+                    throw ParseException(ErrorMessage("unexpected indent", pos));
+                }
+            }
+            if (c == ' ' || c == '\t' || c == '\r')
+            {
+                pos++;
+            }
+            else if (c == '#')
+            {
+                while (pos < code_.size() && code_[pos] != '\n')
+                {
+                    pos++;
+                }
+            }
+            else if (c == '\\' && pos + 1 < code_.size() && code_[pos + 1] == '\n')
+            {
+                pos += 2;
+            }
+            else if (c == '\n' || c == ';')
+            {
+                // newlines inside brackets continue the statement
+                if (c == ';' || depth == 0)
+                {
+                    tokens.push_back(Token{Token::Type::kSeparator, std::string(1, c), pos, pos + 1});
+                }
+                line_start = statements_ && c == '\n' && depth == 0;
+                pos++;
+            }
+            else if (IsDigit(c) || (c == '.' && pos + 1 < code_.size() && IsDigit(code_[pos + 1])))
+            {
+                tokens.push_back(ReadNumber(pos));
+                pos = tokens.back().end;
+            }
+            else if (IsNameStart(c))
+            {
+                size_t end = pos;
+                while (end < code_.size() && IsNameChar(code_[end]))
+                {
+                    end++;
+                }
+                std::string text = code_.substr(pos, end - pos);
+                bool keyword = text == "and" || text == "or" || text == "not" || text == "True" || text == "False";
+                tokens.push_back(Token{keyword ? Token::Type::kKeyword : Token::Type::kName, text, pos, end});
+                pos = end;
+            }
+            else
+            {
+                tokens.push_back(ReadOperator(pos));
+                const std::string &op = tokens.back().text;
+                if (op == "(" || op == "[")
+                {
+                    depth++;
+                }
+                else if ((op == ")" || op == "]") && depth > 0)
+                {
+                    depth--;
+                }
+                pos = tokens.back().end;
+            }
+        }
+        tokens.push_back(Token{Token::Type::kEnd, std::string(), code_.size(), code_.size()});
+        return tokens;
+    }
+
+  private:
+    Token ReadNumber(size_t pos)
+    {
+        size_t end = pos;
+        bool is_float = false;
+        while (end < code_.size() && IsDigit(code_[end]))
+        {
+            end++;
+        }
+        if (end < code_.size() && code_[end] == '.')
+        {
+            is_float = true;
+            end++;
+            while (end < code_.size() && IsDigit(code_[end]))
+            {
+                end++;
+            }
+        }
+        if (end < code_.size() && (code_[end] == 'e' || code_[end] == 'E'))
+        {
+            size_t exponent = end + 1;
+            if (exponent < code_.size() && (code_[exponent] == '+' || code_[exponent] == '-'))
+            {
+                exponent++;
+            }
+            if (exponent < code_.size() && IsDigit(code_[exponent]))
+            {
+                is_float = true;
+                end = exponent;
+                while (end < code_.size() && IsDigit(code_[end]))
+                {
+                    end++;
+                }
+            }
+        }
+        if (end < code_.size() && IsNameChar(code_[end]))
+        {
+            throw ParseException(ErrorMessage("invalid decimal literal", pos));
+        }
+        if (!is_float && code_[pos] == '0' && code_.find_first_not_of('0', pos) < end)
+        {
+            throw ParseException(ErrorMessage("leading zeros in decimal integer literals are not permitted", pos));
+        }
+        return Token{is_float ? Token::Type::kFloat : Token::Type::kInt, code_.substr(pos, end - pos), pos, end};
+    }
+
+    Token ReadOperator(size_t pos)
+    {
+        static const char *const kOperators[] = {"**", "//", "==", "!=", "<=", ">=", "+", "-", "*", "/", "%",
+                                                 "<",  ">",  "=",  "(",  ")",  "[",  "]", ",", nullptr};
+        for (const char *const *op = kOperators; *op; ++op)
+        {
+            if (code_.compare(pos, std::char_traits<char>::length(*op), *op) == 0)
+            {
+                return Token{Token::Type::kOp, *op, pos, pos + std::char_traits<char>::length(*op)};
+            }
+        }
+        throw ParseException(ErrorMessage("invalid character '" + std::string(1, code_[pos]) + "'", pos));
+    }
+
+    std::string ErrorMessage(const std::string &message, size_t pos) const
+    {
+        return message + " (column " + std::to_string(pos + 1) + ")";
+    }
+
+    const std::string &code_;
+    bool statements_;
+};
+
+class Parser
+{
+  public:
+    Parser(const std::string &code, bool statements) : code_(code), tokens_(Lexer(code, statements).Tokenize()) {}
+
+    std::vector<NativeStatement> ParseStatements()
+    {
+        std::vector<NativeStatement> statements;
+        while (!Check(Token::Type::kEnd))
+        {
+            if (Check(Token::Type::kSeparator))
+            {
+                Advance();
+                continue;
+            }
+
+            NativeStatement statement;
+            if (Check(Token::Type::kName) && Peek(1).type == Token::Type::kOp && Peek(1).text == "=")
+            {
+                statement.target = Advance().text;
+                Advance();
+            }
+            size_t begin = Current().begin;
+            statement.expression = ParseExpression();
+            statement.content = code_.substr(begin, previous_end_ - begin);
+            if (!Check(Token::Type::kSeparator) && !Check(Token::Type::kEnd))
+            {
+                if (CheckOp("="))
+                {
+                    throw Error("Assignment statement can only have one target variable");
+                }
+                throw Error("invalid syntax");
+            }
+            statements.push_back(std::move(statement));
+        }
+        return statements;
+    }
+
+    std::unique_ptr<NativeNode> ParseSingleExpression()
+    {
+        while (Check(Token::Type::kSeparator))
+        {
+            Advance();
+        }
+        std::unique_ptr<NativeNode> node = ParseExpression();
+        while (Check(Token::Type::kSeparator))
+        {
+            Advance();
+        }
+        if (!Check(Token::Type::kEnd))
+        {
+            throw Error("invalid syntax");
+        }
+        return node;
+    }
+
+  private:
+    using NodePtr = std::unique_ptr<NativeNode>;
+
+    NodePtr ParseExpression()
+    {
+        return ParseOr();
+    }
+
+    NodePtr ParseOr()
+    {
+        NodePtr node = ParseAnd();
+        while (CheckKeyword("or"))
+        {
+            Advance();
+            node = MakeNode(NativeNode::Kind::kOr, std::move(node), ParseAnd());
+        }
+        return node;
+    }
+
+    NodePtr ParseAnd()
+    {
+        NodePtr node = ParseNot();
+        while (CheckKeyword("and"))
+        {
+            Advance();
+            node = MakeNode(NativeNode::Kind::kAnd, std::move(node), ParseNot());
+        }
+        return node;
+    }
+
+    NodePtr ParseNot()
+    {
+        if (CheckKeyword("not"))
+        {
+            Advance();
+            NodePtr node(new NativeNode(NativeNode::Kind::kUnary));
+            node->ops.push_back("not");
+            node->children.push_back(ParseNot());
+            return node;
+        }
+        return ParseComparison();
+    }
+
+    NodePtr ParseComparison()
+    {
+        NodePtr first = ParseArith();
+        if (!IsComparisonOp())
+        {
+            return first;
+        }
+        NodePtr node(new NativeNode(NativeNode::Kind::kCompare));
+        node->children.push_back(std::move(first));
+        while (IsComparisonOp())
+        {
+            node->ops.push_back(Advance().text);
+            node->children.push_back(ParseArith());
+        }
+        return node;
+    }
+
+    NodePtr ParseArith()
+    {
+        NodePtr node = ParseTerm();
+        while (CheckOp("+") || CheckOp("-"))
+        {
+            std::string op = Advance().text;
+            node = MakeBinary(op, std::move(node), ParseTerm());
+        }
+        return node;
+    }
+
+    NodePtr ParseTerm()
+    {
+        NodePtr node = ParseFactor();
+        while (CheckOp("*") || CheckOp("/") || CheckOp("//") || CheckOp("%"))
+        {
+            std::string op = Advance().text;
+            node = MakeBinary(op, std::move(node), ParseFactor());
+        }
+        return node;
+    }
+
+    NodePtr ParseFactor()
+    {
+        if (CheckOp("+") || CheckOp("-"))
+        {
+            NodePtr node(new NativeNode(NativeNode::Kind::kUnary));
+            node->ops.push_back(Advance().text);
+            node->children.push_back(ParseFactor());
+            return node;
+        }
+        return ParsePower();
+    }
+
+    NodePtr ParsePower()
+    {
+        NodePtr node = ParsePostfix();
+        if (CheckOp("**"))
+        {
+            Advance();
+            // right associative and binds tighter than a unary minus on its left
+            node = MakeBinary("**", std::move(node), ParseFactor());
+        }
+        return node;
+    }
+
+    NodePtr ParsePostfix()
+    {
+        NodePtr node = ParseAtom();
+        while (true)
+        {
+            if (CheckOp("("))
+            {
+                if (node->kind != NativeNode::Kind::kName)
+                {
+                    throw Error("only builtin functions can be called");
+                }
+                Advance();
+                node->kind = NativeNode::Kind::kCall;
+                ParseSequence(")", node->children);
+            }
+            else if (CheckOp("["))
+            {
+                Advance();
+                NodePtr index = MakeNode(NativeNode::Kind::kIndex, std::move(node), ParseExpression());
+                Expect("]");
+                node = std::move(index);
+            }
+            else
+            {
+                return node;
+            }
+        }
+    }
+
+    NodePtr ParseAtom()
+    {
+        const Token &token = Current();
+        switch (token.type)
+        {
+        case Token::Type::kInt: {
+            NodePtr node(new NativeNode(NativeNode::Kind::kInt));
+            errno = 0;
+            long long value = std::strtoll(token.text.c_str(), nullptr, 10);
+            if (errno == ERANGE)
+            {
+                throw Error("integer literal is too large");
+            }
+            node->int_value = static_cast<int64_t>(value);
+            Advance();
+            return node;
+        }
+        case Token::Type::kFloat: {
+            NodePtr node(new NativeNode(NativeNode::Kind::kFloat));
+            node->float_value = std::strtod(token.text.c_str(), nullptr);
+            Advance();
+            return node;
+        }
+        case Token::Type::kName: {
+            NodePtr node(new NativeNode(NativeNode::Kind::kName));
+            node->name = Advance().text;
+            return node;
+        }
+        case Token::Type::kKeyword:
+            if (token.text == "True" || token.text == "False")
+            {
+                NodePtr node(new NativeNode(NativeNode::Kind::kBool));
+                node->int_value = token.text == "True" ? 1 : 0;
+                Advance();
+                return node;
+            }
+            break;
+        case Token::Type::kOp:
+            if (token.text == "(")
+            {
+                Advance();
+                NodePtr node = ParseExpression();
+                Expect(")");
+                return node;
+            }
+            if (token.text == "[")
+            {
+                Advance();
+                NodePtr node(new NativeNode(NativeNode::Kind::kList));
+                ParseSequence("]", node->children);
+                return node;
+            }
+            break;
+        default:
+            break;
+        }
+        throw Error(token.type == Token::Type::kEnd || token.type == Token::Type::kSeparator
+                        ? "unexpected end of expression"
+                        : "invalid syntax");
+    }
+
+    // comma separated expressions up to close, a trailing comma is allowed
+    void ParseSequence(const std::string &close, std::vector<NodePtr> &items)
+    {
+        while (!CheckOp(close))
+        {
+            items.push_back(ParseExpression());
+            if (!CheckOp(","))
+            {
+                break;
+            }
+            Advance();
+        }
+        Expect(close);
+    }
+
+    NodePtr MakeNode(NativeNode::Kind kind, NodePtr left, NodePtr right)
+    {
+        NodePtr node(new NativeNode(kind));
+        node->children.push_back(std::move(left));
+        node->children.push_back(std::move(right));
+        return node;
+    }
+
+    NodePtr MakeBinary(const std::string &op, NodePtr left, NodePtr right)
+    {
+        NodePtr node = MakeNode(NativeNode::Kind::kBinary, std::move(left), std::move(right));
+        node->ops.push_back(op);
+        return node;
+    }
+
+    bool IsComparisonOp() const
+    {
+        return CheckOp("<") || CheckOp("<=") || CheckOp(">") || CheckOp(">=") || CheckOp("==") || CheckOp("!=");
+    }
+
+    const Token &Current() const
+    {
+        return tokens_[pos_];
+    }
+
+    const Token &Peek(size_t offset) const
+    {
+        return tokens_[std::min(pos_ + offset, tokens_.size() - 1)];
+    }
+
+    bool Check(Token::Type type) const
+    {
+        return Current().type == type;
+    }
+
+    bool CheckOp(const std::string &op) const
+    {
+        return Current().type == Token::Type::kOp && Current().text == op;
+    }
+
+    bool CheckKeyword(const std::string &keyword) const
+    {
+        return Current().type == Token::Type::kKeyword && Current().text == keyword;
+    }
+
+    const Token &Advance()
+    {
+        const Token &token = tokens_[pos_];
+        previous_end_ = token.end;
+        if (pos_ + 1 < tokens_.size())
+        {
+            pos_++;
+        }
+        return token;
+    }
+
+    void Expect(const std::string &op)
+    {
+        if (!CheckOp(op))
+        {
+            throw Error("expected '" + op + "'");
+        }
+        Advance();
+    }
+
+    ParseException Error(const std::string &message) const
+    {
+        size_t line = 1;
+        size_t column = 1;
+        for (size_t i = 0; i < Current().begin && i < code_.size(); i++)
+        {
+            if (code_[i] == '\n')
+            {
+                line++;
+                column = 1;
+            }
+            else
+            {
+                column++;
+            }
+        }
+        return ParseException(message + " (line " + std::to_string(line) + ", column " + std::to_string(column) + ")");
+    }
+
+    const std::string &code_;
+    std::vector<Token> tokens_;
+    size_t pos_ = 0;
+    size_t previous_end_ = 0;
+};
+
+void CollectNames(const NativeNode &node, std::vector<std::string> &names, std::unordered_set<std::string> &seen)
+{
+    if (node.kind == NativeNode::Kind::kName && seen.insert(node.name).second)
+    {
+        names.push_back(node.name);
+    }
+    for (const auto &child : node.children)
+    {
+        CollectNames(*child, names, seen);
+    }
+}
+} // namespace
+
+std::vector<NativeStatement> NativeParser::ParseStatements(const std::string &code)
+{
+    return Parser(code, true).ParseStatements();
+}
+
+std::unique_ptr<NativeNode> NativeParser::ParseExpression(const std::string &code)
+{
+    return Parser(code, false).ParseSingleExpression();
+}
+
+std::vector<std::string> NativeParser::CollectDependencies(const NativeNode &node)
+{
+    std::vector<std::string> names;
+    std::unordered_set<std::string> seen;
+    CollectNames(node, names, seen);
+    return names;
+}
+} // namespace native
+} // namespace xequation
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/equation_common.h"
+
+namespace xequation
+{
+namespace native
+{
+// Syntax tree of the native expression language, a numeric subset of Python:
+// int / float / bool literals, list literals of numbers, names, arithmetic
+// (+ - * / // % **), comparisons, and / or / not, indexing and calls of
+// builtin functions.
+struct NativeNode
+{
+    enum class Kind
+    {
+        kInt,
+        kFloat,
+        kBool,
+        kName,
+        kList,
+        kUnary,
+        kBinary,
+        kCompare,
+        kAnd,
+        kOr,
+        kCall,
+        kIndex,
+    };
+
+    explicit NativeNode(Kind kind) : kind(kind) {}
+
+    Kind kind;
+    // literal value of kInt / kFloat / kBool
+    int64_t int_value = 0;
+    double float_value = 0.0;
+    // variable of kName, function of kCall
+    std::string name;
+    // operator of kUnary / kBinary, one per adjacent operand pair of kCompare
+    std::vector<std::string> ops;
+    std::vector<std::unique_ptr<NativeNode>> children;
+};
+
+struct NativeStatement
+{
+    // empty for a bare expression
+    std::string target;
+    // source text of the expression
+    std::string content;
+    std::unique_ptr<NativeNode> expression;
+};
+
+// Parses native code, syntax errors throw ParseException.
+class NativeParser
+{
+  public:
+    // Statements are separated by newlines or ';', each is either
+    // "name = expression" or a bare expression.
+    static std::vector<NativeStatement> ParseStatements(const std::string &code);
+
+    static std::unique_ptr<NativeNode> ParseExpression(const std::string &code);
+
+    // Names read by the expression in order of first use, without duplicates.
+    // Called functions are builtins and not reported.
+    static std::vector<std::string> CollectDependencies(const NativeNode &node);
+};
+} // namespace native
+} // namespace xequation
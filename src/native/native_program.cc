@@ -0,0 +1,1635 @@
+#include "native_program.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace xequation
+{
+namespace native
+{
+namespace
+{
+class RuntimeError : public std::runtime_error
+{
+  public:
+    RuntimeError(ResultStatus status, const std::string &message) : std::runtime_error(message), status_(status) {}
+
+    ResultStatus status() const
+    {
+        return status_;
+    }
+
+  private:
+    ResultStatus status_;
+};
+
+using Kind = NativeValue::Kind;
+
+const char *KindName(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::kBool:
+        return "bool";
+    case Kind::kInt:
+        return "int";
+    case Kind::kFloat:
+        return "float";
+    default:
+        return "vector";
+    }
+}
+
+bool IsInteger(const NativeValue &value)
+{
+    return value.kind == Kind::kBool || value.kind == Kind::kInt;
+}
+
+// ints within 2^53 convert to double exactly
+const int64_t kMaxExactInt = int64_t(1) << 53;
+
+// Conversion as Python's float(), rounding ints to the nearest double. Only
+// for the places where Python rounds too, like math functions.
+double RoundToDouble(const NativeValue &value)
+{
+    return IsInteger(value) ? static_cast<double>(value.int_value) : value.float_value;
+}
+
+// Conversion of an operand of arithmetic, comparisons and vectors. Python
+// computes with larger ints exactly, e.g. compares 2**53 + 1 unequal to
+// float(2**53), so they are an error here rather than a rounded result.
+double ToDouble(const NativeValue &value)
+{
+    if (IsInteger(value) && (value.int_value > kMaxExactInt || value.int_value < -kMaxExactInt))
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "int too large to convert to float exactly");
+    }
+    return RoundToDouble(value);
+}
+
+bool IsTrue(const NativeValue &value)
+{
+    switch (value.kind)
+    {
+    case Kind::kFloat:
+        return value.float_value != 0.0;
+    case Kind::kVector:
+        return !value.vector_value.empty();
+    default:
+        return value.int_value != 0;
+    }
+}
+
+int64_t CheckedAdd(int64_t a, int64_t b)
+{
+    if ((b > 0 && a > std::numeric_limits<int64_t>::max() - b) ||
+        (b < 0 && a < std::numeric_limits<int64_t>::min() - b))
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "integer overflow");
+    }
+    return a + b;
+}
+
+int64_t CheckedSub(int64_t a, int64_t b)
+{
+    if ((b < 0 && a > std::numeric_limits<int64_t>::max() + b) ||
+        (b > 0 && a < std::numeric_limits<int64_t>::min() + b))
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "integer overflow");
+    }
+    return a - b;
+}
+
+int64_t CheckedMul(int64_t a, int64_t b)
+{
+    if (a == 0 || b == 0)
+    {
+        return 0;
+    }
+    int64_t result = static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+    if ((a == -1 && b == std::numeric_limits<int64_t>::min()) ||
+        (b == -1 && a == std::numeric_limits<int64_t>::min()) || result / b != a)
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "integer overflow");
+    }
+    return result;
+}
+
+int64_t IntFloorDiv(int64_t a, int64_t b)
+{
+    if (b == 0)
+    {
+        throw RuntimeError(ResultStatus::kZeroDivisionError, "integer division or modulo by zero");
+    }
+    if (a == std::numeric_limits<int64_t>::min() && b == -1)
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "integer overflow");
+    }
+    int64_t quotient = a / b;
+    // rounds towards negative infinity like Python
+    if (a % b != 0 && ((a < 0) != (b < 0)))
+    {
+        quotient--;
+    }
+    return quotient;
+}
+
+int64_t IntMod(int64_t a, int64_t b)
+{
+    if (b == 0)
+    {
+        throw RuntimeError(ResultStatus::kZeroDivisionError, "integer division or modulo by zero");
+    }
+    if (b == -1)
+    {
+        return 0;
+    }
+    int64_t remainder = a % b;
+    if (remainder != 0 && ((remainder < 0) != (b < 0)))
+    {
+        remainder += b;
+    }
+    return remainder;
+}
+
+int64_t IntPow(int64_t base, int64_t exponent)
+{
+    int64_t result = 1;
+    while (exponent > 0)
+    {
+        if (exponent & 1)
+        {
+            result = CheckedMul(result, base);
+        }
+        exponent >>= 1;
+        if (exponent > 0)
+        {
+            base = CheckedMul(base, base);
+        }
+    }
+    return result;
+}
+
+double FloatPow(double base, double exponent)
+{
+    if (base == 0.0 && exponent < 0.0)
+    {
+        throw RuntimeError(ResultStatus::kZeroDivisionError, "0.0 cannot be raised to a negative power");
+    }
+    if (base < 0.0 && std::isfinite(exponent) && exponent != std::floor(exponent))
+    {
+        throw RuntimeError(ResultStatus::kValueError, "math domain error");
+    }
+    double result = std::pow(base, exponent);
+    if (std::isinf(result) && std::isfinite(base) && std::isfinite(exponent))
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "Numerical result out of range");
+    }
+    return result;
+}
+
+double FloatMod(double a, double b)
+{
+    if (b == 0.0)
+    {
+        throw RuntimeError(ResultStatus::kZeroDivisionError, "float modulo");
+    }
+    double remainder = std::fmod(a, b);
+    if (remainder == 0.0)
+    {
+        return std::copysign(0.0, b);
+    }
+    if ((remainder < 0.0) != (b < 0.0))
+    {
+        remainder += b;
+    }
+    return remainder;
+}
+
+template <typename Op>
+NativeValue ElementWise(const char *op_name, const NativeValue &a, const NativeValue &b, Op op)
+{
+    if (a.kind == Kind::kVector && b.kind == Kind::kVector)
+    {
+        if (a.vector_value.size() != b.vector_value.size())
+        {
+            throw RuntimeError(
+                ResultStatus::kValueError, std::string("operands of ") + op_name +
+                                               " could not be broadcast together with lengths " +
+                                               std::to_string(a.vector_value.size()) + " and " +
+                                               std::to_string(b.vector_value.size())
+            );
+        }
+        std::vector<double> result(a.vector_value.size());
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            result[i] = op(a.vector_value[i], b.vector_value[i]);
+        }
+        return NativeValue::Vector(std::move(result));
+    }
+    if (a.kind == Kind::kVector)
+    {
+        double scalar = ToDouble(b);
+        std::vector<double> result(a.vector_value.size());
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            result[i] = op(a.vector_value[i], scalar);
+        }
+        return NativeValue::Vector(std::move(result));
+    }
+    if (b.kind == Kind::kVector)
+    {
+        double scalar = ToDouble(a);
+        std::vector<double> result(b.vector_value.size());
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            result[i] = op(scalar, b.vector_value[i]);
+        }
+        return NativeValue::Vector(std::move(result));
+    }
+    return NativeValue::Float(op(ToDouble(a), ToDouble(b)));
+}
+
+template <typename Op>
+NativeValue Map(const NativeValue &value, Op op)
+{
+    if (value.kind != Kind::kVector)
+    {
+        return NativeValue::Float(op(RoundToDouble(value)));
+    }
+    std::vector<double> result(value.vector_value.size());
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        result[i] = op(value.vector_value[i]);
+    }
+    return NativeValue::Vector(std::move(result));
+}
+
+double Divide(double a, double b)
+{
+    if (b == 0.0)
+    {
+        throw RuntimeError(ResultStatus::kZeroDivisionError, "division by zero");
+    }
+    return a / b;
+}
+
+// same steps as CPython, std::floor(a / b) differs for e.g. 1 // 0.1
+double FloorDivide(double a, double b)
+{
+    if (b == 0.0)
+    {
+        throw RuntimeError(ResultStatus::kZeroDivisionError, "float floor division by zero");
+    }
+    double mod = std::fmod(a, b);
+    double div = (a - mod) / b;
+    if (mod != 0.0 && ((b < 0.0) != (mod < 0.0)))
+    {
+        div -= 1.0;
+    }
+    if (div == 0.0)
+    {
+        return std::copysign(0.0, a / b);
+    }
+    double floor_div = std::floor(div);
+    if (div - floor_div > 0.5)
+    {
+        floor_div += 1.0;
+    }
+    return floor_div;
+}
+
+int64_t ToInt64(double value)
+{
+    if (std::isnan(value))
+    {
+        throw RuntimeError(ResultStatus::kValueError, "cannot convert float NaN to integer");
+    }
+    // 2^63 is the first double above the int64_t range
+    if (value >= 9223372036854775808.0 || value < -9223372036854775808.0)
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "cannot convert float to integer, out of range");
+    }
+    return static_cast<int64_t>(value);
+}
+
+bool NumericLess(const NativeValue &a, const NativeValue &b)
+{
+    if (IsInteger(a) && IsInteger(b))
+    {
+        return a.int_value < b.int_value;
+    }
+    return ToDouble(a) < ToDouble(b);
+}
+
+bool NumericEqual(const NativeValue &a, const NativeValue &b)
+{
+    if (a.kind == Kind::kVector || b.kind == Kind::kVector)
+    {
+        return a.kind == b.kind && a.vector_value == b.vector_value;
+    }
+    if (IsInteger(a) && IsInteger(b))
+    {
+        return a.int_value == b.int_value;
+    }
+    return ToDouble(a) == ToDouble(b);
+}
+
+void CheckOrderable(const char *op, const NativeValue &a, const NativeValue &b)
+{
+    if (a.kind == Kind::kVector || b.kind == Kind::kVector)
+    {
+        throw RuntimeError(
+            ResultStatus::kTypeError, std::string("'") + op + "' not supported between instances of '" +
+                                          KindName(a.kind) + "' and '" + KindName(b.kind) + "'"
+        );
+    }
+}
+
+void CheckScalar(const char *function, const NativeValue &value)
+{
+    if (value.kind == Kind::kVector)
+    {
+        throw RuntimeError(
+            ResultStatus::kTypeError, std::string(function) + "() argument must be a number, not 'vector'"
+        );
+    }
+}
+
+// math function of one argument applied element-wise, domain checked
+template <typename Op, typename Domain>
+NativeValue MathFunction(const NativeValue &value, Op op, Domain in_domain)
+{
+    return Map(value, [&](double x) -> double {
+        if (!in_domain(x))
+        {
+            throw RuntimeError(ResultStatus::kValueError, "math domain error");
+        }
+        double result = op(x);
+        if (std::isinf(result) && std::isfinite(x))
+        {
+            throw RuntimeError(ResultStatus::kOverflowError, "math range error");
+        }
+        return result;
+    });
+}
+
+bool AnyValue(double)
+{
+    return true;
+}
+
+using BuiltinFunction = NativeValue (*)(const NativeValue *args, size_t count);
+
+struct Builtin
+{
+    const char *name;
+    size_t min_args;
+    size_t max_args;
+    BuiltinFunction function;
+};
+
+NativeValue Abs(const NativeValue *args, size_t)
+{
+    if (IsInteger(args[0]))
+    {
+        if (args[0].int_value == std::numeric_limits<int64_t>::min())
+        {
+            throw RuntimeError(ResultStatus::kOverflowError, "integer overflow");
+        }
+        return NativeValue::Int(std::abs(args[0].int_value));
+    }
+    return Map(args[0], [](double x) { return std::fabs(x); });
+}
+
+NativeValue Sqrt(const NativeValue *args, size_t)
+{
+    return MathFunction(args[0], [](double x) { return std::sqrt(x); }, [](double x) { return x >= 0.0; });
+}
+
+NativeValue Exp(const NativeValue *args, size_t)
+{
+    return MathFunction(args[0], [](double x) { return std::exp(x); }, AnyValue);
+}
+
+NativeValue Log(const NativeValue *args, size_t count)
+{
+    NativeValue result =
+        MathFunction(args[0], [](double x) { return std::log(x); }, [](double x) { return x > 0.0; });
+    if (count == 1)
+    {
+        return result;
+    }
+    CheckScalar("log", args[1]);
+    double base = RoundToDouble(args[1]);
+    if (base <= 0.0 || base == 1.0)
+    {
+        throw RuntimeError(base == 1.0 ? ResultStatus::kZeroDivisionError : ResultStatus::kValueError,
+                           base == 1.0 ? "float division by zero" : "math domain error");
+    }
+    double log_base = std::log(base);
+    return Map(result, [log_base](double x) { return x / log_base; });
+}
+
+NativeValue Log10(const NativeValue *args, size_t)
+{
+    return MathFunction(args[0], [](double x) { return std::log10(x); }, [](double x) { return x > 0.0; });
+}
+
+NativeValue Sin(const NativeValue *args, size_t)
+{
+    return MathFunction(args[0], [](double x) { return std::sin(x); }, [](double x) { return !std::isinf(x); });
+}
+
+NativeValue Cos(const NativeValue *args, size_t)
+{
+    return MathFunction(args[0], [](double x) { return std::cos(x); }, [](double x) { return !std::isinf(x); });
+}
+
+NativeValue Tan(const NativeValue *args, size_t)
+{
+    return MathFunction(args[0], [](double x) { return std::tan(x); }, [](double x) { return !std::isinf(x); });
+}
+
+NativeValue Asin(const NativeValue *args, size_t)
+{
+    return MathFunction(
+        args[0], [](double x) { return std::asin(x); }, [](double x) { return x >= -1.0 && x <= 1.0; }
+    );
+}
+
+NativeValue Acos(const NativeValue *args, size_t)
+{
+    return MathFunction(
+        args[0], [](double x) { return std::acos(x); }, [](double x) { return x >= -1.0 && x <= 1.0; }
+    );
+}
+
+NativeValue Atan(const NativeValue *args, size_t)
+{
+    return MathFunction(args[0], [](double x) { return std::atan(x); }, AnyValue);
+}
+
+NativeValue Atan2(const NativeValue *args, size_t)
+{
+    return ElementWise("atan2", args[0], args[1], [](double y, double x) { return std::atan2(y, x); });
+}
+
+// floor / ceil / round of scalars are int like in Python, vectors stay float
+template <typename Op>
+NativeValue RoundToInt(const NativeValue &value, Op op)
+{
+    if (IsInteger(value))
+    {
+        return NativeValue::Int(value.int_value);
+    }
+    if (value.kind == Kind::kVector)
+    {
+        return Map(value, op);
+    }
+    if (std::isinf(value.float_value))
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "cannot convert float infinity to integer");
+    }
+    return NativeValue::Int(ToInt64(op(value.float_value)));
+}
+
+NativeValue Floor(const NativeValue *args, size_t)
+{
+    return RoundToInt(args[0], [](double x) { return std::floor(x); });
+}
+
+NativeValue Ceil(const NativeValue *args, size_t)
+{
+    return RoundToInt(args[0], [](double x) { return std::ceil(x); });
+}
+
+NativeValue Round(const NativeValue *args, size_t count)
+{
+    // std::nearbyint rounds half to even like Python in the default rounding mode
+    if (count == 1)
+    {
+        return RoundToInt(args[0], [](double x) { return std::nearbyint(x); });
+    }
+    CheckScalar("round", args[1]);
+    if (!IsInteger(args[1]))
+    {
+        throw RuntimeError(ResultStatus::kTypeError, "'float' object cannot be interpreted as an integer");
+    }
+    if (IsInteger(args[0]) && args[1].int_value >= 0)
+    {
+        return NativeValue::Int(args[0].int_value);
+    }
+    double scale = std::pow(10.0, static_cast<double>(args[1].int_value));
+    return Map(args[0], [scale](double x) { return std::nearbyint(x * scale) / scale; });
+}
+
+NativeValue Pow(const NativeValue *args, size_t);
+
+NativeValue MinMax(const char *function, const NativeValue *args, size_t count, bool max)
+{
+    if (count == 1)
+    {
+        if (args[0].kind != Kind::kVector)
+        {
+            throw RuntimeError(
+                ResultStatus::kTypeError, std::string("'") + KindName(args[0].kind) + "' object is not iterable"
+            );
+        }
+        const std::vector<double> &items = args[0].vector_value;
+        if (items.empty())
+        {
+            throw RuntimeError(ResultStatus::kValueError, std::string(function) + "() arg is an empty sequence");
+        }
+        return NativeValue::Float(max ? *std::max_element(items.begin(), items.end())
+                                      : *std::min_element(items.begin(), items.end()));
+    }
+    const NativeValue *best = &args[0];
+    for (size_t i = 0; i < count; i++)
+    {
+        CheckScalar(function, args[i]);
+        if (i > 0 && (max ? NumericLess(*best, args[i]) : NumericLess(args[i], *best)))
+        {
+            best = &args[i];
+        }
+    }
+    return *best;
+}
+
+NativeValue Min(const NativeValue *args, size_t count)
+{
+    return MinMax("min", args, count, false);
+}
+
+NativeValue Max(const NativeValue *args, size_t count)
+{
+    return MinMax("max", args, count, true);
+}
+
+NativeValue Sum(const NativeValue *args, size_t)
+{
+    if (args[0].kind != Kind::kVector)
+    {
+        throw RuntimeError(
+            ResultStatus::kTypeError, std::string("'") + KindName(args[0].kind) + "' object is not iterable"
+        );
+    }
+    double sum = 0.0;
+    for (double item : args[0].vector_value)
+    {
+        sum += item;
+    }
+    return NativeValue::Float(sum);
+}
+
+NativeValue Len(const NativeValue *args, size_t)
+{
+    if (args[0].kind != Kind::kVector)
+    {
+        throw RuntimeError(
+            ResultStatus::kTypeError, std::string("object of type '") + KindName(args[0].kind) + "' has no len()"
+        );
+    }
+    return NativeValue::Int(static_cast<int64_t>(args[0].vector_value.size()));
+}
+
+NativeValue Float(const NativeValue *args, size_t)
+{
+    CheckScalar("float", args[0]);
+    return NativeValue::Float(RoundToDouble(args[0]));
+}
+
+NativeValue Int(const NativeValue *args, size_t)
+{
+    CheckScalar("int", args[0]);
+    if (IsInteger(args[0]))
+    {
+        return NativeValue::Int(args[0].int_value);
+    }
+    if (std::isinf(args[0].float_value))
+    {
+        throw RuntimeError(ResultStatus::kOverflowError, "cannot convert float infinity to integer");
+    }
+    return NativeValue::Int(ToInt64(args[0].float_value));
+}
+
+const size_t kVariadic = std::numeric_limits<size_t>::max();
+
+const Builtin kBuiltins[] = {
+    {"abs", 1, 1, Abs},       {"sqrt", 1, 1, Sqrt},   {"exp", 1, 1, Exp},     {"log", 1, 2, Log},
+    {"log10", 1, 1, Log10},   {"sin", 1, 1, Sin},     {"cos", 1, 1, Cos},     {"tan", 1, 1, Tan},
+    {"asin", 1, 1, Asin},     {"acos", 1, 1, Acos},   {"atan", 1, 1, Atan},   {"atan2", 2, 2, Atan2},
+    {"floor", 1, 1, Floor},   {"ceil", 1, 1, Ceil},   {"round", 1, 2, Round}, {"pow", 2, 2, Pow},
+    {"min", 1, kVariadic, Min}, {"max", 1, kVariadic, Max}, {"sum", 1, 1, Sum}, {"len", 1, 1, Len},
+    {"float", 1, 1, Float},   {"int", 1, 1, Int},
+};
+
+// in the order of the arithmetic opcodes of NativeProgram
+enum ArithmeticOp : uint8_t
+{
+    kAddOp,
+    kSubOp,
+    kMulOp,
+    kDivOp,
+    kFloorDivOp,
+    kModOp,
+    kPowOp,
+};
+
+const char *const kArithmeticSymbols[] = {"+", "-", "*", "/", "//", "%", "**"};
+
+NativeValue Arithmetic(uint8_t op, const NativeValue &a, const NativeValue &b)
+{
+    if (a.kind == Kind::kVector || b.kind == Kind::kVector)
+    {
+        const char *symbol = kArithmeticSymbols[op];
+        switch (op)
+        {
+        case kAddOp:
+            return ElementWise(symbol, a, b, [](double x, double y) { return x + y; });
+        case kSubOp:
+            return ElementWise(symbol, a, b, [](double x, double y) { return x - y; });
+        case kMulOp:
+            return ElementWise(symbol, a, b, [](double x, double y) { return x * y; });
+        case kDivOp:
+            return ElementWise(symbol, a, b, Divide);
+        case kFloorDivOp:
+            return ElementWise(symbol, a, b, FloorDivide);
+        case kModOp:
+            return ElementWise(symbol, a, b, FloatMod);
+        default:
+            return ElementWise(symbol, a, b, FloatPow);
+        }
+    }
+
+    if (IsInteger(a) && IsInteger(b))
+    {
+        switch (op)
+        {
+        case kAddOp:
+            return NativeValue::Int(CheckedAdd(a.int_value, b.int_value));
+        case kSubOp:
+            return NativeValue::Int(CheckedSub(a.int_value, b.int_value));
+        case kMulOp:
+            return NativeValue::Int(CheckedMul(a.int_value, b.int_value));
+        case kDivOp:
+            return NativeValue::Float(Divide(ToDouble(a), ToDouble(b)));
+        case kFloorDivOp:
+            return NativeValue::Int(IntFloorDiv(a.int_value, b.int_value));
+        case kModOp:
+            return NativeValue::Int(IntMod(a.int_value, b.int_value));
+        default:
+            if (b.int_value < 0)
+            {
+                return NativeValue::Float(FloatPow(ToDouble(a), ToDouble(b)));
+            }
+            return NativeValue::Int(IntPow(a.int_value, b.int_value));
+        }
+    }
+
+    double x = ToDouble(a);
+    double y = ToDouble(b);
+    switch (op)
+    {
+    case kAddOp:
+        return NativeValue::Float(x + y);
+    case kSubOp:
+        return NativeValue::Float(x - y);
+    case kMulOp:
+        return NativeValue::Float(x * y);
+    case kDivOp:
+        return NativeValue::Float(Divide(x, y));
+    case kFloorDivOp:
+        return NativeValue::Float(FloorDivide(x, y));
+    case kModOp:
+        return NativeValue::Float(FloatMod(x, y));
+    default:
+        return NativeValue::Float(FloatPow(x, y));
+    }
+}
+
+NativeValue Pow(const NativeValue *args, size_t)
+{
+    return Arithmetic(kPowOp, args[0], args[1]);
+}
+
+const Builtin *FindBuiltin(const std::string &name, size_t &index)
+{
+    for (size_t i = 0; i < sizeof(kBuiltins) / sizeof(kBuiltins[0]); i++)
+    {
+        if (name == kBuiltins[i].name)
+        {
+            index = i;
+            return &kBuiltins[i];
+        }
+    }
+    return nullptr;
+}
+
+template <typename T>
+bool CastVector(const Value &value, NativeValue &result)
+{
+    if (value.Type() != typeid(std::vector<T>))
+    {
+        return false;
+    }
+    const std::vector<T> items = value.Cast<std::vector<T>>();
+    result = NativeValue::Vector(std::vector<double>(items.begin(), items.end()));
+    return true;
+}
+
+template <typename T>
+bool CastInteger(const Value &value, NativeValue &result)
+{
+    if (value.Type() != typeid(T))
+    {
+        return false;
+    }
+    T item = value.Cast<T>();
+    if (static_cast<uint64_t>(item) > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) && item > 0)
+    {
+        return false;
+    }
+    result = NativeValue::Int(static_cast<int64_t>(item));
+    return true;
+}
+} // namespace
+
+NativeValue NativeValue::Bool(bool value)
+{
+    NativeValue result;
+    result.kind = Kind::kBool;
+    result.int_value = value ? 1 : 0;
+    return result;
+}
+
+NativeValue NativeValue::Int(int64_t value)
+{
+    NativeValue result;
+    result.kind = Kind::kInt;
+    result.int_value = value;
+    return result;
+}
+
+NativeValue NativeValue::Float(double value)
+{
+    NativeValue result;
+    result.kind = Kind::kFloat;
+    result.float_value = value;
+    return result;
+}
+
+NativeValue NativeValue::Vector(std::vector<double> value)
+{
+    NativeValue result;
+    result.kind = Kind::kVector;
+    result.vector_value = std::move(value);
+    return result;
+}
+
+bool NativeValue::FromValue(const Value &value, NativeValue &result)
+{
+    if (value.IsNull())
+    {
+        return false;
+    }
+    const std::type_info &type = value.Type();
+    if (type == typeid(double))
+    {
+        result = Float(value.Cast<double>());
+        return true;
+    }
+    if (type == typeid(float))
+    {
+        result = Float(value.Cast<float>());
+        return true;
+    }
+    if (type == typeid(bool))
+    {
+        result = Bool(value.Cast<bool>());
+        return true;
+    }
+    return CastInteger<int>(value, result) || CastInteger<long>(value, result) ||
+           CastInteger<long long>(value, result) || CastInteger<unsigned int>(value, result) ||
+           CastInteger<unsigned long>(value, result) || CastInteger<unsigned long long>(value, result) ||
+           CastVector<double>(value, result) || CastVector<float>(value, result) || CastVector<int>(value, result) ||
+           CastVector<long>(value, result) || CastVector<long long>(value, result);
+}
+
+Value NativeValue::ToValue() const
+{
+    switch (kind)
+    {
+    case Kind::kBool:
+        return Value(int_value != 0);
+    case Kind::kInt:
+        return Value(int_value);
+    case Kind::kFloat:
+        return Value(float_value);
+    default:
+        return Value(vector_value);
+    }
+}
+
+class NativeProgram::Compiler
+{
+  public:
+    explicit Compiler(NativeProgram &program) : program_(program) {}
+
+    void CompileStatement(const NativeStatement &statement)
+    {
+        uint32_t value = Push();
+        CompileInto(*statement.expression, value);
+        if (!statement.target.empty())
+        {
+            Emit(OpCode::kStoreName, 0, NameIndex(statement.target), value);
+        }
+        Pop();
+    }
+
+    void CompileExpression(const NativeNode &node)
+    {
+        // the result stays in register 0
+        CompileInto(node, Push());
+        Pop();
+    }
+
+  private:
+    void CompileInto(const NativeNode &node, uint32_t dst)
+    {
+        NativeValue constant;
+        if (Fold(node, constant))
+        {
+            Emit(OpCode::kLoadConst, dst, ConstantIndex(std::move(constant)));
+            return;
+        }
+
+        switch (node.kind)
+        {
+        case NativeNode::Kind::kName:
+            Emit(OpCode::kLoadName, dst, NameIndex(node.name));
+            break;
+        case NativeNode::Kind::kList:
+            program_.scalar_arithmetic_ = false;
+            Emit(OpCode::kBuildList, dst, 0, CompileOperands(node.children), static_cast<uint32_t>(node.children.size()));
+            PopOperands(node.children.size());
+            break;
+        case NativeNode::Kind::kCall:
+            program_.scalar_arithmetic_ = false;
+            CompileCall(node, dst);
+            break;
+        case NativeNode::Kind::kUnary:
+            CompileInto(*node.children[0], dst);
+            Emit(node.ops[0] == "-" ? OpCode::kNeg : node.ops[0] == "+" ? OpCode::kPos : OpCode::kNot, dst, dst);
+            break;
+        case NativeNode::Kind::kBinary:
+        case NativeNode::Kind::kIndex: {
+            if (node.kind == NativeNode::Kind::kIndex)
+            {
+                program_.scalar_arithmetic_ = false;
+            }
+            CompileInto(*node.children[0], dst);
+            uint32_t right = Push();
+            CompileInto(*node.children[1], right);
+            Emit(node.kind == NativeNode::Kind::kIndex ? OpCode::kIndex : BinaryOpCode(node.ops[0]), dst, dst, right);
+            Pop();
+            break;
+        }
+        case NativeNode::Kind::kCompare:
+            CompileCompare(node, dst);
+            break;
+        case NativeNode::Kind::kAnd:
+        case NativeNode::Kind::kOr: {
+            // the result is the operand deciding it, like in Python
+            CompileInto(*node.children[0], dst);
+            size_t jump = Emit(node.kind == NativeNode::Kind::kAnd ? OpCode::kJumpIfFalse : OpCode::kJumpIfTrue, 0, dst);
+            CompileInto(*node.children[1], dst);
+            PatchJump(jump);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void CompileCall(const NativeNode &node, uint32_t dst)
+    {
+        size_t index = 0;
+        const Builtin *builtin = FindBuiltin(node.name, index);
+        if (!builtin)
+        {
+            throw NativeCompileError(ResultStatus::kNameError, "name '" + node.name + "' is not a builtin function");
+        }
+        size_t count = node.children.size();
+        if (count < builtin->min_args || count > builtin->max_args)
+        {
+            std::string expected = builtin->min_args == builtin->max_args
+                                       ? std::to_string(builtin->min_args)
+                                       : builtin->max_args == kVariadic
+                                             ? "at least " + std::to_string(builtin->min_args)
+                                             : std::to_string(builtin->min_args) + " to " +
+                                                   std::to_string(builtin->max_args);
+            throw NativeCompileError(
+                ResultStatus::kTypeError, node.name + "() takes " + expected + " argument(s) (" +
+                                              std::to_string(count) + " given)"
+            );
+        }
+        uint32_t first = CompileOperands(node.children);
+        Emit(OpCode::kCall, dst, static_cast<uint32_t>(index), first, static_cast<uint32_t>(count));
+        PopOperands(count);
+    }
+
+    // a < b < c runs as a < b and b < c with b evaluated once
+    void CompileCompare(const NativeNode &node, uint32_t dst)
+    {
+        uint32_t left = Push();
+        uint32_t right = Push();
+        CompileInto(*node.children[0], left);
+        std::vector<size_t> jumps;
+        for (size_t i = 0; i < node.ops.size(); i++)
+        {
+            CompileInto(*node.children[i + 1], right);
+            Emit(CompareOpCode(node.ops[i]), dst, left, right);
+            if (i + 1 < node.ops.size())
+            {
+                jumps.push_back(Emit(OpCode::kJumpIfFalse, 0, dst));
+                Emit(OpCode::kMove, left, right);
+            }
+        }
+        for (size_t jump : jumps)
+        {
+            PatchJump(jump);
+        }
+        Pop();
+        Pop();
+    }
+
+    // evaluates nodes into consecutive registers, returns the first one
+    uint32_t CompileOperands(const std::vector<std::unique_ptr<NativeNode>> &nodes)
+    {
+        uint32_t first = top_;
+        for (const auto &node : nodes)
+        {
+            CompileInto(*node, Push());
+        }
+        return first;
+    }
+
+    void PopOperands(size_t count)
+    {
+        top_ -= static_cast<uint32_t>(count);
+    }
+
+    // literals, negated literals and lists of them become constants
+    bool Fold(const NativeNode &node, NativeValue &result) const
+    {
+        switch (node.kind)
+        {
+        case NativeNode::Kind::kInt:
+            result = NativeValue::Int(node.int_value);
+            return true;
+        case NativeNode::Kind::kFloat:
+            result = NativeValue::Float(node.float_value);
+            return true;
+        case NativeNode::Kind::kBool:
+            result = NativeValue::Bool(node.int_value != 0);
+            return true;
+        case NativeNode::Kind::kUnary: {
+            NativeValue operand;
+            if (node.ops[0] != "-" || !Fold(*node.children[0], operand) || operand.kind == Kind::kVector ||
+                (IsInteger(operand) && operand.int_value == std::numeric_limits<int64_t>::min()))
+            {
+                return false;
+            }
+            result = IsInteger(operand) ? NativeValue::Int(-operand.int_value) : NativeValue::Float(-operand.float_value);
+            return true;
+        }
+        case NativeNode::Kind::kList: {
+            std::vector<double> items;
+            items.reserve(node.children.size());
+            for (const auto &child : node.children)
+            {
+                NativeValue item;
+                // inexact ints are left to the run, which reports them
+                if (!Fold(*child, item) || item.kind == Kind::kVector ||
+                    (IsInteger(item) && (item.int_value > kMaxExactInt || item.int_value < -kMaxExactInt)))
+                {
+                    return false;
+                }
+                items.push_back(ToDouble(item));
+            }
+            result = NativeValue::Vector(std::move(items));
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    static OpCode BinaryOpCode(const std::string &op)
+    {
+        if (op == "+")
+            return OpCode::kAdd;
+        if (op == "-")
+            return OpCode::kSub;
+        if (op == "*")
+            return OpCode::kMul;
+        if (op == "/")
+            return OpCode::kDiv;
+        if (op == "//")
+            return OpCode::kFloorDiv;
+        if (op == "%")
+            return OpCode::kMod;
+        return OpCode::kPow;
+    }
+
+    static OpCode CompareOpCode(const std::string &op)
+    {
+        if (op == "<")
+            return OpCode::kLt;
+        if (op == "<=")
+            return OpCode::kLe;
+        if (op == ">")
+            return OpCode::kGt;
+        if (op == ">=")
+            return OpCode::kGe;
+        if (op == "==")
+            return OpCode::kEq;
+        return OpCode::kNe;
+    }
+
+    size_t Emit(OpCode op, uint32_t dst, uint32_t a = 0, uint32_t b = 0, uint32_t count = 0)
+    {
+        program_.code_.push_back(Instruction{op, dst, a, b, count});
+        return program_.code_.size() - 1;
+    }
+
+    void PatchJump(size_t jump)
+    {
+        program_.code_[jump].b = static_cast<uint32_t>(program_.code_.size());
+    }
+
+    uint32_t Push()
+    {
+        uint32_t reg = top_++;
+        program_.register_count_ = std::max(program_.register_count_, top_);
+        return reg;
+    }
+
+    void Pop()
+    {
+        top_--;
+    }
+
+    uint32_t NameIndex(const std::string &name)
+    {
+        auto it = name_indices_.find(name);
+        if (it != name_indices_.end())
+        {
+            return it->second;
+        }
+        uint32_t index = static_cast<uint32_t>(program_.names_.size());
+        program_.names_.push_back(name);
+        name_indices_[name] = index;
+        return index;
+    }
+
+    uint32_t ConstantIndex(NativeValue value)
+    {
+        if (value.kind == Kind::kVector)
+        {
+            program_.scalar_arithmetic_ = false;
+        }
+        program_.constants_.push_back(std::move(value));
+        return static_cast<uint32_t>(program_.constants_.size() - 1);
+    }
+
+    NativeProgram &program_;
+    uint32_t top_ = 0;
+    std::unordered_map<std::string, uint32_t> name_indices_;
+};
+
+std::shared_ptr<const NativeProgram> NativeProgram::Compile(const std::string &code, InterpretMode mode)
+{
+    std::shared_ptr<NativeProgram> program(new NativeProgram());
+    program->mode_ = mode;
+    Compiler compiler(*program);
+    if (mode == InterpretMode::kEval)
+    {
+        compiler.CompileExpression(*NativeParser::ParseExpression(code));
+    }
+    else
+    {
+        for (const auto &statement : NativeParser::ParseStatements(code))
+        {
+            compiler.CompileStatement(statement);
+        }
+    }
+    program->ComputeBatchShape();
+    return program;
+}
+
+InterpretResult NativeProgram::Run(EquationContext &context, const std::atomic<uint64_t> &interrupt_epoch) const
+{
+    NameLoader load = [&context](const std::string &name, NativeValue &value) -> ResultStatus {
+        if (!context.Contains(name))
+        {
+            return ResultStatus::kNameError;
+        }
+        return NativeValue::FromValue(context.Get(name), value) ? ResultStatus::kSuccess : ResultStatus::kTypeError;
+    };
+    NameStorer store = [&context](const std::string &name, const NativeValue &value) {
+        context.Set(name, value.ToValue());
+    };
+    return Run(load, store, interrupt_epoch);
+}
+
+InterpretResult NativeProgram::Run(
+    const NameLoader &load, const NameStorer &store, const std::atomic<uint64_t> &interrupt_epoch
+) const
+{
+    InterpretResult result;
+    result.mode = mode_;
+    result.status = ResultStatus::kSuccess;
+
+    uint64_t epoch = interrupt_epoch.load();
+    std::vector<NativeValue> registers(register_count_);
+    try
+    {
+        for (size_t pc = 0; pc < code_.size(); pc++)
+        {
+            if (interrupt_epoch.load(std::memory_order_relaxed) != epoch)
+            {
+                throw RuntimeError(ResultStatus::kKeyBoardInterrupt, "Execution was interrupted");
+            }
+
+            const Instruction &instruction = code_[pc];
+            NativeValue &dst = registers[instruction.dst];
+            switch (instruction.op)
+            {
+            case OpCode::kLoadConst:
+                dst = constants_[instruction.a];
+                break;
+            case OpCode::kLoadName: {
+                const std::string &name = names_[instruction.a];
+                ResultStatus status = load(name, dst);
+                if (status == ResultStatus::kNameError)
+                {
+                    throw RuntimeError(status, "name '" + name + "' is not defined");
+                }
+                if (status != ResultStatus::kSuccess)
+                {
+                    throw RuntimeError(status, "name '" + name + "' holds a value of unsupported type");
+                }
+                break;
+            }
+            case OpCode::kStoreName:
+                store(names_[instruction.a], registers[instruction.b]);
+                break;
+            case OpCode::kMove:
+                dst = registers[instruction.a];
+                break;
+            case OpCode::kNeg:
+                if (IsInteger(dst))
+                {
+                    dst = NativeValue::Int(CheckedSub(0, dst.int_value));
+                }
+                else
+                {
+                    dst = Map(dst, [](double x) { return -x; });
+                }
+                break;
+            case OpCode::kPos:
+                if (dst.kind == Kind::kBool)
+                {
+                    dst = NativeValue::Int(dst.int_value);
+                }
+                break;
+            case OpCode::kNot:
+                dst = NativeValue::Bool(!IsTrue(dst));
+                break;
+            case OpCode::kAdd:
+            case OpCode::kSub:
+            case OpCode::kMul:
+            case OpCode::kDiv:
+            case OpCode::kFloorDiv:
+            case OpCode::kMod:
+            case OpCode::kPow:
+                dst = Arithmetic(
+                    static_cast<uint8_t>(static_cast<uint8_t>(instruction.op) - static_cast<uint8_t>(OpCode::kAdd)),
+                    registers[instruction.a], registers[instruction.b]
+                );
+                break;
+            case OpCode::kLt:
+            case OpCode::kLe:
+            case OpCode::kGt:
+            case OpCode::kGe: {
+                static const char *const kSymbols[] = {"<", "<=", ">", ">="};
+                const NativeValue &a = registers[instruction.a];
+                const NativeValue &b = registers[instruction.b];
+                CheckOrderable(kSymbols[static_cast<int>(instruction.op) - static_cast<int>(OpCode::kLt)], a, b);
+                bool value = instruction.op == OpCode::kLt   ? NumericLess(a, b)
+                             : instruction.op == OpCode::kLe ? !NumericLess(b, a)
+                             : instruction.op == OpCode::kGt ? NumericLess(b, a)
+                                                             : !NumericLess(a, b);
+                dst = NativeValue::Bool(value);
+                break;
+            }
+            case OpCode::kEq:
+                dst = NativeValue::Bool(NumericEqual(registers[instruction.a], registers[instruction.b]));
+                break;
+            case OpCode::kNe:
+                dst = NativeValue::Bool(!NumericEqual(registers[instruction.a], registers[instruction.b]));
+                break;
+            case OpCode::kIndex: {
+                const NativeValue &target = registers[instruction.a];
+                const NativeValue &index = registers[instruction.b];
+                if (target.kind != Kind::kVector)
+                {
+                    throw RuntimeError(
+                        ResultStatus::kTypeError,
+                        std::string("'") + KindName(target.kind) + "' object is not subscriptable"
+                    );
+                }
+                if (!IsInteger(index))
+                {
+                    throw RuntimeError(
+                        ResultStatus::kTypeError,
+                        std::string("vector indices must be integers, not '") + KindName(index.kind) + "'"
+                    );
+                }
+                int64_t size = static_cast<int64_t>(target.vector_value.size());
+                int64_t position = index.int_value < 0 ? index.int_value + size : index.int_value;
+                if (position < 0 || position >= size)
+                {
+                    throw RuntimeError(ResultStatus::kIndexError, "vector index out of range");
+                }
+                dst = NativeValue::Float(target.vector_value[static_cast<size_t>(position)]);
+                break;
+            }
+            case OpCode::kBuildList: {
+                std::vector<double> items(instruction.count);
+                for (uint32_t i = 0; i < instruction.count; i++)
+                {
+                    const NativeValue &item = registers[instruction.b + i];
+                    if (item.kind == Kind::kVector)
+                    {
+                        throw RuntimeError(ResultStatus::kTypeError, "vector items must be numbers, not 'vector'");
+                    }
+                    items[i] = ToDouble(item);
+                }
+                dst = NativeValue::Vector(std::move(items));
+                break;
+            }
+            case OpCode::kCall:
+                dst = kBuiltins[instruction.a].function(&registers[instruction.b], instruction.count);
+                break;
+            case OpCode::kJumpIfFalse:
+                if (!IsTrue(registers[instruction.a]))
+                {
+                    pc = instruction.b - 1;
+                }
+                break;
+            case OpCode::kJumpIfTrue:
+                if (IsTrue(registers[instruction.a]))
+                {
+                    pc = instruction.b - 1;
+                }
+                break;
+            }
+        }
+    }
+    catch (const RuntimeError &e)
+    {
+        result.status = e.status();
+        result.message = e.what();
+        return result;
+    }
+
+    if (mode_ == InterpretMode::kEval)
+    {
+        result.value = registers[0].ToValue();
+    }
+    return result;
+}
+
+namespace
+{
+template <typename T>
+void AppendBytes(std::string &out, const T &value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// register of RunBatch, a value per program or one scalar for all of them
+struct BatchRegister
+{
+    bool per_program = false;
+    NativeValue scalar;
+    std::vector<double> values;
+};
+
+// plain loops over contiguous doubles, the compiler turns them into the SIMD
+// instructions of the target (SSE / AVX / NEON) where op allows it
+template <typename Op>
+void ApplyBatch(const BatchRegister &a, const BatchRegister &b, size_t count, std::vector<double> &result, Op op)
+{
+    result.resize(count);
+    double *out = result.data();
+    if (a.per_program && b.per_program)
+    {
+        const double *x = a.values.data();
+        const double *y = b.values.data();
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = op(x[i], y[i]);
+        }
+    }
+    else if (a.per_program)
+    {
+        const double *x = a.values.data();
+        double y = ToDouble(b.scalar);
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = op(x[i], y);
+        }
+    }
+    else
+    {
+        double x = ToDouble(a.scalar);
+        const double *y = b.values.data();
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = op(x, y[i]);
+        }
+    }
+}
+
+bool HasZero(const BatchRegister &value)
+{
+    if (!value.per_program)
+    {
+        return ToDouble(value.scalar) == 0.0;
+    }
+    return std::find(value.values.begin(), value.values.end(), 0.0) != value.values.end();
+}
+} // namespace
+
+void NativeProgram::ComputeBatchShape()
+{
+    batch_shape_.clear();
+    if (mode_ != InterpretMode::kExec || code_.empty() || code_.back().op != OpCode::kStoreName)
+    {
+        return;
+    }
+
+    // registers holding a value per program once loaded from names, the
+    // others hold constants and what is computed from constants only
+    std::vector<bool> per_program(register_count_, false);
+    std::string shape;
+    for (size_t pc = 0; pc < code_.size(); pc++)
+    {
+        const Instruction &instruction = code_[pc];
+        switch (instruction.op)
+        {
+        case OpCode::kLoadConst:
+            if (constants_[instruction.a].kind == Kind::kVector)
+            {
+                return;
+            }
+            per_program[instruction.dst] = false;
+            break;
+        case OpCode::kLoadName:
+            per_program[instruction.dst] = true;
+            break;
+        case OpCode::kStoreName:
+            if (pc + 1 != code_.size() || !per_program[instruction.b])
+            {
+                return;
+            }
+            break;
+        case OpCode::kMove:
+            per_program[instruction.dst] = per_program[instruction.a];
+            break;
+        case OpCode::kNeg:
+        case OpCode::kPos:
+            if (!per_program[instruction.dst])
+            {
+                return;
+            }
+            break;
+        case OpCode::kAdd:
+        case OpCode::kSub:
+        case OpCode::kMul:
+        case OpCode::kDiv:
+        case OpCode::kFloorDiv:
+        case OpCode::kMod:
+        case OpCode::kPow:
+            per_program[instruction.dst] = per_program[instruction.a] || per_program[instruction.b];
+            break;
+        default:
+            return;
+        }
+        AppendBytes(shape, instruction.op);
+        AppendBytes(shape, instruction.dst);
+        AppendBytes(shape, instruction.a);
+        AppendBytes(shape, instruction.b);
+    }
+    for (const auto &constant : constants_)
+    {
+        AppendBytes(shape, constant.kind);
+        AppendBytes(shape, constant.int_value);
+        AppendBytes(shape, constant.float_value);
+    }
+    AppendBytes(shape, names_.size());
+    batch_shape_ = std::move(shape);
+}
+
+std::vector<bool> NativeProgram::RunBatch(
+    const std::vector<const NativeProgram *> &programs, const NameLoader &load, const NameStorer &store,
+    const std::atomic<uint64_t> &interrupt_epoch, std::vector<InterpretResult> &results
+)
+{
+    results.resize(programs.size());
+    std::vector<bool> ran(programs.size(), false);
+    if (programs.empty())
+    {
+        return ran;
+    }
+    const NativeProgram &shape = *programs[0];
+
+    // gathers the inputs of each load into one array, leaving out the
+    // programs with an input which is not a float
+    std::vector<const Instruction *> loads;
+    for (const Instruction &instruction : shape.code_)
+    {
+        if (instruction.op == OpCode::kLoadName)
+        {
+            loads.push_back(&instruction);
+        }
+    }
+    std::vector<size_t> lanes;
+    std::vector<std::vector<double>> inputs(loads.size());
+    NativeValue value;
+    for (size_t i = 0; i < programs.size(); i++)
+    {
+        size_t loaded = 0;
+        for (; loaded < loads.size(); loaded++)
+        {
+            if (load(programs[i]->names_[loads[loaded]->a], value) != ResultStatus::kSuccess ||
+                value.kind != Kind::kFloat)
+            {
+                break;
+            }
+            inputs[loaded].push_back(value.float_value);
+        }
+        if (loaded < loads.size())
+        {
+            for (size_t j = 0; j < loaded; j++)
+            {
+                inputs[j].pop_back();
+            }
+            continue;
+        }
+        lanes.push_back(i);
+    }
+    if (lanes.empty())
+    {
+        return ran;
+    }
+
+    size_t count = lanes.size();
+    uint64_t epoch = interrupt_epoch.load();
+    std::vector<BatchRegister> registers(shape.register_count_);
+    // swapped with the registers written, so they reuse their storage
+    std::vector<double> scratch;
+    size_t next_input = 0;
+    bool interrupted = false;
+    try
+    {
+        for (const Instruction &instruction : shape.code_)
+        {
+            if (interrupt_epoch.load(std::memory_order_relaxed) != epoch)
+            {
+                interrupted = true;
+                break;
+            }
+
+            BatchRegister &dst = registers[instruction.dst];
+            switch (instruction.op)
+            {
+            case OpCode::kLoadConst:
+                dst.per_program = false;
+                dst.scalar = shape.constants_[instruction.a];
+                break;
+            case OpCode::kLoadName:
+                dst.values.swap(inputs[next_input++]);
+                dst.per_program = true;
+                break;
+            case OpCode::kStoreName: {
+                // scatters the results back, nothing was assigned before
+                const std::vector<double> &values = registers[instruction.b].values;
+                for (size_t i = 0; i < count; i++)
+                {
+                    store(programs[lanes[i]]->names_[instruction.a], NativeValue::Float(values[i]));
+                }
+                break;
+            }
+            case OpCode::kMove:
+                dst = registers[instruction.a];
+                break;
+            case OpCode::kNeg:
+                for (double &element : dst.values)
+                {
+                    element = -element;
+                }
+                break;
+            case OpCode::kPos:
+                break;
+            case OpCode::kAdd:
+            case OpCode::kSub:
+            case OpCode::kMul:
+            case OpCode::kDiv:
+            case OpCode::kFloorDiv:
+            case OpCode::kMod:
+            case OpCode::kPow: {
+                const BatchRegister &a = registers[instruction.a];
+                const BatchRegister &b = registers[instruction.b];
+                uint8_t op = static_cast<uint8_t>(static_cast<uint8_t>(instruction.op) - static_cast<uint8_t>(OpCode::kAdd));
+                if (!a.per_program && !b.per_program)
+                {
+                    dst.scalar = Arithmetic(op, a.scalar, b.scalar);
+                    break;
+                }
+                switch (op)
+                {
+                case kAddOp:
+                    ApplyBatch(a, b, count, scratch, [](double x, double y) { return x + y; });
+                    break;
+                case kSubOp:
+                    ApplyBatch(a, b, count, scratch, [](double x, double y) { return x - y; });
+                    break;
+                case kMulOp:
+                    ApplyBatch(a, b, count, scratch, [](double x, double y) { return x * y; });
+                    break;
+                case kDivOp:
+                    // checked up front, keeps the division loop free of branches
+                    if (HasZero(b))
+                    {
+                        return ran;
+                    }
+                    ApplyBatch(a, b, count, scratch, [](double x, double y) { return x / y; });
+                    break;
+                case kFloorDivOp:
+                    ApplyBatch(a, b, count, scratch, FloorDivide);
+                    break;
+                case kModOp:
+                    ApplyBatch(a, b, count, scratch, FloatMod);
+                    break;
+                default:
+                    ApplyBatch(a, b, count, scratch, FloatPow);
+                    break;
+                }
+                dst.values.swap(scratch);
+                dst.per_program = true;
+                break;
+            }
+            default:
+                return ran;
+            }
+        }
+    }
+    catch (const RuntimeError &)
+    {
+        return ran;
+    }
+
+    for (size_t lane : lanes)
+    {
+        InterpretResult &result = results[lane];
+        result.mode = InterpretMode::kExec;
+        result.status = interrupted ? ResultStatus::kKeyBoardInterrupt : ResultStatus::kSuccess;
+        result.message = interrupted ? "Execution was interrupted" : "";
+        ran[lane] = true;
+    }
+    return ran;
+}
+
+const std::set<std::string> &NativeProgram::BuiltinFunctionNames()
+{
+    static const std::set<std::string> names = []() -> std::set<std::string> {
+        std::set<std::string> result;
+        for (const auto &builtin : kBuiltins)
+        {
+            result.insert(builtin.name);
+        }
+        return result;
+    }();
+    return names;
+}
+} // namespace native
+} // namespace xequation
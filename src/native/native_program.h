@@ -0,0 +1,184 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "core/equation_common.h"
+#include "core/equation_context.h"
+#include "native_parser.h"
+
+namespace xequation
+{
+namespace native
+{
+// Value of a register of NativeProgram. Vectors hold doubles and operators
+// apply to them element-wise like numpy arrays, scalars broadcast.
+struct NativeValue
+{
+    enum class Kind : uint8_t
+    {
+        kBool,
+        kInt,
+        kFloat,
+        kVector,
+    };
+
+    Kind kind = Kind::kInt;
+    // kBool and kInt
+    int64_t int_value = 0;
+    double float_value = 0.0;
+    std::vector<double> vector_value;
+
+    static NativeValue Bool(bool value);
+    static NativeValue Int(int64_t value);
+    static NativeValue Float(double value);
+    static NativeValue Vector(std::vector<double> value);
+
+    // Accepts bool, integers, float, double and std::vector of those, returns
+    // false for any other type.
+    static bool FromValue(const Value &value, NativeValue &result);
+
+    // bool, int64_t, double or std::vector<double>
+    Value ToValue() const;
+};
+
+// Thrown by NativeProgram::Compile for code which parses but can not run,
+// e.g. calls of unknown functions.
+class NativeCompileError : public ParseException
+{
+  public:
+    NativeCompileError(ResultStatus status, const std::string &message) : ParseException(message), status_(status) {}
+
+    ResultStatus status() const
+    {
+        return status_;
+    }
+
+  private:
+    ResultStatus status_;
+};
+
+// Native code compiled to register based bytecode. A program is immutable
+// after Compile(), so one instance is run by any number of threads at once.
+class NativeProgram
+{
+  public:
+    // kExec compiles statements, assignments are stored into the context.
+    // kEval compiles a single expression whose value is the result. Throws
+    // ParseException on syntax errors and NativeCompileError.
+    static std::shared_ptr<const NativeProgram> Compile(const std::string &code, InterpretMode mode);
+
+    // Reads the value of a name, returns kNameError if it is not defined and
+    // kTypeError if it holds something the program can not compute with.
+    using NameLoader = std::function<ResultStatus(const std::string &name, NativeValue &value)>;
+    using NameStorer = std::function<void(const std::string &name, const NativeValue &value)>;
+
+    // Names are read from and assigned to context while running, names bound
+    // before an error stay bound. Ends with ResultStatus::kKeyBoardInterrupt
+    // once interrupt_epoch changes.
+    InterpretResult Run(EquationContext &context, const std::atomic<uint64_t> &interrupt_epoch) const;
+
+    InterpretResult Run(const NameLoader &load, const NameStorer &store, const std::atomic<uint64_t> &interrupt_epoch) const;
+
+    // True if the program only does arithmetic, comparisons and and / or /
+    // not on scalars, no vectors, indexing or calls. For int, float and bool
+    // values such a program means the same as the Python code it was
+    // compiled from, as long as it ends with kSuccess.
+    bool IsScalarArithmetic() const
+    {
+        return scalar_arithmetic_;
+    }
+
+    // Key shared by the programs of single assignments which only differ in
+    // the names they read and assign, like "r1 = p1 * q1" and "r2 = p2 * q2".
+    // Empty if the program is not a single assignment of arithmetic on
+    // scalars, which is all RunBatch() computes.
+    const std::string &batch_shape() const
+    {
+        return batch_shape_;
+    }
+
+    // Runs programs of the same non empty batch_shape() together, every
+    // instruction once for all of them over contiguous arrays. The programs
+    // must not read names assigned by one another. Programs reading anything
+    // but floats are left out. Returns which programs ran and got a result,
+    // none do if an error is about to occur, Run() the rest one by one to
+    // report it.
+    static std::vector<bool> RunBatch(
+        const std::vector<const NativeProgram *> &programs, const NameLoader &load, const NameStorer &store,
+        const std::atomic<uint64_t> &interrupt_epoch, std::vector<InterpretResult> &results
+    );
+
+    static const std::set<std::string> &BuiltinFunctionNames();
+
+    size_t instruction_count() const
+    {
+        return code_.size();
+    }
+
+    size_t register_count() const
+    {
+        return register_count_;
+    }
+
+  private:
+    enum class OpCode : uint8_t
+    {
+        kLoadConst,
+        kLoadName,
+        kStoreName,
+        kMove,
+        kNeg,
+        kPos,
+        kNot,
+        kAdd,
+        kSub,
+        kMul,
+        kDiv,
+        kFloorDiv,
+        kMod,
+        kPow,
+        kLt,
+        kLe,
+        kGt,
+        kGe,
+        kEq,
+        kNe,
+        kIndex,
+        kBuildList,
+        kCall,
+        kJumpIfFalse,
+        kJumpIfTrue,
+    };
+
+    // dst = op(a, b); kCall / kBuildList take count registers from b on,
+    // kCall has the function in a, jumps have the target in b
+    struct Instruction
+    {
+        OpCode op;
+        uint32_t dst;
+        uint32_t a;
+        uint32_t b;
+        uint32_t count;
+    };
+
+    class Compiler;
+
+    NativeProgram() = default;
+
+    void ComputeBatchShape();
+
+    InterpretMode mode_ = InterpretMode::kExec;
+    std::vector<Instruction> code_;
+    std::vector<NativeValue> constants_;
+    std::vector<std::string> names_;
+    uint32_t register_count_ = 0;
+    bool scalar_arithmetic_ = true;
+    std::string batch_shape_;
+};
+} // namespace native
+} // namespace xequation
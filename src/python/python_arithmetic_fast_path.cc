@@ -0,0 +1,132 @@
+#include "python_arithmetic_fast_path.h"
+
+#include <utility>
+#include <vector>
+
+namespace xequation
+{
+namespace python
+{
+namespace
+{
+// ints beyond 2^53 do not convert to double exactly, Python divides and
+// compares them with floats exactly; the VM fails on such ints computed in
+// the code, which leaves them to the interpreter as well
+const long long kMaxExactInt = 1LL << 53;
+
+// subclasses like numpy.float64 have their own semantics and are not taken
+bool FromPyObject(PyObject *object, native::NativeValue &value)
+{
+    if (PyBool_Check(object))
+    {
+        value = native::NativeValue::Bool(object == Py_True);
+        return true;
+    }
+    if (PyLong_CheckExact(object))
+    {
+        int overflow = 0;
+        long long number = PyLong_AsLongLongAndOverflow(object, &overflow);
+        if (overflow != 0 || number > kMaxExactInt || number < -kMaxExactInt)
+        {
+            return false;
+        }
+        value = native::NativeValue::Int(number);
+        return true;
+    }
+    if (PyFloat_CheckExact(object))
+    {
+        value = native::NativeValue::Float(PyFloat_AS_DOUBLE(object));
+        return true;
+    }
+    return false;
+}
+
+pybind11::object ToPyObject(const native::NativeValue &value)
+{
+    switch (value.kind)
+    {
+    case native::NativeValue::Kind::kBool:
+        return pybind11::bool_(value.int_value != 0);
+    case native::NativeValue::Kind::kInt:
+        return pybind11::int_(static_cast<long long>(value.int_value));
+    default:
+        return pybind11::float_(value.float_value);
+    }
+}
+} // namespace
+
+bool PythonArithmeticFastPath::TryExec(
+    const std::string &code_string, const pybind11::dict &local_dict, InterpretResult &result
+)
+{
+    std::shared_ptr<const native::NativeProgram> program = GetProgram(code_string);
+    if (!program)
+    {
+        return false;
+    }
+
+    // assignments are kept back until the whole code succeeded, reads see them
+    std::vector<std::pair<std::string, native::NativeValue>> assigned;
+    auto load = [&local_dict, &assigned](const std::string &name, native::NativeValue &value) -> ResultStatus {
+        for (auto it = assigned.rbegin(); it != assigned.rend(); ++it)
+        {
+            if (it->first == name)
+            {
+                value = it->second;
+                return ResultStatus::kSuccess;
+            }
+        }
+        // borrowed reference, names only found in builtins are not numbers
+        PyObject *object = PyDict_GetItemString(local_dict.ptr(), name.c_str());
+        if (!object)
+        {
+            return ResultStatus::kNameError;
+        }
+        return FromPyObject(object, value) ? ResultStatus::kSuccess : ResultStatus::kTypeError;
+    };
+    auto store = [&assigned](const std::string &name, const native::NativeValue &value) {
+        assigned.emplace_back(name, value);
+    };
+
+    InterpretResult native_result = program->Run(load, store, interrupt_epoch_);
+    if (native_result.status != ResultStatus::kSuccess)
+    {
+        return false;
+    }
+
+    for (const auto &item : assigned)
+    {
+        local_dict[item.first.c_str()] = ToPyObject(item.second);
+    }
+    result.mode = InterpretMode::kExec;
+    result.status = ResultStatus::kSuccess;
+    result.message.clear();
+    return true;
+}
+
+std::shared_ptr<const native::NativeProgram> PythonArithmeticFastPath::GetProgram(const std::string &code_string)
+{
+    auto cached = program_cache_.get(code_string);
+    if (cached)
+    {
+        return *cached;
+    }
+
+    std::shared_ptr<const native::NativeProgram> program;
+    try
+    {
+        program = native::NativeProgram::Compile(code_string, InterpretMode::kExec);
+    }
+    catch (const ParseException &)
+    {
+        // not in the native subset, e.g. strings, attributes or calls
+    }
+    if (program && !program->IsScalarArithmetic())
+    {
+        program.reset();
+    }
+    program_cache_.insert(code_string, program);
+    return program;
+}
+} // namespace python
+} // namespace xequation
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <boost/compute/detail/lru_cache.hpp>
+
+#include "python_common.h"
+#include "core/equation_common.h"
+#include "native/native_program.h"
+
+namespace xequation
+{
+namespace python
+{
+// Runs statements like "x = a * b + c / 2" on the native bytecode VM with
+// unboxed numbers instead of interpreting them. Only code compiling to a
+// scalar arithmetic NativeProgram over exact int / float / bool values is
+// taken, anything else is left to the interpreter.
+class PythonArithmeticFastPath
+{
+  public:
+    PythonArithmeticFastPath() = default;
+
+    PythonArithmeticFastPath(const PythonArithmeticFastPath &) = delete;
+    PythonArithmeticFastPath &operator=(const PythonArithmeticFastPath &) = delete;
+
+    // Returns false without touching local_dict when the code or the values
+    // it reads are not eligible or it fails, the caller interprets the code
+    // then, so errors always come from the interpreter. Assignments are
+    // written back as Python objects. The caller holds the GIL.
+    bool TryExec(const std::string &code_string, const pybind11::dict &local_dict, InterpretResult &result);
+
+    size_t GetCompiledProgramCacheSize() const { return program_cache_.size(); }
+
+  private:
+    std::shared_ptr<const native::NativeProgram> GetProgram(const std::string &code_string);
+
+  private:
+    static constexpr size_t max_cache_size_ = 256;
+    // holds null for code that is not eligible, so it is not parsed again
+    boost::compute::detail::lru_cache<std::string, std::shared_ptr<const native::NativeProgram>> program_cache_{max_cache_size_};
+    // fast path programs are never interrupted
+    std::atomic<uint64_t> interrupt_epoch_{0};
+};
+} // namespace python
+} // namespace xequation
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "core/equation_common.h"
 #include "python_base.h"
 #include "value_pybind_converter.h"
@@ -8,65 +12,162 @@ namespace xequation
 {
 namespace python
 {
-inline ResultStatus MapPythonExceptionToStatus(const pybind11::error_already_set &e)
+// Defines dumps(value), pickle.dumps except that modules are pickled by
+// name and imported again when loaded. Used wherever values leave the
+// interpreter (worker processes, result cache, snapshots); plain
+// pickle.loads reads the data.
+const char kPickleDumpsCode[] = R"(
+import copyreg, importlib, io, pickle, types
+
+def _reduce_module(module):
+    return importlib.import_module, (module.__name__,)
+
+_dispatch_table = copyreg.dispatch_table.copy()
+_dispatch_table[types.ModuleType] = _reduce_module
+
+def dumps(value):
+    buffer = io.BytesIO()
+    pickler = pickle.Pickler(buffer)
+    pickler.dispatch_table = _dispatch_table
+    pickler.dump(value)
+    return buffer.getvalue()
+)";
+
+// dumps() of kPickleDumpsCode for the current interpreter, callers keep it
+// per interpreter.
+inline pybind11::object CreatePickleDumps()
 {
     pybind11::gil_scoped_acquire acquire;
 
-    // Extract Python exception type
-    pybind11::object type = e.type();
-    pybind11::object type_name = type.attr("__name__");
-    std::string type_name_str = type_name.cast<std::string>();
+    pybind11::dict scope;
+    pybind11::exec(kPickleDumpsCode, scope);
+    return scope["dumps"];
+}
 
-    if (type_name_str == "SyntaxError")
-    {
-        return ResultStatus::kSyntaxError;
-    }
-    else if (type_name_str == "NameError")
-    {
-        return ResultStatus::kNameError;
-    }
-    else if (type_name_str == "TypeError")
-    {
-        return ResultStatus::kTypeError;
-    }
-    else if (type_name_str == "ZeroDivisionError")
+inline ResultStatus MapPythonExceptionToStatus(const pybind11::error_already_set &e)
+{
+    pybind11::gil_scoped_acquire acquire;
+
+    // compared by identity, the exception classes are static objects of the
+    // interpreter, no lookup or string conversion per error
+    struct StatusEntry
     {
-        return ResultStatus::kZeroDivisionError;
-    }
-    else if (type_name_str == "ValueError")
+        PyObject *type;
+        ResultStatus status;
+    };
+    const StatusEntry entries[] = {
+        {PyExc_SyntaxError, ResultStatus::kSyntaxError},
+        {PyExc_NameError, ResultStatus::kNameError},
+        {PyExc_TypeError, ResultStatus::kTypeError},
+        {PyExc_ZeroDivisionError, ResultStatus::kZeroDivisionError},
+        {PyExc_ValueError, ResultStatus::kValueError},
+        {PyExc_MemoryError, ResultStatus::kMemoryError},
+        {PyExc_OverflowError, ResultStatus::kOverflowError},
+        {PyExc_RecursionError, ResultStatus::kRecursionError},
+        {PyExc_IndexError, ResultStatus::kIndexError},
+        {PyExc_KeyError, ResultStatus::kKeyError},
+        {PyExc_AttributeError, ResultStatus::kAttributeError},
+        {PyExc_KeyboardInterrupt, ResultStatus::kKeyBoardInterrupt},
+    };
+
+    PyObject *type = e.type().ptr();
+    for (const auto &entry : entries)
     {
-        return ResultStatus::kValueError;
+        if (type == entry.type)
+        {
+            return entry.status;
+        }
     }
-    else if (type_name_str == "MemoryError")
+    return ResultStatus::kUnknownError;
+}
+
+// str() of the exception, without looking builtins.str up.
+inline std::string PythonExceptionMessage(const pybind11::error_already_set &e)
+{
+    pybind11::gil_scoped_acquire acquire;
+
+    PyObject *text = PyObject_Str(e.value().ptr());
+    if (!text)
     {
-        return ResultStatus::kMemoryError;
+        PyErr_Clear();
+        return std::string();
     }
-    else if (type_name_str == "OverflowError")
+    Py_ssize_t size = 0;
+    const char *data = PyUnicode_AsUTF8AndSize(text, &size);
+    std::string message = data ? std::string(data, static_cast<size_t>(size)) : std::string();
+    if (!data)
     {
-        return ResultStatus::kOverflowError;
+        PyErr_Clear();
     }
-    else if (type_name_str == "RecursionError")
+    Py_DECREF(text);
+    return message;
+}
+
+// Frames of a traceback, innermost last. A failed lookup ends the walk, a
+// partial list is still better than none.
+inline std::vector<ErrorFrame> ReadTracebackFrames(PyObject *traceback)
+{
+    std::vector<ErrorFrame> frames;
+    try
     {
-        return ResultStatus::kRecursionError;
+        for (PyObject *tb = traceback; tb && tb != Py_None;
+             tb = reinterpret_cast<PyObject *>(reinterpret_cast<PyTracebackObject *>(tb)->tb_next))
+        {
+            pybind11::handle entry(tb);
+            pybind11::object code = entry.attr("tb_frame").attr("f_code");
+            ErrorFrame frame;
+            frame.file = code.attr("co_filename").cast<std::string>();
+            frame.function = code.attr("co_name").cast<std::string>();
+            frame.line = entry.attr("tb_lineno").cast<int>();
+            frames.push_back(frame);
+        }
     }
-    else if (type_name_str == "IndexError")
+    catch (const pybind11::error_already_set &)
     {
-        return ResultStatus::kIndexError;
     }
-    else if (type_name_str == "KeyError")
+    return frames;
+}
+
+// Copies type, message, line and the file, function and line of every frame
+// into plain data, so the record holds no Python object and the traceback
+// with the locals of its frames is released along with the exception. The
+// text is only formatted by ErrorRecord::FormatTraceback.
+inline std::shared_ptr<const ErrorRecord> CaptureErrorRecord(const pybind11::error_already_set &e)
+{
+    pybind11::gil_scoped_acquire acquire;
+
+    PyObject *traceback = e.trace().ptr();
+    if (traceback && !PyTraceBack_Check(traceback))
     {
-        return ResultStatus::kKeyError;
+        traceback = nullptr;
     }
-    else if (type_name_str == "AttributeError")
+    std::shared_ptr<ErrorRecord> record = std::make_shared<ErrorRecord>();
+    record->frames = ReadTracebackFrames(traceback);
+    record->type = reinterpret_cast<PyTypeObject *>(e.type().ptr())->tp_name;
+    record->message = PythonExceptionMessage(e);
+    try
     {
-        return ResultStatus::kAttributeError;
+        if (PyErr_GivenExceptionMatches(e.type().ptr(), PyExc_SyntaxError))
+        {
+            pybind11::object lineno = e.value().attr("lineno");
+            record->line = lineno.is_none() ? 0 : lineno.cast<int>();
+        }
+        else if (traceback)
+        {
+            // only the innermost entry is needed for the line
+            PyTracebackObject *innermost = reinterpret_cast<PyTracebackObject *>(traceback);
+            while (innermost->tb_next)
+            {
+                innermost = innermost->tb_next;
+            }
+            record->line = pybind11::handle(reinterpret_cast<PyObject *>(innermost)).attr("tb_lineno").cast<int>();
+        }
     }
-    else if (type_name_str == "KeyboardInterrupt")
+    catch (const pybind11::error_already_set &)
     {
-        return ResultStatus::kKeyBoardInterrupt;
+        // a partial record is still better than none
     }
-
-    return ResultStatus::kUnknownError;
+    return record;
 }
 } // namespace python
 } // namespace xequation
\ No newline at end of file
@@ -4,16 +4,66 @@
 using namespace xequation;
 using namespace xequation::python;
 
-PythonEquationContext::PythonEquationContext()
+namespace
 {
-    pybind11::gil_scoped_acquire acquire;
+// Walks the objects referenced by obj without recursion, each object is
+// counted once. Containers over sample_limit items only walk sample_size of
+// them and scale their size up. Modules, classes and functions are shared
+// rather than held by a value and are not counted.
+const char kDeepSizeCode[] = R"(
+def deep_size(obj, sample_limit=1000, sample_size=100):
+    import itertools, sys, types
+    shared = (types.ModuleType, type, types.FunctionType, types.BuiltinFunctionType, types.MethodType)
+    seen = set()
+    total = 0.0
+    stack = [(obj, 1.0)]
+    while stack:
+        o, scale = stack.pop()
+        if id(o) in seen or isinstance(o, shared):
+            continue
+        seen.add(id(o))
+        total += sys.getsizeof(o, 0) * scale
+        if isinstance(o, dict):
+            children, count = itertools.chain.from_iterable(o.items()), 2 * len(o)
+        elif isinstance(o, (list, tuple, set, frozenset)):
+            children, count = o, len(o)
+        elif isinstance(getattr(o, '__dict__', None), dict):
+            children, count = (o.__dict__,), 1
+        else:
+            continue
+        if count > sample_limit:
+            if isinstance(o, (list, tuple)):
+                children = o[::max(1, count // sample_size)][:sample_size]
+            else:
+                children = list(itertools.islice(children, sample_size))
+            scale = scale * count / max(1, len(children))
+        for child in children:
+            stack.append((child, scale))
+    return int(total)
+)";
+} // namespace
+
+PythonEquationContext::PythonEquationContext(std::shared_ptr<PythonSubInterpreter> interpreter)
+    : interpreter_(interpreter)
+{
+    PythonInterpreterLock lock(interpreter_.get());
     dict_.reset(new pybind11::dict());
     (*dict_)["__builtins__"] = pybind11::module_::import("builtins");
 }
 
+PythonEquationContext::~PythonEquationContext() noexcept
+{
+    // the dict belongs to the interpreter the context was created in
+    PythonInterpreterLock lock(interpreter_.get());
+    deep_size_func_.reset();
+    dumps_func_.reset();
+    builtin_names_dict_ = pybind11::object();
+    dict_.reset();
+}
+
 Value PythonEquationContext::Get(const std::string &var_name) const
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
     if (dict_->contains(var_name))
     {
         Value value = pybind11::cast<Value>((*dict_)[var_name.c_str()]);
@@ -24,13 +74,13 @@ Value PythonEquationContext::Get(const std::string &var_name) const
 
 bool PythonEquationContext::Contains(const std::string &var_name) const
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
     return dict_->contains(var_name);
 }
 
 std::unordered_set<std::string> PythonEquationContext::keys() const
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
 
     pybind11::object keys_obj = dict_->attr("keys")();
     std::unordered_set<std::string> keys;
@@ -44,18 +94,26 @@ std::unordered_set<std::string> PythonEquationContext::keys() const
 
 void PythonEquationContext::Set(const std::string &var_name, const Value &value)
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
 
     (*dict_)[var_name.c_str()] = value;
+    if (var_name == "__builtins__")
+    {
+        builtins_version_++;
+    }
 }
 
 bool PythonEquationContext::Remove(const std::string &var_name)
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
 
     if (dict_->contains(var_name))
     {
         dict_->attr("__delitem__")(var_name);
+        if (var_name == "__builtins__")
+        {
+            builtins_version_++;
+        }
         return true;
     }
     return false;
@@ -63,28 +121,29 @@ bool PythonEquationContext::Remove(const std::string &var_name)
 
 void PythonEquationContext::Clear() 
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
     
     dict_->clear();
+    builtins_version_++;
 }
 
 size_t PythonEquationContext::size() const
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
     
     return dict_->size();
 }
 
 bool PythonEquationContext::empty() const
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
 
     return dict_->empty();
 }
 
 pybind11::dict PythonEquationContext::builtin_dict() const
 {
-    pybind11::gil_scoped_acquire acquire;
+    PythonInterpreterLock lock(interpreter_.get());
 
     pybind11::object builtins = (*dict_)["__builtins__"];
     if (pybind11::isinstance<pybind11::module>(builtins))
@@ -97,21 +156,154 @@ pybind11::dict PythonEquationContext::builtin_dict() const
     }
 }
 
-std::set<std::string> PythonEquationContext::GetBuiltinNames() const
+std::shared_ptr<const std::unordered_set<std::string>> PythonEquationContext::GetBuiltinNames() const
 {
-    if (!builtin_names_cache_.empty())
+    PythonInterpreterLock lock(interpreter_.get());
+
+    pybind11::dict builtins_dict = builtin_dict();
+    Py_ssize_t size = PyDict_Size(builtins_dict.ptr());
+    // the cache keeps its dict alive, so the identity can not be reused
+    if (builtin_names_cache_ && builtins_dict.ptr() == builtin_names_dict_.ptr() && size == builtin_names_size_ &&
+        builtins_version_ == builtin_names_version_)
     {
         return builtin_names_cache_;
     }
 
-    pybind11::gil_scoped_acquire acquire;
-
-    pybind11::dict builtins_dict = builtin_dict();
-    std::set<std::string> names;
-    for (auto key : builtins_dict.attr("keys")())
+    std::shared_ptr<std::unordered_set<std::string>> names = std::make_shared<std::unordered_set<std::string>>();
+    names->reserve(static_cast<size_t>(size));
+    PyObject *key = nullptr;
+    PyObject *value = nullptr;
+    Py_ssize_t position = 0;
+    while (PyDict_Next(builtins_dict.ptr(), &position, &key, &value))
     {
-        names.insert(key.cast<std::string>());
+        if (PyUnicode_Check(key))
+        {
+            names->insert(pybind11::reinterpret_borrow<pybind11::str>(key).cast<std::string>());
+        }
     }
     builtin_names_cache_ = names;
-    return names;
+    builtin_names_dict_ = builtins_dict;
+    builtin_names_size_ = size;
+    builtin_names_version_ = builtins_version_;
+    return builtin_names_cache_;
+}
+
+bool PythonEquationContext::SerializeValue(const std::string &key, std::string &data) const
+{
+    PythonInterpreterLock lock(interpreter_.get());
+
+    if (!dict_->contains(key))
+    {
+        return false;
+    }
+
+    try
+    {
+        if (!dumps_func_)
+        {
+            dumps_func_.reset(new pybind11::object(CreatePickleDumps()));
+        }
+        pybind11::bytes bytes = (*dumps_func_)((*dict_)[key.c_str()]);
+        data = bytes;
+        return true;
+    }
+    catch (const pybind11::error_already_set &)
+    {
+        return false;
+    }
+}
+
+bool PythonEquationContext::DeserializeValue(const std::string &key, const std::string &data)
+{
+    PythonInterpreterLock lock(interpreter_.get());
+
+    try
+    {
+        pybind11::module_ pickle = pybind11::module_::import("pickle");
+        (*dict_)[key.c_str()] = pickle.attr("loads")(pybind11::bytes(data));
+        if (key == "__builtins__")
+        {
+            builtins_version_++;
+        }
+        return true;
+    }
+    catch (const pybind11::error_already_set &)
+    {
+        return false;
+    }
+}
+
+bool PythonEquationContext::GetValueSize(const std::string &key, size_t &size) const
+{
+    PythonInterpreterLock lock(interpreter_.get());
+
+    if (!dict_->contains(key))
+    {
+        return false;
+    }
+
+    try
+    {
+        if (!deep_size_func_)
+        {
+            pybind11::dict scope;
+            pybind11::exec(kDeepSizeCode, scope);
+            deep_size_func_.reset(new pybind11::object(scope["deep_size"]));
+        }
+        size = (*deep_size_func_)((*dict_)[key.c_str()]).cast<size_t>();
+        return true;
+    }
+    catch (const pybind11::error_already_set &)
+    {
+        return false;
+    }
+}
+
+bool PythonEquationContext::SetAllocationTracking(bool enabled)
+{
+    PythonInterpreterLock lock(interpreter_.get());
+
+    try
+    {
+        pybind11::module_ tracemalloc = pybind11::module_::import("tracemalloc");
+        bool tracing = tracemalloc.attr("is_tracing")().cast<bool>();
+        if (enabled && !tracing)
+        {
+            tracemalloc.attr("start")();
+            started_tracing_ = true;
+        }
+        else if (!enabled)
+        {
+            if (tracing && started_tracing_)
+            {
+                tracemalloc.attr("stop")();
+            }
+            started_tracing_ = false;
+        }
+        return true;
+    }
+    catch (const pybind11::error_already_set &)
+    {
+        return false;
+    }
+}
+
+bool PythonEquationContext::GetAllocatedMemory(size_t &bytes) const
+{
+    PythonInterpreterLock lock(interpreter_.get());
+
+    try
+    {
+        pybind11::module_ tracemalloc = pybind11::module_::import("tracemalloc");
+        if (!tracemalloc.attr("is_tracing")().cast<bool>())
+        {
+            return false;
+        }
+        bytes = tracemalloc.attr("get_traced_memory")().cast<pybind11::tuple>()[0].cast<size_t>();
+        return true;
+    }
+    catch (const pybind11::error_already_set &)
+    {
+        return false;
+    }
 }
@@ -1,7 +1,10 @@
 #pragma once
 #include "core/equation_context.h"
 #include "python_common.h"
+#include "python_sub_interpreter.h"
+#include <cstdint>
 #include <memory>
+#include <unordered_set>
 
 namespace xequation
 {
@@ -45,19 +48,56 @@ class PythonEquationContext : public EquationContext
 
     pybind11::dict builtin_dict() const;
 
-    std::set<std::string> GetBuiltinNames() const override;
+    // Rebuilt when the context replaced its builtins, or names were added to
+    // or removed from them, e.g. by code assigning builtins.name, otherwise
+    // the same set is returned.
+    std::shared_ptr<const std::unordered_set<std::string>> GetBuiltinNames() const override;
+
+    // the sub-interpreter owning dict(), null for the main interpreter
+    PythonSubInterpreter *interpreter() const
+    {
+        return interpreter_.get();
+    }
+
+    // Pickles the value, modules by their name. Objects that can not be
+    // pickled (e.g. functions and classes defined by equations) are not
+    // persisted.
+    bool SerializeValue(const std::string &key, std::string &data) const override;
+
+    bool DeserializeValue(const std::string &key, const std::string &data) override;
+
+    // Deep size from sys.getsizeof, containers over 1000 items are sampled.
+    bool GetValueSize(const std::string &key, size_t &size) const override;
+
+    // Uses tracemalloc, which counts the allocations of the whole process and
+    // slows down allocating while enabled. Tracing started by someone else is
+    // used but never stopped.
+    bool SetAllocationTracking(bool enabled) override;
+    bool GetAllocatedMemory(size_t &bytes) const override;
 
   private:
     friend class PythonEquationEngine;
-    PythonEquationContext();
-    ~PythonEquationContext() noexcept = default;
+    explicit PythonEquationContext(std::shared_ptr<PythonSubInterpreter> interpreter = nullptr);
+    ~PythonEquationContext() noexcept;
     PythonEquationContext(const PythonEquationContext &) = delete;
     PythonEquationContext &operator=(const PythonEquationContext &) = delete;
 
     PythonEquationContext(PythonEquationContext &&) noexcept = delete;
     PythonEquationContext &operator=(PythonEquationContext &&) noexcept = delete;
+    std::shared_ptr<PythonSubInterpreter> interpreter_;
     std::unique_ptr<pybind11::dict> dict_;
-    mutable std::set<std::string> builtin_names_cache_;
+    // bumped whenever the context itself changes __builtins__
+    uint64_t builtins_version_ = 0;
+    mutable std::shared_ptr<const std::unordered_set<std::string>> builtin_names_cache_;
+    // the builtins dict the cache was built from, its size and builtins_version_
+    mutable pybind11::object builtin_names_dict_;
+    mutable Py_ssize_t builtin_names_size_ = -1;
+    mutable uint64_t builtin_names_version_ = 0;
+    mutable std::unique_ptr<pybind11::object> deep_size_func_;
+    // see CreatePickleDumps
+    mutable std::unique_ptr<pybind11::object> dumps_func_;
+    // whether SetAllocationTracking() started tracemalloc
+    bool started_tracing_ = false;
 };
 } // namespace python
 } // namespace xequation
\ No newline at end of file
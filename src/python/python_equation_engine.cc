@@ -35,8 +35,14 @@ void PythonEquationEngine::SetPyEnvConfig(const PyEnvConfig &config)
 
 InterpretResult PythonEquationEngine::Interpret(const std::string &code, const EquationContext *context, InterpretMode mode)
 {
-    pybind11::gil_scoped_acquire acquire;
     const PythonEquationContext* py_context = dynamic_cast<const PythonEquationContext*>(context);
+    if (py_context && py_context->interpreter())
+    {
+        // the context dict can only be used by the interpreter it belongs to
+        return py_context->interpreter()->Interpret(code, py_context, mode);
+    }
+
+    pybind11::gil_scoped_acquire acquire;
     if (mode == InterpretMode::kEval)
     {
         return code_executor->Eval(code, py_context ? py_context->dict() : pybind11::dict());
@@ -47,6 +53,57 @@ InterpretResult PythonEquationEngine::Interpret(const std::string &code, const E
     }
 }
 
+std::vector<InterpretResult> PythonEquationEngine::EvalBatch(
+    const std::vector<std::string> &expressions, const EquationContext *context
+)
+{
+    const PythonEquationContext *py_context = dynamic_cast<const PythonEquationContext *>(context);
+    if (py_context && py_context->interpreter())
+    {
+        return py_context->interpreter()->EvalBatch(expressions, py_context);
+    }
+
+    std::vector<InterpretResult> results;
+    results.reserve(expressions.size());
+
+    pybind11::gil_scoped_acquire acquire;
+    pybind11::dict dict = py_context ? py_context->dict() : pybind11::dict();
+    for (const auto &expression : expressions)
+    {
+        results.push_back(code_executor->Eval(expression, dict));
+    }
+    return results;
+}
+
+void PythonEquationEngine::Interrupt()
+{
+    pybind11::gil_scoped_acquire acquire;
+    code_executor->Interrupt();
+}
+
+void PythonEquationEngine::Interrupt(const EquationContext *context)
+{
+    const PythonEquationContext* py_context = dynamic_cast<const PythonEquationContext*>(context);
+    if (!py_context)
+    {
+        return;
+    }
+    if (py_context->interpreter())
+    {
+        py_context->interpreter()->Interrupt();
+        return;
+    }
+
+    pybind11::gil_scoped_acquire acquire;
+    code_executor->Interrupt(py_context->dict());
+}
+
+void PythonEquationEngine::SetExecutionBudget(const ExecutionBudget &budget)
+{
+    execution_budget_ = budget;
+    code_executor->SetExecutionBudget(budget);
+}
+
 ParseResult PythonEquationEngine::Parse(const std::string &code, ParseMode mode)
 {
     pybind11::gil_scoped_acquire acquire;
@@ -64,6 +121,69 @@ std::unique_ptr<EquationContext> PythonEquationEngine::CreateContext()
     return std::unique_ptr<EquationContext>(new PythonEquationContext());
 }
 
+std::unique_ptr<EquationManager> PythonEquationEngine::CreateEquationManager()
+{
+    std::unique_ptr<EquationManager> manager = EquationEngine<PythonEquationEngine>::CreateEquationManager();
+    manager->SetBatchEvalHandler([this](const std::vector<std::string> &expressions, EquationContext *context) {
+        return EvalBatch(expressions, context);
+    });
+    return manager;
+}
+
+std::unique_ptr<EquationManager> PythonEquationEngine::CreateIsolatedEquationManager(bool own_gil)
+{
+    if (!PythonSubInterpreter::IsSupported())
+    {
+        return CreateEquationManager();
+    }
+
+    // shared by the handlers and the context, the interpreter goes away with the last of them
+    std::shared_ptr<PythonSubInterpreter> interpreter = std::make_shared<PythonSubInterpreter>(own_gil);
+    interpreter->SetExecutionBudget(execution_budget_);
+
+    InterpretHandler interpret_handler = [interpreter](const std::string &code, EquationContext *context, InterpretMode mode) -> InterpretResult {
+        return interpreter->Interpret(code, dynamic_cast<const PythonEquationContext *>(context), mode);
+    };
+
+    ParseHandler parse_handler = [interpreter](const std::string &code, ParseMode mode) -> ParseResult {
+        return interpreter->Parse(code, mode);
+    };
+
+    std::unique_ptr<EquationContext> context(new PythonEquationContext(interpreter));
+    std::unique_ptr<EquationManager> manager(
+        new EquationManager(std::move(context), interpret_handler, parse_handler, GetLanguage())
+    );
+    manager->SetInterruptHandler([interpreter]() { interpreter->Interrupt(); });
+    manager->SetBatchEvalHandler([interpreter](const std::vector<std::string> &expressions, EquationContext *context) {
+        return interpreter->EvalBatch(expressions, dynamic_cast<const PythonEquationContext *>(context));
+    });
+    return manager;
+}
+
+std::unique_ptr<EquationManager> PythonEquationEngine::CreateWorkerPoolEquationManager(InterpreterWorkerPool::Options options)
+{
+    if (!options.fallback_handler)
+    {
+        options.fallback_handler = [this](const std::string &code, EquationContext *context, InterpretMode mode) -> InterpretResult {
+            return Interpret(code, context, mode);
+        };
+    }
+    std::shared_ptr<InterpreterWorkerPool> pool = std::make_shared<InterpreterWorkerPool>(options);
+
+    InterpretHandler interpret_handler = [pool](const std::string &code, EquationContext *context, InterpretMode mode) -> InterpretResult {
+        return pool->Interpret(code, context, mode);
+    };
+
+    ParseHandler parse_handler = [this](const std::string &code, ParseMode mode) -> ParseResult {
+        return Parse(code, mode);
+    };
+
+    std::unique_ptr<EquationManager> manager(new EquationManager(CreateContext(), interpret_handler, parse_handler, GetLanguage()));
+    manager->SetInterpretConcurrency(pool->worker_count());
+    manager->SetInterruptHandler([pool]() { pool->Interrupt(); });
+    return manager;
+}
+
 void PythonEquationEngine::InitializePyEnv()
 {
     PyConfig config;
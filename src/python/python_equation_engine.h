@@ -1,10 +1,13 @@
 #pragma once
 #include "core/equation_common.h"
 #include "core/equation_engine.h"
+#include "core/interpreter_worker_pool.h"
 #include "python_executor.h"
 #include "python_parser.h"
+#include "python_sub_interpreter.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 
 namespace xequation
@@ -22,8 +25,36 @@ class PythonEquationEngine : public EquationEngine<PythonEquationEngine>
     static void SetPyEnvConfig(const PyEnvConfig &config);
     InterpretResult Interpret(const std::string &expr, const EquationContext *context = nullptr, InterpretMode mode = InterpretMode::kExec) override;
     ParseResult Parse(const std::string &expr, ParseMode mode = ParseMode::kExpression) override;
+    void Interrupt() override;
+    void Interrupt(const EquationContext *context) override;
+
+    // Evaluates the expressions while holding the lock of the interpreter
+    // the context belongs to once, see EquationManager::EvalBatch.
+    std::vector<InterpretResult> EvalBatch(const std::vector<std::string> &expressions, const EquationContext *context);
+
+    // Limits every equation interpreted in this process, including managers
+    // created by CreateIsolatedEquationManager() afterwards, see
+    // PythonExecutor::SetExecutionBudget. Worker pool managers take their
+    // budget from InterpreterWorkerPool::Options.
+    void SetExecutionBudget(const ExecutionBudget &budget);
 
     std::unique_ptr<EquationContext> CreateContext() override;
+
+    std::unique_ptr<EquationManager> CreateEquationManager() override;
+
+    // Creates a manager whose context, parser and executor live in their own
+    // sub-interpreter, so its values are isolated from other managers. With
+    // own_gil (Python 3.12+) managers are updated in parallel instead of
+    // serializing on one GIL. Falls back to CreateEquationManager() when
+    // sub-interpreters are not supported.
+    std::unique_ptr<EquationManager> CreateIsolatedEquationManager(bool own_gil = true);
+
+    // Creates a manager whose equations are interpreted by a pool of
+    // xequation_python_worker processes (options.worker_path), independent
+    // equations are spread over the workers. The context stays in this
+    // process; code needing values that can not be pickled runs here unless
+    // options.fallback_handler is set otherwise.
+    std::unique_ptr<EquationManager> CreateWorkerPoolEquationManager(InterpreterWorkerPool::Options options);
     std::string GetLanguage() const override { return "Python"; }
   private:
     friend class EquationEngine<PythonEquationEngine>;
@@ -37,6 +68,7 @@ class PythonEquationEngine : public EquationEngine<PythonEquationEngine>
     std::unique_ptr<PythonParser> code_parser = nullptr;
     std::unique_ptr<PythonExecutor> code_executor = nullptr;
     bool manage_python_context_ = false;
+    ExecutionBudget execution_budget_;
 };
 } // namespace python
 } // namespace xequation
\ No newline at end of file
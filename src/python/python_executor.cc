@@ -2,10 +2,134 @@
 #include "core/equation_common.h"
 #include "core/value.h"
 
+#include <algorithm>
+#include <chrono>
+
 namespace xequation
 {
 namespace python
 {
+namespace
+{
+struct TraceState
+{
+    std::atomic<ResultStatus> *abort_status;
+    // the tracer installed before the call (e.g. a debugger), still called
+    Py_tracefunc previous_func;
+    PyObject *previous_obj;
+};
+
+// Line trace of calls with a budget, obj points to the TraceState of the
+// call. Raises again on every line once aborted, so except clauses in the
+// code can not swallow it.
+int AbortTrace(PyObject *obj, PyFrameObject *frame, int what, PyObject *arg)
+{
+    auto *state = static_cast<TraceState *>(PyCapsule_GetPointer(obj, nullptr));
+    if (state->previous_func && state->previous_func(state->previous_obj, frame, what, arg) != 0)
+    {
+        return -1;
+    }
+    if (what != PyTrace_LINE && what != PyTrace_CALL)
+    {
+        return 0;
+    }
+    ResultStatus status = state->abort_status->load();
+    if (status == ResultStatus::kSuccess)
+    {
+        return 0;
+    }
+    PyErr_SetString(status == ResultStatus::kTimeout ? PyExc_TimeoutError : PyExc_KeyboardInterrupt, "Execution aborted");
+    return -1;
+}
+} // namespace
+
+struct PythonExecutor::RunningCall
+{
+    unsigned long thread_id = 0;
+    // the local dict the call runs in, borrowed and only compared
+    PyObject *scope = nullptr;
+    uint32_t wall_time_ms = 0;
+    // set by the watchdog or Interrupt()
+    std::atomic<ResultStatus> abort_status{ResultStatus::kSuccess};
+    // interrupted through AbortTrace instead of an async exception
+    bool traced = false;
+    // a KeyboardInterrupt scheduled by Interrupt() that may not have fired yet
+    bool async_exc_pending = false;
+};
+
+// Registers an Exec / Eval call for the time it runs and arms its budget,
+// constructed and destroyed with the GIL held.
+class PythonExecutor::CallScope
+{
+  public:
+    CallScope(PythonExecutor &executor, const pybind11::dict &local_dict)
+        : executor_(executor), call_(std::make_shared<RunningCall>())
+    {
+        call_->thread_id = PyThread_get_thread_ident();
+        call_->scope = local_dict.ptr();
+        {
+            std::lock_guard<std::mutex> lock(executor_.call_mutex_);
+            call_->wall_time_ms = executor_.budget_.wall_time_ms;
+            call_->traced = call_->wall_time_ms > 0;
+            executor_.running_calls_.push_back(call_);
+        }
+        if (!call_->traced)
+        {
+            return;
+        }
+
+        // a tracer already installed keeps running and gets its place back afterwards
+        PyThreadState *thread_state = PyThreadState_Get();
+        trace_state_.abort_status = &call_->abort_status;
+        trace_state_.previous_func = thread_state->c_tracefunc;
+        trace_state_.previous_obj = thread_state->c_traceobj;
+        Py_XINCREF(trace_state_.previous_obj);
+
+        PyObject *capsule = PyCapsule_New(&trace_state_, nullptr, nullptr);
+        PyEval_SetTrace(AbortTrace, capsule);
+        Py_XDECREF(capsule);
+
+        // the callback may run after the call ended, it only touches its own state
+        std::shared_ptr<RunningCall> call = call_;
+        timer_ = executor_.watchdog_.Arm(std::chrono::milliseconds(call_->wall_time_ms), [call]() {
+            ResultStatus expected = ResultStatus::kSuccess;
+            call->abort_status.compare_exchange_strong(expected, ResultStatus::kTimeout);
+        });
+    }
+
+    ~CallScope()
+    {
+        if (call_->traced)
+        {
+            executor_.watchdog_.Disarm(timer_);
+            PyEval_SetTrace(trace_state_.previous_func, trace_state_.previous_obj);
+            Py_XDECREF(trace_state_.previous_obj);
+        }
+
+        std::lock_guard<std::mutex> lock(executor_.call_mutex_);
+        auto &calls = executor_.running_calls_;
+        calls.erase(std::remove(calls.begin(), calls.end(), call_), calls.end());
+        if (call_->async_exc_pending)
+        {
+            // must not hit whatever this thread runs next
+            PyThreadState_SetAsyncExc(call_->thread_id, nullptr);
+        }
+    }
+
+    CallScope(const CallScope &) = delete;
+    CallScope &operator=(const CallScope &) = delete;
+
+    const RunningCall &call() const
+    {
+        return *call_;
+    }
+
+  private:
+    PythonExecutor &executor_;
+    std::shared_ptr<RunningCall> call_;
+    uint64_t timer_ = 0;
+    TraceState trace_state_ = {nullptr, nullptr, nullptr};
+};
 
 PythonExecutor::PythonExecutor()
 {
@@ -15,12 +139,100 @@ PythonExecutor::~PythonExecutor()
 {
 }
 
+pybind11::object PythonExecutor::CompileExpression(const std::string &expression)
+{
+    auto cached_code = compiled_expression_cache_.get(expression);
+    if (cached_code)
+    {
+        return *cached_code;
+    }
+
+    pybind11::object code = pybind11::reinterpret_steal<pybind11::object>(
+        Py_CompileString(expression.c_str(), "<string>", Py_eval_input)
+    );
+    if (!code)
+    {
+        throw pybind11::error_already_set();
+    }
+    compiled_expression_cache_.insert(expression, code);
+    return code;
+}
+
+void PythonExecutor::SetExecutionBudget(const ExecutionBudget &budget)
+{
+    std::lock_guard<std::mutex> lock(call_mutex_);
+    budget_ = budget;
+}
+
+ExecutionBudget PythonExecutor::execution_budget() const
+{
+    std::lock_guard<std::mutex> lock(call_mutex_);
+    return budget_;
+}
+
+void PythonExecutor::Interrupt()
+{
+    InterruptCalls(nullptr);
+}
+
+void PythonExecutor::Interrupt(const pybind11::dict &local_dict)
+{
+    InterruptCalls(local_dict.ptr());
+}
+
+void PythonExecutor::InterruptCalls(PyObject *scope)
+{
+    std::lock_guard<std::mutex> lock(call_mutex_);
+    for (const auto &call : running_calls_)
+    {
+        if (scope && call->scope != scope)
+        {
+            continue;
+        }
+        ResultStatus expected = ResultStatus::kSuccess;
+        if (!call->abort_status.compare_exchange_strong(expected, ResultStatus::kKeyBoardInterrupt) || call->traced)
+        {
+            continue;
+        }
+        // raised at the next bytecode the thread runs, the call scope
+        // withdraws it if the call ends first
+        PyThreadState_SetAsyncExc(call->thread_id, PyExc_KeyboardInterrupt);
+        call->async_exc_pending = true;
+    }
+}
+
+void PythonExecutor::HandleError(const pybind11::error_already_set &e, const RunningCall &call, InterpretResult &res)
+{
+    ResultStatus abort_status = call.abort_status.load();
+    if (abort_status == ResultStatus::kTimeout)
+    {
+        res.status = ResultStatus::kTimeout;
+        res.message = "Execution exceeded the time budget of " + std::to_string(call.wall_time_ms) + " ms";
+        return;
+    }
+    if (abort_status == ResultStatus::kKeyBoardInterrupt)
+    {
+        res.status = ResultStatus::kKeyBoardInterrupt;
+        res.message = "Execution was interrupted";
+        return;
+    }
+    res.status = MapPythonExceptionToStatus(e);
+    res.error = CaptureErrorRecord(e);
+    res.message = res.error->message;
+}
+
 InterpretResult PythonExecutor::Exec(const std::string &code_string, const pybind11::dict &local_dict)
 {
     pybind11::gil_scoped_acquire acquire;
 
     InterpretResult res;
     res.mode = InterpretMode::kExec;
+    if (arithmetic_fast_path_enabled_ && arithmetic_fast_path_.TryExec(code_string, local_dict, res))
+    {
+        return res;
+    }
+
+    CallScope scope(*this, local_dict);
     try
     {
         pybind11::exec(code_string.c_str(), local_dict);
@@ -28,12 +240,7 @@ InterpretResult PythonExecutor::Exec(const std::string &code_string, const pybin
     }
     catch (const pybind11::error_already_set &e)
     {
-        ResultStatus status = MapPythonExceptionToStatus(e);
-        res.status = status;
-        pybind11::object pv = e.value();
-        pybind11::object str_func = pybind11::module_::import("builtins").attr("str");
-        std::string error_msg = str_func(pv).cast<std::string>();
-        res.message = error_msg;
+        HandleError(e, scope.call(), res);
     }
     return res;
 }
@@ -44,23 +251,29 @@ InterpretResult PythonExecutor::Eval(const std::string &expression, const pybind
 
     InterpretResult res;
     res.mode = InterpretMode::kEval;
+    CallScope scope(*this, local_dict);
     try
     {
-        // store python thread state
-
-        pybind11::object result = pybind11::eval(expression.c_str(), local_dict);
+        if (!local_dict.contains("__builtins__"))
+        {
+            // the builtins of the running interpreter, borrowed, no import per call
+            local_dict["__builtins__"] = pybind11::reinterpret_borrow<pybind11::object>(PyEval_GetBuiltins());
+        }
+        pybind11::object code = CompileExpression(expression);
+        pybind11::object result = pybind11::reinterpret_steal<pybind11::object>(
+            PyEval_EvalCode(code.ptr(), local_dict.ptr(), local_dict.ptr())
+        );
+        if (!result)
+        {
+            throw pybind11::error_already_set();
+        }
         res.value = result;
         res.status = ResultStatus::kSuccess;
     }
     catch (const pybind11::error_already_set &e)
     {
-        ResultStatus status = MapPythonExceptionToStatus(e);
         res.value = Value::Null();
-        res.status = status;
-        pybind11::object pv = e.value();
-        pybind11::object str_func = pybind11::module_::import("builtins").attr("str");
-        std::string error_msg = str_func(pv).cast<std::string>();
-        res.message = error_msg;
+        HandleError(e, scope.call(), res);
     }
     return res;
 }
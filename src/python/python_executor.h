@@ -1,9 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+#include <boost/compute/detail/lru_cache.hpp>
 
+#include "python_arithmetic_fast_path.h"
 #include "python_common.h"
 #include "core/equation_common.h"
+#include "core/execution_watchdog.h"
 
 namespace xequation
 {
@@ -22,7 +29,51 @@ class PythonExecutor {
   InterpretResult Exec(const std::string& code_string, const pybind11::dict& local_dict = pybind11::dict());
   
   // Evaluates Python expression in the given local dictionary.
+  // The compiled code object is cached, so re-evaluating the same expression skips compilation.
   InterpretResult Eval(const std::string& expression, const pybind11::dict& local_dict = pybind11::dict());
+
+  size_t GetCompiledExpressionCacheSize() const { return compiled_expression_cache_.size(); }
+
+  // Exec runs plain arithmetic on numbers through PythonArithmeticFastPath
+  // instead of the interpreter, enabled by default.
+  void SetArithmeticFastPathEnabled(bool enabled) { arithmetic_fast_path_enabled_ = enabled; }
+  size_t GetArithmeticFastPathCacheSize() const { return arithmetic_fast_path_.GetCompiledProgramCacheSize(); }
+
+  // Every Exec / Eval call is limited to budget.wall_time_ms and ends with
+  // ResultStatus::kTimeout beyond it. Calls are stopped between two lines of
+  // Python code, code blocked in an extension module or in time.sleep runs
+  // until it returns; run such code in an InterpreterWorkerPool, which also
+  // enforces budget.memory_bytes. The memory limit is ignored here.
+  void SetExecutionBudget(const ExecutionBudget& budget);
+  ExecutionBudget execution_budget() const;
+
+  // Ends the running Exec / Eval calls with ResultStatus::kKeyBoardInterrupt.
+  // The caller holds the GIL of the interpreter this executor runs in.
+  void Interrupt();
+
+  // Like Interrupt(), but only ends the calls running in local_dict, the
+  // calls of other contexts go on.
+  void Interrupt(const pybind11::dict& local_dict);
+
+ private:
+  struct RunningCall;
+  class CallScope;
+
+  pybind11::object CompileExpression(const std::string& expression);
+  // all running calls for a null scope
+  void InterruptCalls(PyObject* scope);
+  void HandleError(const pybind11::error_already_set& e, const RunningCall& call, InterpretResult& res);
+
+ private:
+  static constexpr size_t max_cache_size_ = 256;
+  boost::compute::detail::lru_cache<std::string, pybind11::object> compiled_expression_cache_{max_cache_size_};
+  PythonArithmeticFastPath arithmetic_fast_path_;
+  bool arithmetic_fast_path_enabled_ = true;
+
+  mutable std::mutex call_mutex_;
+  ExecutionBudget budget_;
+  std::vector<std::shared_ptr<RunningCall>> running_calls_;
+  ExecutionWatchdog watchdog_;
 };
 } // namespace python
 } // namespace xequation
\ No newline at end of file
@@ -45,9 +45,7 @@ std::vector<std::string> PythonParser::SplitStatements(const std::string &code)
     }
     catch (const pybind11::error_already_set &e)
     {
-        pybind11::object pv = e.value();
-        pybind11::object str_func = pybind11::module_::import("builtins").attr("str");
-        std::string error_msg = str_func(pv).cast<std::string>();
+        std::string error_msg = PythonExceptionMessage(e);
         throw ParseException(error_msg);
     }
 }
@@ -69,9 +67,7 @@ ParseResult PythonParser::ParseStatements(const std::string &code)
     }
     catch (const pybind11::error_already_set &e)
     {
-        pybind11::object pv = e.value();
-        pybind11::object str_func = pybind11::module_::import("builtins").attr("str");
-        std::string error_msg = str_func(pv).cast<std::string>();
+        std::string error_msg = PythonExceptionMessage(e);
         throw ParseException(error_msg);
     }
 }
@@ -119,9 +115,7 @@ ParseResult PythonParser::ParseSingleStatement(const std::string &code)
     }
     catch (const pybind11::error_already_set &e)
     {
-        pybind11::object pv = e.value();
-        pybind11::object str_func = pybind11::module_::import("builtins").attr("str");
-        std::string error_msg = str_func(pv).cast<std::string>();
+        std::string error_msg = PythonExceptionMessage(e);
         throw ParseException(error_msg);
     }
 }
@@ -149,9 +143,7 @@ ParseResult PythonParser::ParseExpression(const std::string &code)
     }
     catch (const pybind11::error_already_set &e)
     {
-        pybind11::object pv = e.value();
-        pybind11::object str_func = pybind11::module_::import("builtins").attr("str");
-        std::string error_msg = str_func(pv).cast<std::string>();
+        std::string error_msg = PythonExceptionMessage(e);
         ParseResult parse_result;
         parse_result.mode = ParseMode::kExpression;
         ParseResultItem parse_item;
@@ -0,0 +1,148 @@
+#include "python_sub_interpreter.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "python_equation_context.h"
+#include "python_executor.h"
+#include "python_parser.h"
+
+namespace xequation
+{
+namespace python
+{
+namespace
+{
+#if defined(PYBIND11_HAS_SUBINTERPRETER_SUPPORT)
+pybind11::subinterpreter CreateInterpreter(bool own_gil)
+{
+    PyInterpreterConfig config;
+    std::memset(&config, 0, sizeof(config));
+    config.allow_threads = 1;
+    if (own_gil)
+    {
+        // a per-interpreter GIL requires an isolated allocator and
+        // extension modules supporting multiple interpreters
+        config.use_main_obmalloc = 0;
+        config.check_multi_interp_extensions = 1;
+        config.gil = PyInterpreterConfig_OWN_GIL;
+    }
+    else
+    {
+        config.use_main_obmalloc = 1;
+        config.check_multi_interp_extensions = 0;
+        config.gil = PyInterpreterConfig_SHARED_GIL;
+    }
+    return pybind11::subinterpreter::create(config);
+}
+#endif
+} // namespace
+
+#if defined(PYBIND11_HAS_SUBINTERPRETER_SUPPORT)
+PythonSubInterpreter::PythonSubInterpreter(bool own_gil) : own_gil_(own_gil), interpreter_(CreateInterpreter(own_gil))
+{
+    PythonInterpreterLock lock(this);
+    parser_.reset(new PythonParser());
+    executor_.reset(new PythonExecutor());
+}
+#else
+PythonSubInterpreter::PythonSubInterpreter(bool own_gil) : own_gil_(own_gil)
+{
+    throw std::runtime_error("Python sub-interpreters are not supported by this build");
+}
+#endif
+
+PythonSubInterpreter::~PythonSubInterpreter()
+{
+    // the parser and executor hold objects of this interpreter
+    PythonInterpreterLock lock(this);
+    parser_.reset();
+    executor_.reset();
+}
+
+bool PythonSubInterpreter::IsSupported()
+{
+#if defined(PYBIND11_HAS_SUBINTERPRETER_SUPPORT)
+    return true;
+#else
+    return false;
+#endif
+}
+
+InterpretResult
+PythonSubInterpreter::Interpret(const std::string &code, const PythonEquationContext *context, InterpretMode mode)
+{
+    PythonInterpreterLock lock(this);
+    if (mode == InterpretMode::kEval)
+    {
+        return executor_->Eval(code, context ? context->dict() : pybind11::dict());
+    }
+    else
+    {
+        return executor_->Exec(code, context ? context->dict() : pybind11::dict());
+    }
+}
+
+std::vector<InterpretResult>
+PythonSubInterpreter::EvalBatch(const std::vector<std::string> &expressions, const PythonEquationContext *context)
+{
+    std::vector<InterpretResult> results;
+    results.reserve(expressions.size());
+
+    PythonInterpreterLock lock(this);
+    pybind11::dict dict = context ? context->dict() : pybind11::dict();
+    for (const auto &expression : expressions)
+    {
+        results.push_back(executor_->Eval(expression, dict));
+    }
+    return results;
+}
+
+void PythonSubInterpreter::SetExecutionBudget(const ExecutionBudget &budget)
+{
+    executor_->SetExecutionBudget(budget);
+}
+
+void PythonSubInterpreter::Interrupt()
+{
+    PythonInterpreterLock lock(this);
+    executor_->Interrupt();
+}
+
+ParseResult PythonSubInterpreter::Parse(const std::string &code, ParseMode mode)
+{
+    PythonInterpreterLock lock(this);
+    if (mode == ParseMode::kExpression)
+    {
+        return parser_->ParseExpression(code);
+    }
+    else
+    {
+        return parser_->ParseStatements(code);
+    }
+}
+
+#if defined(PYBIND11_HAS_SUBINTERPRETER_SUPPORT)
+PythonInterpreterLock::PythonInterpreterLock(const PythonSubInterpreter *interpreter) : activate_(Activate(interpreter))
+{
+}
+
+std::unique_ptr<pybind11::subinterpreter_scoped_activate>
+PythonInterpreterLock::Activate(const PythonSubInterpreter *interpreter)
+{
+    if (!interpreter)
+    {
+        return nullptr;
+    }
+    // once the sub-interpreter is active, acquire_ only holds its GIL
+    return std::unique_ptr<pybind11::subinterpreter_scoped_activate>(
+        new pybind11::subinterpreter_scoped_activate(interpreter->interpreter_)
+    );
+}
+#else
+PythonInterpreterLock::PythonInterpreterLock(const PythonSubInterpreter *)
+{
+}
+#endif
+} // namespace python
+} // namespace xequation
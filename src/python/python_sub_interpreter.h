@@ -0,0 +1,89 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/equation_common.h"
+#include "python_common.h"
+
+#if defined(PYBIND11_HAS_SUBINTERPRETER_SUPPORT)
+#include <pybind11/subinterpreter.h>
+#endif
+
+namespace xequation
+{
+namespace python
+{
+class PythonExecutor;
+class PythonParser;
+class PythonEquationContext;
+
+// A Python sub-interpreter with its own parser and executor.
+//
+// With own_gil (Python 3.12+) the interpreter does not share the GIL with
+// the main interpreter or other sub-interpreters, so equation managers backed
+// by different sub-interpreters evaluate in parallel. Extension modules that
+// do not support per-interpreter GIL can not be imported in such an
+// interpreter; use a shared GIL for them.
+//
+// Python objects must never cross interpreters, and objects of this
+// interpreter may only be touched while a PythonInterpreterLock on it is held.
+class PythonSubInterpreter
+{
+  public:
+    explicit PythonSubInterpreter(bool own_gil = true);
+    ~PythonSubInterpreter();
+
+    PythonSubInterpreter(const PythonSubInterpreter &) = delete;
+    PythonSubInterpreter &operator=(const PythonSubInterpreter &) = delete;
+
+    // Requires pybind11 built with sub-interpreter support, i.e. pybind11 3
+    // and Python 3.12 or later.
+    static bool IsSupported();
+
+    InterpretResult Interpret(const std::string &code, const PythonEquationContext *context, InterpretMode mode);
+    // evaluates the expressions under one lock of this interpreter
+    std::vector<InterpretResult> EvalBatch(const std::vector<std::string> &expressions, const PythonEquationContext *context);
+    ParseResult Parse(const std::string &code, ParseMode mode);
+
+    // see PythonExecutor::SetExecutionBudget / Interrupt
+    void SetExecutionBudget(const ExecutionBudget &budget);
+    void Interrupt();
+
+    bool own_gil() const
+    {
+        return own_gil_;
+    }
+
+  private:
+    friend class PythonInterpreterLock;
+
+    bool own_gil_;
+#if defined(PYBIND11_HAS_SUBINTERPRETER_SUPPORT)
+    pybind11::subinterpreter interpreter_;
+#endif
+    std::unique_ptr<PythonParser> parser_;
+    std::unique_ptr<PythonExecutor> executor_;
+};
+
+// Makes the given sub-interpreter current on this thread and holds its GIL,
+// falls back to the GIL of the main interpreter when interpreter is null.
+class PythonInterpreterLock
+{
+  public:
+    explicit PythonInterpreterLock(const PythonSubInterpreter *interpreter);
+    ~PythonInterpreterLock() = default;
+
+    PythonInterpreterLock(const PythonInterpreterLock &) = delete;
+    PythonInterpreterLock &operator=(const PythonInterpreterLock &) = delete;
+
+  private:
+#if defined(PYBIND11_HAS_SUBINTERPRETER_SUPPORT)
+    static std::unique_ptr<pybind11::subinterpreter_scoped_activate> Activate(const PythonSubInterpreter *interpreter);
+
+    std::unique_ptr<pybind11::subinterpreter_scoped_activate> activate_;
+#endif
+    pybind11::gil_scoped_acquire acquire_;
+};
+} // namespace python
+} // namespace xequation
@@ -0,0 +1,296 @@
+// Interpreter worker process for InterpreterWorkerPool.
+//
+// Speaks WorkerProtocol over stdin / stdout. Every request runs in a fresh
+// namespace whose missing names are fetched from the host, names bound by the
+// code are sent back pickled, modules by name. A value only the host has
+// aborts the request, the host runs the code itself. stdout is redirected to
+// stderr so that output of user code can not corrupt the protocol.
+//
+// usage: xequation_python_worker [--home <python home>] [--path <module path>]...
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "core/interpreter_worker_protocol.h"
+#include "python_common.h"
+#include "python_equation_engine.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+using namespace xequation;
+using namespace xequation::python;
+
+namespace
+{
+const char kWorkerNamespaceCode[] = R"(
+# a BaseException, so that except Exception in user code does not swallow it
+class HostValueRequired(BaseException):
+    pass
+
+class WorkerNamespace(dict):
+    def __init__(self, fetch, builtins):
+        super().__init__()
+        self._fetch = fetch
+        self._builtins = builtins
+        self._missing = set()
+        self.assigned = []
+
+    def __missing__(self, key):
+        # names are looked up in locals and globals, which are both this dict
+        if key in self._missing or key in self._builtins:
+            raise KeyError(key)
+        found, value, host_only = self._fetch(key)
+        if host_only:
+            raise HostValueRequired(key)
+        if not found:
+            self._missing.add(key)
+            raise KeyError(key)
+        dict.__setitem__(self, key, value)
+        return value
+
+    def __setitem__(self, key, value):
+        if key not in self.assigned:
+            self.assigned.append(key)
+        dict.__setitem__(self, key, value)
+)";
+
+class WorkerChannel
+{
+  public:
+    WorkerChannel(std::FILE *input, std::FILE *output) : input_(input), output_(output) {}
+
+    bool Read(WorkerMessageType &type, std::string &payload)
+    {
+        return WorkerProtocol::ReadMessage(
+            [this](char *data, size_t size) { return std::fread(data, 1, size, input_) == size; }, type, payload
+        );
+    }
+
+    bool Write(WorkerMessageType type, const std::string &payload)
+    {
+        return WorkerProtocol::WriteMessage(
+                   [this](const char *data, size_t size) { return std::fwrite(data, 1, size, output_) == size; }, type,
+                   payload
+               ) &&
+               std::fflush(output_) == 0;
+    }
+
+  private:
+    std::FILE *input_;
+    std::FILE *output_;
+};
+
+// Caps the address space of the worker at its current size plus limit while
+// alive, allocations beyond it raise MemoryError. Only supported on Linux, the
+// limit is ignored elsewhere.
+class ScopedMemoryLimit
+{
+  public:
+    explicit ScopedMemoryLimit(uint64_t limit)
+    {
+#ifdef __linux__
+        if (limit == 0 || getrlimit(RLIMIT_AS, &previous_) != 0)
+        {
+            return;
+        }
+        unsigned long long vm_pages = 0;
+        std::FILE *statm = std::fopen("/proc/self/statm", "r");
+        if (!statm)
+        {
+            return;
+        }
+        bool read = std::fscanf(statm, "%llu", &vm_pages) == 1;
+        std::fclose(statm);
+        if (!read)
+        {
+            return;
+        }
+        rlimit capped = previous_;
+        capped.rlim_cur = static_cast<rlim_t>(vm_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) + limit);
+        if (previous_.rlim_max != RLIM_INFINITY && capped.rlim_cur > previous_.rlim_max)
+        {
+            capped.rlim_cur = previous_.rlim_max;
+        }
+        active_ = setrlimit(RLIMIT_AS, &capped) == 0;
+#else
+        (void)limit;
+#endif
+    }
+
+    ~ScopedMemoryLimit()
+    {
+#ifdef __linux__
+        if (active_)
+        {
+            setrlimit(RLIMIT_AS, &previous_);
+        }
+#endif
+    }
+
+    ScopedMemoryLimit(const ScopedMemoryLimit &) = delete;
+    ScopedMemoryLimit &operator=(const ScopedMemoryLimit &) = delete;
+
+  private:
+#ifdef __linux__
+    rlimit previous_;
+    bool active_ = false;
+#endif
+};
+
+WorkerInterpretResponse Interpret(
+    WorkerChannel &channel, const WorkerInterpretRequest &request, const pybind11::object &dumps
+)
+{
+    pybind11::module_ builtins = pybind11::module_::import("builtins");
+    pybind11::module_ pickle = pybind11::module_::import("pickle");
+    pybind11::module_ main = pybind11::module_::import("__main__");
+
+    pybind11::cpp_function fetch([&channel, &pickle](const std::string &name) -> pybind11::tuple {
+        WorkerMessageType type;
+        std::string payload;
+        WorkerFetchResponse response;
+        if (!channel.Write(WorkerMessageType::kFetchRequest, WorkerProtocol::Encode(WorkerFetchRequest{name})) ||
+            !channel.Read(type, payload) || type != WorkerMessageType::kFetchResponse ||
+            !WorkerProtocol::Decode(payload, response))
+        {
+            throw std::runtime_error("Interpreter worker lost the connection to the host");
+        }
+        if (!response.found)
+        {
+            return pybind11::make_tuple(false, pybind11::none(), response.host_only);
+        }
+        return pybind11::make_tuple(true, pickle.attr("loads")(pybind11::bytes(response.data)), false);
+    });
+
+    pybind11::object namespace_class = main.attr("WorkerNamespace");
+    pybind11::object scope = namespace_class(fetch, builtins.attr("__dict__"));
+    pybind11::dict scope_dict = scope.cast<pybind11::dict>();
+    PyDict_SetItemString(scope_dict.ptr(), "__builtins__", builtins.ptr());
+
+    WorkerInterpretResponse response;
+    response.status = ResultStatus::kSuccess;
+    response.has_value = false;
+    try
+    {
+        ScopedMemoryLimit memory_limit(request.memory_limit);
+        if (request.mode == InterpretMode::kEval)
+        {
+            pybind11::object value = pybind11::eval(request.code, scope_dict, scope_dict);
+            try
+            {
+                response.value_data = dumps(value).cast<std::string>();
+                response.has_value = true;
+            }
+            catch (const pybind11::error_already_set &)
+            {
+                // the host evaluates it again itself
+            }
+        }
+        else
+        {
+            pybind11::exec(request.code, scope_dict, scope_dict);
+        }
+    }
+    catch (const pybind11::error_already_set &e)
+    {
+        if (e.matches(main.attr("HostValueRequired")))
+        {
+            // nothing is sent back, the host runs the code again
+            response.status = ResultStatus::kUnknownError;
+            response.message = "Value only available in the host";
+            return response;
+        }
+        response.status = MapPythonExceptionToStatus(e);
+        response.message = PythonExceptionMessage(e);
+    }
+
+    // names bound before an error are reported as well, like in-process execution
+    for (auto item : scope.attr("assigned"))
+    {
+        std::string name = item.cast<std::string>();
+        try
+        {
+            std::string data = dumps(scope_dict[name.c_str()]).cast<std::string>();
+            response.bindings.emplace_back(name, std::move(data));
+        }
+        catch (const pybind11::error_already_set &)
+        {
+            response.unserializable_names.push_back(name);
+        }
+    }
+    return response;
+}
+
+PythonEquationEngine::PyEnvConfig ParseArguments(int argc, char **argv)
+{
+    PythonEquationEngine::PyEnvConfig config;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--home") == 0)
+        {
+            config.py_home = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--path") == 0)
+        {
+            config.lib_path_list.push_back(argv[i + 1]);
+        }
+    }
+    return config;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    // keep the real stdout for the protocol, anything else printing goes to stderr
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    int protocol_fd = _dup(_fileno(stdout));
+    _dup2(_fileno(stderr), _fileno(stdout));
+    std::FILE *protocol_output = _fdopen(protocol_fd, "wb");
+#else
+    int protocol_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    std::FILE *protocol_output = fdopen(protocol_fd, "wb");
+#endif
+    if (!protocol_output)
+    {
+        return 1;
+    }
+    WorkerChannel channel(stdin, protocol_output);
+
+    PythonEquationEngine::SetPyEnvConfig(ParseArguments(argc, argv));
+    PythonEquationEngine::GetInstance();
+
+    pybind11::gil_scoped_acquire acquire;
+    pybind11::exec(kWorkerNamespaceCode);
+    pybind11::object dumps = CreatePickleDumps();
+
+    WorkerMessageType type;
+    std::string payload;
+    while (channel.Read(type, payload))
+    {
+        if (type == WorkerMessageType::kShutdown)
+        {
+            return 0;
+        }
+
+        WorkerInterpretRequest request;
+        if (type != WorkerMessageType::kInterpretRequest || !WorkerProtocol::Decode(payload, request))
+        {
+            return 1;
+        }
+        WorkerInterpretResponse response = Interpret(channel, request, dumps);
+        if (!channel.Write(WorkerMessageType::kInterpretResponse, WorkerProtocol::Encode(response)))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
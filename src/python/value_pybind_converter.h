@@ -15,9 +15,15 @@ namespace xequation
 {
 namespace value_convert
 {
-inline std::vector<PyGILState_STATE> &gil_state_stack()
+struct GilState
 {
-    static thread_local std::vector<PyGILState_STATE> stack;
+    bool ensured;
+    PyGILState_STATE state;
+};
+
+inline std::vector<GilState> &gil_state_stack()
+{
+    static thread_local std::vector<GilState> stack;
     return stack;
 }
 
@@ -25,7 +31,17 @@ inline void acquire_gil()
 {
     if (Py_IsInitialized())
     {
-        gil_state_stack().push_back(PyGILState_Ensure());
+        // A thread already attached to an interpreter keeps it: PyGILState
+        // only knows the main interpreter and would switch away from an
+        // active sub-interpreter.
+        if (pybind11::detail::get_thread_state_unchecked() != nullptr)
+        {
+            gil_state_stack().push_back(GilState{false, PyGILState_LOCKED});
+        }
+        else
+        {
+            gil_state_stack().push_back(GilState{true, PyGILState_Ensure()});
+        }
     }
 }
 
@@ -34,9 +50,12 @@ inline void release_gil()
     auto &stack = gil_state_stack();
     if (!stack.empty() && Py_IsInitialized())
     {
-        PyGILState_STATE st = stack.back();
+        GilState st = stack.back();
         stack.pop_back();
-        PyGILState_Release(st);
+        if (st.ensured)
+        {
+            PyGILState_Release(st.state);
+        }
     }
 }
 
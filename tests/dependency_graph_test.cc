@@ -1,5 +1,9 @@
 #include "core/dependency_graph.h"
+#include "core/dependency_graph_layout.h"
+#include "core/dependency_graph_exporter.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <string>
 
@@ -164,6 +168,31 @@ TEST(DependencyGraphTest, TopologicalSort) {
   EXPECT_GT(b_pos, c_pos);
 }
 
+// Test topological sorting of the upstream closure
+TEST(DependencyGraphTest, TopologicalSortDependencies) {
+  DependencyGraph graph;
+
+  graph.AddNodes({"A", "B", "C", "D", "E"});
+
+  // A -> B -> C, A -> D, E -> A
+  graph.AddEdges({{"A", "B"}, {"B", "C"}, {"A", "D"}, {"E", "A"}});
+
+  auto sorted = graph.TopologicalSortDependencies({"B"});
+  ASSERT_EQ(sorted, std::vector<std::string>({"C", "B"}));
+
+  sorted = graph.TopologicalSortDependencies({"A", "B", "X"});
+  ASSERT_EQ(sorted.size(), 4);
+  auto pos = [&sorted](const std::string &node) {
+    return std::find(sorted.begin(), sorted.end(), node) - sorted.begin();
+  };
+  EXPECT_GT(pos("A"), pos("B"));
+  EXPECT_GT(pos("B"), pos("C"));
+  EXPECT_GT(pos("A"), pos("D"));
+  EXPECT_EQ(std::find(sorted.begin(), sorted.end(), "E"), sorted.end());
+
+  EXPECT_TRUE(graph.TopologicalSortDependencies({}).empty());
+}
+
 TEST(DependencyGraphTest, CycleDetection) {
   DependencyGraph graph;
   
@@ -742,6 +771,175 @@ TEST(DependencyGraphTest, Reset) {
   EXPECT_TRUE(graph.GetAllEdges().first == graph.GetAllEdges().second);
 }
 
+// Test k-hop neighborhood and subgraph extraction
+TEST(DependencyGraphTest, NeighborhoodAndSubgraph) {
+  DependencyGraph graph;
+
+  // chain A <- B <- C <- D <- E, plus X depending on C
+  graph.AddNodes({"A", "B", "C", "D", "E", "X"});
+  graph.AddEdges({
+    {"B", "A"},
+    {"C", "B"},
+    {"D", "C"},
+    {"E", "D"},
+    {"X", "C"}
+  });
+
+  auto sorted_neighborhood = [&graph](int upstream_hops, int downstream_hops) {
+    auto nodes = graph.GetNeighborhood({"C"}, upstream_hops, downstream_hops);
+    EXPECT_EQ(nodes.front(), "C");
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+  };
+
+  EXPECT_EQ(sorted_neighborhood(0, 0), std::vector<std::string>({"C"}));
+  EXPECT_EQ(sorted_neighborhood(1, 0), std::vector<std::string>({"B", "C"}));
+  EXPECT_EQ(sorted_neighborhood(1, 1), std::vector<std::string>({"B", "C", "D", "X"}));
+  EXPECT_EQ(sorted_neighborhood(-1, 0), std::vector<std::string>({"A", "B", "C"}));
+  EXPECT_EQ(sorted_neighborhood(0, -1), std::vector<std::string>({"C", "D", "E", "X"}));
+
+  // unknown nodes are ignored
+  EXPECT_TRUE(graph.GetNeighborhood({"Y"}, -1, -1).empty());
+
+  auto subgraph = graph.ExtractSubgraph({"B", "C", "D", "Y"});
+  EXPECT_TRUE(subgraph->IsNodeExist("B"));
+  EXPECT_TRUE(subgraph->IsNodeExist("D"));
+  EXPECT_FALSE(subgraph->IsNodeExist("A"));
+  EXPECT_FALSE(subgraph->IsNodeExist("Y"));
+  EXPECT_TRUE(subgraph->IsEdgeExist({"C", "B"}));
+  EXPECT_TRUE(subgraph->IsEdgeExist({"D", "C"}));
+  EXPECT_FALSE(subgraph->IsEdgeExist({"B", "A"}));
+  EXPECT_EQ(subgraph->GetNode("B")->dependencies().size(), 0);
+}
+
+// Test layered layout of the graph
+TEST(DependencyGraphLayoutTest, LayersAndEdgeRoutes) {
+  DependencyGraph graph;
+
+  // D depends on A directly and through B -> C
+  graph.AddNodes({"A", "B", "C", "D"});
+  graph.AddEdges({
+    {"B", "A"},
+    {"C", "B"},
+    {"D", "C"},
+    {"D", "A"}
+  });
+
+  DependencyGraphLayout layout;
+  layout.Compute(graph);
+
+  ASSERT_EQ(layout.nodes().size(), 4);
+  EXPECT_EQ(layout.layer_count(), 4);
+  EXPECT_EQ(layout.GetNode("A")->layer, 0);
+  EXPECT_EQ(layout.GetNode("B")->layer, 1);
+  EXPECT_EQ(layout.GetNode("C")->layer, 2);
+  EXPECT_EQ(layout.GetNode("D")->layer, 3);
+  EXPECT_LT(layout.GetNode("A")->y, layout.GetNode("D")->y);
+  EXPECT_EQ(layout.GetNode("X"), nullptr);
+
+  // the long edge D -> A is routed through the two layers in between
+  ASSERT_EQ(layout.edges().size(), 4);
+  for (const auto &edge : layout.edges()) {
+    const auto *from = layout.GetNode(edge.from);
+    const auto *to = layout.GetNode(edge.to);
+    ASSERT_NE(from, nullptr);
+    ASSERT_NE(to, nullptr);
+    EXPECT_EQ(edge.points.size(), static_cast<size_t>(from->layer - to->layer + 1));
+    EXPECT_DOUBLE_EQ(edge.points.front().y, to->y + to->height / 2);
+    EXPECT_DOUBLE_EQ(edge.points.back().y, from->y - from->height / 2);
+  }
+
+  // nodes fit in the layout and do not overlap within a layer
+  for (const auto &lhs : layout.nodes()) {
+    EXPECT_GE(lhs.x - lhs.width / 2, -1e-9);
+    EXPECT_LE(lhs.x + lhs.width / 2, layout.width() + 1e-9);
+    for (const auto &rhs : layout.nodes()) {
+      if (&lhs != &rhs && lhs.layer == rhs.layer) {
+        EXPECT_GE(std::abs(lhs.x - rhs.x), (lhs.width + rhs.width) / 2);
+      }
+    }
+  }
+}
+
+// Test that re-layout after an edit keeps the untouched nodes in order
+TEST(DependencyGraphLayoutTest, IncrementalLayout) {
+  DependencyGraph graph;
+  graph.AddNodes({"A", "B", "C", "D", "E"});
+  graph.AddEdges({
+    {"C", "A"},
+    {"D", "B"},
+    {"E", "A"},
+    {"E", "B"}
+  });
+
+  DependencyGraphLayout layout;
+  layout.Compute(graph, [](const std::string &name) { return name + "\nlabel"; });
+  EXPECT_EQ(layout.GetNode("A")->label, "A\nlabel");
+  EXPECT_GT(layout.GetNode("A")->height, layout.options().line_height * 2);
+
+  bool a_left_of_b = layout.GetNode("A")->x < layout.GetNode("B")->x;
+  bool c_left_of_d = layout.GetNode("C")->x < layout.GetNode("D")->x;
+
+  graph.AddNode("F");
+  graph.AddEdge({"F", "E"});
+  layout.Compute(graph);
+
+  ASSERT_EQ(layout.nodes().size(), 6);
+  EXPECT_EQ(layout.GetNode("F")->layer, 2);
+  EXPECT_EQ(layout.GetNode("A")->x < layout.GetNode("B")->x, a_left_of_b);
+  EXPECT_EQ(layout.GetNode("C")->x < layout.GetNode("D")->x, c_left_of_d);
+}
+
+TEST(DependencyGraphExporterTest, ExportFormats) {
+  DependencyGraph graph;
+  graph.AddNodes({"a", "b", "c"});
+  graph.AddEdges({
+    {"b", "a"},
+    {"c", "b"}
+  });
+
+  std::string dot;
+  // a tiny buffer forces several flushes
+  DependencyGraphExporter dot_exporter(DependencyGraphExporter::StringSink(dot), 8);
+  dot_exporter.SetDotNodeAttributes("shape=box");
+  dot_exporter.SetNodeLabelHandler([](const std::string &name, GraphExportFormat, std::string &label) {
+    label.append(name);
+    label.append(" \"q\"\nx");
+  });
+  ASSERT_TRUE(dot_exporter.Export(graph, GraphExportFormat::kDot));
+  EXPECT_EQ(dot.find("digraph DependencyGraph"), 0);
+  EXPECT_NE(dot.find("\"a\" [shape=box, label=\"a \\\"q\\\"\\nx\"];"), std::string::npos);
+  EXPECT_NE(dot.find("\"a\" -> \"b\";"), std::string::npos);
+  EXPECT_NE(dot.find("\"b\" -> \"c\";"), std::string::npos);
+  EXPECT_EQ(dot.substr(dot.size() - 2), "}\n");
+
+  std::string json;
+  DependencyGraphExporter json_exporter(DependencyGraphExporter::StringSink(json));
+  json_exporter.SetNodeFilter([](const std::string &name) { return name != "c"; });
+  ASSERT_TRUE(json_exporter.Export(graph, GraphExportFormat::kJson));
+  EXPECT_NE(json.find("{\"id\":\"a\",\"label\":\"a\",\"dependents\":[\"b\"]}"), std::string::npos);
+  EXPECT_NE(json.find("{\"id\":\"b\",\"label\":\"b\",\"dependents\":[]}"), std::string::npos);
+  EXPECT_EQ(json.find("\"c\""), std::string::npos);
+
+  graph.AddNode("x<&>");
+  graph.AddEdge({"x<&>", "a"});
+  std::string graphml;
+  DependencyGraphExporter graphml_exporter(DependencyGraphExporter::StringSink(graphml));
+  ASSERT_TRUE(graphml_exporter.Export(graph, GraphExportFormat::kGraphML));
+  EXPECT_NE(graphml.find("<node id=\"x&lt;&amp;&gt;\">"), std::string::npos);
+  EXPECT_NE(graphml.find("<edge source=\"a\" target=\"x&lt;&amp;&gt;\"/>"), std::string::npos);
+  EXPECT_NE(graphml.find("</graphml>"), std::string::npos);
+
+  // a failing sink aborts the export
+  int calls = 0;
+  DependencyGraphExporter failing_exporter([&calls](const char *, size_t) {
+    calls++;
+    return false;
+  }, 4);
+  EXPECT_FALSE(failing_exporter.Export(graph, GraphExportFormat::kDot));
+  EXPECT_EQ(calls, 1);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -1,12 +1,21 @@
+#include "core/dependency_graph_layout.h"
 #include "core/equation.h"
 #include "core/equation_common.h"
 #include "core/equation_context.h"
 #include "core/equation_group.h"
 #include "core/equation_manager.h"
+#include "core/equation_registry.h"
+#include "core/equation_result_cache.h"
+#include "core/equation_snapshot.h"
 
 #include "gmock/gmock.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
 #include <regex>
 #include <string>
+#include <thread>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -288,6 +297,10 @@ class MockExprContext : public EquationContext
     virtual void Set(const std::string &var_name, const Value &value) override
     {
         manager_[var_name] = value;
+        if (allocation_tracking_ && value.Type() == typeid(int))
+        {
+            allocated_ += value.Cast<int>();
+        }
     }
 
     virtual bool Remove(const std::string &var_name) override
@@ -320,8 +333,49 @@ class MockExprContext : public EquationContext
         return key_set;
     }
 
+    virtual bool SerializeValue(const std::string &var_name, std::string &data) const override
+    {
+        if (!Contains(var_name) || manager_.at(var_name).Type() != typeid(int))
+        {
+            return false;
+        }
+        data = std::to_string(manager_.at(var_name).Cast<int>());
+        return true;
+    }
+
+    virtual bool DeserializeValue(const std::string &var_name, const std::string &data) override
+    {
+        manager_[var_name] = std::stoi(data);
+        return true;
+    }
+
+    // an int value holds as many bytes as it is large
+    virtual bool GetValueSize(const std::string &var_name, size_t &size) const override
+    {
+        if (!Contains(var_name) || manager_.at(var_name).Type() != typeid(int))
+        {
+            return false;
+        }
+        size = manager_.at(var_name).Cast<int>();
+        return true;
+    }
+
+    virtual bool SetAllocationTracking(bool enabled) override
+    {
+        allocation_tracking_ = enabled;
+        return true;
+    }
+
+    virtual bool GetAllocatedMemory(size_t &bytes) const override
+    {
+        bytes = allocated_;
+        return allocation_tracking_;
+    }
+
   private:
     std::unordered_map<std::string, Value> manager_;
+    bool allocation_tracking_ = false;
+    size_t allocated_ = 0;
 };
 
 class EquationManagerTest : public testing::Test
@@ -594,6 +648,43 @@ TEST_F(EquationManagerTest, EquationManagerUpdate)
     EXPECT_TRUE(manager_.context().Get("F").Cast<int>() == 10);
 }
 
+TEST_F(EquationManagerTest, EditKeepsUnchangedEdges)
+{
+    EquationGroupId id = manager_.AddEquationGroup("A=1;B=2;C=A+B;D=C");
+    manager_.Update();
+    const DependencyGraph::Node *node = manager_.graph().GetNode("C");
+
+    std::vector<std::string> rewired;
+    ScopedConnection connection = manager_.signals_manager().ConnectScoped<EquationEvent::kEquationUpdated>(
+        [&rewired](const Equation *equation, bitmask::bitmask<EquationUpdateFlag> flags) {
+            if (flags & (EquationUpdateFlag::kDependencies | EquationUpdateFlag::kDependents))
+            {
+                rewired.push_back(equation->name());
+            }
+        }
+    );
+
+    // only the body changed, the graph is not touched
+    manager_.EditEquationGroup(id, "A=1;B=2;C=B+A;D=C");
+    EXPECT_TRUE(rewired.empty());
+    EXPECT_EQ(manager_.graph().GetNode("C"), node);
+    EXPECT_THAT(node->dependencies(), testing::UnorderedElementsAre("A", "B"));
+    manager_.Update();
+    EXPECT_EQ(manager_.context().Get("D").Cast<int>(), 3);
+
+    // only the dropped edge is rewired, D keeps its edge to C
+    manager_.EditEquationGroup(id, "A=1;B=2;C=A*2;D=C");
+    EXPECT_THAT(rewired, testing::UnorderedElementsAre("C", "B"));
+    EXPECT_THAT(node->dependencies(), testing::ElementsAre("A"));
+    EXPECT_TRUE(manager_.graph().GetNode("B")->dependents().empty());
+    manager_.Update();
+    EXPECT_EQ(manager_.context().Get("D").Cast<int>(), 2);
+
+    // a cycle is still rejected and rolled back
+    EXPECT_THROW(manager_.EditEquationGroup(id, "A=D;B=2;C=A*2;D=C"), DependencyCycleException);
+    EXPECT_TRUE(manager_.graph().GetNode("A")->dependencies().empty());
+}
+
 TEST_F(EquationManagerTest, Eval) 
 {
     EquationGroupId id_0 = manager_.AddEquationGroup("A=B+C;B=D+E;C=F;D=1;E=5;F=10");
@@ -609,6 +700,793 @@ TEST_F(EquationManagerTest, Eval)
     EXPECT_EQ(res.status, ResultStatus::kNameError);
 }
 
+TEST_F(EquationManagerTest, EvalBatch)
+{
+    manager_.AddEquationGroup("A=1;B=A+1");
+    manager_.Update();
+
+    std::vector<InterpretResult> results = manager_.EvalBatch({"A+B", "G+1"});
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].value.Cast<int>(), 3);
+    EXPECT_EQ(results[1].status, ResultStatus::kNameError);
+
+    // the handler gets the whole batch in one call
+    int batch_count = 0;
+    manager_.SetBatchEvalHandler([&batch_count](const std::vector<std::string> &expressions, EquationContext *context) {
+        batch_count++;
+        std::vector<InterpretResult> batch_results;
+        for (const auto &expression : expressions)
+        {
+            batch_results.push_back(Interpret(expression, context, InterpretMode::kEval));
+        }
+        return batch_results;
+    });
+    results = manager_.EvalBatch({"A+B", "B+1", "A+1"});
+    EXPECT_EQ(batch_count, 1);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].value.Cast<int>(), 3);
+    EXPECT_EQ(results[1].value.Cast<int>(), 3);
+    EXPECT_EQ(results[2].value.Cast<int>(), 2);
+}
+
+TEST_F(EquationManagerTest, SnapshotSaveLoad)
+{
+    EquationGroupId id_0 = manager_.AddEquationGroup("A=B+C;B=D+E;C=F;D=1;F=10");
+    EquationGroupId id_1 = manager_.AddEquationGroup("E=5");
+    manager_.AddEquationGroup("G=H");
+    manager_.Update();
+    EXPECT_EQ(manager_.GetEquation("G")->status(), ResultStatus::kNameError);
+
+    const std::string file_path = testing::TempDir() + "equation_manager_snapshot.bin";
+    EXPECT_TRUE(manager_.SaveSnapshot(file_path));
+
+    int interpret_count = 0;
+    EquationManager loaded(
+        std::unique_ptr<MockExprContext>(new MockExprContext()),
+        [&interpret_count](const std::string &code, EquationContext *context, InterpretMode mode) {
+            interpret_count++;
+            return Interpret(code, context, mode);
+        },
+        Parse
+    );
+    loaded.AddEquationGroup("X=1");
+    EXPECT_TRUE(loaded.LoadSnapshot(file_path));
+
+    EXPECT_FALSE(loaded.IsEquationExist("X"));
+    EXPECT_EQ(loaded.GetEquationGroupIds(), manager_.GetEquationGroupIds());
+    EXPECT_EQ(loaded.GetEquationGroup(id_0)->statement(), "A=B+C;B=D+E;C=F;D=1;F=10");
+    EXPECT_TRUE(loaded.IsEquationExist("E"));
+    EXPECT_EQ(loaded.GetEquation("E")->group_id(), id_1);
+    EXPECT_EQ(loaded.GetEquation("A")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(loaded.GetEquation("G")->status(), ResultStatus::kNameError);
+    EXPECT_EQ(loaded.GetEquation("G")->message(), manager_.GetEquation("G")->message());
+    EXPECT_TRUE(loaded.graph().IsEdgeExist({"A", "B"}));
+    EXPECT_TRUE(loaded.graph().IsEdgeExist({"B", "E"}));
+    EXPECT_EQ(loaded.context().Get("A").Cast<int>(), 16);
+    EXPECT_EQ(loaded.context().Get("E").Cast<int>(), 5);
+
+    // restored values are not recomputed
+    loaded.Update();
+    EXPECT_EQ(interpret_count, 0);
+
+    loaded.EditEquationGroup(id_1, "E=6");
+    loaded.Update();
+    EXPECT_EQ(interpret_count, 3);
+    EXPECT_EQ(loaded.context().Get("A").Cast<int>(), 17);
+
+    EXPECT_FALSE(loaded.LoadSnapshot(testing::TempDir() + "equation_manager_snapshot_missing.bin"));
+
+    // equations saved before they ran are computed after loading
+    manager_.AddEquationGroup("P=A+1");
+    EXPECT_EQ(manager_.GetEquation("P")->status(), ResultStatus::kPending);
+    EXPECT_TRUE(manager_.SaveSnapshot(file_path));
+    EXPECT_TRUE(loaded.LoadSnapshot(file_path));
+    interpret_count = 0;
+    loaded.Update();
+    EXPECT_EQ(interpret_count, 1);
+    EXPECT_EQ(loaded.GetEquation("P")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(loaded.context().Get("P").Cast<int>(), 17);
+    std::remove(file_path.c_str());
+}
+
+TEST_F(EquationManagerTest, SnapshotInvalidStatus)
+{
+    EquationSnapshotItem item;
+    item.name = "A";
+    item.content = "1";
+    item.type = ItemType::kVariable;
+    item.status = static_cast<ResultStatus>(static_cast<uint32_t>(ResultStatus::kUpstreamError) + 1);
+    item.content_hash = EquationSnapshot::ComputeItemHash(item);
+    item.has_value = false;
+    item.value_hash = 0;
+    EquationGroupSnapshot group;
+    group.id = boost::uuids::uuid();
+    group.statement = "A=1";
+    group.items.push_back(item);
+    EquationSnapshot snapshot;
+    snapshot.language = manager_.language();
+    snapshot.groups.push_back(group);
+
+    const std::string file_path = testing::TempDir() + "equation_manager_snapshot_status.bin";
+    ASSERT_TRUE(snapshot.WriteToFile(file_path));
+    EquationSnapshot read;
+    EXPECT_FALSE(EquationSnapshot::ReadFromFile(file_path, read));
+    EXPECT_FALSE(manager_.LoadSnapshot(file_path));
+
+    // an item type out of range is a corrupt file as well
+    item = snapshot.groups[0].items[0];
+    item.status = ResultStatus::kSuccess;
+    item.type = static_cast<ItemType>(static_cast<uint32_t>(ItemType::kError) + 1);
+    item.content_hash = EquationSnapshot::ComputeItemHash(item);
+    snapshot.groups[0].items[0] = item;
+    ASSERT_TRUE(snapshot.WriteToFile(file_path));
+    EXPECT_FALSE(EquationSnapshot::ReadFromFile(file_path, read));
+    EXPECT_FALSE(manager_.LoadSnapshot(file_path));
+    std::remove(file_path.c_str());
+}
+
+TEST_F(EquationManagerTest, SnapshotCyclicGraph)
+{
+    EquationGroupId id = manager_.AddEquationGroup("X=1");
+    manager_.Update();
+
+    EquationGroupSnapshot group;
+    group.id = boost::uuids::uuid();
+    group.statement = "A=B;B=A";
+    for (const auto &name : {"A", "B"})
+    {
+        EquationSnapshotItem item;
+        item.name = name;
+        item.content = name == std::string("A") ? "B" : "A";
+        item.type = ItemType::kVariable;
+        item.dependencies = {item.content};
+        item.status = ResultStatus::kPending;
+        item.content_hash = EquationSnapshot::ComputeItemHash(item);
+        item.has_value = false;
+        item.value_hash = 0;
+        group.items.push_back(item);
+    }
+    EquationSnapshot snapshot;
+    snapshot.language = manager_.language();
+    snapshot.groups.push_back(group);
+
+    // the file reads fine, the cycle is only found while loading
+    const std::string file_path = testing::TempDir() + "equation_manager_snapshot_cycle.bin";
+    ASSERT_TRUE(snapshot.WriteToFile(file_path));
+    EquationSnapshot read;
+    EXPECT_TRUE(EquationSnapshot::ReadFromFile(file_path, read));
+    EXPECT_FALSE(manager_.LoadSnapshot(file_path));
+
+    // the workspace is left as it was
+    EXPECT_EQ(manager_.GetEquationGroupIds(), std::vector<EquationGroupId>({id}));
+    EXPECT_FALSE(manager_.IsEquationExist("A"));
+    EXPECT_EQ(manager_.context().Get("X").Cast<int>(), 1);
+    std::remove(file_path.c_str());
+}
+
+TEST_F(EquationManagerTest, ResultCache)
+{
+    const std::string cache_directory = testing::TempDir() + "equation_manager_result_cache";
+    auto cache = std::make_shared<EquationResultCache>(cache_directory);
+    cache->Clear();
+
+    int interpret_count = 0;
+    auto counting_interpret = [&interpret_count](const std::string &code, EquationContext *context, InterpretMode mode) {
+        interpret_count++;
+        return Interpret(code, context, mode);
+    };
+
+    {
+        EquationManager manager(std::unique_ptr<MockExprContext>(new MockExprContext()), counting_interpret, Parse);
+        manager.SetResultCache(cache);
+        manager.AddEquationGroup("A=B+C;B=D+E;C=F;D=1;E=5;F=10");
+        manager.Update();
+        EXPECT_EQ(interpret_count, 6);
+        EXPECT_EQ(cache->entry_count(), 6u);
+    }
+
+    // a new session sharing the cache directory does not interpret anything
+    interpret_count = 0;
+    EquationManager manager(std::unique_ptr<MockExprContext>(new MockExprContext()), counting_interpret, Parse);
+    manager.SetResultCache(std::make_shared<EquationResultCache>(cache_directory));
+    EquationGroupId id = manager.AddEquationGroup("A=B+C;B=D+E;C=F;D=1;E=5;F=10");
+    manager.SetEquationCacheable("C", false);
+    manager.Update();
+    EXPECT_EQ(interpret_count, 1);
+    EXPECT_EQ(manager.GetEquation("A")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(manager.context().Get("A").Cast<int>(), 16);
+    EXPECT_EQ(manager.context().Get("C").Cast<int>(), 10);
+
+    // a changed input value changes the key of everything downstream, C is
+    // opted out and interpreted on every update
+    interpret_count = 0;
+    manager.EditEquationGroup(id, "A=B+C;B=D+E;C=F;D=2;E=5;F=10");
+    manager.Update();
+    EXPECT_EQ(interpret_count, 4);
+    EXPECT_EQ(manager.context().Get("A").Cast<int>(), 17);
+
+    EXPECT_THROW(manager.SetEquationCacheable("G", false), EquationException);
+    manager.result_cache()->Clear();
+}
+
+TEST_F(EquationManagerTest, DependencyGraphView)
+{
+    EquationGroupId id_0 = manager_.AddEquationGroup("A=1;B=A");
+    EquationGroupId id_1 = manager_.AddEquationGroup("C=B;D=C");
+    manager_.AddEquationGroup("E=D");
+
+    auto neighborhood = manager_.GetEquationNeighborhood({"C"}, 1, 1);
+    std::sort(neighborhood.begin(), neighborhood.end());
+    EXPECT_EQ(neighborhood, std::vector<std::string>({"B", "C", "D"}));
+    EXPECT_THROW(manager_.GetEquationNeighborhood({"Z"}, 1, 1), EquationException);
+
+    DependencyGraphViewOptions options;
+    options.focus_equations = {"E"};
+    options.upstream_hops = 1;
+    DependencyGraphView view = manager_.GetDependencyGraphView(options);
+    EXPECT_TRUE(view.graph->IsNodeExist("D"));
+    EXPECT_TRUE(view.graph->IsNodeExist("E"));
+    EXPECT_FALSE(view.graph->IsNodeExist("C"));
+    EXPECT_TRUE(view.group_nodes.empty());
+
+    // every group but the focused one becomes a single node
+    options.upstream_hops = -1;
+    options.collapse_groups = true;
+    view = manager_.GetDependencyGraphView(options);
+    std::string group_0 = EquationManager::GetGroupNodeName(id_0);
+    std::string group_1 = EquationManager::GetGroupNodeName(id_1);
+    ASSERT_EQ(view.group_nodes.size(), 2);
+    EXPECT_EQ(view.group_nodes.at(group_0), id_0);
+    EXPECT_EQ(view.group_nodes.at(group_1), id_1);
+    EXPECT_TRUE(view.graph->IsNodeExist("E"));
+    EXPECT_FALSE(view.graph->IsNodeExist("A"));
+    EXPECT_TRUE(view.graph->IsEdgeExist({"E", group_1}));
+    EXPECT_TRUE(view.graph->IsEdgeExist({group_1, group_0}));
+    EXPECT_EQ(view.graph->TopologicalSort().size(), 3);
+}
+
+TEST_F(EquationManagerTest, DependencyGraphViewMutualGroups)
+{
+    // B depends on group 1 and C on group 0, the equations themselves are acyclic
+    EquationGroupId id_0 = manager_.AddEquationGroup("A=1;B=C");
+    EquationGroupId id_1 = manager_.AddEquationGroup("C=A;D=B");
+    manager_.Update();
+    EXPECT_EQ(manager_.context().Get("D").Cast<int>(), 1);
+
+    DependencyGraphViewOptions options;
+    options.collapse_groups = true;
+    DependencyGraphView view = manager_.GetDependencyGraphView(options);
+    std::string group_0 = EquationManager::GetGroupNodeName(id_0);
+    std::string group_1 = EquationManager::GetGroupNodeName(id_1);
+    ASSERT_EQ(view.group_nodes.size(), 2);
+    EXPECT_TRUE(view.graph->IsEdgeExist({group_0, group_1}));
+    EXPECT_TRUE(view.graph->IsEdgeExist({group_1, group_0}));
+
+    // the layout places both group nodes and draws both edges from the
+    // dependency to the dependent
+    DependencyGraphLayout layout;
+    layout.Compute(*view.graph);
+    ASSERT_EQ(layout.nodes().size(), 2);
+    ASSERT_EQ(layout.edges().size(), 2);
+    EXPECT_NE(layout.GetNode(group_0)->layer, layout.GetNode(group_1)->layer);
+    for (const auto &edge : layout.edges())
+    {
+        const DependencyGraphLayout::NodeLayout *from = layout.GetNode(edge.from);
+        const DependencyGraphLayout::NodeLayout *to = layout.GetNode(edge.to);
+        ASSERT_GE(edge.points.size(), 2);
+        EXPECT_DOUBLE_EQ(edge.points.front().x, to->x);
+        EXPECT_DOUBLE_EQ(edge.points.back().x, from->x);
+    }
+}
+
+class StatementValueContext : public MockExprContext
+{
+  public:
+    // M stands for a module or function, its value can not be serialized
+    bool SerializeValue(const std::string &var_name, std::string &data) const override
+    {
+        return var_name != "M" && MockExprContext::SerializeValue(var_name, data);
+    }
+};
+
+// parses M as an import
+ParseResult ParseWithImport(const std::string &code, ParseMode mode)
+{
+    ParseResult result = Parse(code, mode);
+    for (auto &item : result.items)
+    {
+        if (item.name == "M")
+        {
+            // statements other than variables are executed as they are
+            item.type = ItemType::kImport;
+            item.content = "M=" + item.content;
+        }
+    }
+    return result;
+}
+
+TEST_F(EquationManagerTest, ResultCacheStatementDependencies)
+{
+    const std::string cache_directory = testing::TempDir() + "equation_manager_result_cache_statement";
+    auto cache = std::make_shared<EquationResultCache>(cache_directory);
+    cache->Clear();
+
+    int interpret_count = 0;
+    auto counting_interpret = [&interpret_count](const std::string &code, EquationContext *context, InterpretMode mode) {
+        interpret_count++;
+        return Interpret(code, context, mode);
+    };
+
+    {
+        EquationManager manager(std::unique_ptr<MockExprContext>(new StatementValueContext()), counting_interpret, ParseWithImport);
+        manager.SetResultCache(cache);
+        manager.AddEquationGroup("M=1;A=M+2");
+        manager.Update();
+        EXPECT_EQ(interpret_count, 2);
+        EXPECT_EQ(cache->entry_count(), 1u);
+    }
+
+    // the import is executed again, A depending on it comes from the cache
+    interpret_count = 0;
+    EquationManager manager(std::unique_ptr<MockExprContext>(new StatementValueContext()), counting_interpret, ParseWithImport);
+    manager.SetResultCache(cache);
+    EquationGroupId id = manager.AddEquationGroup("M=1;A=M+2");
+    manager.Update();
+    EXPECT_EQ(interpret_count, 1);
+    EXPECT_EQ(manager.context().Get("A").Cast<int>(), 3);
+
+    // a changed import statement changes the key of its dependents
+    interpret_count = 0;
+    manager.EditEquationGroup(id, "M=5;A=M+2");
+    manager.Update();
+    EXPECT_EQ(interpret_count, 2);
+    EXPECT_EQ(manager.context().Get("A").Cast<int>(), 7);
+    cache->Clear();
+}
+
+TEST_F(EquationManagerTest, SnapshotStatementItems)
+{
+    EquationManager manager(std::unique_ptr<MockExprContext>(new StatementValueContext()), Interpret, ParseWithImport);
+    manager.AddEquationGroup("M=1;A=M+2;B=A+1");
+    manager.Update();
+    const std::string file_path = testing::TempDir() + "equation_manager_snapshot_statement.bin";
+    ASSERT_TRUE(manager.SaveSnapshot(file_path));
+
+    // the import is executed again while loading, its dependents stay restored
+    int interpret_count = 0;
+    EquationManager loaded(
+        std::unique_ptr<MockExprContext>(new StatementValueContext()),
+        [&interpret_count](const std::string &code, EquationContext *context, InterpretMode mode) {
+            interpret_count++;
+            return Interpret(code, context, mode);
+        },
+        ParseWithImport
+    );
+    EXPECT_TRUE(loaded.LoadSnapshot(file_path));
+    EXPECT_EQ(interpret_count, 1);
+    EXPECT_EQ(loaded.GetEquation("M")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(loaded.context().Get("M").Cast<int>(), 1);
+    EXPECT_EQ(loaded.context().Get("B").Cast<int>(), 4);
+    loaded.Update();
+    EXPECT_EQ(interpret_count, 1);
+    std::remove(file_path.c_str());
+}
+
+TEST(EquationResultCacheTest, LeastRecentlyUsedEviction)
+{
+    const std::string cache_directory = testing::TempDir() + "equation_result_cache_lru";
+    EquationResultCache(cache_directory).Clear();
+
+    const std::string data(100, 'x');
+    std::string out;
+    // header of each entry is 20 bytes, so exactly two entries fit
+    EquationResultCache cache(cache_directory, 2 * (data.size() + 20));
+    EXPECT_TRUE(cache.Store(1, data));
+    EXPECT_TRUE(cache.Store(2, data));
+    EXPECT_TRUE(cache.Lookup(1, out));
+    EXPECT_EQ(out, data);
+    EXPECT_TRUE(cache.Store(3, data));
+    EXPECT_TRUE(cache.Contains(1));
+    EXPECT_FALSE(cache.Contains(2));
+    EXPECT_TRUE(cache.Contains(3));
+    EXPECT_FALSE(cache.Lookup(2, out));
+    EXPECT_EQ(cache.total_size(), 2 * (data.size() + 20));
+
+    EXPECT_FALSE(cache.Store(4, std::string(1000, 'x')));
+
+    EquationResultCache reopened(cache_directory, 2 * (data.size() + 20));
+    EXPECT_EQ(reopened.entry_count(), 2u);
+    EXPECT_TRUE(reopened.Lookup(3, out));
+    reopened.Clear();
+}
+
+TEST_F(EquationManagerTest, LazyEvaluation)
+{
+    int interpret_count = 0;
+    EquationManager manager(
+        std::unique_ptr<MockExprContext>(new MockExprContext()),
+        [&interpret_count](const std::string &code, EquationContext *context, InterpretMode mode) {
+            interpret_count++;
+            return Interpret(code, context, mode);
+        },
+        Parse
+    );
+    manager.SetEvaluationMode(EvaluationMode::kLazy);
+    EquationGroupId id = manager.AddEquationGroup("A=B+C;B=D+E;C=F;D=1;E=5;F=10;G=A");
+
+    // nothing is observed, nothing is computed
+    manager.Update();
+    EXPECT_EQ(interpret_count, 0);
+    EXPECT_EQ(manager.GetEquation("A")->status(), ResultStatus::kPending);
+
+    // observing B computes B and its upstream closure only
+    manager.ObserveEquation("B");
+    manager.ObserveEquation("B");
+    EXPECT_TRUE(manager.IsEquationObserved("B"));
+    manager.Update();
+    EXPECT_EQ(interpret_count, 3);
+    EXPECT_EQ(manager.context().Get("B").Cast<int>(), 6);
+    EXPECT_FALSE(manager.context().Contains("A"));
+    EXPECT_FALSE(manager.context().Contains("C"));
+
+    // up to date equations are not computed again
+    manager.UpdateEquationGroup(id);
+    EXPECT_EQ(interpret_count, 3);
+
+    // an explicit request only pays for what is still dirty
+    manager.RequestEquation("A");
+    EXPECT_EQ(interpret_count, 6);
+    EXPECT_EQ(manager.context().Get("A").Cast<int>(), 16);
+    EXPECT_FALSE(manager.context().Contains("G"));
+
+    // an edit dirties the downstream equations, only the observed ones are recomputed
+    manager.EditEquationGroup(id, "A=B+C;B=D+E;C=F;D=2;E=5;F=10;G=A");
+    EXPECT_EQ(manager.GetUpdateOrder({"D"}), std::vector<std::string>({"D", "B"}));
+    manager.UpdateEquation("D");
+    EXPECT_EQ(interpret_count, 8);
+    EXPECT_EQ(manager.context().Get("B").Cast<int>(), 7);
+    EXPECT_EQ(manager.GetRequestOrder({"G"}), std::vector<std::string>({"A", "G"}));
+
+    manager.UnobserveEquation("B");
+    EXPECT_TRUE(manager.IsEquationObserved("B"));
+    manager.UnobserveEquation("B");
+    EXPECT_FALSE(manager.IsEquationObserved("B"));
+
+    EXPECT_THROW(manager.RequestEquation("X"), EquationException);
+}
+
+TEST_F(EquationManagerTest, ConcurrentUpdate)
+{
+    std::mutex context_mutex;
+    std::atomic<int> active_count(0);
+    std::atomic<int> max_active_count(0);
+    EquationManager manager(
+        std::unique_ptr<MockExprContext>(new MockExprContext()),
+        [&](const std::string &code, EquationContext *context, InterpretMode mode) -> InterpretResult {
+            int active = ++active_count;
+            int max_active = max_active_count;
+            while (active > max_active && !max_active_count.compare_exchange_weak(max_active, active))
+            {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            active_count--;
+            std::lock_guard<std::mutex> lock(context_mutex);
+            return Interpret(code, context, mode);
+        },
+        Parse
+    );
+    manager.SetInterpretConcurrency(3);
+    EXPECT_EQ(manager.interpret_concurrency(), 3);
+    manager.AddEquationGroup("A=B+C;B=D+E;C=F;D=1;E=5;F=10;G=X");
+    manager.Update();
+
+    // D, E and F do not depend on each other
+    EXPECT_GT(max_active_count, 1);
+    EXPECT_LE(max_active_count, 3);
+    EXPECT_EQ(manager.context().Get("A").Cast<int>(), 16);
+    EXPECT_EQ(manager.GetEquation("A")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(manager.GetEquation("G")->status(), ResultStatus::kNameError);
+
+    manager.SetInterpretConcurrency(0);
+    EXPECT_EQ(manager.interpret_concurrency(), 1);
+}
+
+TEST_F(EquationManagerTest, ConcurrentUpdateException)
+{
+    std::mutex context_mutex;
+    EquationManager manager(
+        std::unique_ptr<MockExprContext>(new MockExprContext()),
+        [&](const std::string &code, EquationContext *context, InterpretMode mode) -> InterpretResult {
+            if (code.find("E") == 0)
+            {
+                throw std::runtime_error("interpreter failed");
+            }
+            std::lock_guard<std::mutex> lock(context_mutex);
+            return Interpret(code, context, mode);
+        },
+        Parse
+    );
+    manager.SetInterpretConcurrency(3);
+    manager.AddEquationGroup("A=B+C;B=D+E;C=F;D=1;E=5;F=10");
+    EXPECT_THROW(manager.Update(), std::runtime_error);
+
+    // the failed equation, the rest of its wave and the later waves all finish
+    EXPECT_EQ(manager.GetEquation("E")->status(), ResultStatus::kUnknownError);
+    EXPECT_EQ(manager.GetEquation("E")->message(), "interpreter failed");
+    EXPECT_EQ(manager.GetEquation("D")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(manager.GetEquation("F")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(manager.GetEquation("C")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(manager.GetEquation("B")->status(), ResultStatus::kUpstreamError);
+    EXPECT_EQ(manager.GetEquation("A")->status(), ResultStatus::kUpstreamError);
+}
+
+TEST_F(EquationManagerTest, Interrupt)
+{
+    std::atomic<bool> interrupted(false);
+    std::atomic<bool> running(false);
+    EquationManager manager(
+        std::unique_ptr<MockExprContext>(new MockExprContext()),
+        [&](const std::string &code, EquationContext *context, InterpretMode mode) -> InterpretResult {
+            if (code.find("B") == std::string::npos)
+            {
+                return Interpret(code, context, mode);
+            }
+            running = true;
+            while (!interrupted)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            InterpretResult result;
+            result.mode = mode;
+            result.status = ResultStatus::kKeyBoardInterrupt;
+            return result;
+        },
+        Parse
+    );
+    // no handler installed yet
+    manager.Interrupt();
+    manager.SetInterruptHandler([&interrupted]() { interrupted = true; });
+    manager.AddEquationGroup("A=1;B=A+1");
+
+    std::thread updater([&manager]() { manager.Update(); });
+    while (!running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    manager.Interrupt();
+    updater.join();
+
+    EXPECT_EQ(manager.GetEquation("A")->status(), ResultStatus::kSuccess);
+    EXPECT_EQ(manager.GetEquation("B")->status(), ResultStatus::kKeyBoardInterrupt);
+    EXPECT_EQ(ResultStatusConverter::FromString(ResultStatusConverter::ToString(ResultStatus::kTimeout)), ResultStatus::kTimeout);
+}
+
+TEST_F(EquationManagerTest, ErrorRecord)
+{
+    EquationManager manager(
+        std::unique_ptr<MockExprContext>(new MockExprContext()),
+        [](const std::string &code, EquationContext *context, InterpretMode mode) -> InterpretResult {
+            InterpretResult result = Interpret(code, context, mode);
+            if (result.status != ResultStatus::kSuccess)
+            {
+                std::shared_ptr<ErrorRecord> error = std::make_shared<ErrorRecord>();
+                error->type = "NameError";
+                error->message = result.message;
+                error->line = 1;
+                error->frames.push_back(ErrorFrame{"<string>", "<module>", 1});
+                result.error = error;
+            }
+            return result;
+        },
+        Parse
+    );
+    manager.AddEquationGroup("A=1;B=X");
+    manager.Update();
+
+    EXPECT_FALSE(manager.GetEquation("A")->error());
+    const auto &error = manager.GetEquation("B")->error();
+    ASSERT_TRUE(error);
+    EXPECT_EQ(error->message, manager.GetEquation("B")->message());
+    EXPECT_EQ(
+        error->FormatTraceback(),
+        "Traceback (most recent call last):\n  File \"<string>\", line 1, in <module>\nNameError: " + error->message
+    );
+
+    manager.EditEquationGroup(manager.GetEquation("B")->group_id(), "A=1;B=A");
+    manager.Update();
+    EXPECT_FALSE(manager.GetEquation("B")->error());
+}
+
+TEST_F(EquationManagerTest, UpstreamError)
+{
+    std::vector<std::string> interpreted;
+    EquationManager manager(
+        std::unique_ptr<MockExprContext>(new MockExprContext()),
+        [&interpreted](const std::string &code, EquationContext *context, InterpretMode mode) -> InterpretResult {
+            interpreted.push_back(code.substr(0, 1));
+            return Interpret(code, context, mode);
+        },
+        Parse
+    );
+    EquationGroupId id = manager.AddEquationGroup("A=1;B=A/0;C=B+1;D=C*2;E=A+1");
+    manager.Update();
+
+    EXPECT_EQ(manager.GetEquation("B")->status(), ResultStatus::kZeroDivisionError);
+    EXPECT_EQ(manager.GetEquation("E")->status(), ResultStatus::kSuccess);
+    for (const std::string name : {"C", "D"})
+    {
+        const Equation *equation = manager.GetEquation(name);
+        EXPECT_EQ(equation->status(), ResultStatus::kUpstreamError);
+        EXPECT_EQ(equation->root_cause(), "B");
+        EXPECT_EQ(equation->message(), "Upstream equation 'B' failed with ZeroDivisionError");
+        EXPECT_FALSE(manager.context().Contains(name));
+        EXPECT_EQ(std::count(interpreted.begin(), interpreted.end(), name), 0);
+    }
+
+    manager.EditEquationGroup(id, "A=1;B=A/2;C=B+1;D=C*2;E=A+1");
+    manager.Update();
+    EXPECT_EQ(manager.GetEquation("D")->status(), ResultStatus::kSuccess);
+    EXPECT_TRUE(manager.GetEquation("D")->root_cause().empty());
+    EXPECT_EQ(ResultStatusConverter::FromString("UpstreamError"), ResultStatus::kUpstreamError);
+}
+
+class BuiltinExprContext : public MockExprContext
+{
+  public:
+    std::shared_ptr<const std::unordered_set<std::string>> GetBuiltinNames() const override
+    {
+        return builtin_names_;
+    }
+
+    std::shared_ptr<const std::unordered_set<std::string>> builtin_names_ =
+        std::make_shared<const std::unordered_set<std::string>>(std::unordered_set<std::string>{"E", "F"});
+};
+
+TEST_F(EquationManagerTest, BuiltinNames)
+{
+    EquationManager manager(std::unique_ptr<BuiltinExprContext>(new BuiltinExprContext()), Interpret, Parse);
+
+    ParseResult result = manager.Parse("A=E+B+F+C", ParseMode::kStatement);
+    ASSERT_EQ(result.items.size(), 1);
+    EXPECT_THAT(result.items[0].dependencies, testing::ElementsAre("B", "C"));
+
+    EXPECT_FALSE(manager_.context().GetBuiltinNames());
+    result = manager_.Parse("A=E+B", ParseMode::kStatement);
+    EXPECT_THAT(result.items[0].dependencies, testing::ElementsAre("E", "B"));
+}
+
+TEST_F(EquationManagerTest, EquationHandle)
+{
+    EquationGroupId id = manager_.AddEquationGroup("A=1;B=A+1");
+    EquationHandle handle = manager_.GetEquationHandle("B");
+    ASSERT_TRUE(handle.valid());
+    EXPECT_EQ(manager_.GetEquation(handle), manager_.GetEquation("B"));
+    EXPECT_EQ(manager_.GetEquationHandle("B"), handle);
+    EXPECT_FALSE(manager_.GetEquationHandle("X").valid());
+    EXPECT_EQ(manager_.GetEquation(EquationHandle()), nullptr);
+
+    manager_.EditEquationGroup(id, "A=1");
+    EXPECT_EQ(manager_.GetEquation(handle), nullptr);
+
+    // the slot is reused, the old handle stays stale
+    manager_.EditEquationGroup(id, "A=1;C=A+2");
+    EquationHandle reused = manager_.GetEquationHandle("C");
+    EXPECT_EQ(reused.index, handle.index);
+    EXPECT_EQ(manager_.GetEquation(handle), nullptr);
+    EXPECT_EQ(manager_.GetEquation(reused)->name(), "C");
+
+    manager_.RemoveEquationGroup(id);
+    EXPECT_EQ(manager_.GetEquation(reused), nullptr);
+    EXPECT_FALSE(manager_.IsEquationExist("A"));
+}
+
+TEST(EquationRegistryTest, ReplaceInvalidatesHandles)
+{
+    boost::uuids::uuid group_id = boost::uuids::uuid();
+    Equation first("A", group_id, nullptr);
+    Equation second("A", group_id, nullptr);
+
+    EquationRegistry registry;
+    EquationHandle handle = registry.Add(&first);
+    EXPECT_EQ(registry.Add(&first), handle);
+
+    // the name keeps its slot, the old handle does not reach the new equation
+    EquationHandle replaced = registry.Add(&second);
+    EXPECT_EQ(replaced.index, handle.index);
+    EXPECT_NE(replaced, handle);
+    EXPECT_EQ(registry.Get(handle), nullptr);
+    EXPECT_EQ(registry.Get(replaced), &second);
+    EXPECT_EQ(registry.Find("A"), replaced);
+    EXPECT_EQ(registry.size(), 1u);
+}
+
+TEST_F(EquationManagerTest, MemoryReport)
+{
+    manager_.AddEquationGroup("A=100;B=A+50;C=A-90;D=C/0");
+    manager_.Update();
+
+    MemoryReport report = manager_.GetMemoryReport(2);
+    EXPECT_EQ(report.total_size, 260u);
+    ASSERT_EQ(report.top_equations.size(), 2u);
+    EXPECT_EQ(report.top_equations[0].equation_name, "B");
+    EXPECT_EQ(report.top_equations[0].value_size, 150u);
+    EXPECT_EQ(report.top_equations[1].equation_name, "A");
+    EXPECT_EQ(report.top_equations[0].allocation_delta, 0);
+
+    EXPECT_TRUE(manager_.SetAllocationTracking(true));
+    manager_.UpdateEquation("A");
+    report = manager_.GetMemoryReport();
+    // D failed and holds no value
+    ASSERT_EQ(report.top_equations.size(), 3u);
+    EXPECT_EQ(report.top_equations[0].allocation_delta, 150);
+    EXPECT_EQ(report.top_equations[1].allocation_delta, 100);
+    EXPECT_EQ(report.top_equations[2].equation_name, "C");
+    EXPECT_EQ(report.top_equations[2].allocation_delta, 10);
+
+    EXPECT_TRUE(manager_.SetAllocationTracking(false));
+    EXPECT_EQ(manager_.GetMemoryReport().top_equations[0].allocation_delta, 0);
+}
+
+TEST_F(EquationManagerTest, Eviction)
+{
+    const std::string spill_directory = testing::TempDir() + "equation_manager_spill";
+    auto spill_cache = std::make_shared<EquationResultCache>(spill_directory);
+    spill_cache->Clear();
+
+    int interpret_count = 0;
+    auto counting_interpret = [&interpret_count](const std::string &code, EquationContext *context, InterpretMode mode) {
+        interpret_count++;
+        return Interpret(code, context, mode);
+    };
+    EquationManager manager(std::unique_ptr<MockExprContext>(new MockExprContext()), counting_interpret, Parse);
+    manager.AddEquationGroup("A=100;B=A+50;C=B-140");
+    manager.Update();
+
+    EvictionPolicy policy;
+    policy.memory_budget = 150;
+    policy.min_value_size = 50;
+    manager.SetEvictionPolicy(policy);
+    // the largest value goes first
+    EXPECT_TRUE(manager.IsEquationEvicted("B"));
+    EXPECT_FALSE(manager.IsEquationEvicted("A"));
+    EXPECT_FALSE(manager.context().Contains("B"));
+
+    // dropped values are recomputed when read
+    interpret_count = 0;
+    InterpretResult result = manager.Eval("B+1");
+    EXPECT_EQ(result.status, ResultStatus::kSuccess);
+    EXPECT_EQ(result.value.Cast<int>(), 151);
+    EXPECT_EQ(interpret_count, 2);
+    EXPECT_FALSE(manager.IsEquationEvicted("B"));
+
+    // observed values stay, spilled values are reloaded without interpreting
+    policy.spill_cache = spill_cache;
+    policy.min_value_size = 60;
+    manager.ObserveEquation("B");
+    manager.SetEvictionPolicy(policy);
+    EXPECT_FALSE(manager.IsEquationEvicted("B"));
+    EXPECT_TRUE(manager.IsEquationEvicted("A"));
+    EXPECT_EQ(spill_cache->entry_count(), 1u);
+
+    interpret_count = 0;
+    EXPECT_TRUE(manager.MaterializeEquation("A"));
+    EXPECT_EQ(interpret_count, 0);
+    EXPECT_EQ(manager.context().Get("A").Cast<int>(), 100);
+    EXPECT_EQ(spill_cache->entry_count(), 0u);
+
+    // updates materialize the values they read and evict again afterwards
+    manager.EditEquationGroup(manager.GetEquationGroupIds()[0], "A=100;B=A+50;C=B-A");
+    manager.Update();
+    EXPECT_EQ(manager.context().Get("C").Cast<int>(), 50);
+    EXPECT_TRUE(manager.IsEquationEvicted("A"));
+    EXPECT_EQ(manager.GetMemoryReport().total_size, 200u);
+
+    manager.SetEvictionPolicy(EvictionPolicy());
+    EXPECT_FALSE(manager.IsEquationEvicted("A"));
+    EXPECT_EQ(manager.context().Get("A").Cast<int>(), 100);
+    EXPECT_THROW(manager.MaterializeEquation("X"), EquationException);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
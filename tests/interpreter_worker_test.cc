@@ -0,0 +1,364 @@
+#include "core/execution_watchdog.h"
+#include "core/interpreter_worker_pool.h"
+#include "core/interpreter_worker_protocol.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <thread>
+
+using namespace xequation;
+
+namespace
+{
+// path of this test binary, which doubles as a worker with --fake-worker
+std::string test_executable;
+
+// holds ints, the value of "handle" exists in the host only
+class HostContext : public EquationContext
+{
+  public:
+    bool Contains(const std::string &key) const override
+    {
+        return values_.count(key) != 0;
+    }
+
+    Value Get(const std::string &key) const override
+    {
+        return Contains(key) ? values_.at(key) : Value::Null();
+    }
+
+    void Set(const std::string &key, const Value &value) override
+    {
+        values_[key] = value;
+    }
+
+    bool Remove(const std::string &key) override
+    {
+        return values_.erase(key) != 0;
+    }
+
+    void Clear() override
+    {
+        values_.clear();
+    }
+
+    std::unordered_set<std::string> keys() const override
+    {
+        std::unordered_set<std::string> result;
+        for (const auto &entry : values_)
+        {
+            result.insert(entry.first);
+        }
+        return result;
+    }
+
+    bool SerializeValue(const std::string &key, std::string &data) const override
+    {
+        if (!Contains(key) || values_.at(key).Type() != typeid(int))
+        {
+            return false;
+        }
+        data = std::to_string(values_.at(key).Cast<int>());
+        return true;
+    }
+
+    bool DeserializeValue(const std::string &key, const std::string &data) override
+    {
+        values_[key] = std::stoi(data);
+        return true;
+    }
+
+  private:
+    std::map<std::string, Value> values_;
+};
+
+// Stands in for the interpreter worker, runs code of the form
+// "target = source + 1" with source fetched from the host. Like the real
+// worker it gives up on values only the host has.
+int RunFakeWorker()
+{
+    auto read = [](char *data, size_t size) -> bool { return std::fread(data, 1, size, stdin) == size; };
+    auto write = [](const char *data, size_t size) -> bool {
+        return std::fwrite(data, 1, size, stdout) == size && std::fflush(stdout) == 0;
+    };
+
+    WorkerMessageType type;
+    std::string payload;
+    while (WorkerProtocol::ReadMessage(read, type, payload) && type == WorkerMessageType::kInterpretRequest)
+    {
+        WorkerInterpretRequest request;
+        if (!WorkerProtocol::Decode(payload, request))
+        {
+            return 1;
+        }
+        size_t assign = request.code.find(" = ");
+        size_t plus = request.code.find(" + ");
+        std::string target = request.code.substr(0, assign);
+        std::string source = request.code.substr(assign + 3, plus - assign - 3);
+
+        WorkerFetchRequest fetch_request{source};
+        WorkerFetchResponse fetch;
+        if (!WorkerProtocol::WriteMessage(write, WorkerMessageType::kFetchRequest, WorkerProtocol::Encode(fetch_request)) ||
+            !WorkerProtocol::ReadMessage(read, type, payload) || !WorkerProtocol::Decode(payload, fetch))
+        {
+            return 1;
+        }
+
+        WorkerInterpretResponse response;
+        response.status = ResultStatus::kSuccess;
+        response.has_value = false;
+        if (fetch.host_only)
+        {
+            response.status = ResultStatus::kUnknownError;
+            response.message = "Value only available in the host";
+        }
+        else if (!fetch.found)
+        {
+            response.status = ResultStatus::kNameError;
+            response.message = "name '" + source + "' is not defined";
+        }
+        else
+        {
+            response.bindings.emplace_back(target, std::to_string(std::stoi(fetch.data) + 1));
+        }
+        if (!WorkerProtocol::WriteMessage(write, WorkerMessageType::kInterpretResponse, WorkerProtocol::Encode(response)))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+} // namespace
+
+TEST(InterpreterWorkerProtocolTest, MessageRoundTrip)
+{
+    std::string channel;
+    auto write = [&channel](const char *data, size_t size) -> bool {
+        channel.append(data, size);
+        return true;
+    };
+    size_t read_pos = 0;
+    auto read = [&](char *data, size_t size) -> bool {
+        if (channel.size() - read_pos < size)
+        {
+            return false;
+        }
+        channel.copy(data, size, read_pos);
+        read_pos += size;
+        return true;
+    };
+
+    WorkerInterpretRequest request{InterpretMode::kEval, "a + b", 1ull << 32};
+    WorkerFetchResponse fetch{"a", true, std::string("\0\x01\x02", 3), false};
+    WorkerFetchResponse host_fetch{"m", false, std::string(), true};
+    WorkerInterpretResponse response;
+    response.status = ResultStatus::kNameError;
+    response.message = "name 'c' is not defined";
+    response.has_value = false;
+    response.bindings = {{"x", "1"}, {"y", ""}};
+    response.unserializable_names = {"os"};
+
+    ASSERT_TRUE(WorkerProtocol::WriteMessage(write, WorkerMessageType::kInterpretRequest, WorkerProtocol::Encode(request)));
+    ASSERT_TRUE(WorkerProtocol::WriteMessage(write, WorkerMessageType::kFetchResponse, WorkerProtocol::Encode(fetch)));
+    ASSERT_TRUE(WorkerProtocol::WriteMessage(write, WorkerMessageType::kFetchResponse, WorkerProtocol::Encode(host_fetch)));
+    ASSERT_TRUE(WorkerProtocol::WriteMessage(write, WorkerMessageType::kInterpretResponse, WorkerProtocol::Encode(response)));
+    ASSERT_TRUE(WorkerProtocol::WriteMessage(write, WorkerMessageType::kShutdown, std::string()));
+
+    WorkerMessageType type;
+    std::string payload;
+    ASSERT_TRUE(WorkerProtocol::ReadMessage(read, type, payload));
+    EXPECT_EQ(type, WorkerMessageType::kInterpretRequest);
+    WorkerInterpretRequest decoded_request;
+    ASSERT_TRUE(WorkerProtocol::Decode(payload, decoded_request));
+    EXPECT_EQ(decoded_request.mode, InterpretMode::kEval);
+    EXPECT_EQ(decoded_request.code, "a + b");
+    EXPECT_EQ(decoded_request.memory_limit, 1ull << 32);
+
+    ASSERT_TRUE(WorkerProtocol::ReadMessage(read, type, payload));
+    EXPECT_EQ(type, WorkerMessageType::kFetchResponse);
+    WorkerFetchResponse decoded_fetch;
+    ASSERT_TRUE(WorkerProtocol::Decode(payload, decoded_fetch));
+    EXPECT_EQ(decoded_fetch.name, "a");
+    EXPECT_TRUE(decoded_fetch.found);
+    EXPECT_EQ(decoded_fetch.data, std::string("\0\x01\x02", 3));
+    EXPECT_FALSE(decoded_fetch.host_only);
+
+    ASSERT_TRUE(WorkerProtocol::ReadMessage(read, type, payload));
+    ASSERT_TRUE(WorkerProtocol::Decode(payload, decoded_fetch));
+    EXPECT_EQ(decoded_fetch.name, "m");
+    EXPECT_FALSE(decoded_fetch.found);
+    EXPECT_TRUE(decoded_fetch.host_only);
+
+    ASSERT_TRUE(WorkerProtocol::ReadMessage(read, type, payload));
+    EXPECT_EQ(type, WorkerMessageType::kInterpretResponse);
+    WorkerInterpretResponse decoded_response;
+    ASSERT_TRUE(WorkerProtocol::Decode(payload, decoded_response));
+    EXPECT_EQ(decoded_response.status, ResultStatus::kNameError);
+    EXPECT_EQ(decoded_response.message, response.message);
+    EXPECT_FALSE(decoded_response.has_value);
+    EXPECT_EQ(decoded_response.bindings, response.bindings);
+    EXPECT_EQ(decoded_response.unserializable_names, response.unserializable_names);
+
+    // truncated payloads are rejected instead of read past the end
+    std::string truncated = WorkerProtocol::Encode(response);
+    truncated.pop_back();
+    EXPECT_FALSE(WorkerProtocol::Decode(truncated, decoded_response));
+
+    ASSERT_TRUE(WorkerProtocol::ReadMessage(read, type, payload));
+    EXPECT_EQ(type, WorkerMessageType::kShutdown);
+    EXPECT_TRUE(payload.empty());
+    EXPECT_FALSE(WorkerProtocol::ReadMessage(read, type, payload));
+}
+
+TEST(InterpreterWorkerPoolTest, MissingWorker)
+{
+    InterpreterWorkerPool::Options options;
+    options.worker_path = "xequation_missing_worker";
+    options.worker_count = 2;
+    InterpreterWorkerPool pool(options);
+    EXPECT_EQ(pool.worker_count(), 2);
+
+    InterpretResult result = pool.Interpret("a = 1", nullptr, InterpretMode::kExec);
+    EXPECT_EQ(result.status, ResultStatus::kUnknownError);
+    EXPECT_FALSE(result.message.empty());
+}
+
+#ifndef _WIN32
+InterpreterWorkerPool::Options FakeWorkerOptions(int &fallback_count)
+{
+    InterpreterWorkerPool::Options options;
+    options.worker_path = test_executable;
+    options.worker_arguments = {"--fake-worker"};
+    options.worker_count = 1;
+    options.fallback_handler = [&fallback_count](const std::string &, EquationContext *, InterpretMode) {
+        fallback_count++;
+        InterpretResult result;
+        result.status = ResultStatus::kSuccess;
+        return result;
+    };
+    return options;
+}
+
+TEST(InterpreterWorkerPoolTest, ContextValuesTransfer)
+{
+    int fallback_count = 0;
+    InterpreterWorkerPool pool(FakeWorkerOptions(fallback_count));
+    HostContext context;
+    context.Set("x", 41);
+
+    InterpretResult result = pool.Interpret("y = x + 1", &context, InterpretMode::kExec);
+    EXPECT_EQ(result.status, ResultStatus::kSuccess);
+    ASSERT_TRUE(context.Contains("y"));
+    EXPECT_EQ(context.Get("y").Cast<int>(), 42);
+
+    result = pool.Interpret("z = missing + 1", &context, InterpretMode::kExec);
+    EXPECT_EQ(result.status, ResultStatus::kNameError);
+    EXPECT_FALSE(context.Contains("z"));
+    EXPECT_EQ(fallback_count, 0);
+}
+
+TEST(InterpreterWorkerPoolTest, HostOnlyValueRunsInHost)
+{
+    int fallback_count = 0;
+    InterpreterWorkerPool pool(FakeWorkerOptions(fallback_count));
+    HostContext context;
+    context.Set("handle", std::string("module"));
+
+    // the worker stops at the fetch, the code runs once in the host
+    InterpretResult result = pool.Interpret("y = handle + 1", &context, InterpretMode::kExec);
+    EXPECT_EQ(result.status, ResultStatus::kSuccess);
+    EXPECT_EQ(fallback_count, 1);
+    EXPECT_FALSE(context.Contains("y"));
+
+    // the worker stays usable
+    context.Set("x", 1);
+    result = pool.Interpret("y = x + 1", &context, InterpretMode::kExec);
+    EXPECT_EQ(result.status, ResultStatus::kSuccess);
+    EXPECT_EQ(context.Get("y").Cast<int>(), 2);
+    EXPECT_EQ(fallback_count, 1);
+}
+#endif
+
+TEST(ExecutionWatchdogTest, ArmAndDisarm)
+{
+    ExecutionWatchdog watchdog;
+    std::atomic<int> fired{0};
+    watchdog.Arm(std::chrono::milliseconds(20), [&fired]() { fired += 1; });
+    uint64_t disarmed = watchdog.Arm(std::chrono::milliseconds(20), [&fired]() { fired += 10; });
+    watchdog.Disarm(disarmed);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(fired.load(), 1);
+}
+
+#ifndef _WIN32
+// a worker which reads requests and never answers them
+InterpreterWorkerPool::Options SilentWorkerOptions()
+{
+    InterpreterWorkerPool::Options options;
+    options.worker_path = "/bin/sh";
+    options.worker_arguments = {"-c", "cat > /dev/null; exit 0"};
+    options.worker_count = 1;
+    return options;
+}
+
+TEST(InterpreterWorkerPoolTest, TimeoutKillsWorker)
+{
+    InterpreterWorkerPool::Options options = SilentWorkerOptions();
+    options.budget.wall_time_ms = 100;
+    InterpreterWorkerPool pool(options);
+
+    auto start = std::chrono::steady_clock::now();
+    InterpretResult result = pool.Interpret("while True: pass", nullptr, InterpretMode::kExec);
+    EXPECT_EQ(result.status, ResultStatus::kTimeout);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+    // the slot gets a fresh worker
+    result = pool.Interpret("while True: pass", nullptr, InterpretMode::kExec);
+    EXPECT_EQ(result.status, ResultStatus::kTimeout);
+}
+
+TEST(InterpreterWorkerPoolTest, Interrupt)
+{
+    // the worker marks that the request reached it, the call runs from then on
+    const std::string started_path = testing::TempDir() + "interpreter_worker_started";
+    std::remove(started_path.c_str());
+    InterpreterWorkerPool::Options options = SilentWorkerOptions();
+    options.worker_arguments = {"-c", "head -c 1 > /dev/null; touch '" + started_path + "'; cat > /dev/null; exit 0"};
+    // ends the call if the interrupt gets lost, so the test fails instead of hanging
+    options.budget.wall_time_ms = 10000;
+    InterpreterWorkerPool pool(options);
+
+    std::future<InterpretResult> result = std::async(std::launch::async, [&pool]() {
+        return pool.Interpret("import time; time.sleep(60)", nullptr, InterpretMode::kExec);
+    });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!std::ifstream(started_path).good() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_TRUE(std::ifstream(started_path).good());
+    pool.Interrupt();
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(result.get().status, ResultStatus::kKeyBoardInterrupt);
+    std::remove(started_path.c_str());
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--fake-worker") == 0)
+    {
+        return RunFakeWorker();
+    }
+    test_executable = argv[0];
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
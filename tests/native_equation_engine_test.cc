@@ -0,0 +1,164 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "core/equation.h"
+#include "core/equation_common.h"
+#include "native/native_equation_context.h"
+#include "native/native_equation_engine.h"
+
+using namespace xequation;
+using namespace xequation::native;
+
+TEST(NativeEquationEngine, TestParse)
+{
+    auto &engine = NativeEquationEngine::GetInstance();
+    auto result = engine.Parse("e = a + b * max(c, a) # comment\nf = [1, 2,\n 3][0]", ParseMode::kStatement);
+
+    ASSERT_EQ(result.items.size(), 2);
+    EXPECT_EQ(result.items[0].name, "e");
+    EXPECT_EQ(result.items[0].type, ItemType::kVariable);
+    EXPECT_EQ(result.items[0].content, "a + b * max(c, a)");
+    EXPECT_THAT(result.items[0].dependencies, testing::ElementsAre("a", "b", "c"));
+    EXPECT_EQ(result.items[1].name, "f");
+    EXPECT_TRUE(result.items[1].dependencies.empty());
+
+    EXPECT_THROW(engine.Parse("a + 1", ParseMode::kStatement), ParseException);
+    EXPECT_THROW(engine.Parse("a = b = 1", ParseMode::kStatement), ParseException);
+    EXPECT_THROW(engine.Parse("a = (1 + ", ParseMode::kStatement), ParseException);
+    EXPECT_THROW(engine.Parse("a = 1\n  b = 2", ParseMode::kStatement), ParseException);
+    EXPECT_THROW(engine.Parse("a = 012", ParseMode::kStatement), ParseException);
+
+    result = engine.Parse("x * 2 < y", ParseMode::kExpression);
+    ASSERT_EQ(result.items.size(), 1);
+    EXPECT_EQ(result.items[0].type, ItemType::kExpression);
+    EXPECT_THAT(result.items[0].dependencies, testing::ElementsAre("x", "y"));
+
+    result = engine.Parse("x *", ParseMode::kExpression);
+    EXPECT_EQ(result.items[0].type, ItemType::kError);
+    EXPECT_EQ(result.items[0].status, ResultStatus::kSyntaxError);
+}
+
+TEST(NativeEquationEngine, TestInterpret)
+{
+    auto &engine = NativeEquationEngine::GetInstance();
+    NativeEquationContext context;
+    context.Set("a", 3);
+    context.Set("v", std::vector<double>{1.0, 2.0, 3.0});
+
+    auto eval = [&](const std::string &code) { return engine.Interpret(code, &context, InterpretMode::kEval); };
+
+    EXPECT_EQ(eval("a * 2 + 1").value, Value(int64_t(7)));
+    EXPECT_EQ(eval("a / 2").value, Value(1.5));
+    EXPECT_EQ(eval("-7 // 2").value, Value(int64_t(-4)));
+    EXPECT_EQ(eval("-7 % 3").value, Value(int64_t(2)));
+    EXPECT_EQ(eval("1 // 0.1").value, Value(9.0));
+    EXPECT_EQ(eval("-2 ** 2").value, Value(int64_t(-4)));
+    EXPECT_EQ(eval("2 ** -1").value, Value(0.5));
+    EXPECT_EQ(eval("1 < a <= 3 and not a == 4").value, Value(true));
+    EXPECT_EQ(eval("0 or a").value, Value(int64_t(3)));
+    EXPECT_EQ(eval("v * 2 + [1, 1, 1]").value, Value(std::vector<double>{3.0, 5.0, 7.0}));
+    EXPECT_EQ(eval("sum(v) + len(v) + v[-1]").value, Value(12.0));
+    EXPECT_EQ(eval("max(a, 2.5)").value, Value(int64_t(3)));
+    EXPECT_EQ(eval("round(2.5) + floor(-0.5)").value, Value(int64_t(1)));
+    EXPECT_DOUBLE_EQ(eval("sqrt(16) + log(exp(1))").value.Cast<double>(), 5.0);
+
+    EXPECT_EQ(eval("a / 0").status, ResultStatus::kZeroDivisionError);
+    EXPECT_EQ(eval("b + 1").status, ResultStatus::kNameError);
+    EXPECT_EQ(eval("foo(a)").status, ResultStatus::kNameError);
+    EXPECT_EQ(eval("sqrt(a, a)").status, ResultStatus::kTypeError);
+    EXPECT_EQ(eval("v + [1, 2]").status, ResultStatus::kValueError);
+    EXPECT_EQ(eval("v[3]").status, ResultStatus::kIndexError);
+    EXPECT_EQ(eval("sqrt(-1)").status, ResultStatus::kValueError);
+    EXPECT_EQ(eval("9223372036854775807 + 1").status, ResultStatus::kOverflowError);
+    EXPECT_EQ(eval("a +").status, ResultStatus::kSyntaxError);
+    // ints beyond 2^53 are not rounded to double, Python computes them exactly
+    EXPECT_EQ(eval("9007199254740993 == 9007199254740992.0").status, ResultStatus::kOverflowError);
+    EXPECT_EQ(eval("(1073741825*1073741825) == 1152921506754330624.0").status, ResultStatus::kOverflowError);
+    EXPECT_EQ(eval("(94906267*94906267)/3").status, ResultStatus::kOverflowError);
+    EXPECT_EQ(eval("[9007199254740993]").status, ResultStatus::kOverflowError);
+    EXPECT_EQ(eval("9007199254740992 / 2").value, Value(4503599627370496.0));
+    EXPECT_EQ(eval("9007199254740993 == 9007199254740993").value, Value(true));
+
+    InterpretResult result = engine.Interpret("b = a + 1; c = b * v", &context, InterpretMode::kExec);
+    EXPECT_EQ(result.status, ResultStatus::kSuccess);
+    EXPECT_EQ(context.Get("b"), Value(int64_t(4)));
+    EXPECT_EQ(context.Get("c"), Value(std::vector<double>{4.0, 8.0, 12.0}));
+
+    // the compiled program is reused
+    size_t cache_size = engine.GetCompiledProgramCacheSize();
+    eval("a * 2 + 1");
+    EXPECT_EQ(engine.GetCompiledProgramCacheSize(), cache_size);
+
+    std::string data;
+    ASSERT_TRUE(context.SerializeValue("c", data));
+    ASSERT_TRUE(context.DeserializeValue("d", data));
+    EXPECT_EQ(context.Get("d"), context.Get("c"));
+}
+
+TEST(NativeEquationEngine, TestEquationManager)
+{
+    auto equation_manager = NativeEquationEngine::GetInstance().CreateEquationManager();
+    EXPECT_EQ(equation_manager->language(), "Native");
+
+    EquationGroupId id = equation_manager->AddEquationGroup(R"(
+a = 1
+b = 3
+c = [1, 2, 3]
+d = a + b * c
+e = sum(d) / len(d)
+)");
+    equation_manager->SetInterpretConcurrency(4);
+    equation_manager->Update();
+
+    EXPECT_EQ(equation_manager->context().Get("d"), Value(std::vector<double>{4.0, 7.0, 10.0}));
+    EXPECT_EQ(equation_manager->context().Get("e"), Value(7.0));
+
+    equation_manager->EditEquationGroup(id, R"(
+a = 1
+b = a / 0
+c = [1, 2, 3]
+d = a + b * c
+e = sum(d) / len(d)
+)");
+    equation_manager->Update();
+    EXPECT_EQ(equation_manager->GetEquation("b")->status(), ResultStatus::kZeroDivisionError);
+    EXPECT_NE(equation_manager->GetEquation("e")->status(), ResultStatus::kSuccess);
+}
+
+TEST(NativeEquationEngine, TestBatchInterpret)
+{
+    auto &engine = NativeEquationEngine::GetInstance();
+    auto equation_manager = engine.CreateEquationManager();
+
+    std::string code;
+    for (int i = 0; i < 8; i++)
+    {
+        std::string index = std::to_string(i);
+        code += "p" + index + " = " + std::to_string(i) + ".5\n";
+        code += "q" + index + " = 2.0\n";
+        code += "r" + index + " = -p" + index + " * q" + index + " + 1 / 4\n";
+    }
+    // same shape, but ints are computed one by one to keep int results
+    code += "m = 3\nn = 4\ns = -m * n + 1 / 4\n";
+    size_t batched = engine.batched_statement_count();
+    EquationGroupId id = equation_manager->AddEquationGroup(code);
+    equation_manager->Update();
+    EXPECT_GE(engine.batched_statement_count(), batched + 8);
+    for (int i = 0; i < 8; i++)
+    {
+        std::string index = std::to_string(i);
+        EXPECT_EQ(equation_manager->GetEquation("r" + index)->status(), ResultStatus::kSuccess);
+        EXPECT_EQ(equation_manager->context().Get("r" + index), Value(-(i + 0.5) * 2.0 + 0.25));
+    }
+    EXPECT_EQ(equation_manager->context().Get("s"), Value(-11.75));
+
+    // a failing equation makes the batch fall back, errors stay per equation
+    code += "z0 = 0.0\nz1 = 1.0\nz2 = 2.0\nz3 = 3.0\nw0 = p0 / z0\nw1 = p1 / z1\nw2 = p2 / z2\nw3 = p3 / z3\n";
+    equation_manager->EditEquationGroup(id, code);
+    equation_manager->Update();
+    EXPECT_EQ(equation_manager->GetEquation("w0")->status(), ResultStatus::kZeroDivisionError);
+    EXPECT_EQ(equation_manager->context().Get("w1"), Value(1.5));
+    EXPECT_EQ(equation_manager->context().Get("w3"), Value(3.5 / 3.0));
+}
@@ -1,11 +1,14 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <string>
+#include <thread>
 
 #include "core/equation.h"
 #include "core/equation_common.h"
+#include "core/equation_result_cache.h"
 #include "python/python_equation_context.h"
 #include "python/python_equation_engine.h"
+#include "python/python_sub_interpreter.h"
 
 using namespace xequation;
 using namespace xequation::python;
@@ -84,6 +87,139 @@ d=a+b*c
     obj = v.Cast<pybind11::object>();
     std::string path = obj.cast<std::string>();
     EXPECT_EQ(path, R"(home\user\documents\file.txt)");
+
+    std::vector<InterpretResult> results = equation_manager->EvalBatch({"a+b", "undefined_name"});
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].status, ResultStatus::kSuccess);
+    EXPECT_EQ(results[0].value.Cast<pybind11::object>().cast<int>(), 6);
+    EXPECT_EQ(results[1].status, ResultStatus::kNameError);
+}
+
+TEST(PythonEquationEngine, TestBuiltinNames)
+{
+    auto& engine = PythonEquationEngine::GetInstance();
+    pybind11::gil_scoped_acquire acquire;
+    auto equation_manager = engine.CreateEquationManager();
+    const auto &context = dynamic_cast<const PythonEquationContext &>(equation_manager->context());
+
+    auto names = context.GetBuiltinNames();
+    ASSERT_TRUE(names);
+    EXPECT_EQ(names->count("len"), 1);
+    EXPECT_EQ(context.GetBuiltinNames(), names);
+
+    // a replacement of the same size, only the dict identity tells it apart
+    pybind11::dict replaced = context.builtin_dict().attr("copy")().cast<pybind11::dict>();
+    replaced.attr("pop")("len");
+    replaced["my_len"] = pybind11::int_(0);
+    context.dict()["__builtins__"] = replaced;
+
+    auto replaced_names = context.GetBuiltinNames();
+    ASSERT_TRUE(replaced_names);
+    EXPECT_NE(replaced_names, names);
+    EXPECT_EQ(replaced_names->count("len"), 0);
+    EXPECT_EQ(replaced_names->count("my_len"), 1);
+}
+
+TEST(PythonEquationEngine, TestResultCacheWithImportAndFunction)
+{
+    auto& engine = PythonEquationEngine::GetInstance();
+    pybind11::gil_scoped_acquire acquire;
+    auto cache = std::make_shared<EquationResultCache>(testing::TempDir() + "python_engine_result_cache");
+    cache->Clear();
+    pybind11::module_ builtins = pybind11::module_::import("builtins");
+    builtins.attr("cached_calls") = 0;
+
+    // modules and functions defined by equations can not be pickled, the
+    // dependents are keyed by the import and def statements instead
+    const char *code = R"(
+import math
+def f(x):
+    import builtins
+    builtins.cached_calls += 1
+    return x * 2
+a = 3
+b = f(a) + math.floor(1.5)
+)";
+    {
+        auto equation_manager = engine.CreateEquationManager();
+        equation_manager->SetResultCache(cache);
+        equation_manager->AddEquationGroup(code);
+        equation_manager->Update();
+        EXPECT_EQ(equation_manager->GetEquation("b")->status(), ResultStatus::kSuccess);
+        EXPECT_EQ(builtins.attr("cached_calls").cast<int>(), 1);
+    }
+
+    auto equation_manager = engine.CreateEquationManager();
+    equation_manager->SetResultCache(cache);
+    equation_manager->AddEquationGroup(code);
+    equation_manager->Update();
+    EXPECT_EQ(equation_manager->context().Get("b").Cast<pybind11::object>().cast<int>(), 7);
+    EXPECT_EQ(builtins.attr("cached_calls").cast<int>(), 1);
+    cache->Clear();
+}
+
+TEST(PythonEquationEngine, TestAllocationTracking)
+{
+    auto& engine = PythonEquationEngine::GetInstance();
+    pybind11::gil_scoped_acquire acquire;
+    auto context = engine.CreateContext();
+    pybind11::module_ tracemalloc = pybind11::module_::import("tracemalloc");
+
+    // tracing started elsewhere keeps running
+    tracemalloc.attr("start")();
+    EXPECT_TRUE(context->SetAllocationTracking(true));
+    EXPECT_TRUE(context->SetAllocationTracking(false));
+    EXPECT_TRUE(tracemalloc.attr("is_tracing")().cast<bool>());
+    tracemalloc.attr("stop")();
+
+    // tracing the context started is stopped again
+    EXPECT_TRUE(context->SetAllocationTracking(true));
+    size_t bytes = 0;
+    EXPECT_TRUE(context->GetAllocatedMemory(bytes));
+    EXPECT_TRUE(context->SetAllocationTracking(false));
+    EXPECT_FALSE(tracemalloc.attr("is_tracing")().cast<bool>());
+}
+
+TEST(PythonEquationEngine, TestIsolatedEquationManager)
+{
+    auto& engine = PythonEquationEngine::GetInstance();
+    if (!PythonSubInterpreter::IsSupported())
+    {
+        GTEST_SKIP() << "Python sub-interpreters are not supported";
+    }
+
+    auto manager_0 = engine.CreateIsolatedEquationManager();
+    auto manager_1 = engine.CreateIsolatedEquationManager();
+    manager_0->AddEquationGroup("a=1\nb=a*2");
+    manager_1->AddEquationGroup("a=10\nb=a*3");
+
+    std::thread thread_0([&manager_0]() { manager_0->Update(); });
+    std::thread thread_1([&manager_1]() { manager_1->Update(); });
+    thread_0.join();
+    thread_1.join();
+
+    auto read_int = [](EquationManager &manager, const char *name) -> int {
+        const auto &context = dynamic_cast<const PythonEquationContext &>(manager.context());
+        EXPECT_NE(context.interpreter(), nullptr);
+        PythonInterpreterLock lock(context.interpreter());
+        return context.dict()[name].cast<int>();
+    };
+    EXPECT_EQ(read_int(*manager_0, "b"), 2);
+    EXPECT_EQ(read_int(*manager_1, "b"), 30);
+
+    // the batch runs in the interpreter of the manager
+    std::vector<InterpretResult> results = manager_1->EvalBatch({"a+1", "b*2"});
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].status, ResultStatus::kSuccess);
+    EXPECT_EQ(results[1].status, ResultStatus::kSuccess);
+    {
+        const auto &context = dynamic_cast<const PythonEquationContext &>(manager_1->context());
+        PythonInterpreterLock lock(context.interpreter());
+        EXPECT_EQ(results[0].value.Cast<pybind11::object>().cast<int>(), 11);
+        EXPECT_EQ(results[1].value.Cast<pybind11::object>().cast<int>(), 60);
+        // the values belong to the interpreter, release them under its lock
+        results.clear();
+    }
 }
 
 int main(int argc, char **argv) {
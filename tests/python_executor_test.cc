@@ -335,6 +335,182 @@ TEST_F(PythonExecutorTest, EvalReturnTypes) {
   EXPECT_EQ(pybind11::cast<std::string>(dict["key"]), "value");
 }
 
+TEST_F(PythonExecutorTest, CompiledExpressionCache) {
+  pybind11::dict locals;
+  locals["x"] = 1;
+
+  auto result1 = executor_->Eval("x + 1", locals);
+  EXPECT_EQ(result1.status, ResultStatus::kSuccess);
+  EXPECT_EQ(pybind11::cast<int>(result1.value.Cast<pybind11::object>()), 2);
+  EXPECT_EQ(executor_->GetCompiledExpressionCacheSize(), 1u);
+
+  locals["x"] = 10;
+  auto result2 = executor_->Eval("x + 1", locals);
+  EXPECT_EQ(result2.status, ResultStatus::kSuccess);
+  EXPECT_EQ(pybind11::cast<int>(result2.value.Cast<pybind11::object>()), 11);
+  EXPECT_EQ(executor_->GetCompiledExpressionCacheSize(), 1u);
+
+  auto result3 = executor_->Eval("x * 2", locals);
+  EXPECT_EQ(result3.status, ResultStatus::kSuccess);
+  EXPECT_EQ(executor_->GetCompiledExpressionCacheSize(), 2u);
+
+  auto result4 = executor_->Eval("x +", locals);
+  EXPECT_EQ(result4.status, ResultStatus::kSyntaxError);
+  EXPECT_EQ(executor_->GetCompiledExpressionCacheSize(), 2u);
+}
+
+TEST_F(PythonExecutorTest, ArithmeticFastPath) {
+  pybind11::dict locals;
+  locals["a"] = 2;
+  locals["b"] = 3.5;
+  locals["c"] = 1;
+
+  auto result1 = executor_->Exec("x = a * b + c / 2", locals);
+  EXPECT_EQ(result1.status, ResultStatus::kSuccess);
+  EXPECT_EQ(pybind11::cast<double>(locals["x"]), 7.5);
+  EXPECT_EQ(executor_->GetArithmeticFastPathCacheSize(), 1u);
+
+  auto result2 = executor_->Exec("f = 1 // 0.1 + -7 % 3", locals);
+  EXPECT_EQ(result2.status, ResultStatus::kSuccess);
+  EXPECT_TRUE(pybind11::isinstance<pybind11::float_>(locals["f"]));
+  EXPECT_EQ(pybind11::cast<double>(locals["f"]), 11.0);
+
+  auto result3 = executor_->Exec("t = a < b and not c", locals);
+  EXPECT_EQ(result3.status, ResultStatus::kSuccess);
+  EXPECT_TRUE(pybind11::isinstance<pybind11::bool_>(locals["t"]));
+  EXPECT_FALSE(pybind11::cast<bool>(locals["t"]));
+
+  // int overflow, errors and other types are left to the interpreter
+  auto result4 = executor_->Exec("y = a ** 100", locals);
+  EXPECT_EQ(result4.status, ResultStatus::kSuccess);
+  EXPECT_EQ(pybind11::str(locals["y"]).cast<std::string>(), "1267650600228229401496703205376");
+
+  auto result5 = executor_->Exec("z = a / (c - 1)", locals);
+  EXPECT_EQ(result5.status, ResultStatus::kZeroDivisionError);
+  EXPECT_FALSE(result5.message.empty());
+  EXPECT_FALSE(locals.contains("z"));
+
+  locals["s"] = "text";
+  auto result6 = executor_->Exec("w = s * a", locals);
+  EXPECT_EQ(result6.status, ResultStatus::kSuccess);
+  EXPECT_EQ(pybind11::cast<std::string>(locals["w"]), "texttext");
+
+  // ints beyond 2^53 computed in the code are not rounded to double either
+  auto result8 = executor_->Exec(
+      "e1 = 9007199254740993 == 9007199254740992.0\n"
+      "e2 = (1073741825*1073741825) == 1152921506754330624.0\n"
+      "e3 = (94906267*94906267)/3",
+      locals);
+  EXPECT_EQ(result8.status, ResultStatus::kSuccess);
+  EXPECT_FALSE(pybind11::cast<bool>(locals["e1"]));
+  EXPECT_FALSE(pybind11::cast<bool>(locals["e2"]));
+  EXPECT_EQ(pybind11::cast<double>(locals["e3"]), 3002399838625096.5);
+
+  executor_->SetArithmeticFastPathEnabled(false);
+  auto result7 = executor_->Exec("v = a + c", locals);
+  EXPECT_EQ(result7.status, ResultStatus::kSuccess);
+  EXPECT_EQ(pybind11::cast<int>(locals["v"]), 3);
+  EXPECT_EQ(executor_->GetArithmeticFastPathCacheSize(), 7u);
+}
+
+TEST_F(PythonExecutorTest, InterruptScope)
+{
+  pybind11::dict locals;
+  pybind11::dict other_locals;
+  PythonExecutor *executor = executor_.get();
+  // borrowed, the functions live in the dicts they interrupt
+  pybind11::handle self = locals;
+  pybind11::handle other = other_locals;
+  locals["interrupt_self"] = pybind11::cpp_function([executor, self]() {
+    executor->Interrupt(pybind11::reinterpret_borrow<pybind11::dict>(self));
+  });
+  locals["interrupt_other"] = pybind11::cpp_function([executor, other]() {
+    executor->Interrupt(pybind11::reinterpret_borrow<pybind11::dict>(other));
+  });
+
+  // calls in other dicts go on
+  auto result = executor_->Exec("interrupt_other()\nx = sum(range(1000))", locals);
+  EXPECT_EQ(result.status, ResultStatus::kSuccess);
+  EXPECT_EQ(pybind11::cast<int>(locals["x"]), 499500);
+
+  auto result2 = executor_->Exec("interrupt_self()\nx = sum(range(10))\ny = 1", locals);
+  EXPECT_EQ(result2.status, ResultStatus::kKeyBoardInterrupt);
+  EXPECT_FALSE(locals.contains("y"));
+}
+
+TEST_F(PythonExecutorTest, BudgetKeepsTracer)
+{
+  ExecutionBudget budget;
+  budget.wall_time_ms = 10000;
+  executor_->SetExecutionBudget(budget);
+
+  // a tracer set like a debugger does
+  pybind11::dict scope;
+  pybind11::exec("events = []\ndef tracer(frame, event, arg):\n    events.append(event)\n    return tracer\n", scope);
+  pybind11::module_ sys = pybind11::module_::import("sys");
+  sys.attr("settrace")(scope["tracer"]);
+
+  pybind11::dict locals;
+  auto result = executor_->Exec("def f():\n    return 1\nx = f()", locals);
+  pybind11::object tracer_after = sys.attr("gettrace")();
+  sys.attr("settrace")(pybind11::none());
+
+  EXPECT_EQ(result.status, ResultStatus::kSuccess);
+  EXPECT_EQ(pybind11::cast<int>(locals["x"]), 1);
+  // the tracer saw the call and is installed again afterwards
+  EXPECT_GT(pybind11::len(scope["events"]), 0u);
+  EXPECT_TRUE(tracer_after.is(scope["tracer"]));
+}
+
+TEST_F(PythonExecutorTest, ErrorRecord)
+{
+  pybind11::dict locals;
+  locals["a"] = 1;
+  auto result = executor_->Exec("b = a + 1\nc = b / 0", locals);
+  EXPECT_EQ(result.status, ResultStatus::kZeroDivisionError);
+  ASSERT_TRUE(result.error);
+  EXPECT_EQ(result.error->type, "ZeroDivisionError");
+  EXPECT_EQ(result.error->message, result.message);
+  EXPECT_EQ(result.error->line, 2);
+  // the frames are copied when the error is captured
+  std::vector<ErrorFrame> frames = result.error->GetFrames();
+  ASSERT_FALSE(frames.empty());
+  EXPECT_EQ(frames.back().file, "<string>");
+  EXPECT_EQ(frames.back().line, 2);
+  EXPECT_EQ(result.error->GetFrames().size(), frames.size());
+  EXPECT_NE(result.error->FormatTraceback().find("line 2"), std::string::npos);
+
+  auto result2 = executor_->Exec("d = (", locals);
+  EXPECT_EQ(result2.status, ResultStatus::kSyntaxError);
+  ASSERT_TRUE(result2.error);
+  EXPECT_EQ(result2.error->line, 1);
+
+  auto result3 = executor_->Eval("undefined_name + 1", locals);
+  EXPECT_EQ(result3.status, ResultStatus::kNameError);
+  EXPECT_EQ(result3.message, "name 'undefined_name' is not defined");
+
+  auto result4 = executor_->Exec("e = 1", locals);
+  EXPECT_EQ(result4.status, ResultStatus::kSuccess);
+  EXPECT_FALSE(result4.error);
+
+  // the record does not keep the locals of the failed frames alive
+  locals["refs"] = pybind11::list();
+  auto result5 = executor_->Exec(
+      "import weakref\n"
+      "class Marker: pass\n"
+      "def fail():\n"
+      "    marker = Marker()\n"
+      "    refs.append(weakref.ref(marker))\n"
+      "    1 / 0\n"
+      "fail()",
+      locals);
+  EXPECT_EQ(result5.status, ResultStatus::kZeroDivisionError);
+  ASSERT_TRUE(result5.error);
+  EXPECT_EQ(result5.error->GetFrames().back().function, "fail");
+  pybind11::module_::import("gc").attr("collect")();
+  EXPECT_TRUE(locals["refs"].cast<pybind11::list>()[0]().is_none());
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);